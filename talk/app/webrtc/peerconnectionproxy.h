@@ -33,7 +33,17 @@
 
 namespace webrtc {
 
+// Keep the observer alive while an async SetLocal/RemoteDescription is
+// queued; callers commonly pass a freshly created, unreferenced one.
+template <>
+struct AsyncArg<SetSessionDescriptionObserver*> {
+  typedef talk_base::scoped_refptr<SetSessionDescriptionObserver> type;
+};
+
 // Define proxy for PeerConnectionInterface.
+// SetLocalDescription and SetRemoteDescription take ownership of the
+// description and report back through the observer, so they are pipelined
+// to the signaling thread instead of blocking the caller.
 BEGIN_PROXY_MAP(PeerConnection)
   PROXY_METHOD0(talk_base::scoped_refptr<StreamCollectionInterface>,
                 local_streams)
@@ -53,10 +63,10 @@ BEGIN_PROXY_MAP(PeerConnection)
                 const MediaConstraintsInterface*)
   PROXY_METHOD2(void, CreateAnswer, CreateSessionDescriptionObserver*,
                 const MediaConstraintsInterface*)
-  PROXY_METHOD2(void, SetLocalDescription, SetSessionDescriptionObserver*,
-                SessionDescriptionInterface*)
-  PROXY_METHOD2(void, SetRemoteDescription, SetSessionDescriptionObserver*,
-                SessionDescriptionInterface*)
+  PROXY_ASYNC_METHOD2(SetLocalDescription, SetSessionDescriptionObserver*,
+                      SessionDescriptionInterface*)
+  PROXY_ASYNC_METHOD2(SetRemoteDescription, SetSessionDescriptionObserver*,
+                      SessionDescriptionInterface*)
   PROXY_METHOD2(bool, UpdateIce, const IceServers&,
                 const MediaConstraintsInterface*)
   PROXY_METHOD1(bool, AddIceCandidate, const IceCandidateInterface*)
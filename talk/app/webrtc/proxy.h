@@ -51,10 +51,19 @@
 // END_PROXY()
 //
 // The proxy can be created using TestProxy::Create(Thread*, TestInterface*).
+//
+// Methods returning void can instead be declared with PROXY_ASYNC_METHODn,
+// which posts the call to the owner thread with Thread::InvokeAsync and
+// returns at once rather than blocking on a Send. Async calls run in the
+// order they were made, and any later synchronous call through the same proxy
+// waits for them first, so callers still observe program order. Arguments are
+// copied, but whatever they point to must stay valid until the call runs;
+// specialize AsyncArg to hold such an argument by reference count instead.
 
 #ifndef TALK_APP_WEBRTC_PROXY_H_
 #define TALK_APP_WEBRTC_PROXY_H_
 
+#include "talk/base/criticalsection.h"
 #include "talk/base/thread.h"
 
 namespace webrtc {
@@ -220,6 +229,54 @@ class MethodCall3 : public talk_base::Message,
   T3 a3_;
 };
 
+// How an argument of type T is stored while an async call is in flight.
+template <typename T>
+struct AsyncArg { typedef T type; };
+template <typename T>
+struct AsyncArg<const T&> { typedef T type; };
+
+// Functors run by Thread::InvokeAsync for PROXY_ASYNC_METHODn. Unlike
+// MethodCallN they outlive the proxy method, so arguments are held by value.
+template <typename C>
+class AsyncMethodCall0 {
+ public:
+  typedef void (C::*Method)();
+  AsyncMethodCall0(C* c, Method m) : c_(c), m_(m) {}
+  void operator()() const { (c_->*m_)(); }
+
+ private:
+  C* c_;
+  Method m_;
+};
+
+template <typename C, typename T1>
+class AsyncMethodCall1 {
+ public:
+  typedef void (C::*Method)(T1 a1);
+  AsyncMethodCall1(C* c, Method m, T1 a1) : c_(c), m_(m), a1_(a1) {}
+  void operator()() const { (c_->*m_)(a1_); }
+
+ private:
+  C* c_;
+  Method m_;
+  typename AsyncArg<T1>::type a1_;
+};
+
+template <typename C, typename T1, typename T2>
+class AsyncMethodCall2 {
+ public:
+  typedef void (C::*Method)(T1 a1, T2 a2);
+  AsyncMethodCall2(C* c, Method m, T1 a1, T2 a2)
+      : c_(c), m_(m), a1_(a1), a2_(a2) {}
+  void operator()() const { (c_->*m_)(a1_, a2_); }
+
+ private:
+  C* c_;
+  Method m_;
+  typename AsyncArg<T1>::type a1_;
+  typename AsyncArg<T2>::type a2_;
+};
+
 #define BEGIN_PROXY_MAP(c) \
   class c##Proxy : public c##Interface {\
    protected:\
@@ -228,6 +285,7 @@ class MethodCall3 : public talk_base::Message,
       : owner_thread_(thread), \
         c_(c)  {}\
     ~c##Proxy() {\
+      WaitForAsyncCalls();\
       MethodCall0<c##Proxy, void> call(this, &c##Proxy::Release_s);\
       call.Marshal(owner_thread_);\
     }\
@@ -240,46 +298,96 @@ class MethodCall3 : public talk_base::Message,
 #define PROXY_METHOD0(r, method)\
     r method() OVERRIDE {\
       MethodCall0<C, r> call(c_.get(), &C::method);\
+      WaitForAsyncCalls();\
       return call.Marshal(owner_thread_);\
     }\
 
 #define PROXY_CONSTMETHOD0(r, method)\
     r method() const OVERRIDE {\
       ConstMethodCall0<C, r> call(c_.get(), &C::method);\
+      WaitForAsyncCalls();\
       return call.Marshal(owner_thread_);\
      }\
 
 #define PROXY_METHOD1(r, method, t1)\
     r method(t1 a1) OVERRIDE {\
       MethodCall1<C, r, t1> call(c_.get(), &C::method, a1);\
+      WaitForAsyncCalls();\
       return call.Marshal(owner_thread_);\
     }\
 
 #define PROXY_CONSTMETHOD1(r, method, t1)\
     r method(t1 a1) const OVERRIDE {\
       ConstMethodCall1<C, r, t1> call(c_.get(), &C::method, a1);\
+      WaitForAsyncCalls();\
       return call.Marshal(owner_thread_);\
     }\
 
 #define PROXY_METHOD2(r, method, t1, t2)\
     r method(t1 a1, t2 a2) OVERRIDE {\
       MethodCall2<C, r, t1, t2> call(c_.get(), &C::method, a1, a2);\
+      WaitForAsyncCalls();\
       return call.Marshal(owner_thread_);\
     }\
 
 #define PROXY_METHOD3(r, method, t1, t2, t3)\
     r method(t1 a1, t2 a2, t3 a3) OVERRIDE {\
       MethodCall3<C, r, t1, t2, t3> call(c_.get(), &C::method, a1, a2, a3);\
+      WaitForAsyncCalls();\
       return call.Marshal(owner_thread_);\
     }\
 
+#define PROXY_ASYNC_METHOD0(method)\
+    void method() OVERRIDE {\
+      AsyncMethodCall0<C> call(c_.get(), &C::method);\
+      AddAsyncCall(owner_thread_->InvokeAsync<void>(call));\
+    }\
+
+#define PROXY_ASYNC_METHOD1(method, t1)\
+    void method(t1 a1) OVERRIDE {\
+      AsyncMethodCall1<C, t1> call(c_.get(), &C::method, a1);\
+      AddAsyncCall(owner_thread_->InvokeAsync<void>(call));\
+    }\
+
+#define PROXY_ASYNC_METHOD2(method, t1, t2)\
+    void method(t1 a1, t2 a2) OVERRIDE {\
+      AsyncMethodCall2<C, t1, t2> call(c_.get(), &C::method, a1, a2);\
+      AddAsyncCall(owner_thread_->InvokeAsync<void>(call));\
+    }\
+
 #define END_PROXY() \
    private:\
     void Release_s() {\
       c_ = NULL;\
     }\
+    void AddAsyncCall(\
+        const talk_base::scoped_refptr<talk_base::AsyncResult<void> >& call) {\
+      talk_base::CritScope cs(&async_crit_);\
+      last_async_call_ = call;\
+    }\
+    /* Async calls complete in order, so waiting for the last is enough. */\
+    /* On the owner thread calls run in place; queued ones can't be awaited. */\
+    void WaitForAsyncCalls() const {\
+      if (owner_thread_->IsCurrent()) {\
+        return;\
+      }\
+      talk_base::scoped_refptr<talk_base::AsyncResult<void> > call;\
+      {\
+        talk_base::CritScope cs(&async_crit_);\
+        if (last_async_call_ && last_async_call_->done()) {\
+          last_async_call_ = NULL;\
+        }\
+        call = last_async_call_;\
+      }\
+      if (call) {\
+        call->Wait();\
+      }\
+    }\
     mutable talk_base::Thread* owner_thread_;\
     talk_base::scoped_refptr<C> c_;\
+    mutable talk_base::CriticalSection async_crit_;\
+    mutable talk_base::scoped_refptr<talk_base::AsyncResult<void> >\
+        last_async_call_;\
   };\
 
 }  // namespace webrtc
@@ -32,12 +32,14 @@
 #include "talk/base/refcount.h"
 #include "talk/base/scoped_ptr.h"
 #include "talk/base/thread.h"
+#include "talk/base/timeutils.h"
 #include "talk/base/gunit.h"
 #include "testing/base/public/gmock.h"
 
 using ::testing::_;
 using ::testing::DoAll;
 using ::testing::Exactly;
+using ::testing::InSequence;
 using ::testing::InvokeWithoutArgs;
 using ::testing::Return;
 
@@ -52,6 +54,7 @@ class FakeInterface : public talk_base::RefCountInterface {
   virtual std::string Method1(std::string s) = 0;
   virtual std::string ConstMethod1(std::string s) const = 0;
   virtual std::string Method2(std::string s1, std::string s2) = 0;
+  virtual void AsyncMethod1(const std::string& s) = 0;
 
  protected:
   ~FakeInterface() {}
@@ -65,6 +68,7 @@ BEGIN_PROXY_MAP(Fake)
   PROXY_METHOD1(std::string, Method1, std::string)
   PROXY_CONSTMETHOD1(std::string, ConstMethod1, std::string)
   PROXY_METHOD2(std::string, Method2, std::string, std::string)
+  PROXY_ASYNC_METHOD1(AsyncMethod1, const std::string&)
 END_PROXY()
 
 // Implementation of the test interface.
@@ -83,6 +87,8 @@ class Fake : public FakeInterface {
 
   MOCK_METHOD2(Method2, std::string(std::string, std::string));
 
+  MOCK_METHOD1(AsyncMethod1, void(const std::string&));
+
  protected:
   Fake() {}
   ~Fake() {}
@@ -167,4 +173,84 @@ TEST_F(ProxyTest, Method2) {
   EXPECT_EQ("Method2", fake_proxy_->Method2(arg1, arg2));
 }
 
+TEST_F(ProxyTest, AsyncMethod1) {
+  EXPECT_CALL(*fake_, AsyncMethod1("arg1"))
+            .Times(Exactly(1))
+            .WillOnce(InvokeWithoutArgs(this, &ProxyTest::CheckThread));
+  // The argument must be copied; this temporary is gone before the call runs.
+  fake_proxy_->AsyncMethod1(std::string("arg1"));
+  fake_proxy_ = NULL;
+}
+
+TEST_F(ProxyTest, SyncMethodWaitsForAsyncMethods) {
+  InSequence seq;
+  EXPECT_CALL(*fake_, AsyncMethod1("first"));
+  EXPECT_CALL(*fake_, AsyncMethod1("second"));
+  EXPECT_CALL(*fake_, Method0()).WillOnce(Return("Method0"));
+  fake_proxy_->AsyncMethod1("first");
+  fake_proxy_->AsyncMethod1("second");
+  EXPECT_EQ("Method0", fake_proxy_->Method0());
+}
+
+// Stand-in for the offer half of PeerConnectionInterface, proxied once with
+// a blocking SetLocalDescription and once with a pipelined one.
+class SessionInterface : public talk_base::RefCountInterface {
+ public:
+  virtual std::string CreateOffer() = 0;
+  virtual void SetLocalDescription(const std::string& sdp) = 0;
+  virtual std::string local_description() const = 0;
+
+ protected:
+  ~SessionInterface() {}
+};
+typedef SessionInterface AsyncSessionInterface;
+
+BEGIN_PROXY_MAP(Session)
+  PROXY_METHOD0(std::string, CreateOffer)
+  PROXY_METHOD1(void, SetLocalDescription, const std::string&)
+  PROXY_CONSTMETHOD0(std::string, local_description)
+END_PROXY()
+
+BEGIN_PROXY_MAP(AsyncSession)
+  PROXY_METHOD0(std::string, CreateOffer)
+  PROXY_ASYNC_METHOD1(SetLocalDescription, const std::string&)
+  PROXY_CONSTMETHOD0(std::string, local_description)
+END_PROXY()
+
+class Session : public SessionInterface {
+ public:
+  virtual std::string CreateOffer() { return "v=0"; }
+  virtual void SetLocalDescription(const std::string& sdp) {
+    local_description_ = sdp;
+  }
+  virtual std::string local_description() const { return local_description_; }
+
+ private:
+  std::string local_description_;
+};
+
+// Time spent by the caller per CreateOffer/SetLocalDescription sequence.
+TEST(ProxyBenchmark, DISABLED_CreateOfferSetLocalDescription) {
+  const int kSequences = 50000;
+  talk_base::Thread signaling_thread;
+  signaling_thread.Start();
+  talk_base::scoped_refptr<SessionInterface> session(
+      new talk_base::RefCountedObject<Session>());
+  talk_base::scoped_refptr<SessionInterface> proxies[] = {
+    SessionProxy::Create(&signaling_thread, session.get()),
+    AsyncSessionProxy::Create(&signaling_thread, session.get()),
+  };
+  const char* names[] = { "sync", "async" };
+  for (int i = 0; i < 2; ++i) {
+    uint64 start = talk_base::TimeNanos();
+    for (int j = 0; j < kSequences; ++j) {
+      proxies[i]->SetLocalDescription(proxies[i]->CreateOffer());
+    }
+    uint64 elapsed = talk_base::TimeNanos() - start;
+    EXPECT_EQ("v=0", proxies[i]->local_description());
+    LOG(LS_INFO) << names[i] << " SetLocalDescription: "
+                 << elapsed / kSequences << "ns per sequence";
+  }
+}
+
 }  // namespace webrtc
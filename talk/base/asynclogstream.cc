@@ -0,0 +1,295 @@
+/*
+ * libjingle
+ * Copyright 2013, Google Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "talk/base/asynclogstream.h"
+
+#include <string.h>
+
+#include "talk/base/common.h"
+
+namespace talk_base {
+
+// Messages are handed to the target in batches of about this many bytes.
+static const size_t kBatchSize = 64 * 1024;
+
+struct AsyncLogStream::Record {
+  static const size_t kDataSize = kRecordSize - 8;
+
+  uint32 sequence;
+  uint16 length;
+  // Non-zero if the message continues in the next record.
+  uint8 continued;
+  uint8 padding;
+  char data[kDataSize];
+};
+
+// A single-producer, single-consumer ring. |head| is only advanced by the
+// thread that owns the ring, once a whole message has been copied in, and
+// |tail| only by whoever is draining. One slot is always left empty so that
+// head == tail means the ring is empty.
+struct AsyncLogStream::Ring {
+  explicit Ring(size_t size)
+      : records(new Record[size]), size(static_cast<int>(size)),
+        head(0), tail(0), queued(0), dropped(0) {
+  }
+
+  int Used() const {
+    int used = AtomicOps::AcquireLoad(&head) - AtomicOps::AcquireLoad(&tail);
+    return (used < 0) ? used + size : used;
+  }
+  int Free() const { return size - 1 - Used(); }
+
+  scoped_array<Record> records;
+  const int size;
+  volatile int head;
+  volatile int tail;
+  // Only written by the owning thread.
+  volatile int queued;
+  volatile int dropped;
+};
+
+AsyncLogStream::AsyncLogStream(StreamInterface* target,
+                               size_t records_per_thread,
+                               FullPolicy policy)
+    : target_(target),
+      records_per_thread_(_max<size_t>(records_per_thread, 2)),
+      policy_(policy),
+      written_(0),
+      next_sequence_(1),
+      sequence_(0),
+      stopping_(0),
+      wake_(false, false) {
+#if defined(WIN32)
+  key_ = TlsAlloc();
+#elif defined(POSIX)
+  pthread_key_create(&key_, NULL);
+#endif
+  batch_.reserve(kBatchSize + kRecordSize);
+  writer_.SetName("AsyncLogStream", this);
+  writer_.Start(this);
+}
+
+AsyncLogStream::~AsyncLogStream() {
+  Stop();
+  Drain();
+#if defined(WIN32)
+  TlsFree(key_);
+#elif defined(POSIX)
+  pthread_key_delete(key_);
+#endif
+  for (size_t i = 0; i < rings_.size(); ++i) {
+    delete rings_[i];
+  }
+}
+
+int AsyncLogStream::queued_messages() const {
+  CritScope cs(&rings_crit_);
+  int queued = 0;
+  for (size_t i = 0; i < rings_.size(); ++i) {
+    queued += rings_[i]->queued;
+  }
+  return queued;
+}
+
+int AsyncLogStream::written_messages() const {
+  return AtomicOps::AcquireLoad(&written_);
+}
+
+int AsyncLogStream::dropped_messages() const {
+  CritScope cs(&rings_crit_);
+  int dropped = 0;
+  for (size_t i = 0; i < rings_.size(); ++i) {
+    dropped += rings_[i]->dropped;
+  }
+  return dropped;
+}
+
+StreamState AsyncLogStream::GetState() const {
+  return target_->GetState();
+}
+
+StreamResult AsyncLogStream::Read(void* buffer, size_t buffer_len,
+                                  size_t* read, int* error) {
+  return SR_EOS;
+}
+
+StreamResult AsyncLogStream::Write(const void* data, size_t data_len,
+                                   size_t* written, int* error) {
+  // Dropped messages are still reported as written, since LogMessage has
+  // nothing useful to do with a failure.
+  if (written)
+    *written = data_len;
+
+  Ring* ring = CurrentRing();
+  int needed = static_cast<int>(
+      _max<size_t>((data_len + Record::kDataSize - 1) / Record::kDataSize, 1));
+  if (needed >= ring->size) {
+    // Could never fit, whatever the policy.
+    ring->dropped = ring->dropped + 1;
+    return SR_SUCCESS;
+  }
+  while (ring->Free() < needed) {
+    if (policy_ == DROP_WHEN_FULL || AtomicOps::AcquireLoad(&stopping_)) {
+      ring->dropped = ring->dropped + 1;
+      wake_.Set();
+      return SR_SUCCESS;
+    }
+    wake_.Set();
+    Thread::SleepMs(1);
+  }
+
+  // The drainer writes messages strictly in sequence order, so nothing may
+  // fail between taking a sequence number and publishing the message.
+  uint32 sequence = static_cast<uint32>(AtomicOps::Increment(&sequence_));
+  const char* bytes = static_cast<const char*>(data);
+  int head = ring->head;
+  for (int i = 0; i < needed; ++i) {
+    Record* record = &ring->records[head];
+    size_t length = _min(data_len, Record::kDataSize);
+    record->sequence = sequence;
+    record->length = static_cast<uint16>(length);
+    record->continued = (i + 1 < needed);
+    memcpy(record->data, bytes, length);
+    bytes += length;
+    data_len -= length;
+    head = (head + 1 == ring->size) ? 0 : head + 1;
+  }
+  AtomicOps::ReleaseStore(&ring->head, head);
+  ring->queued = ring->queued + 1;
+
+  // Don't wait for the next periodic flush if the ring is filling up.
+  if (ring->Used() > ring->size / 2)
+    wake_.Set();
+  return SR_SUCCESS;
+}
+
+void AsyncLogStream::Close() {
+  Stop();
+  Drain();
+  target_->Close();
+}
+
+bool AsyncLogStream::Flush() {
+  Drain();
+  target_->Flush();
+  return true;
+}
+
+void AsyncLogStream::Run(Thread* thread) {
+  while (!AtomicOps::AcquireLoad(&stopping_)) {
+    wake_.Wait(kFlushIntervalMs);
+    Drain();
+  }
+}
+
+AsyncLogStream::Ring* AsyncLogStream::CurrentRing() {
+#if defined(WIN32)
+  Ring* ring = static_cast<Ring*>(TlsGetValue(key_));
+#elif defined(POSIX)
+  Ring* ring = static_cast<Ring*>(pthread_getspecific(key_));
+#endif
+  if (!ring) {
+    ring = new Ring(records_per_thread_);
+#if defined(WIN32)
+    TlsSetValue(key_, ring);
+#elif defined(POSIX)
+    pthread_setspecific(key_, ring);
+#endif
+    CritScope cs(&rings_crit_);
+    rings_.push_back(ring);
+  }
+  return ring;
+}
+
+void AsyncLogStream::Drain() {
+  CritScope cs(&drain_crit_);
+  std::vector<Ring*> rings;
+  {
+    CritScope cs(&rings_crit_);
+    rings = rings_;
+  }
+
+  int written = 0;
+  for (;;) {
+    // Pick the oldest message at the front of any ring, so lines from
+    // different threads come out in the order they were logged.
+    Ring* oldest = NULL;
+    for (size_t i = 0; i < rings.size(); ++i) {
+      Ring* ring = rings[i];
+      if (ring->Used() == 0)
+        continue;
+      if (!oldest || static_cast<int32>(
+              ring->records[ring->tail].sequence -
+              oldest->records[oldest->tail].sequence) < 0) {
+        oldest = ring;
+      }
+    }
+    if (!oldest)
+      break;
+    // A thread takes its sequence number before copying the message into its
+    // ring, so an older message may still be on its way in. Its writer is
+    // only copying memory by now, so wait for it rather than write a newer
+    // message ahead of it. The ring may also be one registered since |rings|
+    // was copied, so copy the list again.
+    if (oldest->records[oldest->tail].sequence != next_sequence_) {
+      Thread::SleepMs(0);
+      CritScope cs(&rings_crit_);
+      rings = rings_;
+      continue;
+    }
+
+    int tail = oldest->tail;
+    const Record* record;
+    do {
+      record = &oldest->records[tail];
+      batch_.append(record->data, record->length);
+      tail = (tail + 1 == oldest->size) ? 0 : tail + 1;
+    } while (record->continued);
+    AtomicOps::ReleaseStore(&oldest->tail, tail);
+    ++next_sequence_;
+    ++written;
+
+    if (batch_.size() >= kBatchSize) {
+      target_->WriteAll(batch_.data(), batch_.size(), NULL, NULL);
+      batch_.clear();
+    }
+  }
+  if (!batch_.empty()) {
+    target_->WriteAll(batch_.data(), batch_.size(), NULL, NULL);
+    batch_.clear();
+  }
+  AtomicOps::ReleaseStore(&written_, written_ + written);
+}
+
+void AsyncLogStream::Stop() {
+  AtomicOps::ReleaseStore(&stopping_, 1);
+  wake_.Set();
+  writer_.Stop();
+}
+
+}  // namespace talk_base
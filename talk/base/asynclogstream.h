@@ -0,0 +1,143 @@
+/*
+ * libjingle
+ * Copyright 2013, Google Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef TALK_BASE_ASYNCLOGSTREAM_H_
+#define TALK_BASE_ASYNCLOGSTREAM_H_
+
+#if defined(POSIX)
+#include <pthread.h>
+#endif
+
+#include <string>
+#include <vector>
+
+#include "talk/base/basictypes.h"
+#include "talk/base/constructormagic.h"
+#include "talk/base/criticalsection.h"
+#include "talk/base/event.h"
+#include "talk/base/scoped_ptr.h"
+#include "talk/base/stream.h"
+#include "talk/base/thread.h"
+
+namespace talk_base {
+
+// A log stream that moves the actual writing off the logging thread. Wrap a
+// slow stream, such as a log file, in one of these before handing it to
+// LogMessage::AddLogToStream:
+//   LogMessage::AddLogToStream(new AsyncLogStream(file, 1024,
+//       AsyncLogStream::DROP_WHEN_FULL), LS_INFO);
+//
+// Each thread that logs gets its own single-producer ring of fixed-size
+// records, so Write() only copies the already formatted message into that
+// ring; it takes no locks after the thread's first message. A dedicated
+// writer thread wakes up periodically, or when a ring is filling up, merges
+// the rings in the order Write() was called and passes them to the
+// wrapped stream in large batches. Rings are kept until the stream is
+// destroyed, so this suits long-lived threads rather than many short ones.
+class AsyncLogStream : public StreamInterface, public Runnable {
+ public:
+  // What Write() does when the calling thread's ring has no room.
+  enum FullPolicy {
+    DROP_WHEN_FULL,   // Discard the message and count it as dropped.
+    BLOCK_WHEN_FULL   // Wait for the writer thread to make room.
+  };
+
+  static const size_t kRecordSize = 256;
+  static const int kFlushIntervalMs = 50;
+
+  // Takes ownership of |target|. |records_per_thread| is the ring size for
+  // each logging thread; messages longer than a record use several.
+  AsyncLogStream(StreamInterface* target, size_t records_per_thread,
+                 FullPolicy policy);
+  virtual ~AsyncLogStream();
+
+  StreamInterface* target() { return target_.get(); }
+  FullPolicy policy() const { return policy_; }
+
+  // Messages accepted by Write(), messages handed to the target, and
+  // messages discarded because a ring was full (or the message could never
+  // fit). All three only ever grow.
+  int queued_messages() const;
+  int written_messages() const;
+  int dropped_messages() const;
+
+  // StreamInterface implementation. Writes are queued; Flush() drains all
+  // queued messages to the target before returning.
+  virtual StreamState GetState() const;
+  virtual StreamResult Read(void* buffer, size_t buffer_len,
+                            size_t* read, int* error);
+  virtual StreamResult Write(const void* data, size_t data_len,
+                             size_t* written, int* error);
+  virtual void Close();
+  virtual bool Flush();
+
+  // Runnable implementation, for the writer thread.
+  virtual void Run(Thread* thread);
+
+ private:
+  struct Record;
+  struct Ring;
+
+  // Returns the calling thread's ring, creating it on first use.
+  Ring* CurrentRing();
+  // Moves everything queued so far to the target. Only one thread drains at
+  // a time; producers are never blocked by it.
+  void Drain();
+  void Stop();
+
+  scoped_ptr<StreamInterface> target_;
+  const size_t records_per_thread_;
+  const FullPolicy policy_;
+
+#if defined(WIN32)
+  DWORD key_;
+#elif defined(POSIX)
+  pthread_key_t key_;
+#endif
+  // Guards rings_, which only grows until destruction.
+  mutable CriticalSection rings_crit_;
+  std::vector<Ring*> rings_;
+
+  // Serializes draining, so the writer thread and Flush() don't both consume.
+  CriticalSection drain_crit_;
+  std::string batch_;
+  int written_;
+  // The sequence number of the next message to hand to the target.
+  uint32 next_sequence_;
+
+  int sequence_;
+  volatile int stopping_;
+  Event wake_;
+  Thread writer_;
+
+  DISALLOW_COPY_AND_ASSIGN(AsyncLogStream);
+};
+
+}  // namespace talk_base
+
+#endif  // TALK_BASE_ASYNCLOGSTREAM_H_
@@ -0,0 +1,289 @@
+/*
+ * libjingle
+ * Copyright 2013, Google Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <string>
+
+#include "talk/base/asynclogstream.h"
+#include "talk/base/gunit.h"
+#include "talk/base/logging.h"
+#include "talk/base/stringutils.h"
+#include "talk/base/thread.h"
+#include "talk/base/timeutils.h"
+
+namespace talk_base {
+
+// Collects everything written into a string. Writes can be held up, to
+// simulate a slow disk, and are counted so we can see batching.
+class GatedStream : public StreamInterface {
+ public:
+  explicit GatedStream(int write_delay_ms = 0)
+      : gate_(true, true), write_started_(false, false),
+        write_delay_ms_(write_delay_ms), writes_(0) {
+  }
+
+  void Stall() { gate_.Reset(); }
+  void Resume() { gate_.Set(); }
+  // Waits for the next call to Write, which may be held at the gate.
+  bool WaitForWrite(int timeout_ms) { return write_started_.Wait(timeout_ms); }
+  std::string contents() {
+    CritScope cs(&crit_);
+    return contents_;
+  }
+  int writes() {
+    CritScope cs(&crit_);
+    return writes_;
+  }
+
+  virtual StreamState GetState() const { return SS_OPEN; }
+  virtual StreamResult Read(void* buffer, size_t buffer_len,
+                            size_t* read, int* error) {
+    return SR_EOS;
+  }
+  virtual StreamResult Write(const void* data, size_t data_len,
+                             size_t* written, int* error) {
+    write_started_.Set();
+    gate_.Wait(kForever);
+    if (write_delay_ms_)
+      Thread::SleepMs(write_delay_ms_);
+    CritScope cs(&crit_);
+    contents_.append(static_cast<const char*>(data), data_len);
+    ++writes_;
+    if (written)
+      *written = data_len;
+    return SR_SUCCESS;
+  }
+  virtual void Close() {}
+
+ private:
+  Event gate_;
+  Event write_started_;
+  int write_delay_ms_;
+  CriticalSection crit_;
+  std::string contents_;
+  int writes_;
+};
+
+class LogWriterThread : public Thread {
+ public:
+  LogWriterThread(AsyncLogStream* stream, int id, int count)
+      : stream_(stream), id_(id), count_(count) {
+  }
+  virtual void Run() {
+    char line[64];
+    for (int i = 0; i < count_; ++i) {
+      size_t len = sprintfn(line, sizeof(line), "thread %d line %d\n", id_, i);
+      stream_->WriteAll(line, len, NULL, NULL);
+    }
+  }
+
+ private:
+  AsyncLogStream* stream_;
+  int id_;
+  int count_;
+};
+
+TEST(AsyncLogStreamTest, WritesReachTargetOnFlush) {
+  GatedStream* target = new GatedStream();
+  AsyncLogStream stream(target, 16, AsyncLogStream::DROP_WHEN_FULL);
+  EXPECT_EQ(SR_SUCCESS, stream.WriteAll("one\n", 4, NULL, NULL));
+  EXPECT_EQ(SR_SUCCESS, stream.WriteAll("two\n", 4, NULL, NULL));
+  EXPECT_EQ(2, stream.queued_messages());
+  EXPECT_TRUE(stream.Flush());
+  EXPECT_EQ("one\ntwo\n", target->contents());
+  EXPECT_EQ(2, stream.written_messages());
+  EXPECT_EQ(0, stream.dropped_messages());
+}
+
+TEST(AsyncLogStreamTest, WriterThreadDrainsWithoutFlush) {
+  GatedStream* target = new GatedStream();
+  AsyncLogStream stream(target, 16, AsyncLogStream::DROP_WHEN_FULL);
+  stream.WriteAll("hello\n", 6, NULL, NULL);
+  EXPECT_EQ_WAIT("hello\n", target->contents(),
+                 AsyncLogStream::kFlushIntervalMs * 10);
+}
+
+// A message that spans several records comes out in one piece.
+TEST(AsyncLogStreamTest, LongMessage) {
+  GatedStream* target = new GatedStream();
+  AsyncLogStream stream(target, 16, AsyncLogStream::DROP_WHEN_FULL);
+  std::string message;
+  for (int i = 0; message.size() < 3 * AsyncLogStream::kRecordSize; ++i) {
+    message.push_back('a' + i % 26);
+  }
+  stream.WriteAll("first\n", 6, NULL, NULL);
+  stream.WriteAll(message.data(), message.size(), NULL, NULL);
+  stream.WriteAll("last\n", 5, NULL, NULL);
+  stream.Flush();
+  EXPECT_EQ("first\n" + message + "last\n", target->contents());
+  EXPECT_EQ(3, stream.written_messages());
+}
+
+// With the target stalled, a full ring drops messages and counts them, and
+// the writer catches up once the target comes back.
+TEST(AsyncLogStreamTest, DropsWhenFull) {
+  GatedStream* target = new GatedStream();
+  target->Stall();
+  AsyncLogStream stream(target, 8, AsyncLogStream::DROP_WHEN_FULL);
+  for (int i = 0; i < 20; ++i) {
+    stream.WriteAll("x\n", 2, NULL, NULL);
+  }
+  // The writer may have taken one message off the ring before stalling.
+  EXPECT_GE(stream.queued_messages(), 7);
+  EXPECT_LE(stream.queued_messages(), 8);
+  EXPECT_EQ(20, stream.queued_messages() + stream.dropped_messages());
+
+  target->Resume();
+  stream.Flush();
+  EXPECT_EQ(stream.queued_messages(), stream.written_messages());
+  EXPECT_EQ(static_cast<size_t>(2 * stream.written_messages()),
+            target->contents().size());
+}
+
+// A thread that logs for the first time while a drain is under way gets its
+// message written, in order, by that same drain.
+TEST(AsyncLogStreamTest, NewThreadDuringDrain) {
+  const int kLines = 400;
+  GatedStream* target = new GatedStream();
+  target->Stall();
+  AsyncLogStream stream(target, 1024, AsyncLogStream::DROP_WHEN_FULL);
+  // Enough to fill more than one batch, so the drain stalls partway through.
+  std::string line(199, 'a');
+  line.push_back('\n');
+  for (int i = 0; i < kLines; ++i) {
+    stream.WriteAll(line.data(), line.size(), NULL, NULL);
+  }
+  ASSERT_TRUE(target->WaitForWrite(AsyncLogStream::kFlushIntervalMs * 10));
+
+  // The new thread's message is older than the one that follows it from
+  // this thread, but its ring isn't in the list the drain started with.
+  LogWriterThread thread(&stream, 1, 1);
+  thread.Start();
+  thread.Stop();
+  stream.WriteAll("last\n", 5, NULL, NULL);
+  target->Resume();
+  stream.Flush();
+
+  EXPECT_EQ(kLines + 2, stream.written_messages());
+  std::string expected;
+  for (int i = 0; i < kLines; ++i) {
+    expected += line;
+  }
+  expected += "thread 1 line 0\nlast\n";
+  EXPECT_EQ(expected, target->contents());
+}
+
+// A message that can never fit in the ring is dropped rather than blocking.
+TEST(AsyncLogStreamTest, DropsOversizedMessage) {
+  GatedStream* target = new GatedStream();
+  AsyncLogStream stream(target, 2, AsyncLogStream::BLOCK_WHEN_FULL);
+  std::string message(2 * AsyncLogStream::kRecordSize, 'x');
+  stream.WriteAll(message.data(), message.size(), NULL, NULL);
+  EXPECT_EQ(1, stream.dropped_messages());
+  EXPECT_EQ(0, stream.queued_messages());
+}
+
+// With the blocking policy nothing is lost, and each thread's lines come out
+// in order.
+TEST(AsyncLogStreamTest, BlockingMultipleThreads) {
+  const int kThreads = 4;
+  const int kLines = 2000;
+  GatedStream* target = new GatedStream();
+  AsyncLogStream stream(target, 32, AsyncLogStream::BLOCK_WHEN_FULL);
+  LogWriterThread* threads[kThreads];
+  for (int i = 0; i < kThreads; ++i) {
+    threads[i] = new LogWriterThread(&stream, i, kLines);
+    threads[i]->Start();
+  }
+  for (int i = 0; i < kThreads; ++i) {
+    threads[i]->Stop();
+    delete threads[i];
+  }
+  stream.Flush();
+  EXPECT_EQ(kThreads * kLines, stream.queued_messages());
+  EXPECT_EQ(kThreads * kLines, stream.written_messages());
+  EXPECT_EQ(0, stream.dropped_messages());
+
+  int next[kThreads] = { 0 };
+  std::string contents = target->contents();
+  size_t pos = 0;
+  while (pos < contents.size()) {
+    size_t end = contents.find('\n', pos);
+    ASSERT_NE(std::string::npos, end);
+    int id = -1, line = -1;
+    ASSERT_EQ(2, sscanf(contents.substr(pos, end - pos).c_str(),
+                        "thread %d line %d", &id, &line));
+    ASSERT_TRUE(id >= 0 && id < kThreads);
+    EXPECT_EQ(next[id], line);
+    next[id] = line + 1;
+    pos = end + 1;
+  }
+  for (int i = 0; i < kThreads; ++i) {
+    EXPECT_EQ(kLines, next[i]);
+  }
+}
+
+TEST(AsyncLogStreamTest, AsLogMessageStream) {
+  GatedStream* target = new GatedStream();
+  AsyncLogStream stream(target, 64, AsyncLogStream::DROP_WHEN_FULL);
+  LogMessage::AddLogToStream(&stream, LS_INFO);
+  LOG(LS_INFO) << "queued behind the logging thread";
+  LogMessage::RemoveLogToStream(&stream);
+  stream.Flush();
+  EXPECT_NE(std::string::npos,
+            target->contents().find("queued behind the logging thread"));
+}
+
+// Compares the time LOG() takes on the calling thread when the log stream
+// takes 1ms per write, written directly and through an AsyncLogStream.
+TEST(AsyncLogStreamTest, DISABLED_SlowTargetBenchmark) {
+  const int kMessages = 200;
+  std::string message(80, 'X');
+  for (int async = 0; async < 2; ++async) {
+    GatedStream* target = new GatedStream(1);
+    scoped_ptr<StreamInterface> stream(target);
+    AsyncLogStream* async_stream = NULL;
+    if (async) {
+      async_stream = new AsyncLogStream(stream.release(), 1024,
+                                        AsyncLogStream::DROP_WHEN_FULL);
+      stream.reset(async_stream);
+    }
+    LogMessage::AddLogToStream(stream.get(), LS_SENSITIVE);
+    uint64 start = TimeNanos();
+    for (int i = 0; i < kMessages; ++i) {
+      LOG(LS_SENSITIVE) << message;
+    }
+    uint64 elapsed = TimeNanos() - start;
+    LogMessage::RemoveLogToStream(stream.get());
+    stream->Flush();
+    LOG(LS_INFO) << (async ? "Async" : "Direct") << ": "
+                 << elapsed / kMessages << "ns per message, "
+                 << target->writes() << " target writes";
+  }
+}
+
+}  // namespace talk_base
@@ -74,6 +74,17 @@ class AsyncPacketSocket : public sigslot::has_slots<> {
   virtual int GetError() const = 0;
   virtual void SetError(int error) = 0;
 
+  // Batching, for servers that handle many packets per wakeup. Sockets that
+  // support it read up to |max_packets| packets per readiness notification,
+  // and while a batch is open queue the packets passed to SendTo(), writing
+  // them together when the outermost EndBatch() is called. A batch is open
+  // while a batch of reads is being delivered, so replies sent from
+  // SignalReadPacket handlers are coalesced; those handlers must not destroy
+  // the socket. Sockets that do not support batching ignore these calls.
+  virtual void SetBatchSize(size_t max_packets) {}
+  virtual void BeginBatch() {}
+  virtual void EndBatch() {}
+
   // Emitted each time a packet is read. Used only for UDP and
   // connected TCP sockets.
   sigslot::signal4<AsyncPacketSocket*, const char*, size_t,
@@ -43,6 +43,8 @@ static const size_t kMaxPacketSize = 64 * 1024;
 
 typedef uint16 PacketLength;
 static const size_t kPacketLenSize = sizeof(PacketLength);
+// The largest packet whose length fits in the PacketLength prefix.
+static const size_t kMaxFramedPacketSize = 0xFFFF;
 
 static const size_t kBufSize = kMaxPacketSize + kPacketLenSize;
 
@@ -186,6 +188,25 @@ void AsyncTCPSocketBase::AppendToOutBuffer(const void* pv, size_t cb) {
   outpos_ += cb;
 }
 
+int AsyncTCPSocketBase::SendFromBuffers(const IoVec* iov, size_t count) {
+  ASSERT(IsOutBufferEmpty());
+  int res = socket_->SendV(iov, count);
+  if (res <= 0) {
+    return res;
+  }
+  size_t sent = static_cast<size_t>(res);
+  for (size_t i = 0; i < count; ++i) {
+    if (sent >= iov[i].len) {
+      sent -= iov[i].len;
+    } else {
+      AppendToOutBuffer(static_cast<const char*>(iov[i].data) + sent,
+                        iov[i].len - sent);
+      sent = 0;
+    }
+  }
+  return res;
+}
+
 void AsyncTCPSocketBase::OnConnectEvent(AsyncSocket* socket) {
   SignalConnect(this);
 }
@@ -262,7 +283,7 @@ AsyncTCPSocket::AsyncTCPSocket(AsyncSocket* socket, bool listen)
 }
 
 int AsyncTCPSocket::Send(const void *pv, size_t cb) {
-  if (cb > kBufSize) {
+  if (cb > kMaxFramedPacketSize) {
     SetError(EMSGSIZE);
     return -1;
   }
@@ -272,13 +293,15 @@ int AsyncTCPSocket::Send(const void *pv, size_t cb) {
     return static_cast<int>(cb);
 
   PacketLength pkt_len = HostToNetwork16(static_cast<PacketLength>(cb));
-  AppendToOutBuffer(&pkt_len, kPacketLenSize);
-  AppendToOutBuffer(pv, cb);
+  IoVec iov[2];
+  iov[0].data = &pkt_len;
+  iov[0].len = kPacketLenSize;
+  iov[1].data = pv;
+  iov[1].len = cb;
 
-  int res = FlushOutBuffer();
+  int res = SendFromBuffers(iov, ARRAY_SIZE(iov));
   if (res <= 0) {
     // drop packet if we made no progress
-    ClearOutBuffer();
     return res;
   }
 
@@ -70,6 +70,10 @@ class AsyncTCPSocketBase : public AsyncPacketSocket {
   int FlushOutBuffer();
   // Add data to |outbuf_|.
   void AppendToOutBuffer(const void* pv, size_t cb);
+  // Sends |iov| straight from the caller's buffers, keeping whatever the
+  // socket doesn't take in |outbuf_| to be flushed later. |outbuf_| must be
+  // empty. Returns the result of the send.
+  int SendFromBuffers(const IoVec* iov, size_t count);
 
   // Helper methods for |outpos_|.
   bool IsOutBufferEmpty() const { return outpos_ == 0; }
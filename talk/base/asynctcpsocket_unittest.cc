@@ -31,6 +31,8 @@
 #include "talk/base/gunit.h"
 #include "talk/base/physicalsocketserver.h"
 #include "talk/base/scoped_ptr.h"
+#include "talk/base/thread.h"
+#include "talk/base/timeutils.h"
 #include "talk/base/virtualsocketserver.h"
 
 namespace talk_base {
@@ -67,4 +69,109 @@ TEST_F(AsyncTCPSocketTest, OnWriteEvent) {
   EXPECT_TRUE(ready_to_send_);
 }
 
+// The length prefix is 16 bits, so anything bigger can't be framed.
+TEST_F(AsyncTCPSocketTest, SendTooLargePacket) {
+  std::string packet(0x10000, 'x');
+  EXPECT_EQ(-1, tcp_socket_->Send(packet.data(), packet.size()));
+  EXPECT_EQ(EMSGSIZE, tcp_socket_->GetError());
+}
+
+// Exposes whether a partial send is still being flushed, during which
+// further packets would be dropped.
+class FlushAwareTCPSocket : public AsyncTCPSocket {
+ public:
+  FlushAwareTCPSocket(AsyncSocket* socket, const SocketAddress& remote)
+      : AsyncTCPSocket(ConnectSocket(socket, SocketAddress("127.0.0.1", 0),
+                                     remote), false) {
+  }
+  bool flushed() const { return IsOutBufferEmpty(); }
+};
+
+class TCPPacketCounter : public sigslot::has_slots<> {
+ public:
+  TCPPacketCounter() : packets_(0), last_size_(0) {}
+  void OnNewConnection(AsyncPacketSocket* socket,
+                       AsyncPacketSocket* new_socket) {
+    new_socket->SignalReadPacket.connect(this,
+                                         &TCPPacketCounter::OnReadPacket);
+    accepted_.reset(new_socket);
+  }
+  void OnReadPacket(AsyncPacketSocket* socket, const char* data, size_t size,
+                    const SocketAddress& remote_addr) {
+    ++packets_;
+    last_size_ = size;
+  }
+  int packets() const { return packets_; }
+  size_t last_size() const { return last_size_; }
+
+ private:
+  scoped_ptr<AsyncPacketSocket> accepted_;
+  int packets_;
+  size_t last_size_;
+};
+
+// Sends |count| packets of |size| bytes between a pair of AsyncTCPSockets
+// over loopback, as fast as the sender's buffer allows. Returns the number
+// received before |timeout_ms| ran out, and the size of the last one in
+// |last_size| if it isn't NULL.
+static int SendOverLoopback(size_t size, int count, int timeout_ms,
+                            size_t* last_size = NULL) {
+  PhysicalSocketServer pss;
+  SocketServerScope scope(&pss);
+  AsyncSocket* listen_socket = pss.CreateAsyncSocket(SOCK_STREAM);
+  EXPECT_EQ(0, listen_socket->Bind(SocketAddress("127.0.0.1", 0)));
+  AsyncTCPSocket server(listen_socket, true);
+  TCPPacketCounter counter;
+  server.SignalNewConnection.connect(&counter,
+                                     &TCPPacketCounter::OnNewConnection);
+  FlushAwareTCPSocket client(pss.CreateAsyncSocket(SOCK_STREAM),
+                             listen_socket->GetLocalAddress());
+
+  std::string packet(size, 'x');
+  int sent = 0;
+  uint32 start = Time();
+  while (counter.packets() < count && TimeSince(start) < timeout_ms) {
+    // Send until the kernel pushes back, then let the other end read.
+    while (sent < count &&
+           client.GetState() == AsyncPacketSocket::STATE_CONNECTED &&
+           client.flushed() && client.Send(packet.data(), size) > 0) {
+      ++sent;
+    }
+    Thread::Current()->ProcessMessages(0);
+  }
+  if (last_size)
+    *last_size = counter.last_size();
+  return counter.packets();
+}
+
+// Large packets don't fit in the send buffer in one go; the rest has to be
+// sent once there is room.
+TEST(AsyncTCPSocketLoopbackTest, PartialSendsAreCompleted) {
+  EXPECT_EQ(200, SendOverLoopback(60000, 200, 10000));
+}
+
+// The largest packet the length prefix can describe arrives intact.
+TEST(AsyncTCPSocketLoopbackTest, SendLargestPacket) {
+  size_t last_size = 0;
+  EXPECT_EQ(5, SendOverLoopback(0xFFFF, 5, 10000, &last_size));
+  EXPECT_EQ(0xFFFFu, last_size);
+}
+
+// Measures how fast packets go through a pair of AsyncTCPSockets over
+// loopback. Run with --gtest_also_run_disabled_tests and --log "info" to see
+// the numbers.
+TEST(AsyncTCPSocketBenchmark, DISABLED_LoopbackThroughput) {
+  const int kPackets = 50000;
+  const size_t kPacketSizes[] = { 100, 1200, 8000, 60000 };
+  for (size_t i = 0; i < ARRAY_SIZE(kPacketSizes); ++i) {
+    uint64 start = TimeNanos();
+    EXPECT_EQ(kPackets, SendOverLoopback(kPacketSizes[i], kPackets, 60000));
+    uint64 elapsed = TimeNanos() - start;
+    LOG(LS_INFO) << kPacketSizes[i] << " byte packets: "
+                 << kPackets * kNumNanosecsPerSec / elapsed
+                 << " packets/sec, "
+                 << kPackets * kPacketSizes[i] * 1000 / elapsed << " MB/s";
+  }
+}
+
 }  // namespace talk_base
@@ -53,7 +53,10 @@ AsyncUDPSocket* AsyncUDPSocket::Create(SocketFactory* factory,
 }
 
 AsyncUDPSocket::AsyncUDPSocket(AsyncSocket* socket)
-    : socket_(socket) {
+    : socket_(socket),
+      batch_size_(1),
+      batch_depth_(0),
+      send_buf_used_(0) {
   ASSERT(socket_);
   size_ = BUF_SIZE;
   buf_ = new char[size_];
@@ -76,15 +79,35 @@ SocketAddress AsyncUDPSocket::GetRemoteAddress() const {
 }
 
 int AsyncUDPSocket::Send(const void *pv, size_t cb) {
+  // Keep the packet behind anything already queued.
+  FlushSends();
   return socket_->Send(pv, cb);
 }
 
 int AsyncUDPSocket::SendTo(
     const void *pv, size_t cb, const SocketAddress& addr) {
-  return socket_->SendTo(pv, cb, addr);
+  if (batch_depth_ == 0 || batch_size_ <= 1 || cb > BUF_SIZE) {
+    FlushSends();
+    return socket_->SendTo(pv, cb, addr);
+  }
+
+  if (send_queue_.size() >= batch_size_ || send_buf_used_ + cb > BUF_SIZE) {
+    FlushSends();
+  }
+  QueuedPacket packet;
+  packet.offset = send_buf_used_;
+  packet.len = cb;
+  packet.addr = addr;
+  memcpy(send_buf_.get() + send_buf_used_, pv, cb);
+  send_buf_used_ += cb;
+  send_queue_.push_back(packet);
+  // Like any UDP send, a queued packet may still be dropped; errors are only
+  // logged when the queue is written.
+  return static_cast<int>(cb);
 }
 
 int AsyncUDPSocket::Close() {
+  FlushSends();
   return socket_->Close();
 }
 
@@ -108,9 +131,85 @@ void AsyncUDPSocket::SetError(int error) {
   return socket_->SetError(error);
 }
 
+void AsyncUDPSocket::SetBatchSize(size_t max_packets) {
+  FlushSends();
+  batch_size_ = _max(max_packets, static_cast<size_t>(1));
+  if (batch_size_ <= 1) {
+    recv_buf_.reset();
+    recv_ring_.clear();
+    send_buf_.reset();
+    return;
+  }
+
+  recv_buf_.reset(new char[batch_size_ * BUF_SIZE]);
+  recv_ring_.resize(batch_size_);
+  for (size_t i = 0; i < batch_size_; ++i) {
+    recv_ring_[i].data = recv_buf_.get() + i * BUF_SIZE;
+    recv_ring_[i].size = BUF_SIZE;
+  }
+  if (!send_buf_) {
+    send_buf_.reset(new char[BUF_SIZE]);
+  }
+  send_queue_.reserve(batch_size_);
+  send_datagrams_.reserve(batch_size_);
+}
+
+void AsyncUDPSocket::BeginBatch() {
+  ++batch_depth_;
+}
+
+void AsyncUDPSocket::EndBatch() {
+  ASSERT(batch_depth_ > 0);
+  if (--batch_depth_ == 0) {
+    FlushSends();
+  }
+}
+
+void AsyncUDPSocket::FlushSends() {
+  if (send_queue_.empty())
+    return;
+
+  send_datagrams_.resize(send_queue_.size());
+  for (size_t i = 0; i < send_queue_.size(); ++i) {
+    send_datagrams_[i].data = send_buf_.get() + send_queue_[i].offset;
+    send_datagrams_[i].len = send_queue_[i].len;
+    send_datagrams_[i].addr = send_queue_[i].addr;
+  }
+  int sent = socket_->SendToMulti(&send_datagrams_[0], send_datagrams_.size());
+  if (sent < static_cast<int>(send_datagrams_.size())) {
+    LOG(LS_INFO) << "AsyncUDPSocket[" << GetLocalAddress().ToSensitiveString()
+                 << "] dropped " << send_datagrams_.size() - _max(sent, 0)
+                 << " queued packets, error " << socket_->GetError();
+  }
+  send_queue_.clear();
+  send_buf_used_ = 0;
+}
+
+void AsyncUDPSocket::ReadBatch() {
+  int count = socket_->RecvFromMulti(&recv_ring_[0], recv_ring_.size());
+  if (count < 0) {
+    SocketAddress local_addr = socket_->GetLocalAddress();
+    LOG(LS_INFO) << "AsyncUDPSocket[" << local_addr.ToSensitiveString() << "] "
+                 << "receive failed with error " << socket_->GetError();
+    return;
+  }
+
+  BeginBatch();
+  for (int i = 0; i < count; ++i) {
+    SignalReadPacket(this, recv_ring_[i].data, recv_ring_[i].len,
+                     recv_ring_[i].addr);
+  }
+  EndBatch();
+}
+
 void AsyncUDPSocket::OnReadEvent(AsyncSocket* socket) {
   ASSERT(socket_.get() == socket);
 
+  if (batch_size_ > 1) {
+    ReadBatch();
+    return;
+  }
+
   SocketAddress remote_addr;
   int len = socket_->RecvFrom(buf_, size_, &remote_addr);
   if (len < 0) {
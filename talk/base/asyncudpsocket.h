@@ -28,6 +28,8 @@
 #ifndef TALK_BASE_ASYNCUDPSOCKET_H_
 #define TALK_BASE_ASYNCUDPSOCKET_H_
 
+#include <vector>
+
 #include "talk/base/asyncpacketsocket.h"
 #include "talk/base/scoped_ptr.h"
 #include "talk/base/socketfactory.h"
@@ -62,15 +64,42 @@ class AsyncUDPSocket : public AsyncPacketSocket {
   virtual int GetError() const;
   virtual void SetError(int error);
 
+  // Batched reads use one full-size receive buffer per packet, so the batch
+  // size should be kept small.
+  virtual void SetBatchSize(size_t max_packets);
+  virtual void BeginBatch();
+  virtual void EndBatch();
+
  private:
+  // A packet queued by SendTo() while a batch is open. Its payload is stored
+  // at |offset| in send_buf_.
+  struct QueuedPacket {
+    size_t offset;
+    size_t len;
+    SocketAddress addr;
+  };
+
   // Called when the underlying socket is ready to be read from.
   void OnReadEvent(AsyncSocket* socket);
   // Called when the underlying socket is ready to send.
   void OnWriteEvent(AsyncSocket* socket);
+  // Reads and delivers up to batch_size_ packets.
+  void ReadBatch();
+  // Writes all packets queued while batching.
+  void FlushSends();
 
   scoped_ptr<AsyncSocket> socket_;
   char* buf_;
   size_t size_;
+
+  size_t batch_size_;
+  int batch_depth_;
+  scoped_array<char> recv_buf_;
+  std::vector<Datagram> recv_ring_;
+  scoped_array<char> send_buf_;
+  size_t send_buf_used_;
+  std::vector<QueuedPacket> send_queue_;
+  std::vector<Datagram> send_datagrams_;
 };
 
 }  // namespace talk_base
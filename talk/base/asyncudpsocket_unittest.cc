@@ -26,11 +26,13 @@
  */
 
 #include <string>
+#include <vector>
 
 #include "talk/base/asyncudpsocket.h"
 #include "talk/base/gunit.h"
 #include "talk/base/physicalsocketserver.h"
 #include "talk/base/scoped_ptr.h"
+#include "talk/base/thread.h"
 #include "talk/base/virtualsocketserver.h"
 
 namespace talk_base {
@@ -67,4 +69,90 @@ TEST_F(AsyncUdpSocketTest, OnWriteEvent) {
   EXPECT_TRUE(ready_to_send_);
 }
 
+// Tests batched reads and sends between two loopback sockets, over the given
+// socket server.
+class AsyncUdpSocketBatchTest
+    : public testing::Test,
+      public sigslot::has_slots<> {
+ public:
+  void OnReadPacket(AsyncPacketSocket* socket, const char* data, size_t size,
+                    const SocketAddress& remote_addr) {
+    received_.push_back(std::string(data, size));
+  }
+
+ protected:
+  void CreateSockets(SocketServer* ss) {
+    SocketAddress loopback(IPAddress(INADDR_LOOPBACK), 0);
+    sender_.reset(AsyncUDPSocket::Create(ss, loopback));
+    receiver_.reset(AsyncUDPSocket::Create(ss, loopback));
+    ASSERT_TRUE(sender_ && receiver_);
+    receiver_->SignalReadPacket.connect(this,
+                                        &AsyncUdpSocketBatchTest::OnReadPacket);
+  }
+
+  void TestBatchedRead(SocketServer* ss) {
+    SocketServerScope scope(ss);
+    CreateSockets(ss);
+    receiver_->SetBatchSize(4);
+    const int kNumPackets = 10;
+    for (int i = 0; i < kNumPackets; ++i) {
+      std::string packet(100 + i, 'a' + i);
+      ASSERT_EQ(static_cast<int>(packet.size()),
+                sender_->SendTo(packet.data(), packet.size(),
+                                receiver_->GetLocalAddress()));
+    }
+    EXPECT_EQ_WAIT(static_cast<size_t>(kNumPackets), received_.size(), 1000);
+    for (size_t i = 0; i < received_.size(); ++i) {
+      EXPECT_EQ(std::string(100 + i, 'a' + i), received_[i]);
+    }
+    DestroySockets();
+  }
+
+  // The sockets must go before the socket server they were created on.
+  void DestroySockets() {
+    sender_.reset();
+    receiver_.reset();
+  }
+
+  scoped_ptr<AsyncUDPSocket> sender_;
+  scoped_ptr<AsyncUDPSocket> receiver_;
+  std::vector<std::string> received_;
+};
+
+TEST_F(AsyncUdpSocketBatchTest, BatchedReadPhysical) {
+  PhysicalSocketServer ss;
+  TestBatchedRead(&ss);
+}
+
+TEST_F(AsyncUdpSocketBatchTest, BatchedReadVirtual) {
+  VirtualSocketServer ss(NULL);
+  TestBatchedRead(&ss);
+}
+
+TEST_F(AsyncUdpSocketBatchTest, SendsAreQueuedUntilEndBatch) {
+  PhysicalSocketServer ss;
+  SocketServerScope scope(&ss);
+  CreateSockets(&ss);
+  sender_->SetBatchSize(4);
+
+  // Without an open batch, sends go out immediately.
+  EXPECT_EQ(3, sender_->SendTo("foo", 3, receiver_->GetLocalAddress()));
+  EXPECT_EQ_WAIT(1U, received_.size(), 1000);
+
+  sender_->BeginBatch();
+  sender_->BeginBatch();
+  const int kNumPackets = 6;  // Overflows the queue once.
+  for (int i = 0; i < kNumPackets; ++i) {
+    EXPECT_EQ(3, sender_->SendTo("bar", 3, receiver_->GetLocalAddress()));
+  }
+  sender_->EndBatch();
+  Thread::Current()->ProcessMessages(100);
+  EXPECT_EQ(5U, received_.size());
+
+  sender_->EndBatch();
+  EXPECT_EQ_WAIT(static_cast<size_t>(kNumPackets + 1), received_.size(), 1000);
+  EXPECT_EQ("bar", received_.back());
+  DestroySockets();
+}
+
 }  // namespace talk_base
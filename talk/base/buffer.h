@@ -30,32 +30,51 @@
 
 #include <cstring>
 
+#include "talk/base/bufferpool.h"
 #include "talk/base/scoped_ptr.h"
 
 namespace talk_base {
 
 // Basic buffer class, can be grown and shrunk dynamically.
 // Unlike std::string/vector, does not initialize data when expanding capacity.
+// A buffer may borrow its storage from a BufferPool, in which case the storage
+// goes back to the pool when the buffer is destroyed or outgrows it.
 class Buffer {
  public:
-  Buffer() {
+  Buffer() : pool_(NULL) {
     Construct(NULL, 0, 0);
   }
-  Buffer(const void* data, size_t length) {
+  Buffer(const void* data, size_t length) : pool_(NULL) {
     Construct(data, length, length);
   }
-  Buffer(const void* data, size_t length, size_t capacity) {
+  Buffer(const void* data, size_t length, size_t capacity) : pool_(NULL) {
     Construct(data, length, capacity);
   }
-  Buffer(const Buffer& buf) {
+  // Takes storage from |pool| if it is non-NULL and its blocks can hold
+  // |capacity| bytes; otherwise behaves like the constructor above.
+  Buffer(BufferPool* pool, const void* data, size_t length, size_t capacity)
+      : pool_(NULL) {
+    if (pool && capacity <= pool->block_size()) {
+      SetStorage(pool->Allocate(), pool->block_size(), pool);
+      length_ = 0;
+      SetData(data, length);
+    } else {
+      Construct(data, length, capacity);
+    }
+  }
+  Buffer(const Buffer& buf) : pool_(NULL) {
     Construct(buf.data(), buf.length(), buf.length());
   }
+  ~Buffer() {
+    SetStorage(NULL, 0, NULL);
+  }
 
   const char* data() const { return data_.get(); }
   char* data() { return data_.get(); }
   // TODO: should this be size(), like STL?
   size_t length() const { return length_; }
   size_t capacity() const { return capacity_; }
+  bool pooled() const { return pool_ != NULL; }
 
   Buffer& operator=(const Buffer& buf) {
     if (&buf != this) {
@@ -88,30 +107,42 @@ class Buffer {
   }
   void SetCapacity(size_t capacity) {
     if (capacity > capacity_) {
-      talk_base::scoped_array<char> data(new char[capacity]);
-      memcpy(data.get(), data_.get(), length_);
-      data_.swap(data);
-      capacity_ = capacity;
+      char* data = new char[capacity];
+      memcpy(data, data_.get(), length_);
+      SetStorage(data, capacity, NULL);
     }
   }
 
+  // Moves the contents, and the storage itself, to |buf| without copying.
   void TransferTo(Buffer* buf) {
     ASSERT(buf != NULL);
-    buf->data_.reset(data_.release());
+    buf->SetStorage(data_.release(), capacity_, pool_);
     buf->length_ = length_;
-    buf->capacity_ = capacity_;
+    pool_ = NULL;
     Construct(NULL, 0, 0);
   }
 
  protected:
   void Construct(const void* data, size_t length, size_t capacity) {
-    data_.reset(new char[capacity_ = capacity]);
+    SetStorage(new char[capacity], capacity, NULL);
     SetData(data, length);
   }
 
+  // Releases the current storage, to its pool if it came from one, and adopts
+  // |data|, which came from |pool| if that is non-NULL.
+  void SetStorage(char* data, size_t capacity, BufferPool* pool) {
+    if (pool_) {
+      pool_->Free(data_.release());
+    }
+    data_.reset(data);
+    capacity_ = capacity;
+    pool_ = pool;
+  }
+
   scoped_array<char> data_;
   size_t length_;
   size_t capacity_;
+  BufferPool* pool_;
 };
 
 }  // namespace talk_base
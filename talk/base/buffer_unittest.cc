@@ -27,6 +27,7 @@
 
 #include "talk/base/buffer.h"
 #include "talk/base/gunit.h"
+#include "talk/base/scoped_ref_ptr.h"
 
 namespace talk_base {
 
@@ -157,4 +158,70 @@ TEST(BufferTest, TestTransfer) {
   EXPECT_EQ(0, memcmp(buf2.data(), kTestData, sizeof(kTestData)));
 }
 
+TEST(BufferTest, TestConstructFromPool) {
+  scoped_refptr<BufferPool> pool(new RefCountedObject<BufferPool>(256U, 4U));
+  {
+    Buffer buf(pool.get(), kTestData, sizeof(kTestData), 128U);
+    EXPECT_TRUE(buf.pooled());
+    EXPECT_EQ(sizeof(kTestData), buf.length());
+    EXPECT_EQ(256U, buf.capacity());  // The whole block is usable.
+    EXPECT_EQ(0, memcmp(buf.data(), kTestData, sizeof(kTestData)));
+    EXPECT_EQ(1, pool->outstanding_blocks());
+  }
+  EXPECT_EQ(0, pool->outstanding_blocks());
+  EXPECT_EQ(1U, pool->free_blocks());
+}
+
+TEST(BufferTest, TestConstructFromPoolTooLarge) {
+  scoped_refptr<BufferPool> pool(new RefCountedObject<BufferPool>(256U, 4U));
+  Buffer buf(pool.get(), kTestData, sizeof(kTestData), 512U);
+  EXPECT_FALSE(buf.pooled());
+  EXPECT_EQ(512U, buf.capacity());
+  EXPECT_EQ(0, pool->outstanding_blocks());
+
+  Buffer buf2(NULL, kTestData, sizeof(kTestData), 512U);
+  EXPECT_FALSE(buf2.pooled());
+  EXPECT_EQ(buf, buf2);
+}
+
+TEST(BufferTest, TestPooledSetCapacity) {
+  scoped_refptr<BufferPool> pool(new RefCountedObject<BufferPool>(256U, 4U));
+  Buffer buf(pool.get(), kTestData, sizeof(kTestData), 256U);
+  buf.SetCapacity(128U);
+  EXPECT_TRUE(buf.pooled());
+  // Outgrowing the block moves the data to the heap and returns the block.
+  buf.SetCapacity(512U);
+  EXPECT_FALSE(buf.pooled());
+  EXPECT_EQ(512U, buf.capacity());
+  EXPECT_EQ(0, memcmp(buf.data(), kTestData, sizeof(kTestData)));
+  EXPECT_EQ(0, pool->outstanding_blocks());
+  EXPECT_EQ(1U, pool->free_blocks());
+}
+
+TEST(BufferTest, TestPooledTransfer) {
+  scoped_refptr<BufferPool> pool(new RefCountedObject<BufferPool>(256U, 4U));
+  Buffer buf1(pool.get(), kTestData, sizeof(kTestData), 256U), buf2;
+  const char* data = buf1.data();
+  buf1.TransferTo(&buf2);
+  EXPECT_FALSE(buf1.pooled());
+  EXPECT_EQ(0U, buf1.length());
+  EXPECT_TRUE(buf2.pooled());
+  EXPECT_EQ(data, buf2.data());  // No copy was made.
+  EXPECT_EQ(sizeof(kTestData), buf2.length());
+  EXPECT_EQ(1, pool->outstanding_blocks());
+
+  // Assignment copies onto the heap and gives the block back.
+  buf2 = buf1;
+  EXPECT_FALSE(buf2.pooled());
+  EXPECT_EQ(0, pool->outstanding_blocks());
+}
+
+TEST(BufferTest, TestPoolOutlivesOwner) {
+  scoped_refptr<BufferPool> pool(new RefCountedObject<BufferPool>(256U, 4U));
+  Buffer buf(pool.get(), kTestData, sizeof(kTestData), 256U);
+  // The buffer keeps the pool alive after its owner lets go.
+  pool = NULL;
+  EXPECT_EQ(0, memcmp(buf.data(), kTestData, sizeof(kTestData)));
+}
+
 }  // namespace talk_base
@@ -0,0 +1,87 @@
+/*
+ * libjingle
+ * Copyright 2013, Google Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "talk/base/bufferpool.h"
+
+#include "talk/base/common.h"
+
+namespace talk_base {
+
+BufferPool::BufferPool(size_t block_size, size_t max_free_blocks)
+    : block_size_(block_size),
+      max_free_blocks_(max_free_blocks),
+      outstanding_(0) {
+  ASSERT(block_size_ > 0);
+  free_.reserve(max_free_blocks_);
+}
+
+BufferPool::~BufferPool() {
+  ASSERT(outstanding_ == 0);
+  for (size_t i = 0; i < free_.size(); ++i) {
+    delete [] free_[i];
+  }
+}
+
+size_t BufferPool::free_blocks() const {
+  CritScope cs(&crit_);
+  return free_.size();
+}
+
+char* BufferPool::Allocate() {
+  char* block = NULL;
+  {
+    CritScope cs(&crit_);
+    if (!free_.empty()) {
+      block = free_.back();
+      free_.pop_back();
+    }
+  }
+  if (!block) {
+    block = new char[block_size_];
+  }
+  AtomicOps::Increment(&outstanding_);
+  AddRef();
+  return block;
+}
+
+void BufferPool::Free(char* block) {
+  ASSERT(block != NULL);
+  {
+    CritScope cs(&crit_);
+    if (free_.size() < max_free_blocks_) {
+      free_.push_back(block);
+      block = NULL;
+    }
+  }
+  delete [] block;
+  AtomicOps::Decrement(&outstanding_);
+  // This may delete the pool, so it must come last.
+  Release();
+}
+
+}  // namespace talk_base
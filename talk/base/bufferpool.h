@@ -0,0 +1,82 @@
+/*
+ * libjingle
+ * Copyright 2013, Google Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef TALK_BASE_BUFFERPOOL_H_
+#define TALK_BASE_BUFFERPOOL_H_
+
+#include <vector>
+
+#include "talk/base/basictypes.h"
+#include "talk/base/constructormagic.h"
+#include "talk/base/criticalsection.h"
+#include "talk/base/refcount.h"
+
+namespace talk_base {
+
+// A thread-safe pool of fixed-size memory blocks, used to back packet
+// Buffers so that the media path does not hit the allocator for every packet.
+// Blocks may be allocated on one thread and freed on another. Each block that
+// is handed out holds a reference on the pool, so a pool stays alive until
+// the last packet that borrowed from it has been destroyed, even if its
+// creator has gone away. Create pools with
+//   scoped_refptr<BufferPool> pool(
+//       new RefCountedObject<BufferPool>(block_size, max_free_blocks));
+class BufferPool : public RefCountInterface {
+ public:
+  // |max_free_blocks| bounds how many returned blocks are kept for reuse;
+  // blocks freed beyond that are given back to the allocator.
+  BufferPool(size_t block_size, size_t max_free_blocks);
+
+  size_t block_size() const { return block_size_; }
+  size_t max_free_blocks() const { return max_free_blocks_; }
+  // The number of blocks currently cached for reuse.
+  size_t free_blocks() const;
+  // The number of blocks currently handed out.
+  int outstanding_blocks() const { return outstanding_; }
+
+  // Returns a block of block_size() bytes. The contents are uninitialized.
+  char* Allocate();
+  // Returns a block obtained from Allocate() on this pool.
+  void Free(char* block);
+
+ protected:
+  virtual ~BufferPool();
+
+ private:
+  const size_t block_size_;
+  const size_t max_free_blocks_;
+  mutable CriticalSection crit_;
+  std::vector<char*> free_;
+  int outstanding_;
+
+  DISALLOW_COPY_AND_ASSIGN(BufferPool);
+};
+
+}  // namespace talk_base
+
+#endif  // TALK_BASE_BUFFERPOOL_H_
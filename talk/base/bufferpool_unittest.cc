@@ -0,0 +1,137 @@
+/*
+ * libjingle
+ * Copyright 2013, Google Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <vector>
+
+#include "talk/base/buffer.h"
+#include "talk/base/bufferpool.h"
+#include "talk/base/common.h"
+#include "talk/base/gunit.h"
+#include "talk/base/logging.h"
+#include "talk/base/scoped_ref_ptr.h"
+#include "talk/base/thread.h"
+#include "talk/base/timeutils.h"
+
+namespace talk_base {
+
+TEST(BufferPoolTest, TestAllocateFree) {
+  scoped_refptr<BufferPool> pool(new RefCountedObject<BufferPool>(100U, 2U));
+  EXPECT_EQ(100U, pool->block_size());
+  EXPECT_EQ(0U, pool->free_blocks());
+  char* block1 = pool->Allocate();
+  char* block2 = pool->Allocate();
+  EXPECT_TRUE(block1 != NULL);
+  EXPECT_TRUE(block2 != NULL);
+  EXPECT_NE(block1, block2);
+  EXPECT_EQ(2, pool->outstanding_blocks());
+  pool->Free(block2);
+  EXPECT_EQ(1U, pool->free_blocks());
+  // The most recently freed block is handed out again.
+  EXPECT_EQ(block2, pool->Allocate());
+  EXPECT_EQ(0U, pool->free_blocks());
+  pool->Free(block1);
+  pool->Free(block2);
+  EXPECT_EQ(0, pool->outstanding_blocks());
+  EXPECT_EQ(2U, pool->free_blocks());
+}
+
+TEST(BufferPoolTest, TestMaxFreeBlocks) {
+  scoped_refptr<BufferPool> pool(new RefCountedObject<BufferPool>(100U, 2U));
+  std::vector<char*> blocks;
+  for (int i = 0; i < 5; ++i) {
+    blocks.push_back(pool->Allocate());
+  }
+  EXPECT_EQ(5, pool->outstanding_blocks());
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    pool->Free(blocks[i]);
+  }
+  EXPECT_EQ(0, pool->outstanding_blocks());
+  EXPECT_EQ(2U, pool->free_blocks());
+}
+
+// Frees buffers that were filled on another thread, the way packets posted
+// from an encoder thread are released on the worker thread.
+class BufferReleaser : public MessageHandler {
+ public:
+  struct BufferData : public MessageData {
+    Buffer buffer;
+  };
+  virtual void OnMessage(Message* msg) {
+    delete msg->pdata;
+  }
+};
+
+TEST(BufferPoolTest, TestFreeOnAnotherThread) {
+  const int kCount = 1000;
+  scoped_refptr<BufferPool> pool(new RefCountedObject<BufferPool>(64U, 16U));
+  BufferReleaser releaser;
+  Thread worker;
+  worker.Start();
+  for (int i = 0; i < kCount; ++i) {
+    Buffer buffer(pool.get(), &i, sizeof(i), sizeof(i));
+    EXPECT_TRUE(buffer.pooled());
+    BufferReleaser::BufferData* data = new BufferReleaser::BufferData;
+    buffer.TransferTo(&data->buffer);
+    worker.Post(&releaser, 0, data);
+  }
+  // Drop our reference first; outstanding buffers keep the pool alive.
+  BufferPool* raw_pool = pool.get();
+  raw_pool->AddRef();
+  pool = NULL;
+  worker.Stop();
+  EXPECT_EQ(0, raw_pool->outstanding_blocks());
+  EXPECT_GE(16U, raw_pool->free_blocks());
+  raw_pool->Release();
+}
+
+// Compares a heap-backed packet against a pooled one over the life of an
+// outgoing packet: fill, hand off to another message, release.
+TEST(BufferPoolBenchmark, DISABLED_PacketLifetime) {
+  const int kPackets = 1000000;
+  const size_t kMaxPacketLen = 2048;
+  const size_t kSizes[] = { 100, 1200 };
+  char payload[1200] = { 0 };
+  scoped_refptr<BufferPool> pool(
+      new RefCountedObject<BufferPool>(kMaxPacketLen, 16U));
+  for (int s = 0; s < ARRAY_SIZE(kSizes); ++s) {
+    for (int pooled = 0; pooled < 2; ++pooled) {
+      BufferPool* from = pooled ? pool.get() : NULL;
+      uint64 start = TimeNanos();
+      for (int i = 0; i < kPackets; ++i) {
+        Buffer packet(from, payload, kSizes[s], kMaxPacketLen);
+        Buffer posted;
+        packet.TransferTo(&posted);
+      }
+      uint64 elapsed = TimeNanos() - start;
+      LOG(LS_INFO) << (pooled ? "Pooled" : "Heap") << " " << kSizes[s]
+                   << " byte packets: " << elapsed / kPackets << "ns each";
+    }
+  }
+}
+
+}  // namespace talk_base
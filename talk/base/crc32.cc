@@ -28,6 +28,21 @@
 #include "talk/base/crc32.h"
 
 #include "talk/base/basicdefs.h"
+#include "talk/base/byteorder.h"
+#include "talk/base/common.h"
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#include <cpuid.h>
+#include <immintrin.h>
+#define CRC32_HAS_PCLMUL
+#define CRC32_TARGET(isa) __attribute__((target(isa)))
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <intrin.h>
+#include <smmintrin.h>
+#include <wmmintrin.h>
+#define CRC32_HAS_PCLMUL
+#define CRC32_TARGET(isa)
+#endif
 
 namespace talk_base {
 
@@ -36,12 +51,17 @@ namespace talk_base {
 // CRC32 polynomial, in reversed form.
 // See RFC 1952, or http://en.wikipedia.org/wiki/Cyclic_redundancy_check
 static const uint32 kCrc32Polynomial = 0xEDB88320;
-static uint32 kCrc32Table[256] = { 0 };
+
+// kCrc32Tables[0] is the classic byte-at-a-time table. kCrc32Tables[k][i] is
+// the CRC of byte i followed by k zero bytes, which lets slicing-by-8 look up
+// eight input bytes independently and combine the results with XOR.
+static uint32 kCrc32Tables[8][256] = { { 0 } };
 
 static void EnsureCrc32TableInited() {
-  if (kCrc32Table[ARRAY_SIZE(kCrc32Table) - 1])
+  // The last entry written doubles as the "done" flag.
+  if (kCrc32Tables[7][255])
     return;  // already inited
-  for (uint32 i = 0; i < ARRAY_SIZE(kCrc32Table); ++i) {
+  for (uint32 i = 0; i < 256; ++i) {
     uint32 c = i;
     for (size_t j = 0; j < 8; ++j) {
       if (c & 1) {
@@ -50,20 +70,184 @@ static void EnsureCrc32TableInited() {
         c >>= 1;
       }
     }
-    kCrc32Table[i] = c;
+    kCrc32Tables[0][i] = c;
+  }
+  for (int k = 1; k < 8; ++k) {
+    for (uint32 i = 0; i < 256; ++i) {
+      uint32 c = kCrc32Tables[k - 1][i];
+      kCrc32Tables[k][i] = kCrc32Tables[0][c & 0xFF] ^ (c >> 8);
+    }
   }
 }
 
-uint32 UpdateCrc32(uint32 start, const void* buf, size_t len) {
+// The kernels below work on the internal CRC state, i.e. the checksum
+// XORed with 0xFFFFFFFF.
+static uint32 Crc32Bytewise(uint32 c, const uint8* u, size_t len) {
+  for (size_t i = 0; i < len; ++i) {
+    c = kCrc32Tables[0][(c ^ u[i]) & 0xFF] ^ (c >> 8);
+  }
+  return c;
+}
+
+static uint32 Crc32SlicingBy8(uint32 c, const uint8* u, size_t len) {
+  const uint32 (*t)[256] = kCrc32Tables;
+  for (; len >= 8; u += 8, len -= 8) {
+    uint32 lo = c ^ GetLE32(u);
+    uint32 hi = GetLE32(u + 4);
+    c = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^
+        t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+        t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^
+        t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+  }
+  return Crc32Bytewise(c, u, len);
+}
+
+#if defined(CRC32_HAS_PCLMUL)
+// Below this many bytes, setting up the folding costs more than it saves.
+static const size_t kPclmulMinLength = 64;
+
+static bool HasPclmul() {
+  static int has_pclmul = -1;
+  if (has_pclmul < 0) {
+    // PCLMULQDQ is ECX bit 1 and SSE4.1 (for pextrd) is ECX bit 19 of leaf 1.
+    int regs[4] = { 0 };
+#if defined(_MSC_VER)
+    __cpuid(regs, 1);
+#else
+    unsigned int a, b, c, d;
+    if (__get_cpuid(1, &a, &b, &c, &d)) {
+      regs[2] = c;
+    }
+#endif
+    has_pclmul = ((regs[2] & (1 << 1)) && (regs[2] & (1 << 19))) ? 1 : 0;
+  }
+  return has_pclmul != 0;
+}
+
+// Folds |len| bytes, a multiple of 16 and at least 64, into the CRC state
+// using carry-less multiplication, as described in Intel's "Fast CRC
+// Computation for Generic Polynomials Using PCLMULQDQ Instruction". The
+// constants are x^(32*n) mod P for the bit-reflected polynomial, followed by
+// P and the Barrett constant floor(x^64 / P).
+CRC32_TARGET("pclmul,sse4.1")
+static uint32 Crc32Pclmul(uint32 crc, const uint8* buf, size_t len) {
+  const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596LL, 0x0154442bd4LL);
+  const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009eLL, 0x01751997d0LL);
+  const __m128i k5k0 = _mm_set_epi64x(0, 0x0163cd6124LL);
+  const __m128i poly = _mm_set_epi64x(0x01f7011641LL, 0x01db710641LL);
+  const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+
+  // Four independent 128-bit lanes hide the multiplier latency.
+  __m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf));
+  __m128i x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + 16));
+  __m128i x3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + 32));
+  __m128i x4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + 48));
+  x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(static_cast<int>(crc)));
+  buf += 64;
+  len -= 64;
+
+  for (; len >= 64; buf += 64, len -= 64) {
+    __m128i x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+    __m128i x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+    __m128i x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+    __m128i x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+    x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+    x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+    x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x5),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf)));
+    x2 = _mm_xor_si128(_mm_xor_si128(x2, x6),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + 16)));
+    x3 = _mm_xor_si128(_mm_xor_si128(x3, x7),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + 32)));
+    x4 = _mm_xor_si128(_mm_xor_si128(x4, x8),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + 48)));
+  }
+
+  // Fold the four lanes into one.
+  __m128i lanes[3] = { x2, x3, x4 };
+  for (int i = 0; i < 3; ++i) {
+    __m128i lo = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, lo), lanes[i]);
+  }
+
+  // Fold in whatever 16-byte blocks remain.
+  for (; len >= 16; buf += 16, len -= 16) {
+    __m128i lo = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, lo),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf)));
+  }
+
+  // Reduce 128 bits to 64.
+  __m128i t = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+  x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), t);
+  t = _mm_srli_si128(x1, 4);
+  x1 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k5k0, 0x00);
+  x1 = _mm_xor_si128(x1, t);
+
+  // Barrett reduction to 32 bits.
+  t = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), poly, 0x10);
+  t = _mm_clmulepi64_si128(_mm_and_si128(t, mask32), poly, 0x00);
+  x1 = _mm_xor_si128(x1, t);
+  return static_cast<uint32>(_mm_extract_epi32(x1, 1));
+}
+#endif  // CRC32_HAS_PCLMUL
+
+bool IsCrc32ImplementationSupported(Crc32Implementation impl) {
+  switch (impl) {
+    case CRC32_BYTEWISE:
+    case CRC32_SLICING_BY_8:
+      return true;
+    case CRC32_PCLMUL:
+#if defined(CRC32_HAS_PCLMUL)
+      return HasPclmul();
+#else
+      return false;
+#endif
+  }
+  return false;
+}
+
+uint32 UpdateCrc32WithImplementation(Crc32Implementation impl, uint32 start,
+                                     const void* buf, size_t len) {
   EnsureCrc32TableInited();
 
   uint32 c = start ^ 0xFFFFFFFF;
   const uint8* u = static_cast<const uint8*>(buf);
-  for (size_t i = 0; i < len; ++i) {
-    c = kCrc32Table[(c ^ u[i]) & 0xFF] ^ (c >> 8);
+  switch (impl) {
+    case CRC32_BYTEWISE:
+      c = Crc32Bytewise(c, u, len);
+      break;
+    case CRC32_PCLMUL:
+#if defined(CRC32_HAS_PCLMUL)
+      ASSERT(HasPclmul());
+      if (len >= kPclmulMinLength) {
+        size_t folded = len & ~static_cast<size_t>(15);
+        c = Crc32Pclmul(c, u, folded);
+        u += folded;
+        len -= folded;
+      }
+#else
+      ASSERT(false);
+#endif
+      // The tail, or short inputs, go through the table path.
+      c = Crc32SlicingBy8(c, u, len);
+      break;
+    case CRC32_SLICING_BY_8:
+      c = Crc32SlicingBy8(c, u, len);
+      break;
   }
   return c ^ 0xFFFFFFFF;
 }
 
-}  // namespace talk_base
+uint32 UpdateCrc32(uint32 start, const void* buf, size_t len) {
+  Crc32Implementation impl = CRC32_SLICING_BY_8;
+  if (IsCrc32ImplementationSupported(CRC32_PCLMUL))
+    impl = CRC32_PCLMUL;
+  return UpdateCrc32WithImplementation(impl, start, buf, len);
+}
 
+}  // namespace talk_base
@@ -36,8 +36,26 @@ namespace talk_base {
 
 // Updates a CRC32 checksum with |len| bytes from |buf|. |initial| holds the
 // checksum result from the previous update; for the first call, it should be 0.
+// Updates chain, so data spread over several buffers can be checksummed in
+// place: UpdateCrc32(ComputeCrc32(a, a_len), b, b_len) equals the checksum of
+// |a| followed by |b|.
 uint32 UpdateCrc32(uint32 initial, const void* buf, size_t len);
 
+// The implementations UpdateCrc32 picks from at runtime. These are exposed
+// for tests and benchmarks; other code should just call UpdateCrc32.
+enum Crc32Implementation {
+  CRC32_BYTEWISE,      // One table lookup per byte.
+  CRC32_SLICING_BY_8,  // Eight table lookups per 8 bytes.
+  CRC32_PCLMUL         // Carry-less multiply folding; needs PCLMULQDQ.
+};
+
+// Returns true if |impl| can run on this machine.
+bool IsCrc32ImplementationSupported(Crc32Implementation impl);
+
+// Like UpdateCrc32, but always uses |impl|, which must be supported.
+uint32 UpdateCrc32WithImplementation(Crc32Implementation impl, uint32 initial,
+                                     const void* buf, size_t len);
+
 // Computes a CRC32 checksum using |len| bytes from |buf|.
 inline uint32 ComputeCrc32(const void* buf, size_t len) {
   return UpdateCrc32(0, buf, len);
@@ -27,8 +27,11 @@
 
 #include "talk/base/crc32.h"
 #include "talk/base/gunit.h"
+#include "talk/base/logging.h"
+#include "talk/base/timeutils.h"
 
 #include <string>
+#include <vector>
 
 namespace talk_base {
 
@@ -49,4 +52,85 @@ TEST(Crc32Test, TestMultipleUpdates) {
   EXPECT_EQ(0x171A3F5FU, c);
 }
 
+static const Crc32Implementation kImplementations[] = {
+  CRC32_BYTEWISE, CRC32_SLICING_BY_8, CRC32_PCLMUL
+};
+
+static const char* ImplementationName(Crc32Implementation impl) {
+  switch (impl) {
+    case CRC32_BYTEWISE: return "bytewise";
+    case CRC32_SLICING_BY_8: return "slicing-by-8";
+    case CRC32_PCLMUL: return "pclmul";
+  }
+  return "unknown";
+}
+
+static std::vector<uint8> MakeInput(size_t len) {
+  std::vector<uint8> input(len);
+  uint32 seed = 12345;
+  for (size_t i = 0; i < len; ++i) {
+    seed = seed * 1103515245 + 12345;
+    input[i] = static_cast<uint8>(seed >> 16);
+  }
+  return input;
+}
+
+// Every implementation must match the bytewise reference, whatever the
+// length and alignment of the input.
+TEST(Crc32Test, TestImplementationsAgree) {
+  std::vector<uint8> input = MakeInput(2048 + 16);
+  for (size_t offset = 0; offset < 16; offset += 3) {
+    for (size_t len = 0; len <= 2048; len = len < 256 ? len + 1 : len * 2 - 1) {
+      const uint8* data = &input[offset];
+      uint32 expected = UpdateCrc32WithImplementation(CRC32_BYTEWISE, 0,
+                                                      data, len);
+      EXPECT_EQ(expected, ComputeCrc32(data, len)) << len;
+      for (int i = 0; i < ARRAY_SIZE(kImplementations); ++i) {
+        if (!IsCrc32ImplementationSupported(kImplementations[i]))
+          continue;
+        EXPECT_EQ(expected, UpdateCrc32WithImplementation(
+            kImplementations[i], 0, data, len))
+            << ImplementationName(kImplementations[i]) << " " << len;
+      }
+    }
+  }
+}
+
+// A message split across buffers checksums the same as when contiguous.
+TEST(Crc32Test, TestScatteredUpdates) {
+  std::vector<uint8> input = MakeInput(1500);
+  uint32 expected = ComputeCrc32(&input[0], input.size());
+  const size_t kSplits[] = { 1, 7, 20, 64, 100, 333, 1000, 1499 };
+  for (int i = 0; i < ARRAY_SIZE(kSplits); ++i) {
+    size_t split = kSplits[i];
+    uint32 c = ComputeCrc32(&input[0], split);
+    c = UpdateCrc32(c, &input[split], input.size() - split);
+    EXPECT_EQ(expected, c) << split;
+  }
+}
+
+TEST(Crc32Benchmark, DISABLED_Implementations) {
+  const int kBytesPerRun = 64 * 1024 * 1024;
+  const size_t kSizes[] = { 64, 128, 256, 512, 1500 };
+  std::vector<uint8> input = MakeInput(1500);
+  for (int s = 0; s < ARRAY_SIZE(kSizes); ++s) {
+    int iterations = kBytesPerRun / static_cast<int>(kSizes[s]);
+    for (int i = 0; i < ARRAY_SIZE(kImplementations); ++i) {
+      Crc32Implementation impl = kImplementations[i];
+      if (!IsCrc32ImplementationSupported(impl))
+        continue;
+      uint32 c = 0;
+      uint64 start = TimeNanos();
+      for (int j = 0; j < iterations; ++j) {
+        c = UpdateCrc32WithImplementation(impl, c, &input[0], kSizes[s]);
+      }
+      uint64 elapsed = TimeNanos() - start;
+      LOG(LS_INFO) << ImplementationName(impl) << " " << kSizes[s]
+                   << " bytes: " << elapsed / iterations << "ns, "
+                   << kBytesPerRun * 1000.0 / elapsed
+                   << " MB/s (crc " << c << ")";
+    }
+  }
+}
+
 }  // namespace talk_base
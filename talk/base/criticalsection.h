@@ -181,6 +181,19 @@ class AtomicOps {
   static int Decrement(int* i) {
     return ::InterlockedDecrement(reinterpret_cast<LONG*>(i));
   }
+  // Returns the value |*i| had before the call; the swap happened if that
+  // equals |old_value|.
+  static int CompareAndSwap(volatile int* i, int old_value, int new_value) {
+    return ::InterlockedCompareExchange(reinterpret_cast<volatile LONG*>(i),
+                                        new_value, old_value);
+  }
+  // MSVC gives volatile accesses acquire and release semantics.
+  static int AcquireLoad(volatile const int* i) {
+    return *i;
+  }
+  static void ReleaseStore(volatile int* i, int value) {
+    *i = value;
+  }
 #else
   static int Increment(int* i) {
     return __sync_add_and_fetch(i, 1);
@@ -188,6 +201,15 @@ class AtomicOps {
   static int Decrement(int* i) {
     return __sync_sub_and_fetch(i, 1);
   }
+  static int CompareAndSwap(volatile int* i, int old_value, int new_value) {
+    return __sync_val_compare_and_swap(i, old_value, new_value);
+  }
+  static int AcquireLoad(volatile const int* i) {
+    return __atomic_load_n(i, __ATOMIC_ACQUIRE);
+  }
+  static void ReleaseStore(volatile int* i, int value) {
+    __atomic_store_n(i, value, __ATOMIC_RELEASE);
+  }
 #endif
 };
 
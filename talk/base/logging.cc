@@ -385,7 +385,7 @@ int LogMessage::ParseLogSeverity(const std::string& value) {
 void LogMessage::UpdateMinLogSeverity() {
   int min_sev = dbg_sev_;
   for (StreamList::iterator it = streams_.begin(); it != streams_.end(); ++it) {
-    min_sev = _min(dbg_sev_, it->second);
+    min_sev = _min(min_sev, it->second);
   }
   min_sev_ = min_sev;
 }
@@ -57,6 +57,12 @@
 //     before performing expensive or sensitive operations whose sole purpose is
 //     to output logging data at the desired level.
 // Lastly, PLOG(sev, err) is an alias for LOG_ERR_EX.
+//
+// Messages are only formatted when some target wants their severity; until
+// then, the stream arguments (including calls such as obj->ToString()) are not
+// evaluated. Building with LOG_MIN_SEVERITY set, e.g.
+// -DLOG_MIN_SEVERITY=LS_INFO, removes less severe LOG statements from the
+// binary entirely, whatever the runtime settings.
 
 #ifndef TALK_BASE_LOGGING_H_
 #define TALK_BASE_LOGGING_H_
@@ -116,6 +122,11 @@ enum LoggingSeverity { LS_SENSITIVE, LS_VERBOSE, LS_INFO, LS_WARNING, LS_ERROR,
                        WARNING = LS_WARNING,
                        LERROR = LS_ERROR };
 
+// The least severe level that is compiled in. See the top of this file.
+#if !defined(LOG_MIN_SEVERITY)
+#define LOG_MIN_SEVERITY LS_SENSITIVE
+#endif
+
 // LogErrorContext assists in interpreting the meaning of an error value.
 enum LogErrorContext {
   ERRCTX_NONE,
@@ -139,7 +150,11 @@ class LogMessage {
              const char* module = NULL);
   ~LogMessage();
 
-  static inline bool Loggable(LoggingSeverity sev) { return (sev >= min_sev_); }
+  // When |sev| is a constant below LOG_MIN_SEVERITY this folds to false, and
+  // the compiler drops the logging statement that depends on it.
+  static inline bool Loggable(LoggingSeverity sev) {
+    return (sev >= LOG_MIN_SEVERITY) && (sev >= min_sev_);
+  }
   std::ostream& stream() { return print_stream_; }
 
   // Returns the time at which this function was called for the first time.
@@ -319,7 +334,7 @@ class LogMessageVoidify {
 #define LOG_CHECK_LEVEL_V(sev) \
   talk_base::LogCheckLevel(sev)
 inline bool LogCheckLevel(LoggingSeverity sev) {
-  return (LogMessage::GetMinLogSeverity() <= sev);
+  return LogMessage::Loggable(sev);
 }
 
 #define LOG_E(sev, ctx, err, ...) \
@@ -84,6 +84,57 @@ TEST(LogTest, MultipleStreams) {
   EXPECT_EQ(sev, LogMessage::GetLogToStream(NULL));
 }
 
+// The severity short-circuit must let through anything that any one stream
+// wants, not just the most recently added one.
+TEST(LogTest, MinSeverityCoversAllStreams) {
+  int sev = LogMessage::GetLogToStream(NULL);
+  int debug_sev = LogMessage::GetLogToDebug();
+  LogMessage::LogToDebug(LogMessage::NO_LOGGING);
+
+  std::string str1, str2;
+  StringStream stream1(str1), stream2(str2);
+  LogMessage::AddLogToStream(&stream1, LS_VERBOSE);
+  LogMessage::AddLogToStream(&stream2, LS_ERROR);
+  EXPECT_EQ(LS_VERBOSE, LogMessage::GetMinLogSeverity());
+  EXPECT_TRUE(LOG_CHECK_LEVEL(LS_VERBOSE));
+
+  LOG(LS_VERBOSE) << "VERBOSE";
+  EXPECT_NE(std::string::npos, str1.find("VERBOSE"));
+  EXPECT_EQ(std::string::npos, str2.find("VERBOSE"));
+
+  LogMessage::RemoveLogToStream(&stream2);
+  LogMessage::RemoveLogToStream(&stream1);
+  LogMessage::LogToDebug(debug_sev);
+  EXPECT_EQ(sev, LogMessage::GetLogToStream(NULL));
+}
+
+static int g_describe_calls = 0;
+static std::string Describe() {
+  ++g_describe_calls;
+  return "described";
+}
+
+// Stream arguments are only evaluated when the message will be output.
+TEST(LogTest, ArgumentsEvaluatedOnlyWhenLoggable) {
+  int sev = LogMessage::GetLogToStream(NULL);
+  int debug_sev = LogMessage::GetLogToDebug();
+  LogMessage::LogToDebug(LogMessage::NO_LOGGING);
+
+  std::string str;
+  StringStream stream(str);
+  LogMessage::AddLogToStream(&stream, LS_INFO);
+  g_describe_calls = 0;
+  LOG(LS_VERBOSE) << Describe();
+  EXPECT_EQ(0, g_describe_calls);
+  LOG(LS_INFO) << Describe();
+  EXPECT_EQ(1, g_describe_calls);
+  EXPECT_NE(std::string::npos, str.find("described"));
+
+  LogMessage::RemoveLogToStream(&stream);
+  LogMessage::LogToDebug(debug_sev);
+  EXPECT_EQ(sev, LogMessage::GetLogToStream(NULL));
+}
+
 // Ensure we don't crash when adding/removing streams while threads are going.
 // We should restore the correct global state at the end.
 class LogThread : public Thread {
@@ -31,6 +31,7 @@
 
 #include "talk/base/sslconfig.h"
 #if SSL_USE_OPENSSL
+#include <openssl/sha.h>
 #include "talk/base/openssldigest.h"
 #else
 #include "talk/base/md5digest.h"
@@ -181,4 +182,95 @@ std::string ComputeHmac(const std::string& alg, const std::string& key,
   return output;
 }
 
+#if SSL_USE_OPENSSL
+typedef SHA_CTX Sha1Context;
+static void Sha1Init(Sha1Context* ctx) {
+  SHA1_Init(ctx);
+}
+static void Sha1Update(Sha1Context* ctx, const void* data, size_t len) {
+  SHA1_Update(ctx, data, len);
+}
+static void Sha1Final(Sha1Context* ctx, void* digest) {
+  SHA1_Final(static_cast<unsigned char*>(digest), ctx);
+}
+#else
+typedef SHA1_CTX Sha1Context;
+static void Sha1Init(Sha1Context* ctx) {
+  SHA1Init(ctx);
+}
+static void Sha1Update(Sha1Context* ctx, const void* data, size_t len) {
+  SHA1Update(ctx, static_cast<const uint8*>(data), len);
+}
+static void Sha1Final(Sha1Context* ctx, void* digest) {
+  SHA1Final(ctx, static_cast<uint8*>(digest));
+}
+#endif
+
+struct HmacContext::State {
+  Sha1Context inner;  // After hashing the key XOR ipad.
+  Sha1Context outer;  // After hashing the key XOR opad.
+};
+
+HmacContext::HmacContext() : state_(new State) {
+  SetKey(NULL, 0);
+}
+
+HmacContext::HmacContext(const void* key, size_t key_len)
+    : state_(new State) {
+  SetKey(key, key_len);
+}
+
+HmacContext::~HmacContext() {
+}
+
+void HmacContext::SetKey(const void* key, size_t key_len) {
+  // As in ComputeHmac, a key longer than a block is replaced by its hash.
+  uint8 block_key[kBlockSize] = { 0 };
+  if (key_len > kBlockSize) {
+    Sha1Context ctx;
+    Sha1Init(&ctx);
+    Sha1Update(&ctx, key, key_len);
+    Sha1Final(&ctx, block_key);
+  } else if (key_len > 0) {
+    memcpy(block_key, key, key_len);
+  }
+  uint8 pad[kBlockSize];
+  for (size_t i = 0; i < kBlockSize; ++i) {
+    pad[i] = block_key[i] ^ 0x36;
+  }
+  Sha1Init(&state_->inner);
+  Sha1Update(&state_->inner, pad, kBlockSize);
+  for (size_t i = 0; i < kBlockSize; ++i) {
+    pad[i] = block_key[i] ^ 0x5c;
+  }
+  Sha1Init(&state_->outer);
+  Sha1Update(&state_->outer, pad, kBlockSize);
+}
+
+size_t HmacContext::Compute(const void* input, size_t in_len,
+                            void* output, size_t out_len) const {
+  return Compute(input, in_len, NULL, 0, output, out_len);
+}
+
+size_t HmacContext::Compute(const void* input1, size_t in_len1,
+                            const void* input2, size_t in_len2,
+                            void* output, size_t out_len) const {
+  if (out_len < kSize) {
+    return 0;
+  }
+  Sha1Context ctx = state_->inner;
+  if (in_len1 > 0) {
+    Sha1Update(&ctx, input1, in_len1);
+  }
+  if (in_len2 > 0) {
+    Sha1Update(&ctx, input2, in_len2);
+  }
+  uint8 inner[kSize];
+  Sha1Final(&ctx, inner);
+  ctx = state_->outer;
+  Sha1Update(&ctx, inner, kSize);
+  Sha1Final(&ctx, output);
+  return kSize;
+}
+
 }  // namespace talk_base
@@ -30,6 +30,9 @@
 
 #include <string>
 
+#include "talk/base/constructormagic.h"
+#include "talk/base/scoped_ptr.h"
+
 namespace talk_base {
 
 // Definitions for the digest algorithms.
@@ -118,6 +121,40 @@ std::string ComputeHmac(const std::string& alg, const std::string& key,
 bool ComputeHmac(const std::string& alg, const std::string& key,
                  const std::string& input, std::string* output);
 
+// Computes RFC 2104 HMAC-SHA1 under a fixed key, as STUN MESSAGE-INTEGRITY
+// does for every message of a session. The key is padded and both pad blocks
+// are hashed once, when the key is set, so computing an HMAC only hashes the
+// input and the inner digest. Compute() doesn't modify the context, so one
+// context can serve any number of messages.
+class HmacContext {
+ public:
+  enum { kSize = 20 };  // SHA-1
+
+  // Creates a context keyed with the empty key.
+  HmacContext();
+  HmacContext(const void* key, size_t key_len);
+  ~HmacContext();
+
+  void SetKey(const void* key, size_t key_len);
+
+  // Computes the HMAC of |in_len| bytes of |input| into |output|, which is
+  // |out_len| bytes long. Returns kSize, or 0 if |out_len| was too small.
+  size_t Compute(const void* input, size_t in_len,
+                 void* output, size_t out_len) const;
+  // Like the previous function, but for input that is split in two pieces.
+  size_t Compute(const void* input1, size_t in_len1,
+                 const void* input2, size_t in_len2,
+                 void* output, size_t out_len) const;
+
+ private:
+  // The hash states after the inner and outer pads, in whichever SHA-1
+  // implementation the build uses.
+  struct State;
+  scoped_ptr<State> state_;
+
+  DISALLOW_COPY_AND_ASSIGN(HmacContext);
+};
+
 }  // namespace talk_base
 
 #endif  // TALK_BASE_MESSAGEDIGEST_H_
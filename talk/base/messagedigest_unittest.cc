@@ -159,6 +159,59 @@ TEST(MessageDigestTest, TestSha1Hmac) {
           input.c_str(), input.size(), output, sizeof(output) - 1));
 }
 
+// Computes the hex-encoded HMAC-SHA1 of |input| with a fresh HmacContext.
+static std::string HmacContextHex(const std::string& key,
+                                  const std::string& input) {
+  HmacContext hmac(key.data(), key.size());
+  char output[HmacContext::kSize];
+  EXPECT_EQ(sizeof(output), hmac.Compute(input.data(), input.size(),
+                                         output, sizeof(output)));
+  return hex_encode(output, sizeof(output));
+}
+
+// The same RFC 2202 vectors, through HmacContext.
+TEST(MessageDigestTest, TestHmacContext) {
+  EXPECT_EQ("b617318655057264e28bc0b6fb378c8ef146be00",
+      HmacContextHex(std::string(20, '\x0b'), "Hi There"));
+  EXPECT_EQ("effcdf6ae5eb2fa2d27416d5f184df9c259a7c79",
+      HmacContextHex("Jefe", "what do ya want for nothing?"));
+  EXPECT_EQ("125d7342b9ac11cd91a39af48aa17b4f63f175d3",
+      HmacContextHex(std::string(20, '\xaa'), std::string(50, '\xdd')));
+  EXPECT_EQ("aa4ae5e15272d00e95705637ce8a3b55ed402112",
+      HmacContextHex(std::string(80, '\xaa'),
+          "Test Using Larger Than Block-Size Key - Hash Key First"));
+  EXPECT_EQ("e8e99d0f45237d786d6bbaa7965c7808bbff1a91",
+      HmacContextHex(std::string(80, '\xaa'),
+          "Test Using Larger Than Block-Size Key and Larger "
+          "Than One Block-Size Data"));
+  // The empty key matches ComputeHmac too.
+  EXPECT_EQ(ComputeHmac(DIGEST_SHA_1, "", "abc"), HmacContextHex("", "abc"));
+}
+
+TEST(MessageDigestTest, TestHmacContextReuse) {
+  const std::string key("Jefe");
+  const std::string input("what do ya want for nothing?");
+  HmacContext hmac;
+  hmac.SetKey(key.data(), key.size());
+  char output[HmacContext::kSize];
+  // The context is unchanged by use, and split input gives the same result.
+  for (size_t split = 0; split <= input.size(); ++split) {
+    EXPECT_EQ(sizeof(output),
+        hmac.Compute(input.data(), split, input.data() + split,
+                     input.size() - split, output, sizeof(output)));
+    EXPECT_EQ("effcdf6ae5eb2fa2d27416d5f184df9c259a7c79",
+        hex_encode(output, sizeof(output)));
+  }
+  EXPECT_EQ(0U, hmac.Compute(input.data(), input.size(),
+                             output, sizeof(output) - 1));
+  // Rekeying replaces the old key entirely.
+  hmac.SetKey(std::string(20, '\x0b').data(), 20);
+  EXPECT_EQ(sizeof(output), hmac.Compute("Hi There", 8,
+                                         output, sizeof(output)));
+  EXPECT_EQ("b617318655057264e28bc0b6fb378c8ef146be00",
+      hex_encode(output, sizeof(output)));
+}
+
 TEST(MessageDigestTest, TestBadHmac) {
   std::string output;
   EXPECT_FALSE(ComputeHmac("sha-9000", "key", "abc", &output));
@@ -33,11 +33,15 @@
 #include "talk/base/logging.h"
 #include "talk/base/messagequeue.h"
 #include "talk/base/physicalsocketserver.h"
+#include "talk/base/thread.h"
+#include "talk/base/timerwheel.h"
 
 
 namespace talk_base {
 
 const uint32 kMaxMsgLatency = 150;  // 150 ms
+// Messages that fit in the post queue are queued without locking.
+const int kPostQueueSize = 256;
 
 //------------------------------------------------------------------
 // MessageQueueManager
@@ -102,8 +106,8 @@ void MessageQueueManager::Clear(MessageHandler *handler) {
 // MessageQueue
 
 MessageQueue::MessageQueue(SocketServer* ss)
-    : ss_(ss), fStop_(false), fPeekKeep_(false), active_(false),
-      dmsgq_next_num_(0) {
+    : ss_(ss), fStop_(false), fPeekKeep_(false), active_(0),
+      postq_(kPostQueueSize), overflow_count_(0), dmsgq_next_num_(0) {
   if (!ss_) {
     // Currently, MessageQueue holds a socket server, and is the base class for
     // Thread.  It seems like it makes more sense for Thread to hold the socket
@@ -121,7 +125,7 @@ MessageQueue::~MessageQueue() {
   // that it always gets called when the queue
   // is going away.
   SignalQueueDestroyed();
-  if (active_) {
+  if (AtomicOps::AcquireLoad(&active_)) {
     MessageQueueManager::Instance()->Remove(this);
     Clear(NULL);
   }
@@ -135,6 +139,27 @@ void MessageQueue::set_socketserver(SocketServer* ss) {
   ss_->SetMessageQueue(this);
 }
 
+void MessageQueue::EnableTimerWheel() {
+  CritScope cs(&crit_);
+  if (timer_wheel_)
+    return;
+  timer_wheel_.reset(new TimerWheel());
+  uint32 now = Time();
+  PriorityQueue::container_type& pending = dmsgq_.container();
+  for (size_t i = 0; i < pending.size(); ++i) {
+    timer_wheel_->Insert(now, pending[i].msTrigger_, pending[i].num_,
+                         pending[i].msg_);
+  }
+  pending.clear();
+}
+
+size_t MessageQueue::size() const {
+  CritScope cs(&crit_);  // msgq_.size() is not thread safe.
+  return msgq_.size() + dmsgq_.size() + (fPeekKeep_ ? 1u : 0u) +
+      postq_.Size() + overflowq_.size() +
+      (timer_wheel_ ? timer_wheel_->size() : 0u);
+}
+
 void MessageQueue::Quit() {
   fStop_ = true;
   ss_->WakeUp();
@@ -193,6 +218,11 @@ bool MessageQueue::Get(Message *pmsg, int cmsWait, bool process_io) {
         // triggered and calculate the next trigger time.
         if (first_pass) {
           first_pass = false;
+          ReceivePosts();
+          if (timer_wheel_) {
+            timer_wheel_->Advance(msCurrent, &msgq_);
+            cmsDelayNext = timer_wheel_->GetDelay(msCurrent);
+          }
           while (!dmsgq_.empty()) {
             if (TimeIsLater(msCurrent, dmsgq_.top().msTrigger_)) {
               cmsDelayNext = TimeDiff(dmsgq_.top().msTrigger_, msCurrent);
@@ -264,15 +294,19 @@ void MessageQueue::ReceiveSends() {
 
 void MessageQueue::Post(MessageHandler *phandler, uint32 id,
     MessageData *pdata, bool time_sensitive) {
-  if (fStop_)
+  if (fStop_) {
+    delete pdata;
     return;
+  }
 
   // Keep thread safe
   // Add the message to the end of the queue
   // Signal for the multiplexer to return
 
-  CritScope cs(&crit_);
-  EnsureActive();
+  if (!AtomicOps::AcquireLoad(&active_)) {
+    CritScope cs(&crit_);
+    EnsureActive();
+  }
   Message msg;
   msg.phandler = phandler;
   msg.message_id = id;
@@ -280,14 +314,20 @@ void MessageQueue::Post(MessageHandler *phandler, uint32 id,
   if (time_sensitive) {
     msg.ts_sensitive = Time() + kMaxMsgLatency;
   }
-  msgq_.push_back(msg);
+  if (AtomicOps::AcquireLoad(&overflow_count_) != 0 || !postq_.Push(msg)) {
+    CritScope cs(&crit_);
+    overflowq_.push_back(msg);
+    AtomicOps::Increment(&overflow_count_);
+  }
   ss_->WakeUp();
 }
 
 void MessageQueue::DoDelayPost(int cmsDelay, uint32 tstamp,
     MessageHandler *phandler, uint32 id, MessageData* pdata) {
-  if (fStop_)
+  if (fStop_) {
+    delete pdata;
     return;
+  }
 
   // Keep thread safe
   // Add to the priority queue. Gets sorted soonest first.
@@ -299,8 +339,12 @@ void MessageQueue::DoDelayPost(int cmsDelay, uint32 tstamp,
   msg.phandler = phandler;
   msg.message_id = id;
   msg.pdata = pdata;
-  DelayedMessage dmsg(cmsDelay, tstamp, dmsgq_next_num_, msg);
-  dmsgq_.push(dmsg);
+  if (timer_wheel_) {
+    timer_wheel_->Insert(Time(), tstamp, dmsgq_next_num_, msg);
+  } else {
+    DelayedMessage dmsg(cmsDelay, tstamp, dmsgq_next_num_, msg);
+    dmsgq_.push(dmsg);
+  }
   // If this message queue processes 1 message every millisecond for 50 days,
   // we will wrap this number.  Even then, only messages with identical times
   // will be misordered, and then only briefly.  This is probably ok.
@@ -310,10 +354,14 @@ void MessageQueue::DoDelayPost(int cmsDelay, uint32 tstamp,
 
 int MessageQueue::GetDelay() {
   CritScope cs(&crit_);
+  ReceivePosts();
 
   if (!msgq_.empty())
     return 0;
 
+  if (timer_wheel_)
+    return timer_wheel_->GetDelay(Time());
+
   if (!dmsgq_.empty()) {
     int delay = TimeUntil(dmsgq_.top().msTrigger_);
     if (delay < 0)
@@ -327,6 +375,7 @@ int MessageQueue::GetDelay() {
 void MessageQueue::Clear(MessageHandler *phandler, uint32 id,
                          MessageList* removed) {
   CritScope cs(&crit_);
+  ReceiveAllPosts();
 
   // Remove messages with phandler
 
@@ -341,18 +390,20 @@ void MessageQueue::Clear(MessageHandler *phandler, uint32 id,
 
   // Remove from ordered message queue
 
-  for (MessageList::iterator it = msgq_.begin(); it != msgq_.end();) {
+  std::deque<Message>::iterator new_msgq_end = msgq_.begin();
+  for (std::deque<Message>::iterator it = new_msgq_end;
+       it != msgq_.end(); ++it) {
     if (it->Match(phandler, id)) {
       if (removed) {
         removed->push_back(*it);
       } else {
         delete it->pdata;
       }
-      it = msgq_.erase(it);
     } else {
-      ++it;
+      *new_msgq_end++ = *it;
     }
   }
+  msgq_.erase(new_msgq_end, msgq_.end());
 
   // Remove from priority queue. Not directly iterable, so use this approach
 
@@ -371,17 +422,56 @@ void MessageQueue::Clear(MessageHandler *phandler, uint32 id,
   }
   dmsgq_.container().erase(new_end, dmsgq_.container().end());
   dmsgq_.reheap();
+
+  if (timer_wheel_) {
+    MessageList wheel_removed;
+    timer_wheel_->Remove(phandler, id, removed ? removed : &wheel_removed);
+    for (MessageList::iterator it = wheel_removed.begin();
+         it != wheel_removed.end(); ++it) {
+      delete it->pdata;
+    }
+  }
 }
 
 void MessageQueue::Dispatch(Message *pmsg) {
   pmsg->phandler->OnMessage(pmsg);
 }
 
+void MessageQueue::ReceivePosts() {
+  ASSERT(crit_.CurrentThreadIsOwner());
+  Message msg;
+  while (postq_.Pop(&msg)) {
+    msgq_.push_back(msg);
+  }
+  // A thread's messages in overflowq_ were posted after its messages in
+  // postq_, since Post stops using postq_ while overflowq_ isn't empty. If a
+  // producer is still writing to postq_, wait for it to wake us up again.
+  if (!overflowq_.empty() && postq_.Size() == 0) {
+    msgq_.insert(msgq_.end(), overflowq_.begin(), overflowq_.end());
+    overflowq_.clear();
+    AtomicOps::ReleaseStore(&overflow_count_, 0);
+  }
+}
+
+void MessageQueue::ReceiveAllPosts() {
+  ASSERT(crit_.CurrentThreadIsOwner());
+  ReceivePosts();
+  // Pop stops at a cell that has been claimed but not yet written. Its
+  // producer is only copying the message in by then, so wait for it rather
+  // than leave it, and anything behind it, to be dispatched after a Clear.
+  // Producers can't add to postq_ while overflowq_ holds anything, and
+  // ReceivePosts moves overflowq_ once postq_ is empty.
+  while (postq_.Size() != 0 || !overflowq_.empty()) {
+    Thread::SleepMs(0);
+    ReceivePosts();
+  }
+}
+
 void MessageQueue::EnsureActive() {
   ASSERT(crit_.CurrentThreadIsOwner());
   if (!active_) {
-    active_ = true;
     MessageQueueManager::Instance()->Add(this);
+    AtomicOps::ReleaseStore(&active_, 1);
   }
 }
 
@@ -30,6 +30,7 @@
 
 #include <algorithm>
 #include <cstring>
+#include <deque>
 #include <list>
 #include <queue>
 #include <vector>
@@ -38,16 +39,19 @@
 #include "talk/base/constructormagic.h"
 #include "talk/base/criticalsection.h"
 #include "talk/base/messagehandler.h"
+#include "talk/base/mpscqueue.h"
 #include "talk/base/scoped_ptr.h"
 #include "talk/base/scoped_ref_ptr.h"
 #include "talk/base/sigslot.h"
 #include "talk/base/socketserver.h"
+#include "talk/base/threadlocalpool.h"
 #include "talk/base/timeutils.h"
 
 namespace talk_base {
 
 struct Message;
 class MessageQueue;
+class TimerWheel;
 
 // MessageQueueManager does cleanup of of message queues
 
@@ -71,11 +75,21 @@ class MessageQueueManager {
 
 // Derive from this for specialized data
 // App manages lifetime, except when messages are purged
+// MessageData is typically created on one thread and deleted on another for
+// every Post and Send, so it and its subclasses are allocated from
+// ThreadLocalPool rather than the shared heap.
 
 class MessageData {
  public:
   MessageData() {}
   virtual ~MessageData() {}
+
+  static void* operator new(size_t size) {
+    return ThreadLocalPool::Allocate(size);
+  }
+  static void operator delete(void* p, size_t size) {
+    ThreadLocalPool::Free(p, size);
+  }
 };
 
 template <class T>
@@ -194,6 +208,8 @@ class MessageQueue {
   virtual bool Get(Message *pmsg, int cmsWait = kForever,
                    bool process_io = true);
   virtual bool Peek(Message *pmsg, int cmsWait = 0);
+  // Messages posted once Quit() has been called are dropped, and their data
+  // deleted as Clear() would.
   virtual void Post(MessageHandler *phandler, uint32 id = 0,
                     MessageData *pdata = NULL, bool time_sensitive = false);
   virtual void PostDelayed(int cmsDelay, MessageHandler *phandler,
@@ -212,11 +228,14 @@ class MessageQueue {
   // Amount of time until the next message can be retrieved
   virtual int GetDelay();
 
+  // Keeps delayed messages in a TimerWheel rather than a heap from now on.
+  // Posting and clearing them then takes constant time, which suits queues
+  // with thousands of timers pending, at the cost of sometimes waking up
+  // early to move timers that are more than 256 ms out.
+  void EnableTimerWheel();
+
   bool empty() const { return size() == 0u; }
-  size_t size() const {
-    CritScope cs(&crit_);  // msgq_.size() is not thread safe.
-    return msgq_.size() + dmsgq_.size() + (fPeekKeep_ ? 1u : 0u);
-  }
+  size_t size() const;
 
   // Internally posts a message which causes the doomed object to be deleted
   template<class T> void Dispose(T* doomed) {
@@ -237,6 +256,12 @@ class MessageQueue {
   };
 
   void EnsureActive();
+  // Moves messages posted since the last call into msgq_. Requires crit_.
+  void ReceivePosts();
+  // Like ReceivePosts, but also waits for producers that have claimed a cell
+  // in postq_ and not yet filled it in, so that every message posted before
+  // the call ends up in msgq_. Requires crit_.
+  void ReceiveAllPosts();
   void DoDelayPost(int cmsDelay, uint32 tstamp, MessageHandler *phandler,
                    uint32 id, MessageData* pdata);
 
@@ -249,9 +274,20 @@ class MessageQueue {
   Message msgPeek_;
   // A message queue is active if it has ever had a message posted to it.
   // This also corresponds to being in MessageQueueManager's global list.
-  bool active_;
-  MessageList msgq_;
+  // Set under crit_, but read without it by Post.
+  volatile int active_;
+  // Messages taken from postq_ and overflowq_, and delayed messages that are
+  // due, in the order they will be returned by Get.
+  std::deque<Message> msgq_;
+  // Post adds messages here without taking crit_. When it is full, they go to
+  // overflowq_ under crit_ instead, and keep going there until ReceivePosts
+  // empties it, so that messages from one thread stay in order.
+  FixedSizeMpscQueue<Message> postq_;
+  MessageList overflowq_;
+  int overflow_count_;
   PriorityQueue dmsgq_;
+  // Used instead of dmsgq_ once EnableTimerWheel is called.
+  scoped_ptr<TimerWheel> timer_wheel_;
   uint32 dmsgq_next_num_;
   mutable CriticalSection crit_;
 
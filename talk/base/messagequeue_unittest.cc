@@ -27,6 +27,9 @@
 
 #include "talk/base/messagequeue.h"
 
+#include <algorithm>
+#include <vector>
+
 #include "talk/base/bind.h"
 #include "talk/base/gunit.h"
 #include "talk/base/logging.h"
@@ -94,6 +97,31 @@ TEST_F(MessageQueueTest,
   NullSocketServer nullss;
   MessageQueue q_nullss(&nullss);
   DelayedPostsWithIdenticalTimesAreProcessedInFifoOrder(&q_nullss);
+  MessageQueue q_wheel(&nullss);
+  q_wheel.EnableTimerWheel();
+  DelayedPostsWithIdenticalTimesAreProcessedInFifoOrder(&q_wheel);
+}
+
+TEST_F(MessageQueueTest, DelayedPostsWithTimerWheel) {
+  NullSocketServer nullss;
+  MessageQueue q(&nullss);
+  q.PostDelayed(10, NULL, 2);
+  q.PostDelayed(500, NULL, 4);
+  // Messages already waiting move into the wheel.
+  q.EnableTimerWheel();
+  q.PostDelayed(5, NULL, 1);
+  q.PostDelayed(300, NULL, 3);
+  q.Clear(NULL, 4);
+  EXPECT_EQ(3u, q.size());
+  EXPECT_GE(5, q.GetDelay());
+
+  Message msg;
+  for (uint32 i = 1; i <= 3; ++i) {
+    EXPECT_TRUE(q.Get(&msg, 1000));
+    EXPECT_EQ(i, msg.message_id);
+  }
+  EXPECT_FALSE(q.Get(&msg, 0));
+  EXPECT_EQ(kForever, q.GetDelay());
 }
 
 TEST_F(MessageQueueTest, DisposeNotLocked) {
@@ -130,3 +158,183 @@ TEST_F(MessageQueueTest, DiposeHandlerWithPostedMessagePending) {
   EXPECT_TRUE(deleted);
 }
 
+class DeletedMessageData : public MessageData {
+ public:
+  explicit DeletedMessageData(bool* deleted) : deleted_(deleted) { }
+  ~DeletedMessageData() {
+    *deleted_ = true;
+  }
+ private:
+  bool* deleted_;
+};
+
+// Posts to a queue that is quitting are dropped, and their data deleted.
+TEST_F(MessageQueueTest, PostAfterQuitDeletesData) {
+  bool deleted = false;
+  bool delayed_deleted = false;
+  Quit();
+  Post(NULL, 1, new DeletedMessageData(&deleted));
+  PostDelayed(10, NULL, 2, new DeletedMessageData(&delayed_deleted));
+  EXPECT_TRUE(deleted);
+  EXPECT_TRUE(delayed_deleted);
+  Restart();
+  EXPECT_EQ(0u, size());
+}
+
+TEST_F(MessageQueueTest, PostsBeyondPostQueueSizeAreProcessedInFifoOrder) {
+  const uint32 kNumPosts = 1000;
+  for (uint32 i = 0; i < kNumPosts; ++i) {
+    Post(NULL, i);
+  }
+  EXPECT_EQ(kNumPosts, size());
+  Clear(NULL, 1);
+  EXPECT_EQ(kNumPosts - 1, size());
+
+  Message msg;
+  for (uint32 i = 0; i < kNumPosts; ++i) {
+    if (i == 1)
+      continue;
+    EXPECT_TRUE(Get(&msg, 0));
+    EXPECT_EQ(i, msg.message_id);
+  }
+  EXPECT_FALSE(Get(&msg, 0));
+
+  // Once the overflow has been drained, posting goes back to normal.
+  Post(NULL, 1);
+  Post(NULL, 2);
+  EXPECT_TRUE(Get(&msg, 0));
+  EXPECT_EQ(1U, msg.message_id);
+  EXPECT_TRUE(Get(&msg, 0));
+  EXPECT_EQ(2U, msg.message_id);
+  EXPECT_TRUE(empty());
+}
+
+// Records how long each message took to arrive; the post time is carried in
+// the message id.
+class LatencyRecorder : public MessageHandler {
+ public:
+  explicit LatencyRecorder(int expected) : expected_(expected), done_(0) {
+    latencies_.reserve(expected);
+  }
+  virtual void OnMessage(Message* msg) {
+    latencies_.push_back(PostTime() - msg->message_id);
+    if (static_cast<int>(latencies_.size()) == expected_)
+      AtomicOps::Increment(&done_);
+  }
+  bool done() { return AtomicOps::AcquireLoad(&done_) != 0; }
+  std::vector<uint32>* latencies() { return &latencies_; }
+
+  // Nanoseconds, kept clear of the reserved message ids.
+  static uint32 PostTime() {
+    return static_cast<uint32>(TimeNanos()) & 0x7fffffff;
+  }
+
+ private:
+  int expected_;
+  int done_;
+  std::vector<uint32> latencies_;
+};
+
+class Poster : public Runnable {
+ public:
+  Poster(MessageQueue* queue, MessageHandler* handler, int count)
+      : queue_(queue), handler_(handler), count_(count) {}
+  virtual void Run(Thread* thread) {
+    for (int i = 0; i < count_; ++i) {
+      queue_->Post(handler_, LatencyRecorder::PostTime());
+    }
+  }
+ private:
+  MessageQueue* queue_;
+  MessageHandler* handler_;
+  int count_;
+};
+
+// Measures posts per second and post-to-dispatch latency with 1 to 8 threads
+// posting to one queue. Run with --gtest_also_run_disabled_tests and
+// --log "info" to see the numbers.
+TEST(MessageQueueBenchmark, DISABLED_CrossThreadPosts) {
+  const int kPostsPerThread = 100000;
+  for (int num_posters = 1; num_posters <= 8; num_posters *= 2) {
+    Thread consumer;
+    LatencyRecorder recorder(num_posters * kPostsPerThread);
+    consumer.Start();
+    std::vector<Poster*> posters;
+    std::vector<Thread*> threads;
+    uint64 start = TimeNanos();
+    for (int i = 0; i < num_posters; ++i) {
+      posters.push_back(new Poster(&consumer, &recorder, kPostsPerThread));
+      threads.push_back(new Thread());
+      threads[i]->Start(posters[i]);
+    }
+    while (!recorder.done()) {
+      Thread::Current()->SleepMs(1);
+    }
+    uint64 elapsed = TimeNanos() - start;
+    consumer.Stop();
+    for (int i = 0; i < num_posters; ++i) {
+      delete threads[i];
+      delete posters[i];
+    }
+
+    std::vector<uint32>* latencies = recorder.latencies();
+    std::sort(latencies->begin(), latencies->end());
+    LOG(LS_INFO) << num_posters << " posting threads: "
+                 << latencies->size() * kNumNanosecsPerSec / elapsed
+                 << " posts/sec, p50 "
+                 << (*latencies)[latencies->size() / 2] / 1000
+                 << "us, p99 "
+                 << (*latencies)[latencies->size() * 99 / 100] / 1000 << "us";
+  }
+}
+
+// A StunRequest-like handler with one retransmit timer pending.
+class TransactionHandler : public MessageHandler {
+ public:
+  virtual void OnMessage(Message* msg) {}
+};
+
+// Measures posting, clearing and polling with 100,000 transactions waiting
+// on retransmit timers, using the heap and the timer wheel. Run with
+// --gtest_also_run_disabled_tests and --log "info" to see the numbers.
+TEST(MessageQueueBenchmark, DISABLED_OutstandingTransactions) {
+  const int kTransactions = 100000;
+  const int kClears = 1000;
+  const int kPolls = 10000;
+  std::vector<TransactionHandler> handlers(kTransactions);
+  NullSocketServer nullss;
+  for (int wheel = 0; wheel < 2; ++wheel) {
+    MessageQueue q(&nullss);
+    if (wheel)
+      q.EnableTimerWheel();
+    uint32 seed = 1;
+
+    uint64 start = TimeNanos();
+    for (int i = 0; i < kTransactions; ++i) {
+      // STUN retransmits back off from 100 ms to 1.6 s; TURN refreshes and
+      // ICE pings are further out.
+      seed = seed * 1103515245 + 12345;
+      q.PostDelayed(100 + (seed >> 8) % 40000, &handlers[i]);
+    }
+    uint64 post_ns = (TimeNanos() - start) / kTransactions;
+
+    // Responses arrive and their transactions are deleted.
+    start = TimeNanos();
+    for (int i = 0; i < kClears; ++i) {
+      q.Clear(&handlers[i * (kTransactions / kClears)]);
+    }
+    uint64 clear_ns = (TimeNanos() - start) / kClears;
+
+    // What Get asks before it waits for I/O.
+    start = TimeNanos();
+    for (int i = 0; i < kPolls; ++i) {
+      q.GetDelay();
+    }
+    uint64 poll_ns = (TimeNanos() - start) / kPolls;
+
+    LOG(LS_INFO) << (wheel ? "Timer wheel" : "Heap") << ": post " << post_ns
+                 << " ns, clear " << clear_ns << " ns, poll " << poll_ns
+                 << " ns";
+    q.Clear(NULL);
+  }
+}
@@ -0,0 +1,141 @@
+/*
+ * libjingle
+ * Copyright 2013, Google Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef TALK_BASE_MPSCQUEUE_H_
+#define TALK_BASE_MPSCQUEUE_H_
+
+#include "talk/base/basictypes.h"
+#include "talk/base/common.h"
+#include "talk/base/constructormagic.h"
+#include "talk/base/criticalsection.h"
+#include "talk/base/scoped_ptr.h"
+
+namespace talk_base {
+
+// A bounded multi-producer, single-consumer queue that doesn't lock or
+// allocate once constructed. Any number of threads may call Push at the same
+// time, but Pop and Size must only be called by one thread at a time.
+// Each slot carries a sequence number saying whether it is free for the
+// producer that claims it, or holds a value for the consumer, so producers
+// only contend on the CAS that claims a slot.
+template <typename T>
+class FixedSizeMpscQueue {
+ public:
+  // |capacity| must be a power of two, and no more than 2^30.
+  explicit FixedSizeMpscQueue(int capacity)
+      : cells_(new Cell[capacity]), mask_(capacity - 1),
+        enqueue_pos_(0), dequeue_pos_(0) {
+    ASSERT(capacity > 0 && (capacity & mask_) == 0);
+    ASSERT(static_cast<uint32>(capacity) <= kPositionMask / 2 + 1);
+    for (int i = 0; i < capacity; ++i) {
+      cells_[i].sequence = i;
+    }
+  }
+
+  // Returns false, without blocking, if the queue is full.
+  bool Push(const T& value) {
+    Cell* cell;
+    int pos = AtomicOps::AcquireLoad(&enqueue_pos_);
+    while (true) {
+      cell = &cells_[pos & mask_];
+      int diff = Diff(AtomicOps::AcquireLoad(&cell->sequence), pos);
+      if (diff == 0) {
+        int prev = AtomicOps::CompareAndSwap(&enqueue_pos_, pos,
+                                             Add(pos, 1));
+        if (prev == pos)
+          break;
+        pos = prev;
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = AtomicOps::AcquireLoad(&enqueue_pos_);
+      }
+    }
+    cell->value = value;
+    AtomicOps::ReleaseStore(&cell->sequence, Add(pos, 1));
+    return true;
+  }
+
+  // Returns false if the queue is empty, or if the oldest value is still
+  // being written by its producer.
+  bool Pop(T* value) {
+    Cell* cell = &cells_[dequeue_pos_ & mask_];
+    if (Diff(AtomicOps::AcquireLoad(&cell->sequence),
+             Add(dequeue_pos_, 1)) < 0)
+      return false;
+    *value = cell->value;
+    AtomicOps::ReleaseStore(&cell->sequence, Add(dequeue_pos_, mask_ + 1));
+    dequeue_pos_ = Add(dequeue_pos_, 1);
+    return true;
+  }
+
+  // Includes values whose producers haven't finished writing them.
+  size_t Size() const {
+    return Diff(AtomicOps::AcquireLoad(&enqueue_pos_), dequeue_pos_);
+  }
+  size_t capacity() const { return mask_ + 1; }
+
+ private:
+  struct Cell {
+    volatile int sequence;
+    T value;
+  };
+
+  // Positions and sequence numbers count modulo 2^31, so they stay
+  // non-negative ints that can be advanced without overflowing. Since the
+  // capacity divides 2^31, the slot index is unaffected by the wrap.
+  static const uint32 kPositionMask = 0x7FFFFFFF;
+
+  static int Add(int a, int b) {
+    return static_cast<int>((static_cast<uint32>(a) + static_cast<uint32>(b)) &
+                            kPositionMask);
+  }
+  // Positions wrap around, so compare them as differences, taken to be
+  // negative when more than 2^30 apart.
+  static int Diff(int a, int b) {
+    uint32 d = (static_cast<uint32>(a) - static_cast<uint32>(b)) &
+               kPositionMask;
+    if (d > kPositionMask / 2)
+      return -static_cast<int>(kPositionMask - d) - 1;
+    return static_cast<int>(d);
+  }
+
+  scoped_array<Cell> cells_;
+  const int mask_;
+  // Keep the producers' and the consumer's positions on separate cache lines.
+  char pad0_[64];
+  volatile int enqueue_pos_;
+  char pad1_[64];
+  int dequeue_pos_;
+
+  DISALLOW_COPY_AND_ASSIGN(FixedSizeMpscQueue);
+};
+
+}  // namespace talk_base
+
+#endif  // TALK_BASE_MPSCQUEUE_H_
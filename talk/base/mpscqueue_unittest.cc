@@ -0,0 +1,125 @@
+/*
+ * libjingle
+ * Copyright 2013, Google Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <vector>
+
+#include "talk/base/gunit.h"
+#include "talk/base/mpscqueue.h"
+#include "talk/base/thread.h"
+
+namespace talk_base {
+
+TEST(FixedSizeMpscQueueTest, TestPushPop) {
+  FixedSizeMpscQueue<int> queue(2);
+  EXPECT_EQ(2u, queue.capacity());
+  EXPECT_EQ(0u, queue.Size());
+  EXPECT_TRUE(queue.Push(1));
+  EXPECT_TRUE(queue.Push(2));
+  EXPECT_EQ(2u, queue.Size());
+  EXPECT_FALSE(queue.Push(3));
+  int val;
+  EXPECT_TRUE(queue.Pop(&val));
+  EXPECT_EQ(1, val);
+  EXPECT_TRUE(queue.Push(3));
+  EXPECT_TRUE(queue.Pop(&val));
+  EXPECT_EQ(2, val);
+  EXPECT_TRUE(queue.Pop(&val));
+  EXPECT_EQ(3, val);
+  EXPECT_EQ(0u, queue.Size());
+  EXPECT_FALSE(queue.Pop(&val));
+}
+
+TEST(FixedSizeMpscQueueTest, TestWrapAround) {
+  FixedSizeMpscQueue<int> queue(4);
+  int val;
+  for (int i = 0; i < 1000; ++i) {
+    EXPECT_TRUE(queue.Push(i));
+    EXPECT_TRUE(queue.Push(-i));
+    EXPECT_TRUE(queue.Pop(&val));
+    EXPECT_EQ(i, val);
+    EXPECT_TRUE(queue.Pop(&val));
+    EXPECT_EQ(-i, val);
+  }
+  EXPECT_FALSE(queue.Pop(&val));
+}
+
+// Pushes kCount values tagged with its id, retrying while the queue is full.
+class MpscProducer : public Runnable {
+ public:
+  static const int kCount = 20000;
+  MpscProducer(FixedSizeMpscQueue<int>* queue, int id)
+      : queue_(queue), id_(id) {}
+  virtual void Run(Thread* thread) {
+    for (int i = 0; i < kCount; ++i) {
+      while (!queue_->Push(id_ * kCount + i)) {
+        Thread::Current()->SleepMs(0);
+      }
+    }
+  }
+ private:
+  FixedSizeMpscQueue<int>* queue_;
+  int id_;
+};
+
+// Checks that nothing is lost and each producer's values arrive in order.
+TEST(FixedSizeMpscQueueTest, TestMultipleProducers) {
+  const int kProducers = 4;
+  FixedSizeMpscQueue<int> queue(64);
+  std::vector<MpscProducer*> producers;
+  std::vector<Thread*> threads;
+  for (int i = 0; i < kProducers; ++i) {
+    producers.push_back(new MpscProducer(&queue, i));
+    threads.push_back(new Thread());
+    threads[i]->Start(producers[i]);
+  }
+  std::vector<int> next(kProducers, 0);
+  int received = 0;
+  while (received < kProducers * MpscProducer::kCount) {
+    int val;
+    if (!queue.Pop(&val)) {
+      Thread::Current()->SleepMs(0);
+      continue;
+    }
+    int id = val / MpscProducer::kCount;
+    if (id >= 0 && id < kProducers) {
+      EXPECT_EQ(next[id], val % MpscProducer::kCount);
+      next[id] = val % MpscProducer::kCount + 1;
+    } else {
+      ADD_FAILURE() << "Unexpected value " << val;
+    }
+    ++received;
+  }
+  for (int i = 0; i < kProducers; ++i) {
+    threads[i]->Stop();
+    delete threads[i];
+    delete producers[i];
+  }
+  EXPECT_EQ(0u, queue.Size());
+}
+
+}  // namespace talk_base
@@ -35,6 +35,7 @@
 
 #include "talk/base/byteorder.h"
 #include "talk/base/signalthread.h"
+#include "talk/base/workerpool.h"
 
 namespace talk_base {
 
@@ -67,7 +68,10 @@ int ResolveHostname(const std::string& hostname, int family,
 }
 
 // AsyncResolver
-AsyncResolver::AsyncResolver() : error_(0) {
+// Lookups are a single blocking call, so they share the default WorkerPool
+// rather than starting a thread each.
+AsyncResolver::AsyncResolver()
+    : SignalThread(WorkerPool::Default()), error_(0) {
 }
 
 void AsyncResolver::DoWork() {
@@ -0,0 +1,282 @@
+/*
+ * libjingle
+ * Copyright 2013, Google Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#if defined(LINUX) || defined(ANDROID)
+
+#include "talk/base/netlinkmonitor.h"
+
+#include <errno.h>
+#include <net/if.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+#include "talk/base/asyncfile.h"
+#include "talk/base/logging.h"
+#include "talk/base/physicalsocketserver.h"
+
+namespace talk_base {
+
+namespace {
+
+// Large enough for any single datagram the kernel sends, including the
+// replies to our link dump request.
+const size_t kReceiveBufferSize = 16 * 1024;
+
+std::string StringAttribute(rtattr* attr) {
+  const char* data = static_cast<const char*>(RTA_DATA(attr));
+  return std::string(data, strnlen(data, RTA_PAYLOAD(attr)));
+}
+
+IPAddress AddressAttribute(int family, rtattr* attr) {
+  if (family == AF_INET && RTA_PAYLOAD(attr) >= sizeof(in_addr)) {
+    return IPAddress(*static_cast<in_addr*>(RTA_DATA(attr)));
+  } else if (family == AF_INET6 && RTA_PAYLOAD(attr) >= sizeof(in6_addr)) {
+    return IPAddress(*static_cast<in6_addr*>(RTA_DATA(attr)));
+  }
+  return IPAddress();
+}
+
+}  // namespace
+
+NetlinkMonitor::NetlinkMonitor(PhysicalSocketServer* ss)
+    : ss_(ss),
+      fd_(-1) {
+}
+
+NetlinkMonitor::~NetlinkMonitor() {
+  Stop();
+}
+
+bool NetlinkMonitor::Start() {
+  int fd = socket(AF_NETLINK, SOCK_RAW, NETLINK_ROUTE);
+  if (fd < 0) {
+    LOG_ERR(LS_ERROR) << "Failed to open netlink socket";
+    return false;
+  }
+
+  sockaddr_nl local;
+  memset(&local, 0, sizeof(local));
+  local.nl_family = AF_NETLINK;
+  local.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
+  if (bind(fd, reinterpret_cast<sockaddr*>(&local), sizeof(local)) < 0) {
+    LOG_ERR(LS_ERROR) << "Failed to bind netlink socket";
+    close(fd);
+    return false;
+  }
+
+  // Learn the existing links, so that address notifications can be mapped to
+  // interface names. Failing that we fall back to if_indextoname.
+  struct {
+    nlmsghdr header;
+    rtgenmsg message;
+  } request;
+  memset(&request, 0, sizeof(request));
+  request.header.nlmsg_len = NLMSG_LENGTH(sizeof(rtgenmsg));
+  request.header.nlmsg_type = RTM_GETLINK;
+  request.header.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+  request.header.nlmsg_seq = 1;
+  request.message.rtgen_family = AF_UNSPEC;
+  if (send(fd, &request, request.header.nlmsg_len, 0) < 0) {
+    LOG_ERR(LS_WARNING) << "Failed to request the link list";
+  }
+
+  return Start(fd);
+}
+
+bool NetlinkMonitor::Start(int fd) {
+  ASSERT(!started());
+  fd_ = fd;
+  file_.reset(ss_->CreateFile(fd_));
+  file_->SignalReadEvent.connect(this, &NetlinkMonitor::OnReadEvent);
+  return true;
+}
+
+void NetlinkMonitor::Stop() {
+  if (!started())
+    return;
+
+  file_.reset();
+  close(fd_);
+  fd_ = -1;
+  links_.clear();
+}
+
+void NetlinkMonitor::OnReadEvent(AsyncFile* file) {
+  uint32 buffer[kReceiveBufferSize / sizeof(uint32)];
+  bool received = false;
+  while (true) {
+    sockaddr_nl sender;
+    socklen_t sender_len = sizeof(sender);
+    int len = recvfrom(fd_, buffer, sizeof(buffer), 0,
+                       reinterpret_cast<sockaddr*>(&sender), &sender_len);
+    if (len < 0) {
+      if (errno == EINTR)
+        continue;
+      if (errno == ENOBUFS) {
+        LOG(LS_WARNING) << "Netlink notifications were dropped";
+        SignalOverflow();
+        continue;
+      }
+      if (errno != EAGAIN && errno != EWOULDBLOCK)
+        LOG_ERR(LS_WARNING) << "Failed to read netlink socket";
+      break;
+    }
+    if (len == 0)
+      break;
+
+    // Only the kernel gets to tell us about interfaces.
+    if (sender_len == sizeof(sender) && sender.nl_family == AF_NETLINK &&
+        sender.nl_pid != 0) {
+      continue;
+    }
+
+    for (nlmsghdr* header = reinterpret_cast<nlmsghdr*>(buffer);
+         NLMSG_OK(header, len); header = NLMSG_NEXT(header, len)) {
+      HandleMessage(header);
+    }
+    received = true;
+  }
+
+  if (received)
+    SignalBatchDone();
+}
+
+void NetlinkMonitor::HandleMessage(nlmsghdr* header) {
+  switch (header->nlmsg_type) {
+    case RTM_NEWLINK:
+    case RTM_DELLINK:
+      HandleLinkMessage(header);
+      break;
+    case RTM_NEWADDR:
+    case RTM_DELADDR:
+      HandleAddressMessage(header);
+      break;
+    default:
+      // NLMSG_DONE ends our link dump; nothing else is of interest.
+      break;
+  }
+}
+
+void NetlinkMonitor::HandleLinkMessage(nlmsghdr* header) {
+  if (header->nlmsg_len < NLMSG_LENGTH(sizeof(ifinfomsg)))
+    return;
+
+  ifinfomsg* info = static_cast<ifinfomsg*>(NLMSG_DATA(header));
+  std::string name;
+  int attr_len = IFLA_PAYLOAD(header);
+  for (rtattr* attr = IFLA_RTA(info); RTA_OK(attr, attr_len);
+       attr = RTA_NEXT(attr, attr_len)) {
+    if (attr->rta_type == IFLA_IFNAME)
+      name = StringAttribute(attr);
+  }
+
+  if (header->nlmsg_type == RTM_DELLINK) {
+    LinkMap::iterator it = links_.find(info->ifi_index);
+    if (it != links_.end()) {
+      if (name.empty())
+        name = it->second.name;
+      links_.erase(it);
+    }
+    if (!name.empty())
+      SignalLinkRemoved(name);
+    return;
+  }
+
+  Link& link = links_[info->ifi_index];
+  if (!name.empty())
+    link.name = name;
+  link.flags = info->ifi_flags;
+}
+
+void NetlinkMonitor::HandleAddressMessage(nlmsghdr* header) {
+  if (header->nlmsg_len < NLMSG_LENGTH(sizeof(ifaddrmsg)))
+    return;
+
+  ifaddrmsg* message = static_cast<ifaddrmsg*>(NLMSG_DATA(header));
+  int family = message->ifa_family;
+  if (family != AF_INET && family != AF_INET6)
+    return;
+
+  IPAddress local;
+  IPAddress address;
+  std::string label;
+  int attr_len = IFA_PAYLOAD(header);
+  for (rtattr* attr = IFA_RTA(message); RTA_OK(attr, attr_len);
+       attr = RTA_NEXT(attr, attr_len)) {
+    switch (attr->rta_type) {
+      case IFA_LOCAL:
+        local = AddressAttribute(family, attr);
+        break;
+      case IFA_ADDRESS:
+        address = AddressAttribute(family, attr);
+        break;
+      case IFA_LABEL:
+        label = StringAttribute(attr);
+        break;
+    }
+  }
+
+  NetlinkAddress result;
+  // On point-to-point links IFA_ADDRESS is the peer and IFA_LOCAL our end.
+  result.ip = (local.family() != AF_UNSPEC) ? local : address;
+  if (result.ip.family() == AF_UNSPEC)
+    return;
+  result.prefix_length = message->ifa_prefixlen;
+  if (family == AF_INET6 && message->ifa_scope == RT_SCOPE_LINK)
+    result.scope_id = message->ifa_index;
+
+  LinkMap::const_iterator link = links_.find(message->ifa_index);
+  result.name = label;
+  if (result.name.empty() && link != links_.end())
+    result.name = link->second.name;
+  if (result.name.empty()) {
+    char name[IF_NAMESIZE];
+    if (if_indextoname(message->ifa_index, name))
+      result.name = name;
+  }
+  if (result.name.empty()) {
+    LOG(LS_WARNING) << "Ignoring address on unknown interface "
+                    << message->ifa_index;
+    return;
+  }
+  result.loopback = (message->ifa_scope == RT_SCOPE_HOST) ||
+      (link != links_.end() && (link->second.flags & IFF_LOOPBACK));
+
+  if (header->nlmsg_type == RTM_NEWADDR) {
+    SignalAddressAdded(result);
+  } else {
+    SignalAddressRemoved(result);
+  }
+}
+
+}  // namespace talk_base
+
+#endif  // defined(LINUX) || defined(ANDROID)
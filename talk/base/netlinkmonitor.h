@@ -0,0 +1,117 @@
+/*
+ * libjingle
+ * Copyright 2013, Google Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef TALK_BASE_NETLINKMONITOR_H_
+#define TALK_BASE_NETLINKMONITOR_H_
+
+#if defined(LINUX) || defined(ANDROID)
+
+#include <map>
+#include <string>
+
+#include "talk/base/basictypes.h"
+#include "talk/base/constructormagic.h"
+#include "talk/base/ipaddress.h"
+#include "talk/base/scoped_ptr.h"
+#include "talk/base/sigslot.h"
+
+struct nlmsghdr;
+
+namespace talk_base {
+
+class AsyncFile;
+class PhysicalSocketServer;
+
+// An interface address, as reported by a netlink notification.
+struct NetlinkAddress {
+  NetlinkAddress() : prefix_length(0), scope_id(0), loopback(false) {}
+
+  // The interface name, or the label of an IPv4 alias such as "eth0:1", so
+  // that it matches what getifaddrs reports.
+  std::string name;
+  IPAddress ip;
+  int prefix_length;
+  // The interface index for link-local IPv6 addresses, 0 otherwise.
+  int scope_id;
+  bool loopback;
+};
+
+// Listens on a NETLINK_ROUTE socket for link and address changes and reports
+// each one as it happens. The socket is read by |ss|, so all signals are
+// emitted on the thread running it.
+class NetlinkMonitor : public sigslot::has_slots<> {
+ public:
+  explicit NetlinkMonitor(PhysicalSocketServer* ss);
+  ~NetlinkMonitor();
+
+  // Opens a netlink socket subscribed to link and IPv4/IPv6 address
+  // notifications, and asks the kernel for the current links.
+  bool Start();
+  // Reads netlink messages from |fd| instead of opening a socket. Takes
+  // ownership of |fd|. Tests use this to feed in messages of their own.
+  bool Start(int fd);
+  void Stop();
+  bool started() const { return fd_ >= 0; }
+
+  sigslot::signal1<const NetlinkAddress&> SignalAddressAdded;
+  sigslot::signal1<const NetlinkAddress&> SignalAddressRemoved;
+  // Emitted with the interface name when a link is removed.
+  sigslot::signal1<const std::string&> SignalLinkRemoved;
+  // Emitted when the kernel dropped notifications because they weren't read
+  // fast enough. Listeners must re-read the full interface state.
+  sigslot::signal0<> SignalOverflow;
+  // Emitted after all notifications that were pending have been reported.
+  sigslot::signal0<> SignalBatchDone;
+
+ private:
+  struct Link {
+    Link() : flags(0) {}
+    std::string name;
+    uint32 flags;
+  };
+  typedef std::map<int, Link> LinkMap;
+
+  void OnReadEvent(AsyncFile* file);
+  void HandleMessage(nlmsghdr* header);
+  void HandleLinkMessage(nlmsghdr* header);
+  void HandleAddressMessage(nlmsghdr* header);
+
+  PhysicalSocketServer* ss_;
+  int fd_;
+  scoped_ptr<AsyncFile> file_;
+  // Interface index to name and flags, as learned from link messages.
+  LinkMap links_;
+
+  DISALLOW_COPY_AND_ASSIGN(NetlinkMonitor);
+};
+
+}  // namespace talk_base
+
+#endif  // defined(LINUX) || defined(ANDROID)
+
+#endif  // TALK_BASE_NETLINKMONITOR_H_
@@ -0,0 +1,414 @@
+/*
+ * libjingle
+ * Copyright 2013, Google Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "talk/base/netlinkmonitor.h"
+
+#include <net/if.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+#include <string>
+#include <vector>
+
+#include "talk/base/gunit.h"
+#include "talk/base/network.h"
+#include "talk/base/physicalsocketserver.h"
+#include "talk/base/thread.h"
+
+namespace talk_base {
+
+static const int kTimeout = 1000;
+static const int kFakeIndex = 3;
+static const int kLoopbackIndex = 4;
+
+// Builds a datagram of netlink messages, laid out the way the kernel does.
+class NetlinkWriter {
+ public:
+  void AddLink(uint16 type, int index, const std::string& name,
+               uint32 flags) {
+    ifinfomsg info;
+    memset(&info, 0, sizeof(info));
+    info.ifi_family = AF_UNSPEC;
+    info.ifi_index = index;
+    info.ifi_flags = flags;
+    BeginMessage(type, &info, sizeof(info));
+    AddAttribute(IFLA_IFNAME, name.c_str(), name.size() + 1);
+    EndMessage();
+  }
+
+  void AddAddress(uint16 type, int index, const IPAddress& ip,
+                  int prefix_length, uint8 scope) {
+    AddAddress(type, index, ip, IPAddress(), prefix_length, scope, "");
+  }
+
+  // |peer|, if set, is reported as IFA_ADDRESS with |ip| as IFA_LOCAL, as
+  // for point-to-point links.
+  void AddAddress(uint16 type, int index, const IPAddress& ip,
+                  const IPAddress& peer, int prefix_length, uint8 scope,
+                  const std::string& label) {
+    ifaddrmsg message;
+    memset(&message, 0, sizeof(message));
+    message.ifa_family = ip.family();
+    message.ifa_prefixlen = prefix_length;
+    message.ifa_scope = scope;
+    message.ifa_index = index;
+    BeginMessage(type, &message, sizeof(message));
+    if (peer.family() == AF_UNSPEC) {
+      AddAddressAttribute(IFA_ADDRESS, ip);
+    } else {
+      AddAddressAttribute(IFA_ADDRESS, peer);
+      AddAddressAttribute(IFA_LOCAL, ip);
+    }
+    if (!label.empty())
+      AddAttribute(IFA_LABEL, label.c_str(), label.size() + 1);
+    EndMessage();
+  }
+
+  bool SendTo(int fd) {
+    int sent = send(fd, buffer_.data(), buffer_.size(), 0);
+    buffer_.clear();
+    return sent > 0;
+  }
+
+ private:
+  void Append(const void* data, size_t size) {
+    buffer_.append(static_cast<const char*>(data), size);
+    while (buffer_.size() % NLMSG_ALIGNTO)
+      buffer_.push_back('\0');
+  }
+
+  void BeginMessage(uint16 type, const void* header, size_t size) {
+    message_start_ = buffer_.size();
+    nlmsghdr nlh;
+    memset(&nlh, 0, sizeof(nlh));
+    nlh.nlmsg_type = type;
+    Append(&nlh, sizeof(nlh));
+    Append(header, size);
+  }
+
+  void AddAttribute(uint16 type, const void* data, size_t size) {
+    rtattr attr;
+    attr.rta_type = type;
+    attr.rta_len = RTA_LENGTH(size);
+    Append(&attr, sizeof(attr));
+    Append(data, size);
+  }
+
+  void AddAddressAttribute(uint16 type, const IPAddress& ip) {
+    if (ip.family() == AF_INET) {
+      in_addr addr = ip.ipv4_address();
+      AddAttribute(type, &addr, sizeof(addr));
+    } else {
+      in6_addr addr = ip.ipv6_address();
+      AddAttribute(type, &addr, sizeof(addr));
+    }
+  }
+
+  void EndMessage() {
+    uint32 len = buffer_.size() - message_start_;
+    memcpy(&buffer_[message_start_], &len, sizeof(len));
+  }
+
+  std::string buffer_;
+  size_t message_start_;
+};
+
+class NetlinkMonitorTest : public testing::Test, public sigslot::has_slots<> {
+ public:
+  NetlinkMonitorTest() : monitor_(&ss_), peer_(-1), batches_(0) {}
+
+  virtual void SetUp() {
+    int fds[2];
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_DGRAM, 0, fds));
+    peer_ = fds[1];
+    ASSERT_TRUE(monitor_.Start(fds[0]));
+    monitor_.SignalAddressAdded.connect(this,
+        &NetlinkMonitorTest::OnAddressAdded);
+    monitor_.SignalAddressRemoved.connect(this,
+        &NetlinkMonitorTest::OnAddressRemoved);
+    monitor_.SignalLinkRemoved.connect(this,
+        &NetlinkMonitorTest::OnLinkRemoved);
+    monitor_.SignalBatchDone.connect(this, &NetlinkMonitorTest::OnBatchDone);
+  }
+
+  virtual void TearDown() {
+    monitor_.Stop();
+    close(peer_);
+  }
+
+  // Sends what |writer| holds and lets the monitor read it.
+  void Send(NetlinkWriter* writer) {
+    ASSERT_TRUE(writer->SendTo(peer_));
+    ss_.Wait(0, true);
+  }
+
+  void OnAddressAdded(const NetlinkAddress& address) {
+    added_.push_back(address);
+  }
+  void OnAddressRemoved(const NetlinkAddress& address) {
+    removed_.push_back(address);
+  }
+  void OnLinkRemoved(const std::string& name) {
+    removed_links_.push_back(name);
+  }
+  void OnBatchDone() {
+    ++batches_;
+  }
+
+ protected:
+  PhysicalSocketServer ss_;
+  NetlinkMonitor monitor_;
+  int peer_;
+  std::vector<NetlinkAddress> added_;
+  std::vector<NetlinkAddress> removed_;
+  std::vector<std::string> removed_links_;
+  int batches_;
+};
+
+// Tests that addresses are reported with the name of their link.
+TEST_F(NetlinkMonitorTest, TestAddressAdded) {
+  NetlinkWriter writer;
+  writer.AddLink(RTM_NEWLINK, kFakeIndex, "fake0", IFF_UP);
+  writer.AddAddress(RTM_NEWADDR, kFakeIndex, IPAddress(0xC0A84D05U), 24,
+                    RT_SCOPE_UNIVERSE);
+  Send(&writer);
+  ASSERT_EQ(1U, added_.size());
+  EXPECT_EQ("fake0", added_[0].name);
+  EXPECT_EQ(IPAddress(0xC0A84D05U), added_[0].ip);
+  EXPECT_EQ(24, added_[0].prefix_length);
+  EXPECT_EQ(0, added_[0].scope_id);
+  EXPECT_FALSE(added_[0].loopback);
+  EXPECT_EQ(1, batches_);
+}
+
+// Tests that IPv4 aliases are named by their label, and that the local end of
+// a point-to-point link is reported rather than its peer.
+TEST_F(NetlinkMonitorTest, TestAliasAndPointToPoint) {
+  NetlinkWriter writer;
+  writer.AddLink(RTM_NEWLINK, kFakeIndex, "fake0", IFF_UP);
+  writer.AddAddress(RTM_NEWADDR, kFakeIndex, IPAddress(0x0A000001U),
+                    IPAddress(0x0A000002U), 32, RT_SCOPE_UNIVERSE, "fake0:1");
+  Send(&writer);
+  ASSERT_EQ(1U, added_.size());
+  EXPECT_EQ("fake0:1", added_[0].name);
+  EXPECT_EQ(IPAddress(0x0A000001U), added_[0].ip);
+}
+
+// Tests that link-local IPv6 addresses are scoped to their interface.
+TEST_F(NetlinkMonitorTest, TestLinkLocalScope) {
+  IPAddress ip;
+  EXPECT_TRUE(IPFromString("fe80::1234:5678:abcd:ef12", &ip));
+  NetlinkWriter writer;
+  writer.AddLink(RTM_NEWLINK, kFakeIndex, "fake0", IFF_UP);
+  writer.AddAddress(RTM_NEWADDR, kFakeIndex, ip, 64, RT_SCOPE_LINK);
+  Send(&writer);
+  ASSERT_EQ(1U, added_.size());
+  EXPECT_EQ(ip, added_[0].ip);
+  EXPECT_EQ(kFakeIndex, added_[0].scope_id);
+}
+
+// Tests that addresses on loopback links, or with host scope, are flagged.
+TEST_F(NetlinkMonitorTest, TestLoopback) {
+  NetlinkWriter writer;
+  writer.AddLink(RTM_NEWLINK, kLoopbackIndex, "fakelo",
+                 IFF_UP | IFF_LOOPBACK);
+  writer.AddAddress(RTM_NEWADDR, kLoopbackIndex, IPAddress(0x7F000002U), 8,
+                    RT_SCOPE_UNIVERSE);
+  writer.AddLink(RTM_NEWLINK, kFakeIndex, "fake0", IFF_UP);
+  writer.AddAddress(RTM_NEWADDR, kFakeIndex, IPAddress(0x7F000003U), 8,
+                    RT_SCOPE_HOST);
+  Send(&writer);
+  ASSERT_EQ(2U, added_.size());
+  EXPECT_TRUE(added_[0].loopback);
+  EXPECT_TRUE(added_[1].loopback);
+  // All four messages came in one datagram.
+  EXPECT_EQ(1, batches_);
+}
+
+// Tests that removed addresses and links are reported.
+TEST_F(NetlinkMonitorTest, TestRemovals) {
+  NetlinkWriter writer;
+  writer.AddLink(RTM_NEWLINK, kFakeIndex, "fake0", IFF_UP);
+  Send(&writer);
+  writer.AddAddress(RTM_DELADDR, kFakeIndex, IPAddress(0xC0A84D05U), 24,
+                    RT_SCOPE_UNIVERSE);
+  Send(&writer);
+  writer.AddLink(RTM_DELLINK, kFakeIndex, "fake0", 0);
+  Send(&writer);
+  EXPECT_TRUE(added_.empty());
+  ASSERT_EQ(1U, removed_.size());
+  EXPECT_EQ("fake0", removed_[0].name);
+  EXPECT_EQ(IPAddress(0xC0A84D05U), removed_[0].ip);
+  ASSERT_EQ(1U, removed_links_.size());
+  EXPECT_EQ("fake0", removed_links_[0]);
+  EXPECT_EQ(3, batches_);
+}
+
+// Tests that addresses on interfaces we can't name are dropped.
+TEST_F(NetlinkMonitorTest, TestUnknownInterface) {
+  NetlinkWriter writer;
+  writer.AddAddress(RTM_NEWADDR, 0x7FFFFFF0, IPAddress(0xC0A84D05U), 24,
+                    RT_SCOPE_UNIVERSE);
+  Send(&writer);
+  EXPECT_TRUE(added_.empty());
+  EXPECT_EQ(1, batches_);
+}
+
+// A BasicNetworkManager that reads netlink messages from a socketpair.
+class FakeNetlinkNetworkManager : public BasicNetworkManager {
+ public:
+  explicit FakeNetlinkNetworkManager(PhysicalSocketServer* ss)
+      : ss_(ss), peer_(-1) {
+    set_netlink_socketserver(ss);
+  }
+  virtual ~FakeNetlinkNetworkManager() {
+    if (peer_ >= 0)
+      close(peer_);
+  }
+
+  int peer() const { return peer_; }
+
+ protected:
+  virtual NetlinkMonitor* CreateNetlinkMonitor() {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_DGRAM, 0, fds) != 0)
+      return NULL;
+    NetlinkMonitor* monitor = new NetlinkMonitor(ss_);
+    monitor->Start(fds[0]);
+    peer_ = fds[1];
+    return monitor;
+  }
+
+ private:
+  PhysicalSocketServer* ss_;
+  int peer_;
+};
+
+class NetlinkNetworkManagerTest : public testing::Test,
+                                  public sigslot::has_slots<> {
+ public:
+  NetlinkNetworkManagerTest()
+      : ss_scope_(&ss_),
+        manager_(&ss_),
+        changes_(0) {
+    manager_.SignalNetworksChanged.connect(this,
+        &NetlinkNetworkManagerTest::OnNetworksChanged);
+  }
+
+  void OnNetworksChanged() {
+    ++changes_;
+  }
+
+  Network* FindNetwork(const std::string& name) {
+    NetworkManager::NetworkList list;
+    manager_.GetNetworks(&list);
+    for (size_t i = 0; i < list.size(); ++i) {
+      if (list[i]->name() == name)
+        return list[i];
+    }
+    return NULL;
+  }
+
+  void Send(NetlinkWriter* writer) {
+    ASSERT_TRUE(writer->SendTo(manager_.peer()));
+    Thread::Current()->ProcessMessages(0);
+  }
+
+ protected:
+  PhysicalSocketServer ss_;
+  SocketServerScope ss_scope_;
+  FakeNetlinkNetworkManager manager_;
+  int changes_;
+};
+
+// Tests that netlink notifications are applied to the network list, and that
+// SignalNetworksChanged is only emitted when the list really changed.
+TEST_F(NetlinkNetworkManagerTest, TestIncrementalUpdates) {
+  manager_.StartUpdating();
+  Thread::Current()->ProcessMessages(0);
+  // The full update that starts things off.
+  EXPECT_EQ(1, changes_);
+  EXPECT_GE(manager_.peer(), 0);
+
+  NetlinkWriter writer;
+  writer.AddLink(RTM_NEWLINK, kFakeIndex, "fake0", IFF_UP);
+  writer.AddAddress(RTM_NEWADDR, kFakeIndex, IPAddress(0xC0A84D05U), 24,
+                    RT_SCOPE_UNIVERSE);
+  Send(&writer);
+  EXPECT_EQ(2, changes_);
+  Network* network = FindNetwork("fake0");
+  ASSERT_TRUE(network != NULL);
+  EXPECT_EQ(IPAddress(0xC0A84D00U), network->prefix());
+  EXPECT_EQ(IPAddress(0xC0A84D05U), network->ip());
+
+  // Known addresses and loopback addresses aren't changes.
+  writer.AddAddress(RTM_NEWADDR, kFakeIndex, IPAddress(0xC0A84D05U), 24,
+                    RT_SCOPE_UNIVERSE);
+  writer.AddAddress(RTM_NEWADDR, kFakeIndex, IPAddress(0x7F000002U), 8,
+                    RT_SCOPE_HOST);
+  Send(&writer);
+  EXPECT_EQ(2, changes_);
+
+  // A second address on the same prefix goes to the same network.
+  writer.AddAddress(RTM_NEWADDR, kFakeIndex, IPAddress(0xC0A84D06U), 24,
+                    RT_SCOPE_UNIVERSE);
+  Send(&writer);
+  EXPECT_EQ(3, changes_);
+  EXPECT_EQ(network, FindNetwork("fake0"));
+  EXPECT_EQ(2U, network->GetIPs().size());
+
+  writer.AddAddress(RTM_DELADDR, kFakeIndex, IPAddress(0xC0A84D05U), 24,
+                    RT_SCOPE_UNIVERSE);
+  Send(&writer);
+  EXPECT_EQ(4, changes_);
+  ASSERT_EQ(1U, network->GetIPs().size());
+  EXPECT_EQ(IPAddress(0xC0A84D06U), network->ip());
+
+  // Removing the link takes its networks with it.
+  writer.AddLink(RTM_DELLINK, kFakeIndex, "fake0", 0);
+  Send(&writer);
+  EXPECT_EQ(5, changes_);
+  EXPECT_TRUE(FindNetwork("fake0") == NULL);
+
+  // When it comes back, the same Network object is handed out again.
+  writer.AddLink(RTM_NEWLINK, kFakeIndex, "fake0", IFF_UP);
+  writer.AddAddress(RTM_NEWADDR, kFakeIndex, IPAddress(0xC0A84D07U), 24,
+                    RT_SCOPE_UNIVERSE);
+  Send(&writer);
+  EXPECT_EQ(6, changes_);
+  EXPECT_EQ(network, FindNetwork("fake0"));
+  ASSERT_EQ(1U, network->GetIPs().size());
+  EXPECT_EQ(IPAddress(0xC0A84D07U), network->ip());
+
+  manager_.StopUpdating();
+}
+
+}  // namespace talk_base
@@ -55,6 +55,9 @@
 
 #include "talk/base/host.h"
 #include "talk/base/logging.h"
+#if defined(LINUX) || defined(ANDROID)
+#include "talk/base/netlinkmonitor.h"
+#endif
 #include "talk/base/scoped_ptr.h"
 #include "talk/base/socket.h"  // includes something that makes windows happy
 #include "talk/base/stream.h"
@@ -81,6 +84,22 @@ std::string MakeNetworkKey(const std::string& name, const IPAddress& prefix,
   return ost.str();
 }
 
+std::string MakeNetworkKey(const Network* network) {
+  return MakeNetworkKey(network->name(), network->prefix(),
+                        network->prefix_length());
+}
+
+// Inserts |network| into |list|, keeping the network key order that
+// MergeNetworkList produces.
+void InsertNetworkInKeyOrder(Network* network,
+                             NetworkManager::NetworkList* list) {
+  std::string key = MakeNetworkKey(network);
+  NetworkManager::NetworkList::iterator it = list->begin();
+  while (it != list->end() && MakeNetworkKey(*it) < key)
+    ++it;
+  list->insert(it, network);
+}
+
 bool CompareNetworks(const Network* a, const Network* b) {
   if (a->prefix_length() == b->prefix_length()) {
     if (a->name() == b->name()) {
@@ -173,9 +192,86 @@ void NetworkManagerBase::MergeNetworkList(const NetworkList& new_networks,
   networks_ = merged_list;
 }
 
+bool NetworkManagerBase::AddNetworkAddress(Network* network) {
+  scoped_ptr<Network> owned_network(network);
+  ASSERT(network->GetIPs().size() == 1);
+  IPAddress ip = network->ip();
+  std::string key = MakeNetworkKey(network);
+  NetworkMap::iterator existing = networks_map_.find(key);
+  if (existing == networks_map_.end()) {
+    networks_map_[key] = owned_network.release();
+    InsertNetworkInKeyOrder(network, &networks_);
+    return true;
+  }
+
+  Network* net = existing->second;
+  if (std::find(networks_.begin(), networks_.end(), net) == networks_.end()) {
+    // The network had gone away and is back; its old addresses are stale.
+    net->SetIPs(std::vector<IPAddress>(1, ip), true);
+    InsertNetworkInKeyOrder(net, &networks_);
+    return true;
+  }
+
+  const std::vector<IPAddress>& ips = net->GetIPs();
+  if (std::find(ips.begin(), ips.end(), ip) != ips.end())
+    return false;
+  net->AddIP(ip);
+  return true;
+}
+
+bool NetworkManagerBase::RemoveNetworkAddress(const std::string& name,
+                                              const IPAddress& ip,
+                                              int prefix_length) {
+  NetworkMap::iterator existing = networks_map_.find(
+      MakeNetworkKey(name, TruncateIP(ip, prefix_length), prefix_length));
+  if (existing == networks_map_.end())
+    return false;
+
+  Network* net = existing->second;
+  NetworkList::iterator it =
+      std::find(networks_.begin(), networks_.end(), net);
+  if (it == networks_.end())
+    return false;
+
+  std::vector<IPAddress> ips(net->GetIPs());
+  std::vector<IPAddress>::iterator ip_it = std::find(ips.begin(), ips.end(), ip);
+  if (ip_it == ips.end())
+    return false;
+
+  if (ips.size() == 1) {
+    // As in MergeNetworkList, the object stays in |networks_map_| so that it
+    // is handed out again if the network comes back.
+    networks_.erase(it);
+  } else {
+    ips.erase(ip_it);
+    net->SetIPs(ips, true);
+  }
+  return true;
+}
+
+bool NetworkManagerBase::RemoveInterfaceNetworks(const std::string& name) {
+  std::string alias_prefix = name + ":";
+  bool changed = false;
+  NetworkList::iterator it = networks_.begin();
+  while (it != networks_.end()) {
+    const std::string& net_name = (*it)->name();
+    if (net_name == name ||
+        net_name.compare(0, alias_prefix.size(), alias_prefix) == 0) {
+      it = networks_.erase(it);
+      changed = true;
+    } else {
+      ++it;
+    }
+  }
+  return changed;
+}
+
 BasicNetworkManager::BasicNetworkManager()
     : thread_(NULL),
-      start_count_(0) {
+      sent_first_update_(false),
+      start_count_(0),
+      netlink_ss_(NULL),
+      netlink_changed_(false) {
 }
 
 BasicNetworkManager::~BasicNetworkManager() {
@@ -433,6 +529,12 @@ void BasicNetworkManager::StartUpdating() {
     if (sent_first_update_)
       thread_->Post(this, kSignalNetworksMessage);
   } else {
+#if defined(LINUX) || defined(ANDROID)
+    // Subscribe before the first full update, so that no change can slip in
+    // between the two.
+    if (netlink_ss_)
+      StartNetlinkMonitor();
+#endif
     thread_->Post(this, kUpdateNetworksMessage);
   }
   ++start_count_;
@@ -447,6 +549,10 @@ void BasicNetworkManager::StopUpdating() {
   if (!start_count_) {
     thread_->Clear(this);
     sent_first_update_ = false;
+#if defined(LINUX) || defined(ANDROID)
+    netlink_monitor_.reset();
+    netlink_changed_ = false;
+#endif
   }
 }
 
@@ -483,9 +589,82 @@ void BasicNetworkManager::DoUpdateNetworks() {
     }
   }
 
+#if defined(LINUX) || defined(ANDROID)
+  // Netlink tells us about later changes; there is nothing to poll for.
+  if (netlink_monitor_)
+    return;
+#endif
   thread_->PostDelayed(kNetworksUpdateIntervalMs, this, kUpdateNetworksMessage);
 }
 
+#if defined(LINUX) || defined(ANDROID)
+NetlinkMonitor* BasicNetworkManager::CreateNetlinkMonitor() {
+  scoped_ptr<NetlinkMonitor> monitor(new NetlinkMonitor(netlink_ss_));
+  if (!monitor->Start())
+    return NULL;
+  return monitor.release();
+}
+
+void BasicNetworkManager::StartNetlinkMonitor() {
+  netlink_monitor_.reset(CreateNetlinkMonitor());
+  if (!netlink_monitor_) {
+    LOG(LS_WARNING) << "Netlink unavailable; polling for network changes";
+    return;
+  }
+  netlink_monitor_->SignalAddressAdded.connect(
+      this, &BasicNetworkManager::OnNetlinkAddressAdded);
+  netlink_monitor_->SignalAddressRemoved.connect(
+      this, &BasicNetworkManager::OnNetlinkAddressRemoved);
+  netlink_monitor_->SignalLinkRemoved.connect(
+      this, &BasicNetworkManager::OnNetlinkLinkRemoved);
+  netlink_monitor_->SignalOverflow.connect(
+      this, &BasicNetworkManager::OnNetlinkOverflow);
+  netlink_monitor_->SignalBatchDone.connect(
+      this, &BasicNetworkManager::OnNetlinkBatchDone);
+}
+
+void BasicNetworkManager::OnNetlinkAddressAdded(
+    const NetlinkAddress& address) {
+  if (address.ip.family() == AF_INET6 && !ipv6_enabled())
+    return;
+
+  scoped_ptr<Network> network(new Network(
+      address.name, address.name,
+      TruncateIP(address.ip, address.prefix_length), address.prefix_length));
+  network->set_scope_id(address.scope_id);
+  network->AddIP(address.ip);
+  if (address.loopback || IsIgnoredNetwork(*network))
+    return;
+
+  if (AddNetworkAddress(network.release()))
+    netlink_changed_ = true;
+}
+
+void BasicNetworkManager::OnNetlinkAddressRemoved(
+    const NetlinkAddress& address) {
+  if (RemoveNetworkAddress(address.name, address.ip, address.prefix_length))
+    netlink_changed_ = true;
+}
+
+void BasicNetworkManager::OnNetlinkLinkRemoved(const std::string& name) {
+  if (RemoveInterfaceNetworks(name))
+    netlink_changed_ = true;
+}
+
+void BasicNetworkManager::OnNetlinkOverflow() {
+  // Some changes were lost; fall back to a full update.
+  thread_->Post(this, kUpdateNetworksMessage);
+}
+
+void BasicNetworkManager::OnNetlinkBatchDone() {
+  // Until the first full update has been signaled, that update covers these
+  // changes too.
+  if (netlink_changed_ && sent_first_update_)
+    SignalNetworksChanged();
+  netlink_changed_ = false;
+}
+#endif  // defined(LINUX) || defined(ANDROID)
+
 void BasicNetworkManager::DumpNetworks(bool include_ignored) {
   NetworkList list;
   CreateNetworks(include_ignored, &list);
@@ -36,6 +36,7 @@
 #include "talk/base/basictypes.h"
 #include "talk/base/ipaddress.h"
 #include "talk/base/messagehandler.h"
+#include "talk/base/scoped_ptr.h"
 #include "talk/base/sigslot.h"
 
 #if defined(POSIX)
@@ -46,7 +47,12 @@ namespace talk_base {
 
 class Network;
 class NetworkSession;
+class PhysicalSocketServer;
 class Thread;
+#if defined(LINUX) || defined(ANDROID)
+class NetlinkMonitor;
+struct NetlinkAddress;
+#endif  // defined(LINUX) || defined(ANDROID)
 
 // Generic network manager interface. It provides list of local
 // networks.
@@ -100,6 +106,16 @@ class NetworkManagerBase : public NetworkManager {
   // any change in the network list.
   void MergeNetworkList(const NetworkList& list, bool* changed);
 
+  // Incremental counterparts of MergeNetworkList, for managers that are told
+  // about addresses one at a time. AddNetworkAddress accepts ownership of
+  // |network|, which must carry a single IP. Each returns true if the network
+  // list or the addresses of a listed network changed.
+  bool AddNetworkAddress(Network* network);
+  bool RemoveNetworkAddress(const std::string& name, const IPAddress& ip,
+                            int prefix_length);
+  // Removes the networks of interface |name|, including its IPv4 aliases.
+  bool RemoveInterfaceNetworks(const std::string& name);
+
  private:
   friend class NetworkTest;
   void DoUpdateNetworks();
@@ -112,7 +128,8 @@ class NetworkManagerBase : public NetworkManager {
 // Basic implementation of the NetworkManager interface that gets list
 // of networks using OS APIs.
 class BasicNetworkManager : public NetworkManagerBase,
-                            public MessageHandler {
+                            public MessageHandler,
+                            public sigslot::has_slots<> {
  public:
   BasicNetworkManager();
   virtual ~BasicNetworkManager();
@@ -127,6 +144,15 @@ class BasicNetworkManager : public NetworkManagerBase,
   virtual void OnMessage(Message* msg);
   bool started() { return start_count_ > 0; }
 
+  // Learns about address changes from netlink notifications as they happen,
+  // rather than re-reading every interface each kNetworksUpdateIntervalMs.
+  // Linux only. |ss| reads the netlink socket, so it must be the socket
+  // server run by the thread calling StartUpdating. NULL, the default, goes
+  // back to polling. Takes effect the next time updating starts.
+  void set_netlink_socketserver(PhysicalSocketServer* ss) {
+    netlink_ss_ = ss;
+  }
+
  protected:
 #if defined(POSIX)
   // Separated from CreateNetworks for tests.
@@ -141,14 +167,35 @@ class BasicNetworkManager : public NetworkManagerBase,
   // Determines if a network should be ignored.
   static bool IsIgnoredNetwork(const Network& network);
 
+#if defined(LINUX) || defined(ANDROID)
+  // Creates and starts the monitor used when netlink is enabled. Returns NULL
+  // on failure. Tests override this to use a fake netlink socket.
+  virtual NetlinkMonitor* CreateNetlinkMonitor();
+#endif  // defined(LINUX) || defined(ANDROID)
+
  private:
   friend class NetworkTest;
 
   void DoUpdateNetworks();
+#if defined(LINUX) || defined(ANDROID)
+  void StartNetlinkMonitor();
+  void OnNetlinkAddressAdded(const NetlinkAddress& address);
+  void OnNetlinkAddressRemoved(const NetlinkAddress& address);
+  void OnNetlinkLinkRemoved(const std::string& name);
+  void OnNetlinkOverflow();
+  void OnNetlinkBatchDone();
+#endif  // defined(LINUX) || defined(ANDROID)
 
   Thread* thread_;
   bool sent_first_update_;
   int start_count_;
+  // Reads netlink notifications if set; see set_netlink_socketserver.
+  PhysicalSocketServer* netlink_ss_;
+  // Set when a netlink notification changed the network list.
+  bool netlink_changed_;
+#if defined(LINUX) || defined(ANDROID)
+  scoped_ptr<NetlinkMonitor> netlink_monitor_;
+#endif  // defined(LINUX) || defined(ANDROID)
 };
 
 // Represents a Unix-type network interface, with a name and single address.
@@ -54,6 +54,22 @@ class NetworkTest : public testing::Test, public sigslot::has_slots<>  {
     network_manager.MergeNetworkList(list, changed);
   }
 
+  bool AddNetworkAddress(BasicNetworkManager& network_manager,
+                         Network* network) {
+    return network_manager.AddNetworkAddress(network);
+  }
+
+  bool RemoveNetworkAddress(BasicNetworkManager& network_manager,
+                            const std::string& name, const IPAddress& ip,
+                            int prefix_length) {
+    return network_manager.RemoveNetworkAddress(name, ip, prefix_length);
+  }
+
+  bool RemoveInterfaceNetworks(BasicNetworkManager& network_manager,
+                               const std::string& name) {
+    return network_manager.RemoveInterfaceNetworks(name);
+  }
+
   bool IsIgnoredNetwork(const Network& network) {
     return BasicNetworkManager::IsIgnoredNetwork(network);
   }
@@ -456,6 +472,80 @@ TEST_F(NetworkTest, TestMultiplePublicNetworksOnOneInterfaceMerge) {
   }
 }
 
+// Test that networks can be updated one address at a time, and that only real
+// changes are reported.
+TEST_F(NetworkTest, TestIncrementalNetworkUpdates) {
+  BasicNetworkManager manager;
+  NetworkManager::NetworkList original_list;
+  SetupNetworks(&original_list);
+  bool changed = false;
+  MergeNetworkList(manager, original_list, &changed);
+  EXPECT_TRUE(changed);
+
+  // An address already in the list is not a change.
+  IPAddress ip;
+  EXPECT_TRUE(IPFromString("2401:fa00:4:1000:be30:5bff:fee5:c3", &ip));
+  IPAddress prefix = TruncateIP(ip, 64);
+  Network* network = new Network("test_eth0", "test_eth0", prefix, 64);
+  network->AddIP(ip);
+  EXPECT_FALSE(AddNetworkAddress(manager, network));
+
+  // A second address joins the existing network object.
+  IPAddress ip2;
+  EXPECT_TRUE(IPFromString("2401:fa00:4:1000:be30:5bff:fee5:c6", &ip2));
+  network = new Network("test_eth0", "test_eth0", prefix, 64);
+  network->AddIP(ip2);
+  EXPECT_TRUE(AddNetworkAddress(manager, network));
+  NetworkManager::NetworkList list;
+  manager.GetNetworks(&list);
+  EXPECT_EQ(4U, list.size());
+  EXPECT_EQ(2U, original_list[2]->GetIPs().size());
+
+  // A new prefix makes a new network, in the same order MergeNetworkList
+  // would have put it.
+  IPAddress ip3;
+  EXPECT_TRUE(IPFromString("2400:4030:1:2c00:be30:5bff:fee5:c3", &ip3));
+  network = new Network("test_eth0", "test_eth0", TruncateIP(ip3, 64), 64);
+  network->AddIP(ip3);
+  EXPECT_TRUE(AddNetworkAddress(manager, network));
+  NetworkManager::NetworkList incremental_list;
+  manager.GetNetworks(&incremental_list);
+  EXPECT_EQ(5U, incremental_list.size());
+  original_list.push_back(new Network(*network));
+  MergeNetworkList(manager, original_list, &changed);
+  manager.GetNetworks(&list);
+  EXPECT_TRUE(incremental_list == list);
+
+  // Removing addresses that aren't there is not a change.
+  IPAddress unknown_ip;
+  EXPECT_TRUE(IPFromString("2401:fa00:4:1000::1", &unknown_ip));
+  EXPECT_FALSE(RemoveNetworkAddress(manager, "test_eth0", unknown_ip, 64));
+  EXPECT_FALSE(RemoveNetworkAddress(manager, "test_eth9", ip, 64));
+
+  // Removing the last address of a network removes the network.
+  EXPECT_TRUE(RemoveNetworkAddress(manager, "test_eth0", ip3, 64));
+  manager.GetNetworks(&list);
+  EXPECT_EQ(4U, list.size());
+  EXPECT_EQ(list.end(), std::find(list.begin(), list.end(), network));
+  EXPECT_FALSE(RemoveNetworkAddress(manager, "test_eth0", ip3, 64));
+
+  // When it comes back, the same object is used again.
+  Network* returning = new Network("test_eth0", "test_eth0",
+                                   TruncateIP(ip3, 64), 64);
+  returning->AddIP(ip3);
+  EXPECT_TRUE(AddNetworkAddress(manager, returning));
+  manager.GetNetworks(&list);
+  EXPECT_NE(list.end(), std::find(list.begin(), list.end(), network));
+
+  // Removing an interface removes all of its networks.
+  EXPECT_TRUE(RemoveInterfaceNetworks(manager, "test_eth0"));
+  EXPECT_FALSE(RemoveInterfaceNetworks(manager, "test_eth0"));
+  manager.GetNetworks(&list);
+  ASSERT_EQ(2U, list.size());
+  EXPECT_EQ("test_eth1", list[0]->name());
+  EXPECT_EQ("test_eth1", list[1]->name());
+}
+
 // Test that DumpNetworks works.
 TEST_F(NetworkTest, TestDumpNetworks) {
   BasicNetworkManager manager;
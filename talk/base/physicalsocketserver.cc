@@ -72,6 +72,16 @@
 typedef void* SockOptArg;
 #endif  // POSIX
 
+#ifdef LINUX
+#include <poll.h>
+#include <sys/epoll.h>
+#endif  // LINUX
+
+// recvmmsg/sendmmsg are available from glibc 2.14; Android's libc lacks them.
+#if defined(LINUX) && !defined(ANDROID)
+#define HAVE_MMSG
+#endif
+
 #ifdef WIN32
 typedef char* SockOptArg;
 #endif
@@ -106,12 +116,30 @@ static const int IPV6_HEADER_SIZE = 40u;
 static const int ICMP_HEADER_SIZE = 8u;
 static const int ICMP_PING_TIMEOUT_MILLIS = 10000u;
 
+#ifdef LINUX
+// Maximum number of events collected by a single epoll_wait call.
+static const int kMaxEpollEvents = 128;
+#endif  // LINUX
+
+#ifdef POSIX
+// Maximum number of buffers passed to a single sendmsg call.
+static const size_t kMaxIoVecs = 16;
+#endif  // POSIX
+
+#ifdef HAVE_MMSG
+// Maximum number of datagrams passed to a single recvmmsg/sendmmsg call.
+static const size_t kMaxMultiDatagrams = 64;
+#endif  // HAVE_MMSG
+
 class PhysicalSocket : public AsyncSocket, public sigslot::has_slots<> {
  public:
   PhysicalSocket(PhysicalSocketServer* ss, SOCKET s = INVALID_SOCKET)
     : ss_(ss), s_(s), enabled_events_(0), error_(0),
       state_((s == INVALID_SOCKET) ? CS_CLOSED : CS_CONNECTED),
       resolver_(NULL) {
+#ifdef HAVE_MMSG
+    mmsg_supported_ = true;
+#endif
 #ifdef WIN32
     // EnsureWinsockInit() ensures that winsock is initialized. The default
     // version of this function doesn't do anything because winsock is
@@ -141,7 +169,7 @@ class PhysicalSocket : public AsyncSocket, public sigslot::has_slots<> {
     udp_ = (SOCK_DGRAM == type);
     UpdateLastError();
     if (udp_)
-      enabled_events_ = DE_READ | DE_WRITE;
+      SetEnabledEvents(DE_READ | DE_WRITE);
     return s_ != INVALID_SOCKET;
   }
 
@@ -224,12 +252,12 @@ class PhysicalSocket : public AsyncSocket, public sigslot::has_slots<> {
       state_ = CS_CONNECTED;
     } else if (IsBlockingError(error_)) {
       state_ = CS_CONNECTING;
-      enabled_events_ |= DE_CONNECT;
+      EnableEvents(DE_CONNECT);
     } else {
       return SOCKET_ERROR;
     }
 
-    enabled_events_ |= DE_READ | DE_WRITE;
+    EnableEvents(DE_READ | DE_WRITE);
     return 0;
   }
 
@@ -290,12 +318,50 @@ class PhysicalSocket : public AsyncSocket, public sigslot::has_slots<> {
     MaybeRemapSendError();
     // We have seen minidumps where this may be false.
     ASSERT(sent <= static_cast<int>(cb));
-    if ((sent < 0) && IsBlockingError(error_)) {
-      enabled_events_ |= DE_WRITE;
+    if (((sent < 0) && IsBlockingError(error_)) ||
+        ((sent >= 0) && (static_cast<size_t>(sent) < cb))) {
+      // A short write also means the send buffer is full; ask to be told
+      // when there is room for the rest.
+      EnableEvents(DE_WRITE);
     }
     return sent;
   }
 
+#ifdef POSIX
+  virtual int SendV(const IoVec* iov, size_t count) {
+    if (count > kMaxIoVecs)
+      return AsyncSocket::SendV(iov, count);
+
+    iovec iovs[kMaxIoVecs];
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+      iovs[i].iov_base = const_cast<void*>(iov[i].data);
+      iovs[i].iov_len = iov[i].len;
+      total += iov[i].len;
+    }
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iovs;
+    msg.msg_iovlen = count;
+    int sent = ::sendmsg(s_, &msg,
+#ifdef LINUX
+        // Suppress SIGPIPE. See Send() for explanation.
+        MSG_NOSIGNAL
+#else
+        0
+#endif
+        );
+    UpdateLastError();
+    MaybeRemapSendError();
+    ASSERT(sent <= static_cast<int>(total));
+    if (((sent < 0) && IsBlockingError(error_)) ||
+        ((sent >= 0) && (static_cast<size_t>(sent) < total))) {
+      EnableEvents(DE_WRITE);
+    }
+    return sent;
+  }
+#endif  // POSIX
+
   int SendTo(const void* buffer, size_t length, const SocketAddress& addr) {
     sockaddr_storage saddr;
     size_t len = addr.ToSockAddrStorage(&saddr);
@@ -313,7 +379,7 @@ class PhysicalSocket : public AsyncSocket, public sigslot::has_slots<> {
     // We have seen minidumps where this may be false.
     ASSERT(sent <= static_cast<int>(length));
     if ((sent < 0) && IsBlockingError(error_)) {
-      enabled_events_ |= DE_WRITE;
+      EnableEvents(DE_WRITE);
     }
     return sent;
   }
@@ -328,14 +394,14 @@ class PhysicalSocket : public AsyncSocket, public sigslot::has_slots<> {
       LOG(LS_WARNING) << "EOF from socket; deferring close event";
       // Must turn this back on so that the select() loop will notice the close
       // event.
-      enabled_events_ |= DE_READ;
+      EnableEvents(DE_READ);
       error_ = EWOULDBLOCK;
       return SOCKET_ERROR;
     }
     UpdateLastError();
     bool success = (received >= 0) || IsBlockingError(error_);
     if (udp_ || success) {
-      enabled_events_ |= DE_READ;
+      EnableEvents(DE_READ);
     }
     if (!success) {
       LOG_F(LS_VERBOSE) << "Error = " << error_;
@@ -354,7 +420,7 @@ class PhysicalSocket : public AsyncSocket, public sigslot::has_slots<> {
       SocketAddressFromSockAddrStorage(addr_storage, out_addr);
     bool success = (received >= 0) || IsBlockingError(error_);
     if (udp_ || success) {
-      enabled_events_ |= DE_READ;
+      EnableEvents(DE_READ);
     }
     if (!success) {
       LOG_F(LS_VERBOSE) << "Error = " << error_;
@@ -362,12 +428,99 @@ class PhysicalSocket : public AsyncSocket, public sigslot::has_slots<> {
     return received;
   }
 
+#ifdef HAVE_MMSG
+  virtual int RecvFromMulti(Datagram* datagrams, size_t count) {
+    if (!mmsg_supported_)
+      return AsyncSocket::RecvFromMulti(datagrams, count);
+
+    mmsghdr msgs[kMaxMultiDatagrams];
+    iovec iovs[kMaxMultiDatagrams];
+    sockaddr_storage addrs[kMaxMultiDatagrams];
+    count = _min(count, kMaxMultiDatagrams);
+    for (size_t i = 0; i < count; ++i) {
+      iovs[i].iov_base = datagrams[i].data;
+      iovs[i].iov_len = datagrams[i].size;
+      memset(&msgs[i], 0, sizeof(msgs[i]));
+      msgs[i].msg_hdr.msg_name = &addrs[i];
+      msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+      msgs[i].msg_hdr.msg_iov = &iovs[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    int received = ::recvmmsg(s_, msgs, static_cast<unsigned int>(count),
+                              0, NULL);
+    UpdateLastError();
+    if (received < 0 && error_ == ENOSYS) {
+      // Kernel predates recvmmsg (2.6.33).
+      mmsg_supported_ = false;
+      return AsyncSocket::RecvFromMulti(datagrams, count);
+    }
+    for (int i = 0; i < received; ++i) {
+      if (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+        LOG(LS_WARNING) << "Datagram truncated to " << datagrams[i].size
+                        << " bytes";
+      }
+      datagrams[i].len = msgs[i].msg_len;
+      SocketAddressFromSockAddrStorage(addrs[i], &datagrams[i].addr);
+    }
+    bool success = (received >= 0) || IsBlockingError(error_);
+    if (udp_ || success) {
+      EnableEvents(DE_READ);
+    }
+    if (!success) {
+      LOG_F(LS_VERBOSE) << "Error = " << error_;
+    }
+    return received;
+  }
+
+  virtual int SendToMulti(const Datagram* datagrams, size_t count) {
+    if (!mmsg_supported_)
+      return AsyncSocket::SendToMulti(datagrams, count);
+
+    mmsghdr msgs[kMaxMultiDatagrams];
+    iovec iovs[kMaxMultiDatagrams];
+    sockaddr_storage addrs[kMaxMultiDatagrams];
+    size_t sent = 0;
+    while (sent < count) {
+      size_t chunk = _min(count - sent, kMaxMultiDatagrams);
+      for (size_t i = 0; i < chunk; ++i) {
+        const Datagram& datagram = datagrams[sent + i];
+        iovs[i].iov_base = datagram.data;
+        iovs[i].iov_len = datagram.len;
+        memset(&msgs[i], 0, sizeof(msgs[i]));
+        msgs[i].msg_hdr.msg_name = &addrs[i];
+        msgs[i].msg_hdr.msg_namelen =
+            static_cast<socklen_t>(datagram.addr.ToSockAddrStorage(&addrs[i]));
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+      }
+      // Suppress SIGPIPE. See Send() for explanation.
+      int result = ::sendmmsg(s_, msgs, static_cast<unsigned int>(chunk),
+                              MSG_NOSIGNAL);
+      UpdateLastError();
+      MaybeRemapSendError();
+      if (result < 0 && error_ == ENOSYS && sent == 0) {
+        // Kernel predates sendmmsg (3.0).
+        mmsg_supported_ = false;
+        return AsyncSocket::SendToMulti(datagrams, count);
+      }
+      if (result <= 0) {
+        if (IsBlockingError(error_)) {
+          EnableEvents(DE_WRITE);
+        }
+        break;
+      }
+      sent += result;
+    }
+    return (sent == 0 && count != 0) ? SOCKET_ERROR : static_cast<int>(sent);
+  }
+#endif  // HAVE_MMSG
+
   int Listen(int backlog) {
     int err = ::listen(s_, backlog);
     UpdateLastError();
     if (err == 0) {
       state_ = CS_CONNECTING;
-      enabled_events_ |= DE_ACCEPT;
+      EnableEvents(DE_ACCEPT);
 #ifdef _DEBUG
       dbg_addr_ = "Listening @ ";
       dbg_addr_.append(GetLocalAddress().ToString());
@@ -384,7 +537,7 @@ class PhysicalSocket : public AsyncSocket, public sigslot::has_slots<> {
     UpdateLastError();
     if (s == INVALID_SOCKET)
       return NULL;
-    enabled_events_ |= DE_ACCEPT;
+    EnableEvents(DE_ACCEPT);
     if (out_addr != NULL)
       SocketAddressFromSockAddrStorage(addr_storage, out_addr);
     return ss_->WrapSocket(s);
@@ -397,7 +550,7 @@ class PhysicalSocket : public AsyncSocket, public sigslot::has_slots<> {
     UpdateLastError();
     s_ = INVALID_SOCKET;
     state_ = CS_CLOSED;
-    enabled_events_ = 0;
+    SetEnabledEvents(0);
     if (resolver_) {
       resolver_->Destroy(false);
       resolver_ = NULL;
@@ -530,6 +683,15 @@ class PhysicalSocket : public AsyncSocket, public sigslot::has_slots<> {
         *slevel = IPPROTO_TCP;
         *sopt = TCP_NODELAY;
         break;
+      case OPT_REUSEPORT:
+#if defined(SO_REUSEPORT)
+        *slevel = SOL_SOCKET;
+        *sopt = SO_REUSEPORT;
+        break;
+#else
+        LOG(LS_WARNING) << "Socket::OPT_REUSEPORT not supported.";
+        return -1;
+#endif
       default:
         ASSERT(false);
         return -1;
@@ -537,6 +699,20 @@ class PhysicalSocket : public AsyncSocket, public sigslot::has_slots<> {
     return 0;
   }
 
+  void EnableEvents(uint8 events) {
+    SetEnabledEvents(enabled_events_ | events);
+  }
+
+  void DisableEvents(uint8 events) {
+    SetEnabledEvents(enabled_events_ & ~events);
+  }
+
+  // All changes to enabled_events_ after construction go through here, so
+  // that dispatchers can tell the socket server about them.
+  virtual void SetEnabledEvents(uint8 events) {
+    enabled_events_ = events;
+  }
+
   PhysicalSocketServer* ss_;
   SOCKET s_;
   uint8 enabled_events_;
@@ -544,6 +720,9 @@ class PhysicalSocket : public AsyncSocket, public sigslot::has_slots<> {
   int error_;
   ConnState state_;
   AsyncResolver* resolver_;
+#ifdef HAVE_MMSG
+  bool mmsg_supported_;
+#endif
 
 #ifdef _DEBUG
   std::string dbg_addr_;
@@ -881,24 +1060,24 @@ class SocketDispatcher : public Dispatcher, public PhysicalSocket {
     // Make sure we deliver connect/accept first. Otherwise, consumers may see
     // something like a READ followed by a CONNECT, which would be odd.
     if ((ff & DE_CONNECT) != 0) {
-      enabled_events_ &= ~DE_CONNECT;
+      DisableEvents(DE_CONNECT);
       SignalConnectEvent(this);
     }
     if ((ff & DE_ACCEPT) != 0) {
-      enabled_events_ &= ~DE_ACCEPT;
+      DisableEvents(DE_ACCEPT);
       SignalReadEvent(this);
     }
     if ((ff & DE_READ) != 0) {
-      enabled_events_ &= ~DE_READ;
+      DisableEvents(DE_READ);
       SignalReadEvent(this);
     }
     if ((ff & DE_WRITE) != 0) {
-      enabled_events_ &= ~DE_WRITE;
+      DisableEvents(DE_WRITE);
       SignalWriteEvent(this);
     }
     if ((ff & DE_CLOSE) != 0) {
       // The socket is now dead to us, so stop checking it.
-      enabled_events_ = 0;
+      SetEnabledEvents(0);
       SignalCloseEvent(this, err);
     }
   }
@@ -910,11 +1089,20 @@ class SocketDispatcher : public Dispatcher, public PhysicalSocket {
     ss_->Remove(this);
     return PhysicalSocket::Close();
   }
+
+ protected:
+  virtual void SetEnabledEvents(uint8 events) {
+    if (events == enabled_events_)
+      return;
+    PhysicalSocket::SetEnabledEvents(events);
+    ss_->Update(this);
+  }
 };
 
 class FileDispatcher: public Dispatcher, public AsyncFile {
  public:
-  FileDispatcher(int fd, PhysicalSocketServer *ss) : ss_(ss), fd_(fd) {
+  FileDispatcher(int fd, PhysicalSocketServer *ss)
+      : ss_(ss), fd_(fd), flags_(0) {
     set_readable(true);
 
     ss_->Add(this);
@@ -958,6 +1146,7 @@ class FileDispatcher: public Dispatcher, public AsyncFile {
 
   virtual void set_readable(bool value) {
     flags_ = value ? (flags_ | DE_READ) : (flags_ & ~DE_READ);
+    ss_->Update(this);
   }
 
   virtual bool writable() {
@@ -966,6 +1155,7 @@ class FileDispatcher: public Dispatcher, public AsyncFile {
 
   virtual void set_writable(bool value) {
     flags_ = value ? (flags_ | DE_WRITE) : (flags_ & ~DE_WRITE);
+    ss_->Update(this);
   }
 
  private:
@@ -1117,7 +1307,7 @@ class SocketDispatcher : public Dispatcher, public PhysicalSocket {
     if (((ff & DE_CONNECT) != 0) && (id_ == cache_id)) {
       if (ff != DE_CONNECT)
         LOG(LS_VERBOSE) << "Signalled with DE_CONNECT: " << ff;
-      enabled_events_ &= ~DE_CONNECT;
+      DisableEvents(DE_CONNECT);
 #ifdef _DEBUG
       dbg_addr_ = "Connected @ ";
       dbg_addr_.append(GetRemoteAddress().ToString());
@@ -1125,15 +1315,15 @@ class SocketDispatcher : public Dispatcher, public PhysicalSocket {
       SignalConnectEvent(this);
     }
     if (((ff & DE_ACCEPT) != 0) && (id_ == cache_id)) {
-      enabled_events_ &= ~DE_ACCEPT;
+      DisableEvents(DE_ACCEPT);
       SignalReadEvent(this);
     }
     if ((ff & DE_READ) != 0) {
-      enabled_events_ &= ~DE_READ;
+      DisableEvents(DE_READ);
       SignalReadEvent(this);
     }
     if (((ff & DE_WRITE) != 0) && (id_ == cache_id)) {
-      enabled_events_ &= ~DE_WRITE;
+      DisableEvents(DE_WRITE);
       SignalWriteEvent(this);
     }
     if (((ff & DE_CLOSE) != 0) && (id_ == cache_id)) {
@@ -1187,9 +1377,42 @@ class Signaler : public EventDispatcher {
 };
 
 PhysicalSocketServer::PhysicalSocketServer()
-    : fWait_(false),
+    : backend_(BACKEND_SELECT),
+      fWait_(false),
+      last_tick_tracked_(0),
+      last_tick_dispatch_count_(0) {
+  Construct();
+}
+
+PhysicalSocketServer::PhysicalSocketServer(Backend backend)
+    : backend_(backend),
+      fWait_(false),
       last_tick_tracked_(0),
       last_tick_dispatch_count_(0) {
+  Construct();
+}
+
+void PhysicalSocketServer::Construct() {
+#ifdef LINUX
+  epoll_fd_ = -1;
+  // Key 0 is reserved to mean "no dispatcher" in epoll_dispatching_key_.
+  next_epoll_key_ = 1;
+  epoll_dispatching_key_ = 0;
+  if (backend_ == BACKEND_EPOLL) {
+    epoll_fd_ = epoll_create(kMaxEpollEvents);
+    if (epoll_fd_ < 0) {
+      LOG_ERR(LS_ERROR) << "epoll_create failed, falling back to select";
+      backend_ = BACKEND_SELECT;
+    } else {
+      fcntl(epoll_fd_, F_SETFD, FD_CLOEXEC);
+    }
+  }
+#else
+  if (backend_ == BACKEND_EPOLL) {
+    LOG(LS_WARNING) << "epoll is not supported, falling back to select";
+    backend_ = BACKEND_SELECT;
+  }
+#endif
   signal_wakeup_ = new Signaler(this, &fWait_);
 #ifdef WIN32
   socket_ev_ = WSACreateEvent();
@@ -1205,6 +1428,11 @@ PhysicalSocketServer::~PhysicalSocketServer() {
 #endif
   delete signal_wakeup_;
   ASSERT(dispatchers_.empty());
+#ifdef LINUX
+  ASSERT(epoll_entries_.empty());
+  if (epoll_fd_ >= 0)
+    close(epoll_fd_);
+#endif
 }
 
 void PhysicalSocketServer::WakeUp() {
@@ -1251,6 +1479,12 @@ AsyncSocket* PhysicalSocketServer::WrapSocket(SOCKET s) {
 
 void PhysicalSocketServer::Add(Dispatcher *pdispatcher) {
   CritScope cs(&crit_);
+#ifdef LINUX
+  if (backend_ == BACKEND_EPOLL) {
+    AddEpoll(pdispatcher);
+    return;
+  }
+#endif
   // Prevent duplicates. This can cause dead dispatchers to stick around.
   DispatcherList::iterator pos = std::find(dispatchers_.begin(),
                                            dispatchers_.end(),
@@ -1262,6 +1496,12 @@ void PhysicalSocketServer::Add(Dispatcher *pdispatcher) {
 
 void PhysicalSocketServer::Remove(Dispatcher *pdispatcher) {
   CritScope cs(&crit_);
+#ifdef LINUX
+  if (backend_ == BACKEND_EPOLL) {
+    RemoveEpoll(pdispatcher);
+    return;
+  }
+#endif
   DispatcherList::iterator pos = std::find(dispatchers_.begin(),
                                            dispatchers_.end(),
                                            pdispatcher);
@@ -1276,8 +1516,74 @@ void PhysicalSocketServer::Remove(Dispatcher *pdispatcher) {
   }
 }
 
+void PhysicalSocketServer::Update(Dispatcher *pdispatcher) {
+#ifdef LINUX
+  if (backend_ != BACKEND_EPOLL)
+    return;
+  CritScope cs(&crit_);
+  EpollKeyMap::iterator it = epoll_keys_.find(pdispatcher);
+  if (it != epoll_keys_.end() && it->second != epoll_dispatching_key_)
+    UpdateEpoll(it->second);
+#endif
+}
+
 #ifdef POSIX
+// Turns the readiness of a dispatcher's descriptor into DE_* events and
+// delivers them.
+static void ProcessEvents(Dispatcher* pdispatcher, bool readable,
+                          bool writable) {
+  int fd = pdispatcher->GetDescriptor();
+  uint32 ff = 0;
+  int errcode = 0;
+
+  // Reap any error code, which can be signaled through reads or writes.
+  // TODO: Should we set errcode if getsockopt fails?
+  if (readable || writable) {
+    socklen_t len = sizeof(errcode);
+    ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &errcode, &len);
+  }
+
+  // Check readable descriptors. If we're waiting on an accept, signal
+  // that. Otherwise we're waiting for data, check to see if we're
+  // readable or really closed.
+  // TODO: Only peek at TCP descriptors.
+  if (readable) {
+    if (pdispatcher->GetRequestedEvents() & DE_ACCEPT) {
+      ff |= DE_ACCEPT;
+    } else if (errcode || pdispatcher->IsDescriptorClosed()) {
+      ff |= DE_CLOSE;
+    } else {
+      ff |= DE_READ;
+    }
+  }
+
+  // Check writable descriptors. If we're waiting on a connect, detect
+  // success versus failure by the reaped error code.
+  if (writable) {
+    if (pdispatcher->GetRequestedEvents() & DE_CONNECT) {
+      if (!errcode) {
+        ff |= DE_CONNECT;
+      } else {
+        ff |= DE_CLOSE;
+      }
+    } else {
+      ff |= DE_WRITE;
+    }
+  }
+
+  // Tell the descriptor about the event.
+  if (ff != 0) {
+    pdispatcher->OnPreEvent(ff);
+    pdispatcher->OnEvent(ff, errcode);
+  }
+}
+
 bool PhysicalSocketServer::Wait(int cmsWait, bool process_io) {
+#ifdef LINUX
+  if (backend_ == BACKEND_EPOLL)
+    return WaitEpoll(cmsWait, process_io);
+#endif
+
   // Calculate timing information
 
   struct timeval *ptvWait = NULL;
@@ -1356,51 +1662,13 @@ bool PhysicalSocketServer::Wait(int cmsWait, bool process_io) {
       for (size_t i = 0; i < dispatchers_.size(); ++i) {
         Dispatcher *pdispatcher = dispatchers_[i];
         int fd = pdispatcher->GetDescriptor();
-        uint32 ff = 0;
-        int errcode = 0;
-
-        // Reap any error code, which can be signaled through reads or writes.
-        // TODO: Should we set errcode if getsockopt fails?
-        if (FD_ISSET(fd, &fdsRead) || FD_ISSET(fd, &fdsWrite)) {
-          socklen_t len = sizeof(errcode);
-          ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &errcode, &len);
-        }
-
-        // Check readable descriptors. If we're waiting on an accept, signal
-        // that. Otherwise we're waiting for data, check to see if we're
-        // readable or really closed.
-        // TODO: Only peek at TCP descriptors.
-        if (FD_ISSET(fd, &fdsRead)) {
+        bool readable = FD_ISSET(fd, &fdsRead);
+        if (readable)
           FD_CLR(fd, &fdsRead);
-          if (pdispatcher->GetRequestedEvents() & DE_ACCEPT) {
-            ff |= DE_ACCEPT;
-          } else if (errcode || pdispatcher->IsDescriptorClosed()) {
-            ff |= DE_CLOSE;
-          } else {
-            ff |= DE_READ;
-          }
-        }
-
-        // Check writable descriptors. If we're waiting on a connect, detect
-        // success versus failure by the reaped error code.
-        if (FD_ISSET(fd, &fdsWrite)) {
+        bool writable = FD_ISSET(fd, &fdsWrite);
+        if (writable)
           FD_CLR(fd, &fdsWrite);
-          if (pdispatcher->GetRequestedEvents() & DE_CONNECT) {
-            if (!errcode) {
-              ff |= DE_CONNECT;
-            } else {
-              ff |= DE_CLOSE;
-            }
-          } else {
-            ff |= DE_WRITE;
-          }
-        }
-
-        // Tell the descriptor about the event.
-        if (ff != 0) {
-          pdispatcher->OnPreEvent(ff);
-          pdispatcher->OnEvent(ff, errcode);
-        }
+        ProcessEvents(pdispatcher, readable, writable);
       }
     }
 
@@ -1428,6 +1696,182 @@ bool PhysicalSocketServer::Wait(int cmsWait, bool process_io) {
   return true;
 }
 
+#ifdef LINUX
+static uint32 EventsToEpoll(uint32 events) {
+  uint32 epoll_events = 0;
+  if (events & (DE_READ | DE_ACCEPT))
+    epoll_events |= EPOLLIN;
+  if (events & (DE_WRITE | DE_CONNECT))
+    epoll_events |= EPOLLOUT;
+  return epoll_events;
+}
+
+void PhysicalSocketServer::AddEpoll(Dispatcher* pdispatcher) {
+  // Prevent duplicates.
+  if (epoll_keys_.find(pdispatcher) != epoll_keys_.end())
+    return;
+  uint64 key = next_epoll_key_++;
+  EpollEntry entry = { pdispatcher, 0 };
+  epoll_entries_[key] = entry;
+  epoll_keys_[pdispatcher] = key;
+  UpdateEpoll(key);
+}
+
+void PhysicalSocketServer::RemoveEpoll(Dispatcher* pdispatcher) {
+  EpollKeyMap::iterator it = epoll_keys_.find(pdispatcher);
+  ASSERT(it != epoll_keys_.end());
+  if (it == epoll_keys_.end())
+    return;
+  EpollEntryMap::iterator entry = epoll_entries_.find(it->second);
+  if (entry->second.events != 0) {
+    // The kernel ignores the event argument for EPOLL_CTL_DEL, but versions
+    // before 2.6.9 require it to be non-NULL.
+    epoll_event event;
+    memset(&event, 0, sizeof(event));
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, pdispatcher->GetDescriptor(),
+                  &event) < 0 && errno != EBADF && errno != ENOENT) {
+      LOG_ERR(LS_WARNING) << "epoll_ctl(EPOLL_CTL_DEL)";
+    }
+  }
+  epoll_entries_.erase(entry);
+  epoll_keys_.erase(it);
+}
+
+// Brings the epoll registration of a dispatcher in line with the events it
+// currently requests. A descriptor with nothing requested is taken out of the
+// epoll set entirely, since epoll would otherwise keep reporting hangups and
+// errors on it.
+void PhysicalSocketServer::UpdateEpoll(uint64 key) {
+  EpollEntryMap::iterator it = epoll_entries_.find(key);
+  if (it == epoll_entries_.end())
+    return;
+  EpollEntry& entry = it->second;
+  uint32 events = EventsToEpoll(entry.dispatcher->GetRequestedEvents());
+  if (events == entry.events)
+    return;
+
+  int op;
+  if (entry.events == 0) {
+    op = EPOLL_CTL_ADD;
+  } else if (events == 0) {
+    op = EPOLL_CTL_DEL;
+  } else {
+    op = EPOLL_CTL_MOD;
+  }
+  epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = events;
+  event.data.u64 = key;
+  if (epoll_ctl(epoll_fd_, op, entry.dispatcher->GetDescriptor(),
+                &event) < 0) {
+    LOG_ERR(LS_ERROR) << "epoll_ctl(" << op << ")";
+    return;
+  }
+  entry.events = events;
+}
+
+bool PhysicalSocketServer::WaitEpoll(int cmsWait, bool process_io) {
+  // Only the wakeup signaler is serviced when I/O is not being processed;
+  // polling it on its own is cheaper than rearranging the epoll set.
+  if (!process_io)
+    return WaitForWakeUp(cmsWait);
+
+  uint32 msStop = (cmsWait == kForever) ? 0 : TimeAfter(cmsWait);
+  epoll_event events[kMaxEpollEvents];
+
+  fWait_ = true;
+
+  while (fWait_) {
+    int cmsTimeout = -1;
+    if (cmsWait != kForever)
+      cmsTimeout = _max(0, TimeUntil(msStop));
+
+    // Wait then call handlers as appropriate
+    // < 0 means error
+    // 0 means timeout
+    // > 0 means count of descriptors ready
+    int n = epoll_wait(epoll_fd_, events, kMaxEpollEvents, cmsTimeout);
+
+    if (n < 0) {
+      if (errno != EINTR) {
+        LOG_E(LS_ERROR, EN, errno) << "epoll_wait";
+        return false;
+      }
+      // Else ignore the error and keep going. If this EINTR was for one of the
+      // signals managed by this PhysicalSocketServer, the
+      // PosixSignalDeliveryDispatcher will be in the signaled state in the next
+      // iteration.
+    } else if (n == 0) {
+      // If timeout, return success
+      return true;
+    } else {
+      // We have signaled descriptors
+      CritScope cr(&crit_);
+      for (int i = 0; i < n; ++i) {
+        uint64 key = events[i].data.u64;
+        EpollEntryMap::iterator it = epoll_entries_.find(key);
+        if (it == epoll_entries_.end()) {
+          // Removed by a handler that ran earlier in this batch.
+          continue;
+        }
+        Dispatcher* pdispatcher = it->second.dispatcher;
+
+        // Like select(), treat errors and hangups as readiness for whatever
+        // the dispatcher asked for, so ProcessEvents can reap the error.
+        uint32 requested = pdispatcher->GetRequestedEvents();
+        bool failed = (events[i].events & (EPOLLERR | EPOLLHUP)) != 0;
+        bool readable = (events[i].events & EPOLLIN) ||
+            (failed && (requested & (DE_READ | DE_ACCEPT)));
+        bool writable = (events[i].events & EPOLLOUT) ||
+            (failed && (requested & (DE_WRITE | DE_CONNECT)));
+
+        // Handlers typically disable and then re-enable the same events, so
+        // rather than issuing an epoll_ctl for each change the registration
+        // is brought up to date once afterwards.
+        epoll_dispatching_key_ = key;
+        ProcessEvents(pdispatcher, readable, writable);
+        epoll_dispatching_key_ = 0;
+        UpdateEpoll(key);
+      }
+    }
+  }
+
+  return true;
+}
+
+bool PhysicalSocketServer::WaitForWakeUp(int cmsWait) {
+  uint32 msStop = (cmsWait == kForever) ? 0 : TimeAfter(cmsWait);
+
+  fWait_ = true;
+
+  while (fWait_) {
+    int cmsTimeout = -1;
+    if (cmsWait != kForever)
+      cmsTimeout = _max(0, TimeUntil(msStop));
+
+    pollfd fds;
+    fds.fd = signal_wakeup_->GetDescriptor();
+    fds.events = POLLIN;
+    fds.revents = 0;
+    int n = poll(&fds, 1, cmsTimeout);
+    if (n < 0) {
+      if (errno != EINTR) {
+        LOG_E(LS_ERROR, EN, errno) << "poll";
+        return false;
+      }
+    } else if (n == 0) {
+      return true;
+    } else {
+      CritScope cr(&crit_);
+      signal_wakeup_->OnPreEvent(DE_READ);
+      signal_wakeup_->OnEvent(DE_READ, 0);
+    }
+  }
+
+  return true;
+}
+#endif  // LINUX
+
 static void GlobalSignalHandler(int signum) {
   PosixSignalHandler::Instance()->OnPosixSignalReceived(signum);
 }
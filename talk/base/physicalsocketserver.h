@@ -28,6 +28,7 @@
 #ifndef TALK_BASE_PHYSICALSOCKETSERVER_H__
 #define TALK_BASE_PHYSICALSOCKETSERVER_H__
 
+#include <map>
 #include <vector>
 
 #include "talk/base/asyncfile.h"
@@ -74,9 +75,22 @@ class Dispatcher {
 // A socket server that provides the real sockets of the underlying OS.
 class PhysicalSocketServer : public SocketServer {
  public:
+  // The mechanism Wait() uses to find ready descriptors. select() costs O(n)
+  // in the number of dispatchers on every wakeup and is limited to
+  // FD_SETSIZE descriptors; epoll only costs O(ready) but is Linux-only.
+  // Requesting BACKEND_EPOLL elsewhere, or when epoll cannot be initialized,
+  // falls back to BACKEND_SELECT.
+  enum Backend {
+    BACKEND_SELECT,
+    BACKEND_EPOLL,
+  };
+
   PhysicalSocketServer();
+  explicit PhysicalSocketServer(Backend backend);
   virtual ~PhysicalSocketServer();
 
+  Backend backend() const { return backend_; }
+
   // SocketFactory:
   virtual Socket* CreateSocket(int type);
   virtual Socket* CreateSocket(int family, int type);
@@ -93,6 +107,8 @@ class PhysicalSocketServer : public SocketServer {
 
   void Add(Dispatcher* dispatcher);
   void Remove(Dispatcher* dispatcher);
+  // Must be called when the events requested by an added dispatcher change.
+  void Update(Dispatcher* dispatcher);
 
 #ifdef POSIX
   AsyncFile* CreateFile(int fd);
@@ -117,11 +133,40 @@ class PhysicalSocketServer : public SocketServer {
   typedef std::vector<Dispatcher*> DispatcherList;
   typedef std::vector<size_t*> IteratorList;
 
+  void Construct();
+
 #ifdef POSIX
   static bool InstallSignal(int signum, void (*handler)(int));
 
   scoped_ptr<PosixSignalDispatcher> signal_dispatcher_;
 #endif
+#ifdef LINUX
+  // Dispatchers are registered with epoll under a unique key rather than
+  // their address, so that events already returned by epoll_wait for a
+  // dispatcher that has since been removed (and possibly reallocated) can be
+  // recognized and dropped.
+  struct EpollEntry {
+    Dispatcher* dispatcher;
+    uint32 events;  // The epoll event mask currently registered.
+  };
+  typedef std::map<uint64, EpollEntry> EpollEntryMap;
+  typedef std::map<Dispatcher*, uint64> EpollKeyMap;
+
+  bool WaitEpoll(int cms, bool process_io);
+  bool WaitForWakeUp(int cms);
+  void AddEpoll(Dispatcher* dispatcher);
+  void RemoveEpoll(Dispatcher* dispatcher);
+  void UpdateEpoll(uint64 key);
+
+  int epoll_fd_;
+  uint64 next_epoll_key_;
+  EpollEntryMap epoll_entries_;
+  EpollKeyMap epoll_keys_;
+  // Key of the dispatcher whose handlers are running; its changes are
+  // applied once, after the handlers return.
+  uint64 epoll_dispatching_key_;
+#endif
+  Backend backend_;
   DispatcherList dispatchers_;
   IteratorList iterators_;
   Signaler* signal_wakeup_;
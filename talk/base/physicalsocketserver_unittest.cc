@@ -27,6 +27,9 @@
 
 #include <signal.h>
 #include <stdarg.h>
+#ifdef LINUX
+#include <sys/resource.h>
+#endif
 
 #include "talk/base/gunit.h"
 #include "talk/base/logging.h"
@@ -34,6 +37,7 @@
 #include "talk/base/scoped_ptr.h"
 #include "talk/base/socket_unittest.h"
 #include "talk/base/thread.h"
+#include "talk/base/timeutils.h"
 
 namespace talk_base {
 
@@ -172,6 +176,168 @@ TEST_F(PhysicalSocketTest, TestGetSetOptionsIPv6) {
   SocketTest::TestGetSetOptionsIPv6();
 }
 
+#ifdef LINUX
+
+// Runs the generic socket tests against the epoll backend.
+class PhysicalSocketEpollTest : public SocketTest {
+ protected:
+  PhysicalSocketEpollTest()
+      : server_(PhysicalSocketServer::BACKEND_EPOLL),
+        scope_(&server_) {
+  }
+
+  virtual void SetUp() {
+    ASSERT_EQ(PhysicalSocketServer::BACKEND_EPOLL, server_.backend());
+    SocketTest::SetUp();
+  }
+
+  PhysicalSocketServer server_;
+  SocketServerScope scope_;
+};
+
+TEST_F(PhysicalSocketEpollTest, TestConnectIPv4) {
+  SocketTest::TestConnectIPv4();
+}
+
+TEST_F(PhysicalSocketEpollTest, TestConnectIPv6) {
+  SocketTest::TestConnectIPv6();
+}
+
+TEST_F(PhysicalSocketEpollTest, TestConnectFailIPv4) {
+  SocketTest::TestConnectFailIPv4();
+}
+
+TEST_F(PhysicalSocketEpollTest, TestConnectFailIPv6) {
+  SocketTest::TestConnectFailIPv6();
+}
+
+TEST_F(PhysicalSocketEpollTest, TestConnectWithClosedSocketIPv4) {
+  SocketTest::TestConnectWithClosedSocketIPv4();
+}
+
+TEST_F(PhysicalSocketEpollTest, TestConnectWhileNotClosedIPv4) {
+  SocketTest::TestConnectWhileNotClosedIPv4();
+}
+
+TEST_F(PhysicalSocketEpollTest, TestServerCloseDuringConnectIPv4) {
+  SocketTest::TestServerCloseDuringConnectIPv4();
+}
+
+TEST_F(PhysicalSocketEpollTest, TestClientCloseDuringConnectIPv4) {
+  SocketTest::TestClientCloseDuringConnectIPv4();
+}
+
+TEST_F(PhysicalSocketEpollTest, TestServerCloseIPv4) {
+  SocketTest::TestServerCloseIPv4();
+}
+
+TEST_F(PhysicalSocketEpollTest, TestCloseInClosedCallbackIPv4) {
+  SocketTest::TestCloseInClosedCallbackIPv4();
+}
+
+TEST_F(PhysicalSocketEpollTest, TestSocketServerWaitIPv4) {
+  SocketTest::TestSocketServerWaitIPv4();
+}
+
+TEST_F(PhysicalSocketEpollTest, TestTcpIPv4) {
+  SocketTest::TestTcpIPv4();
+}
+
+TEST_F(PhysicalSocketEpollTest, TestTcpIPv6) {
+  SocketTest::TestTcpIPv6();
+}
+
+TEST_F(PhysicalSocketEpollTest, TestUdpIPv4) {
+  SocketTest::TestUdpIPv4();
+}
+
+TEST_F(PhysicalSocketEpollTest, TestUdpIPv6) {
+  SocketTest::TestUdpIPv6();
+}
+
+TEST_F(PhysicalSocketEpollTest, TestUdpReadyToSendIPv4) {
+  SocketTest::TestUdpReadyToSendIPv4();
+}
+
+TEST_F(PhysicalSocketEpollTest, TestGetSetOptionsIPv4) {
+  SocketTest::TestGetSetOptionsIPv4();
+}
+
+// Measures the cost of a WakeUp()/Wait() round trip while the socket server
+// has many idle sockets registered, for both backends. select() is only run
+// while all descriptors fit in an fd_set.
+// Run with --gtest_also_run_disabled_tests.
+class PhysicalSocketServerWakeUpBenchmark : public testing::Test {
+ protected:
+  static const int kWakeUps = 1000;
+
+  // Returns the average wakeup cost in microseconds, or -1 if the sockets
+  // could not be created.
+  double MeasureWakeUp(PhysicalSocketServer::Backend backend,
+                       int num_sockets) {
+    PhysicalSocketServer server(backend);
+    std::vector<AsyncSocket*> sockets;
+    bool ok = true;
+    for (int i = 0; i < num_sockets && ok; ++i) {
+      AsyncSocket* socket = server.CreateAsyncSocket(SOCK_DGRAM);
+      if (!socket) {
+        ok = false;
+        break;
+      }
+      sockets.push_back(socket);
+      ok = (socket->Bind(SocketAddress(IPAddress(INADDR_LOOPBACK), 0)) == 0);
+    }
+    double cost = -1;
+    if (ok) {
+      // Deliver the initial write events so all sockets are idle.
+      server.Wait(0, true);
+      uint64 start = TimeNanos();
+      for (int i = 0; i < kWakeUps; ++i) {
+        server.WakeUp();
+        server.Wait(kForever, true);
+      }
+      cost = static_cast<double>(TimeNanos() - start) / kWakeUps /
+          (kNumNanosecsPerSec / kNumMicrosecsPerSec);
+    }
+    for (size_t i = 0; i < sockets.size(); ++i) {
+      delete sockets[i];
+    }
+    return cost;
+  }
+};
+
+TEST_F(PhysicalSocketServerWakeUpBenchmark, DISABLED_IdleSockets) {
+  // Make room for the larger runs if the hard limit allows it.
+  struct rlimit limit;
+  getrlimit(RLIMIT_NOFILE, &limit);
+  limit.rlim_cur = limit.rlim_max;
+  setrlimit(RLIMIT_NOFILE, &limit);
+  getrlimit(RLIMIT_NOFILE, &limit);
+
+  const int kSocketCounts[] = { 100, 500, 1000, 5000, 10000, 50000 };
+  for (size_t i = 0; i < ARRAY_SIZE(kSocketCounts); ++i) {
+    int count = kSocketCounts[i];
+    // Leave headroom for descriptors owned by the test harness.
+    if (static_cast<rlim_t>(count) + 64 > limit.rlim_cur) {
+      LOG(LS_WARNING) << "Skipping " << count << " sockets, RLIMIT_NOFILE is "
+                      << limit.rlim_cur;
+      continue;
+    }
+    if (count + 64 < FD_SETSIZE) {
+      LOG(LS_INFO) << count << " idle sockets, select: "
+                   << MeasureWakeUp(PhysicalSocketServer::BACKEND_SELECT,
+                                    count)
+                   << " us/wakeup";
+    }
+    double cost = MeasureWakeUp(PhysicalSocketServer::BACKEND_EPOLL, count);
+    EXPECT_GE(cost, 0);
+    LOG(LS_INFO) << count << " idle sockets, epoll: " << cost
+                 << " us/wakeup";
+  }
+}
+
+#endif  // LINUX
+
 #ifdef POSIX
 
 class PosixSignalDeliveryTest : public testing::Test {
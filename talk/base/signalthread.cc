@@ -28,6 +28,7 @@
 #include "talk/base/signalthread.h"
 
 #include "talk/base/common.h"
+#include "talk/base/workerpool.h"
 
 namespace talk_base {
 
@@ -35,14 +36,19 @@ namespace talk_base {
 // SignalThread
 ///////////////////////////////////////////////////////////////////////////////
 
-SignalThread::SignalThread()
+SignalThread::SignalThread(WorkerPool* pool)
     : main_(Thread::Current()),
-      worker_(this),
+      pool_(pool),
+      pool_task_(this),
+      pool_work_done_(true, false),
       state_(kInit),
       refcount_(1) {
   main_->SignalQueueDestroyed.connect(this,
                                       &SignalThread::OnMainThreadDestroyed);
-  worker_.SetName("SignalThread", this);
+  if (!pool_) {
+    worker_.reset(new Worker(this));
+    worker_->SetName("SignalThread", this);
+  }
 }
 
 SignalThread::~SignalThread() {
@@ -53,14 +59,14 @@ bool SignalThread::SetName(const std::string& name, const void* obj) {
   EnterExit ee(this);
   ASSERT(main_->IsCurrent());
   ASSERT(kInit == state_);
-  return worker_.SetName(name, obj);
+  return worker_ && worker_->SetName(name, obj);
 }
 
 bool SignalThread::SetPriority(ThreadPriority priority) {
   EnterExit ee(this);
   ASSERT(main_->IsCurrent());
   ASSERT(kInit == state_);
-  return worker_.SetPriority(priority);
+  return worker_ && worker_->SetPriority(priority);
 }
 
 void SignalThread::Start() {
@@ -69,7 +75,12 @@ void SignalThread::Start() {
   if (kInit == state_ || kComplete == state_) {
     state_ = kRunning;
     OnWorkStart();
-    worker_.Start();
+    if (pool_) {
+      pool_work_done_.Reset();
+      pool_->Post(&pool_task_);
+    } else {
+      worker_->Start();
+    }
   } else {
     ASSERT(false);
   }
@@ -84,12 +95,17 @@ void SignalThread::Destroy(bool wait) {
     state_ = kStopping;
     // OnWorkStop() must follow Quit(), so that when the thread wakes up due to
     // OWS(), ContinueWork() will return false.
-    worker_.Quit();
+    if (worker_)
+      worker_->Quit();
     OnWorkStop();
     if (wait) {
       // Release the thread's lock so that it can return from ::Run.
       cs_.Leave();
-      worker_.Stop();
+      if (worker_) {
+        worker_->Stop();
+      } else {
+        pool_work_done_.Wait(kForever);
+      }
       cs_.Enter();
       refcount_--;
     }
@@ -113,8 +129,10 @@ void SignalThread::Release() {
 
 bool SignalThread::ContinueWork() {
   EnterExit ee(this);
-  ASSERT(worker_.IsCurrent());
-  return worker_.ProcessMessages(0);
+  if (!worker_)
+    return kStopping != state_;
+  ASSERT(worker_->IsCurrent());
+  return worker_->ProcessMessages(0);
 }
 
 void SignalThread::OnMessage(Message *msg) {
@@ -139,7 +157,8 @@ void SignalThread::OnMessage(Message *msg) {
       // Calling Stop() on the worker ensures that the OS thread that underlies
       // the worker will finish, and will be set to NULL, enabling us to call
       // Start() again.
-      worker_.Stop();
+      if (worker_)
+        worker_->Stop();
       SignalWorkDone(this);
     }
     if (do_delete) {
@@ -155,6 +174,8 @@ void SignalThread::Run() {
     if (main_) {
       main_->Post(this, ST_MSG_WORKER_DONE);
     }
+    if (pool_)
+      pool_work_done_.Set();
   }
 }
 
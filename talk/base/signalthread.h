@@ -31,11 +31,15 @@
 #include <string>
 
 #include "talk/base/constructormagic.h"
+#include "talk/base/event.h"
+#include "talk/base/scoped_ptr.h"
 #include "talk/base/sigslot.h"
 #include "talk/base/thread.h"
 
 namespace talk_base {
 
+class WorkerPool;
+
 ///////////////////////////////////////////////////////////////////////////////
 // SignalThread - Base class for worker threads.  The main thread should call
 //  Start() to begin work, and then follow one of these models:
@@ -51,15 +55,22 @@ namespace talk_base {
 //   periodically calling ContinueWork(), it can check for cancellation.
 //   OnWorkStart and OnWorkDone can be overridden to do pre- or post-work
 //   tasks in the context of the main thread.
+//  A subclass whose DoWork is a single blocking call, and which doesn't use
+//   worker() or rely on OnWorkStop to interrupt DoWork, can pass a WorkerPool
+//   to the constructor. DoWork then runs on one of the pool's threads instead
+//   of a thread of its own; everything else behaves the same.
 ///////////////////////////////////////////////////////////////////////////////
 
 class SignalThread
     : public sigslot::has_slots<>,
       protected MessageHandler {
  public:
-  SignalThread();
+  // Context: Main Thread.  Runs DoWork on a thread of its own, or on |pool|
+  // if given; see above.
+  explicit SignalThread(WorkerPool* pool = NULL);
 
   // Context: Main Thread.  Call before Start to change the worker's name.
+  // Fails when running on a WorkerPool, as does SetPriority.
   bool SetName(const std::string& name, const void* obj);
 
   // Context: Main Thread.  Call before Start to change the worker's priority.
@@ -88,7 +99,8 @@ class SignalThread
  protected:
   virtual ~SignalThread();
 
-  Thread* worker() { return &worker_; }
+  // NULL when running on a WorkerPool.
+  Thread* worker() { return worker_.get(); }
 
   // Context: Main Thread.  Subclass should override to do pre-work setup.
   virtual void OnWorkStart() { }
@@ -131,6 +143,17 @@ class SignalThread
     DISALLOW_IMPLICIT_CONSTRUCTORS(Worker);
   };
 
+  class PoolTask : public Runnable {
+   public:
+    explicit PoolTask(SignalThread* parent) : parent_(parent) {}
+    virtual void Run(Thread* thread) { parent_->Run(); }
+
+   private:
+    SignalThread* parent_;
+
+    DISALLOW_IMPLICIT_CONSTRUCTORS(PoolTask);
+  };
+
   class EnterExit {
    public:
     explicit EnterExit(SignalThread* t) : t_(t) {
@@ -157,7 +180,10 @@ class SignalThread
   void OnMainThreadDestroyed();
 
   Thread* main_;
-  Worker worker_;
+  WorkerPool* pool_;
+  scoped_ptr<Worker> worker_;   // Only when not running on pool_.
+  PoolTask pool_task_;
+  Event pool_work_done_;        // Set when DoWork returns on pool_.
   CriticalSection cs_;
   State state_;
   int refcount_;
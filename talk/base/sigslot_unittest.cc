@@ -28,6 +28,8 @@
 #include "talk/base/sigslot.h"
 
 #include "talk/base/gunit.h"
+#include "talk/base/logging.h"
+#include "talk/base/timeutils.h"
 
 // This function, when passed a has_slots or signalx, will break the build if
 // its threading requirement is not single threaded
@@ -265,3 +267,178 @@ TEST(DestructionOrder, SlotFirst) {
   (*signal)();
   delete signal;
 }
+
+// A slot that disconnects itself, or another slot, while the signal is being
+// emitted must not break the emission or skip the remaining slots.
+class SigslotSelfDisconnect : public sigslot::has_slots<> {
+ public:
+  SigslotSelfDisconnect() : signal_(NULL), victim_(NULL), count_(0) {}
+
+  void Connect(sigslot::signal0<>* signal, SigslotSelfDisconnect* victim) {
+    signal_ = signal;
+    victim_ = victim;
+    signal->connect(this, &SigslotSelfDisconnect::OnSignal);
+  }
+  void OnSignal() {
+    ++count_;
+    signal_->disconnect(this);
+    if (victim_)
+      signal_->disconnect(victim_);
+  }
+  int count() const { return count_; }
+
+ private:
+  sigslot::signal0<>* signal_;
+  SigslotSelfDisconnect* victim_;
+  int count_;
+};
+
+TEST(SigslotEmission, DisconnectDuringEmit) {
+  sigslot::signal0<> signal;
+  SigslotSelfDisconnect first, second, third;
+  first.Connect(&signal, &second);
+  second.Connect(&signal, NULL);
+  third.Connect(&signal, NULL);
+  signal();
+  EXPECT_EQ(1, first.count());
+  EXPECT_EQ(0, second.count());
+  EXPECT_EQ(1, third.count());
+  EXPECT_TRUE(signal.is_empty());
+  signal();
+  EXPECT_EQ(1, first.count());
+  EXPECT_EQ(1, third.count());
+}
+
+// A slot connected during emission is called in that same emission, and
+// connecting more slots than fit in the signal's storage is safe.
+class SigslotConnectOther : public sigslot::has_slots<> {
+ public:
+  SigslotConnectOther() : count_(0) {}
+  void OnSignal() {
+    ++count_;
+    if (count_ == 1) {
+      for (int i = 0; i < ARRAY_SIZE(others_); ++i) {
+        signal_->connect(&others_[i], &SigslotReceiver<>::OnSignal);
+      }
+    }
+  }
+  sigslot::signal0<>* signal_;
+  SigslotReceiver<> others_[16];
+  int count_;
+};
+
+TEST(SigslotEmission, ConnectDuringEmit) {
+  sigslot::signal0<> signal;
+  SigslotConnectOther connector;
+  connector.signal_ = &signal;
+  signal.connect(&connector, &SigslotConnectOther::OnSignal);
+  signal();
+  EXPECT_EQ(1, connector.count_);
+  for (int i = 0; i < ARRAY_SIZE(connector.others_); ++i) {
+    EXPECT_EQ(1, connector.others_[i].signal_count());
+  }
+  signal();
+  EXPECT_EQ(2, connector.count_);
+  EXPECT_EQ(2, connector.others_[0].signal_count());
+}
+
+// A slot object that goes away during emission is disconnected from the
+// rest of that emission.
+class SigslotDeleter : public sigslot::has_slots<> {
+ public:
+  explicit SigslotDeleter(SigslotReceiver<>* victim) : victim_(victim) {}
+  void OnSignal() {
+    delete victim_;
+    victim_ = NULL;
+  }
+
+ private:
+  SigslotReceiver<>* victim_;
+};
+
+TEST(SigslotEmission, SlotDestroyedDuringEmit) {
+  sigslot::signal0<> signal;
+  SigslotReceiver<>* victim = new SigslotReceiver<>();
+  SigslotDeleter deleter(victim);
+  SigslotReceiver<> survivor;
+  signal.connect(&deleter, &SigslotDeleter::OnSignal);
+  victim->Connect(&signal);
+  survivor.Connect(&signal);
+  signal();
+  EXPECT_EQ(1, survivor.signal_count());
+  signal();
+  EXPECT_EQ(2, survivor.signal_count());
+}
+
+// With single_threaded signals, a slot may delete the object that owns the
+// signal being emitted, as socket close handlers commonly do; the emission
+// must stop there.
+class SigslotSignalOwner : public sigslot::has_slots<> {
+ public:
+  sigslot::signal0<> SignalEvent;
+};
+
+class SigslotOwnerDeleter : public sigslot::has_slots<> {
+ public:
+  explicit SigslotOwnerDeleter(SigslotSignalOwner* owner) : owner_(owner) {
+    owner_->SignalEvent.connect(this, &SigslotOwnerDeleter::OnEvent);
+  }
+  void OnEvent() {
+    delete owner_;
+    owner_ = NULL;
+  }
+
+ private:
+  SigslotSignalOwner* owner_;
+};
+
+TEST(SigslotEmission, SignalDestroyedDuringEmit) {
+  SigslotSignalOwner* owner = new SigslotSignalOwner();
+  SigslotOwnerDeleter deleter(owner);
+  SigslotReceiver<> after;
+  after.Connect(&owner->SignalEvent);
+  owner->SignalEvent();
+  EXPECT_EQ(0, after.signal_count());
+}
+
+// One layer of a receive path, such as AsyncUDPSocket -> Port -> Connection:
+// takes a packet from the layer below and passes it on through its own signal.
+template<class mt_policy>
+class SigslotHop : public sigslot::has_slots<mt_policy> {
+ public:
+  SigslotHop() : packets_(0) {}
+  void OnReadPacket(SigslotHop* from, const char* data, size_t len,
+                    const int& address) {
+    ++packets_;
+    SignalReadPacket(this, data, len, address);
+  }
+  sigslot::signal4<SigslotHop*, const char*, size_t, const int&, mt_policy>
+      SignalReadPacket;
+  int packets_;
+};
+
+template<class mt_policy>
+static void RunHopBenchmark(const char* name) {
+  const int kHops = 6;
+  const int kPackets = 2000000;
+  SigslotHop<mt_policy> hops[kHops];
+  for (int i = 0; i + 1 < kHops; ++i) {
+    hops[i].SignalReadPacket.connect(&hops[i + 1],
+        &SigslotHop<mt_policy>::OnReadPacket);
+  }
+  char packet[100] = { 0 };
+  int address = 0;
+  uint64 start = talk_base::TimeNanos();
+  for (int i = 0; i < kPackets; ++i) {
+    hops[0].OnReadPacket(NULL, packet, sizeof(packet), address);
+  }
+  uint64 elapsed = talk_base::TimeNanos() - start;
+  EXPECT_EQ(kPackets, hops[kHops - 1].packets_);
+  LOG(LS_INFO) << name << ": " << elapsed * 1.0 / kPackets / (kHops - 1)
+               << "ns per hop";
+}
+
+TEST(SigslotEmission, DISABLED_PerHopBenchmark) {
+  RunHopBenchmark<sigslot::single_threaded>("single_threaded");
+  RunHopBenchmark<sigslot::multi_threaded_local>("multi_threaded_local");
+}
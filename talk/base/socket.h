@@ -29,6 +29,7 @@
 #define TALK_BASE_SOCKET_H__
 
 #include <errno.h>
+#include <string.h>
 
 #ifdef POSIX
 #include <sys/types.h>
@@ -43,6 +44,7 @@
 #endif
 
 #include "talk/base/basictypes.h"
+#include "talk/base/scoped_ptr.h"
 #include "talk/base/socketaddress.h"
 
 // Rather than converting errors into a private namespace,
@@ -140,6 +142,24 @@ inline bool IsBlockingError(int e) {
   return (e == EWOULDBLOCK) || (e == EAGAIN) || (e == EINPROGRESS);
 }
 
+// One datagram in a batched receive or send. For RecvFromMulti, |data| and
+// |size| describe the buffer to read into, and |len| and |addr| are filled in
+// with the datagram's length and source. For SendToMulti, the first |len|
+// bytes of |data| are sent to |addr|.
+struct Datagram {
+  Datagram() : data(NULL), size(0), len(0) {}
+  char* data;
+  size_t size;
+  size_t len;
+  SocketAddress addr;
+};
+
+// One of the buffers passed to SendV.
+struct IoVec {
+  const void* data;
+  size_t len;
+};
+
 // General interface for the socket implementations of various networks.  The
 // methods match those of normal UNIX sockets very closely.
 class Socket {
@@ -167,6 +187,59 @@ class Socket {
   virtual void SetError(int error) = 0;
   inline bool IsBlocking() const { return IsBlockingError(GetError()); }
 
+  // Receives up to |count| datagrams. Returns the number received, or
+  // SOCKET_ERROR if none could be. Implementations that can read several
+  // datagrams with one system call override this; by default it is the same
+  // as calling RecvFrom repeatedly.
+  virtual int RecvFromMulti(Datagram* datagrams, size_t count) {
+    size_t received = 0;
+    for (; received < count; ++received) {
+      Datagram& datagram = datagrams[received];
+      int len = RecvFrom(datagram.data, datagram.size, &datagram.addr);
+      if (len < 0)
+        break;
+      datagram.len = static_cast<size_t>(len);
+    }
+    return (received == 0 && count != 0) ? SOCKET_ERROR :
+        static_cast<int>(received);
+  }
+
+  // Sends |count| datagrams, stopping at the first one that fails. Returns the
+  // number sent, or SOCKET_ERROR if none could be.
+  virtual int SendToMulti(const Datagram* datagrams, size_t count) {
+    size_t sent = 0;
+    for (; sent < count; ++sent) {
+      const Datagram& datagram = datagrams[sent];
+      if (SendTo(datagram.data, datagram.len, datagram.addr) < 0)
+        break;
+    }
+    return (sent == 0 && count != 0) ? SOCKET_ERROR : static_cast<int>(sent);
+  }
+
+  // Sends the |count| buffers in |iov| as if they were one, like writev.
+  // Returns the number of bytes sent, as Send does. Implementations that can
+  // send from several buffers at once override this; by default they are
+  // copied together and passed to Send.
+  virtual int SendV(const IoVec* iov, size_t count) {
+    size_t total = 0;
+    for (size_t i = 0; i < count; ++i) {
+      total += iov[i].len;
+    }
+    char stack_buffer[2048];
+    scoped_array<char> heap_buffer;
+    char* buffer = stack_buffer;
+    if (total > sizeof(stack_buffer)) {
+      heap_buffer.reset(new char[total]);
+      buffer = heap_buffer.get();
+    }
+    size_t pos = 0;
+    for (size_t i = 0; i < count; ++i) {
+      memcpy(buffer + pos, iov[i].data, iov[i].len);
+      pos += iov[i].len;
+    }
+    return Send(buffer, total);
+  }
+
   enum ConnState {
     CS_CLOSED,
     CS_CONNECTING,
@@ -184,7 +257,8 @@ class Socket {
     OPT_RCVBUF,      // receive buffer size
     OPT_SNDBUF,      // send buffer size
     OPT_NODELAY,     // whether Nagle algorithm is enabled
-    OPT_IPV6_V6ONLY  // Whether the socket is IPv6 only.
+    OPT_IPV6_V6ONLY,  // Whether the socket is IPv6 only.
+    OPT_REUSEPORT     // Whether other sockets may bind the same address.
   };
   virtual int GetOption(Option opt, int* value) = 0;
   virtual int SetOption(Option opt, int value) = 0;
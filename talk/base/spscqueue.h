@@ -0,0 +1,106 @@
+/*
+ * libjingle
+ * Copyright 2013, Google Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef TALK_BASE_SPSCQUEUE_H_
+#define TALK_BASE_SPSCQUEUE_H_
+
+#include "talk/base/basictypes.h"
+#include "talk/base/common.h"
+#include "talk/base/constructormagic.h"
+#include "talk/base/criticalsection.h"
+#include "talk/base/scoped_ptr.h"
+
+namespace talk_base {
+
+// A bounded single-producer, single-consumer ring that doesn't lock or
+// allocate once constructed. Unlike FixedSizeMpscQueue, values are not
+// copied in and out: the producer fills a slot in place and publishes it,
+// and the consumer reads it in place and releases it, so slots can hold
+// objects that own storage (a Buffer, say) and are reused rather than
+// reconstructed. One thread at a time may produce, and one may consume.
+template <typename T>
+class FixedSizeSpscQueue {
+ public:
+  // |capacity| must be a power of two.
+  explicit FixedSizeSpscQueue(int capacity)
+      : slots_(new T[capacity]), mask_(capacity - 1),
+        write_pos_(0), read_pos_(0) {
+    ASSERT(capacity > 0 && (capacity & mask_) == 0);
+  }
+
+  // Returns the slot to fill next, or NULL if the queue is full. The slot
+  // isn't visible to the consumer until Push() is called.
+  T* Back() {
+    if (Diff(write_pos_, AtomicOps::AcquireLoad(&read_pos_)) > mask_)
+      return NULL;
+    return &slots_[write_pos_ & mask_];
+  }
+  // Publishes the slot returned by Back().
+  void Push() {
+    AtomicOps::ReleaseStore(&write_pos_, write_pos_ + 1);
+  }
+
+  // Returns the oldest published slot, or NULL if the queue is empty.
+  T* Front() {
+    if (AtomicOps::AcquireLoad(&write_pos_) == read_pos_)
+      return NULL;
+    return &slots_[read_pos_ & mask_];
+  }
+  // Hands the slot returned by Front() back to the producer.
+  void Pop() {
+    AtomicOps::ReleaseStore(&read_pos_, read_pos_ + 1);
+  }
+
+  // May be called from either side; the answer can be stale by the time the
+  // caller looks at it.
+  size_t Size() const {
+    return Diff(AtomicOps::AcquireLoad(&write_pos_),
+                AtomicOps::AcquireLoad(&read_pos_));
+  }
+  size_t capacity() const { return mask_ + 1; }
+
+ private:
+  // Positions wrap around, so compare them as differences.
+  static int Diff(int a, int b) {
+    return static_cast<int>(static_cast<uint32>(a) - static_cast<uint32>(b));
+  }
+
+  scoped_array<T> slots_;
+  const int mask_;
+  // Keep the producer's and the consumer's positions on separate cache lines.
+  char pad0_[64];
+  volatile int write_pos_;
+  char pad1_[64];
+  volatile int read_pos_;
+
+  DISALLOW_COPY_AND_ASSIGN(FixedSizeSpscQueue);
+};
+
+}  // namespace talk_base
+
+#endif  // TALK_BASE_SPSCQUEUE_H_
@@ -0,0 +1,128 @@
+/*
+ * libjingle
+ * Copyright 2013, Google Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string>
+
+#include "talk/base/gunit.h"
+#include "talk/base/spscqueue.h"
+#include "talk/base/thread.h"
+
+namespace talk_base {
+
+TEST(FixedSizeSpscQueueTest, TestPushPop) {
+  FixedSizeSpscQueue<int> queue(2);
+  EXPECT_EQ(2u, queue.capacity());
+  EXPECT_EQ(0u, queue.Size());
+  EXPECT_TRUE(queue.Front() == NULL);
+  *queue.Back() = 1;
+  queue.Push();
+  *queue.Back() = 2;
+  queue.Push();
+  EXPECT_EQ(2u, queue.Size());
+  EXPECT_TRUE(queue.Back() == NULL);
+  EXPECT_EQ(1, *queue.Front());
+  queue.Pop();
+  *queue.Back() = 3;
+  queue.Push();
+  EXPECT_EQ(2, *queue.Front());
+  queue.Pop();
+  EXPECT_EQ(3, *queue.Front());
+  queue.Pop();
+  EXPECT_EQ(0u, queue.Size());
+  EXPECT_TRUE(queue.Front() == NULL);
+}
+
+// Slots are reused in place, so whatever the consumer leaves in a slot is
+// what the producer finds there on the next lap.
+TEST(FixedSizeSpscQueueTest, TestSlotsReused) {
+  FixedSizeSpscQueue<std::string> queue(2);
+  std::string* first = queue.Back();
+  first->assign("first");
+  queue.Push();
+  queue.Front()->clear();
+  queue.Pop();
+  queue.Push();
+  queue.Pop();
+  EXPECT_EQ(first, queue.Back());
+  EXPECT_TRUE(first->empty());
+}
+
+TEST(FixedSizeSpscQueueTest, TestWrapAround) {
+  FixedSizeSpscQueue<int> queue(4);
+  for (int i = 0; i < 1000; ++i) {
+    *queue.Back() = i;
+    queue.Push();
+    *queue.Back() = -i;
+    queue.Push();
+    EXPECT_EQ(i, *queue.Front());
+    queue.Pop();
+    EXPECT_EQ(-i, *queue.Front());
+    queue.Pop();
+  }
+  EXPECT_TRUE(queue.Front() == NULL);
+}
+
+// Pushes kCount increasing values, retrying while the queue is full.
+class SpscProducer : public Runnable {
+ public:
+  static const int kCount = 100000;
+  explicit SpscProducer(FixedSizeSpscQueue<int>* queue) : queue_(queue) {}
+  virtual void Run(Thread* thread) {
+    for (int i = 0; i < kCount; ++i) {
+      int* slot;
+      while ((slot = queue_->Back()) == NULL) {
+        Thread::Current()->SleepMs(0);
+      }
+      *slot = i;
+      queue_->Push();
+    }
+  }
+ private:
+  FixedSizeSpscQueue<int>* queue_;
+};
+
+// Checks that values cross threads intact and in order.
+TEST(FixedSizeSpscQueueTest, TestAcrossThreads) {
+  FixedSizeSpscQueue<int> queue(64);
+  SpscProducer producer(&queue);
+  Thread thread;
+  thread.Start(&producer);
+  for (int expected = 0; expected < SpscProducer::kCount; ) {
+    int* val = queue.Front();
+    if (!val) {
+      Thread::Current()->SleepMs(0);
+      continue;
+    }
+    EXPECT_EQ(expected, *val);
+    queue.Pop();
+    ++expected;
+  }
+  thread.Stop();
+  EXPECT_EQ(0u, queue.Size());
+}
+
+}  // namespace talk_base
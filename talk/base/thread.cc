@@ -40,6 +40,7 @@
 #include "talk/base/common.h"
 #include "talk/base/logging.h"
 #include "talk/base/stringutils.h"
+#include "talk/base/threadlocalpool.h"
 #include "talk/base/timeutils.h"
 
 #if !__has_feature(objc_arc) && (defined(OSX) || defined(IOS))
@@ -158,7 +159,7 @@ Thread::Thread(SocketServer* ss)
 
 Thread::~Thread() {
   Stop();
-  if (active_)
+  if (AtomicOps::AcquireLoad(&active_))
     Clear(NULL);
 }
 
@@ -358,6 +359,7 @@ void* Thread::PreRun(void* pv) {
       delete init->thread;
     }
     delete init;
+    ThreadLocalPool::ReleaseThreadCache();
     return NULL;
   }
 }
@@ -404,7 +406,12 @@ void Thread::Send(MessageHandler *phandler, uint32 id, MessageData *pdata) {
     smsg.thread = current_thread;
     smsg.msg = msg;
     smsg.ready = &ready;
-    sendlist_.push_back(smsg);
+    if (spare_sends_.empty()) {
+      sendlist_.push_back(smsg);
+    } else {
+      spare_sends_.front() = smsg;
+      sendlist_.splice(sendlist_.end(), spare_sends_, spare_sends_.begin());
+    }
     has_sends_ = true;
   }
 
@@ -449,7 +456,7 @@ void Thread::ReceiveSends() {
   crit_.Enter();
   while (!sendlist_.empty()) {
     _SendMessage smsg = sendlist_.front();
-    sendlist_.pop_front();
+    spare_sends_.splice(spare_sends_.begin(), sendlist_, sendlist_.begin());
     crit_.Leave();
     smsg.msg.phandler->OnMessage(&smsg.msg);
     crit_.Enter();
@@ -553,6 +560,89 @@ void Thread::UnwrapCurrent() {
   started_ = false;
 }
 
+AsyncResultBase::AsyncResultBase(Thread* caller)
+    : caller_(caller), done_(0), cancelled_(0), done_event_(true, false),
+      waiter_(NULL) {
+}
+
+AsyncResultBase::~AsyncResultBase() {
+}
+
+void AsyncResultBase::Start(Thread* target) {
+  // As with Send, run in place when already on the right thread. If the
+  // target is quitting, Post deletes the RunData, which cancels the call.
+  if (target->IsCurrent()) {
+    Run();
+    Complete();
+  } else {
+    target->Post(this, MSG_RUN, new RunData(this));
+  }
+}
+
+void AsyncResultBase::WaitDone() {
+  if (done())
+    return;
+
+  Thread* current = Thread::Current();
+  if (current != NULL) {
+    CritScope cs(&waiter_crit_);
+    if (done())
+      return;
+    if (waiter_ == NULL) {
+      waiter_ = current;
+    } else {
+      // Only one thread can be woken through its socket server.
+      current = NULL;
+    }
+  }
+  if (current == NULL) {
+    done_event_.Wait(kForever);
+    return;
+  }
+  // Same wait loop as Thread::Send; Complete() wakes us up.
+  while (!done()) {
+    current->ReceiveSends();
+    current->socketserver()->Wait(kForever, false);
+  }
+  current->socketserver()->WakeUp();
+}
+
+void AsyncResultBase::OnMessage(Message* msg) {
+  if (msg->message_id == MSG_RUN) {
+    Run();
+    Complete();
+  } else {
+    OnDone();
+  }
+  // May drop the last reference to this.
+  delete msg->pdata;
+}
+
+void AsyncResultBase::Cancel() {
+  AtomicOps::ReleaseStore(&cancelled_, 1);
+  Complete();
+}
+
+void AsyncResultBase::Complete() {
+  {
+    CritScope cs(&waiter_crit_);
+    AtomicOps::ReleaseStore(&done_, 1);
+    if (waiter_)
+      waiter_->socketserver()->WakeUp();
+  }
+  done_event_.Set();
+  if (caller_) {
+    caller_->Post(this, MSG_DONE,
+                  new ScopedRefMessageData<AsyncResultBase>(this));
+  }
+}
+
+AsyncResultBase::RunData::~RunData() {
+  // A queue either dispatches MSG_RUN or clears it, never both, and
+  // OnMessage completes the result before deleting the data.
+  if (!result_->done())
+    result_->Cancel();
+}
 
 AutoThread::AutoThread(SocketServer* ss) : Thread(ss) {
   if (!ThreadManager::Instance()->CurrentThread()) {
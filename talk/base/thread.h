@@ -37,7 +37,9 @@
 #include <pthread.h>
 #endif
 #include "talk/base/constructormagic.h"
+#include "talk/base/event.h"
 #include "talk/base/messagequeue.h"
+#include "talk/base/refcount.h"
 
 #ifdef WIN32
 #include "talk/base/win32.h"
@@ -111,6 +113,115 @@ class Runnable {
   DISALLOW_COPY_AND_ASSIGN(Runnable);
 };
 
+// The state shared by Thread::InvokeAsync and its caller, independent of the
+// result type. The functor runs on the target thread; once it has, done()
+// becomes true, any thread blocked in Wait() is woken, and if a callback was
+// given a message is posted back to the invoking thread to fire SignalDone
+// there. Both threads hold a reference while a message is in flight, so the
+// caller may drop its result at any time. If the target thread goes away or
+// clears its queue before the functor runs, the call is cancelled instead:
+// done() and cancelled() both become true and waiters are released as usual.
+class AsyncResultBase : public MessageHandler, public RefCountInterface {
+ public:
+  // True once the functor has run or the call was cancelled. May be called
+  // from any thread.
+  bool done() const { return AtomicOps::AcquireLoad(&done_) != 0; }
+  // True if the functor was never run, in which case the result holds a
+  // default-constructed value. Only meaningful once done() is true.
+  bool cancelled() const { return AtomicOps::AcquireLoad(&cancelled_) != 0; }
+
+ protected:
+  explicit AsyncResultBase(Thread* caller);
+  virtual ~AsyncResultBase();
+
+  // Runs the functor inline if |target| is the current thread, otherwise
+  // posts it to |target|.
+  void Start(Thread* target);
+  // Blocks until the functor has run or been cancelled. On a thread with a
+  // Thread object this services incoming Sends while it waits, as
+  // Thread::Send does, so the target may Send back to the waiter without
+  // deadlocking.
+  void WaitDone();
+
+  virtual void Run() = 0;
+  virtual void OnDone() = 0;
+
+ private:
+  enum { MSG_RUN, MSG_DONE };
+
+  // The data of MSG_RUN. If the message is thrown away without running, as
+  // Thread::Clear does when the thread is destroyed, its destructor cancels
+  // the call so nobody waits on it forever.
+  class RunData : public MessageData {
+   public:
+    explicit RunData(AsyncResultBase* result) : result_(result) {}
+    virtual ~RunData();
+   private:
+    scoped_refptr<AsyncResultBase> result_;
+  };
+
+  virtual void OnMessage(Message* msg);
+  void Cancel();
+  void Complete();
+
+  // Where to fire SignalDone; NULL if no callback was given.
+  Thread* caller_;
+  volatile int done_;
+  volatile int cancelled_;
+  Event done_event_;
+  // The thread blocked in WaitDone() on its socket server, if any. Guarded by
+  // |waiter_crit_| so Complete() can't miss it.
+  CriticalSection waiter_crit_;
+  Thread* waiter_;
+
+  friend class Thread;
+  DISALLOW_COPY_AND_ASSIGN(AsyncResultBase);
+};
+
+template <class ReturnT>
+class AsyncResult : public AsyncResultBase {
+ public:
+  // Blocks until the functor has run and returns its result.
+  const ReturnT& Wait() {
+    WaitDone();
+    return result_;
+  }
+  // Only valid once done() is true.
+  const ReturnT& result() const {
+    ASSERT(done());
+    return result_;
+  }
+
+  // Fires on the invoking thread the next time it processes messages after
+  // the functor has run. Connected by the InvokeAsync overload that takes a
+  // callback; results from the other overload never fire it.
+  sigslot::signal1<AsyncResult<ReturnT>*> SignalDone;
+
+ protected:
+  explicit AsyncResult(Thread* caller) : AsyncResultBase(caller) {}
+  ReturnT result_;
+
+ private:
+  virtual void OnDone() { SignalDone(this); }
+};
+
+// Specialization for ReturnT of void.
+template <>
+class AsyncResult<void> : public AsyncResultBase {
+ public:
+  void Wait() { WaitDone(); }
+  void result() const { ASSERT(done()); }
+
+  // See AsyncResult<ReturnT>::SignalDone.
+  sigslot::signal1<AsyncResult<void>*> SignalDone;
+
+ protected:
+  explicit AsyncResult(Thread* caller) : AsyncResultBase(caller) {}
+
+ private:
+  virtual void OnDone() { SignalDone(this); }
+};
+
 class Thread : public MessageQueue {
  public:
   explicit Thread(SocketServer* ss = NULL);
@@ -172,6 +283,43 @@ class Thread : public MessageQueue {
     return handler.result();
   }
 
+  // Like Invoke, but returns at once instead of blocking. The functor runs on
+  // this thread in order with messages posted to it (Sends are still
+  // dispatched first). Several calls may be in flight at once, so a caller
+  // can pipeline work and wait only for the result it needs. If this thread
+  // is quitting the functor is not run and the result completes empty, as
+  // with Send.
+  // Ex: scoped_refptr<AsyncResult<bool> > result =
+  //         thread.InvokeAsync<bool>(&MyFunctionReturningBool);
+  //     ...
+  //     bool value = result->Wait();
+  template <class ReturnT, class FunctorT>
+  scoped_refptr<AsyncResult<ReturnT> > InvokeAsync(const FunctorT& functor) {
+    AsyncFunctorResult<ReturnT, FunctorT>* result =
+        new RefCountedObject<AsyncFunctorResult<ReturnT, FunctorT> >(
+            functor, static_cast<Thread*>(NULL));
+    scoped_refptr<AsyncResult<ReturnT> > ref(result);
+    result->Start(this);
+    return ref;
+  }
+
+  // As above, and also calls |callback| on |object| on the calling thread
+  // once the result is in, the next time that thread processes messages.
+  // The calling thread must have a Thread object and outlive the call.
+  template <class ReturnT, class FunctorT, class ObjectT>
+  scoped_refptr<AsyncResult<ReturnT> > InvokeAsync(
+      const FunctorT& functor, ObjectT* object,
+      void (ObjectT::*callback)(AsyncResult<ReturnT>*)) {
+    ASSERT(Current() != NULL);
+    AsyncFunctorResult<ReturnT, FunctorT>* result =
+        new RefCountedObject<AsyncFunctorResult<ReturnT, FunctorT> >(
+            functor, Current());
+    scoped_refptr<AsyncResult<ReturnT> > ref(result);
+    result->SignalDone.connect(object, callback);
+    result->Start(this);
+    return ref;
+  }
+
   // From MessageQueue
   virtual void Clear(MessageHandler *phandler, uint32 id = MQID_ANY,
                      MessageList* removed = NULL);
@@ -244,6 +392,28 @@ class Thread : public MessageQueue {
     FunctorT functor_;
   };
 
+  // The AsyncResult returned by InvokeAsync.
+  template <class ReturnT, class FunctorT>
+  class AsyncFunctorResult : public AsyncResult<ReturnT> {
+   public:
+    AsyncFunctorResult(const FunctorT& functor, Thread* caller)
+        : AsyncResult<ReturnT>(caller), functor_(functor) {}
+   private:
+    virtual void Run() { this->result_ = functor_(); }
+    FunctorT functor_;
+  };
+
+  // Specialization for ReturnT of void.
+  template <class FunctorT>
+  class AsyncFunctorResult<void, FunctorT> : public AsyncResult<void> {
+   public:
+    AsyncFunctorResult(const FunctorT& functor, Thread* caller)
+        : AsyncResult<void>(caller), functor_(functor) {}
+   private:
+    virtual void Run() { functor_(); }
+    FunctorT functor_;
+  };
+
   static void *PreRun(void *pv);
 
   // ThreadManager calls this instead WrapCurrent() because
@@ -252,6 +422,10 @@ class Thread : public MessageQueue {
   bool WrapCurrentWithThreadManager(ThreadManager* thread_manager);
 
   std::list<_SendMessage> sendlist_;
+  // Nodes of sendlist_ that have been received, kept for reuse by later
+  // Sends. They are allocated by the sending thread and would otherwise be
+  // freed by this one, which no thread-local cache can recycle.
+  std::list<_SendMessage> spare_sends_;
   std::string name_;
   ThreadPriority priority_;
   bool started_;
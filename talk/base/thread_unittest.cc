@@ -32,6 +32,8 @@
 #include "talk/base/physicalsocketserver.h"
 #include "talk/base/socketaddress.h"
 #include "talk/base/thread.h"
+#include "talk/base/threadlocalpool.h"
+#include "talk/base/timeutils.h"
 
 #ifdef WIN32
 #include <comdef.h>  // NOLINT
@@ -302,6 +304,227 @@ TEST(ThreadTest, Invoke) {
   thread.Invoke<void>(&LocalFuncs::Func2);
 }
 
+// Function objects and listeners to test Thread::InvokeAsync.
+class CountingFunctor {
+ public:
+  explicit CountingFunctor(int* count) : count_(count) {}
+  int operator()() const { return ++*count_; }
+ private:
+  int* count_;
+};
+class InvokeBackFunctor {
+ public:
+  explicit InvokeBackFunctor(Thread* thread) : thread_(thread) {}
+  int operator()() const { return thread_->Invoke<int>(Functor1()); }
+ private:
+  Thread* thread_;
+};
+class AsyncResultListener : public sigslot::has_slots<> {
+ public:
+  AsyncResultListener() : thread_(NULL), value_(0) {}
+  void OnDone(AsyncResult<int>* result) {
+    thread_ = Thread::Current();
+    value_ = result->result();
+  }
+  Thread* thread_;
+  int value_;
+};
+
+TEST(ThreadTest, InvokeAsync) {
+  Thread thread;
+  thread.Start();
+  scoped_refptr<AsyncResult<int> > result = thread.InvokeAsync<int>(Functor1());
+  EXPECT_EQ(42, result->Wait());
+  EXPECT_TRUE(result->done());
+  EXPECT_FALSE(result->cancelled());
+  bool called = false;
+  Functor2 f2(&called);
+  scoped_refptr<AsyncResult<void> > void_result =
+      thread.InvokeAsync<void>(f2);
+  void_result->Wait();
+  EXPECT_TRUE(called);
+}
+
+TEST(ThreadTest, InvokeAsyncRunsInOrder) {
+  Thread thread;
+  thread.Start();
+  int count = 0;
+  std::vector<scoped_refptr<AsyncResult<int> > > results;
+  for (int i = 0; i < 10; ++i) {
+    results.push_back(thread.InvokeAsync<int>(CountingFunctor(&count)));
+  }
+  results.back()->Wait();
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_TRUE(results[i]->done());
+    EXPECT_EQ(i + 1, results[i]->result());
+  }
+}
+
+TEST(ThreadTest, InvokeAsyncSignalsOnCallingThread) {
+  Thread thread;
+  thread.Start();
+  AsyncResultListener listener;
+  thread.InvokeAsync<int>(Functor1(), &listener,
+                          &AsyncResultListener::OnDone);
+  EXPECT_EQ_WAIT(42, listener.value_, 1000);
+  EXPECT_EQ(Thread::Current(), listener.thread_);
+}
+
+TEST(ThreadTest, InvokeAsyncOnCurrentThread) {
+  scoped_refptr<AsyncResult<int> > result =
+      Thread::Current()->InvokeAsync<int>(Functor1());
+  EXPECT_TRUE(result->done());
+  EXPECT_EQ(42, result->result());
+}
+
+// Waiting must not deadlock when the target calls back into the waiter.
+TEST(ThreadTest, InvokeAsyncWaitReceivesSends) {
+  Thread thread;
+  thread.Start();
+  scoped_refptr<AsyncResult<int> > result =
+      thread.InvokeAsync<int>(InvokeBackFunctor(Thread::Current()));
+  EXPECT_EQ(42, result->Wait());
+}
+
+// A call still queued when the target thread is destroyed must not leave its
+// waiters blocked.
+TEST(ThreadTest, InvokeAsyncCancelledWhenThreadDestroyed) {
+  Thread* thread = new Thread();
+  int count = 0;
+  scoped_refptr<AsyncResult<int> > result =
+      thread->InvokeAsync<int>(CountingFunctor(&count));
+  EXPECT_FALSE(result->done());
+  delete thread;
+  EXPECT_TRUE(result->done());
+  EXPECT_TRUE(result->cancelled());
+  result->Wait();
+  EXPECT_EQ(0, count);
+}
+
+// Calls made once the target has started quitting are cancelled rather than
+// lost.
+TEST(ThreadTest, InvokeAsyncCancelledWhenThreadQuitting) {
+  Thread thread;
+  thread.Quit();
+  int count = 0;
+  scoped_refptr<AsyncResult<int> > result =
+      thread.InvokeAsync<int>(CountingFunctor(&count));
+  result->Wait();
+  EXPECT_TRUE(result->cancelled());
+  EXPECT_EQ(0, count);
+}
+
+TEST(ThreadTest, InvokeAsyncCancelledWhenQueueCleared) {
+  Thread thread;
+  int count = 0;
+  AsyncResultListener listener;
+  scoped_refptr<AsyncResult<int> > result = thread.InvokeAsync<int>(
+      CountingFunctor(&count), &listener, &AsyncResultListener::OnDone);
+  thread.Clear(result.get());
+  result->Wait();
+  EXPECT_TRUE(result->cancelled());
+  thread.Start();
+  // The callback still fires, so callers can tell the call is over.
+  EXPECT_TRUE_WAIT(listener.thread_ != NULL, 1000);
+  EXPECT_EQ(0, count);
+}
+
+// Bounces a message between two threads, with new MessageData for every
+// hop as real code would use, until it has made |hops| hops.
+class PingPongHandler : public MessageHandler {
+ public:
+  PingPongHandler(int hops, Event* done)
+      : hops_(hops), done_(done), peer_thread_(NULL), peer_(NULL) {}
+  void set_peer(Thread* thread, PingPongHandler* peer) {
+    peer_thread_ = thread;
+    peer_ = peer;
+  }
+  virtual void OnMessage(Message* msg) {
+    int hop = UseMessageData<int>(msg->pdata);
+    delete msg->pdata;
+    ThreadLocalPool::GetStats(&stats_);
+    if (hop >= hops_) {
+      done_->Set();
+      return;
+    }
+    peer_thread_->Post(peer_, 0, WrapMessageData(hop + 1));
+  }
+  const ThreadLocalPool::Stats& stats() const { return stats_; }
+
+ private:
+  int hops_;
+  Event* done_;
+  Thread* peer_thread_;
+  PingPongHandler* peer_;
+  ThreadLocalPool::Stats stats_;
+};
+
+class NullHandler : public MessageHandler {
+ public:
+  virtual void OnMessage(Message* msg) {}
+};
+
+static double HitRate(const ThreadLocalPool::Stats& stats) {
+  return stats.allocations ? 100.0 * stats.hits / stats.allocations : 0;
+}
+
+TEST(ThreadBenchmark, DISABLED_PostSendRoundTrips) {
+  const int kRoundTrips = 200000;
+  Thread ping_thread, pong_thread;
+  ping_thread.Start();
+  pong_thread.Start();
+  Event done(false, false);
+  PingPongHandler ping(2 * kRoundTrips, &done), pong(2 * kRoundTrips, &done);
+  ping.set_peer(&pong_thread, &pong);
+  pong.set_peer(&ping_thread, &ping);
+  uint64 start = TimeNanos();
+  ping_thread.Post(&ping, 0, WrapMessageData(0));
+  EXPECT_TRUE(done.Wait(60000));
+  uint64 elapsed = TimeNanos() - start;
+  LOG(LS_INFO) << "Post: " << elapsed / kRoundTrips << "ns per round trip, "
+               << "pool hit rate " << HitRate(ping.stats()) << "% / "
+               << HitRate(pong.stats()) << "%";
+
+  NullHandler handler;
+  start = TimeNanos();
+  for (int i = 0; i < kRoundTrips; ++i) {
+    MessageData* data = WrapMessageData(i);
+    pong_thread.Send(&handler, 0, data);
+    delete data;
+  }
+  elapsed = TimeNanos() - start;
+  ThreadLocalPool::Stats stats;
+  ThreadLocalPool::GetStats(&stats);
+  LOG(LS_INFO) << "Send: " << elapsed / kRoundTrips << "ns per round trip, "
+               << "pool hit rate " << HitRate(stats) << "%";
+}
+
+// A two-step sequence, like CreateOffer followed by SetLocalDescription,
+// made either as two blocking Invokes or as two pipelined InvokeAsyncs
+// waiting only for the second.
+TEST(ThreadBenchmark, DISABLED_InvokeVersusInvokeAsync) {
+  const int kSequences = 100000;
+  Thread thread;
+  thread.Start();
+  int count = 0;
+  uint64 start = TimeNanos();
+  for (int i = 0; i < kSequences; ++i) {
+    thread.Invoke<int>(CountingFunctor(&count));
+    thread.Invoke<int>(CountingFunctor(&count));
+  }
+  uint64 elapsed = TimeNanos() - start;
+  LOG(LS_INFO) << "Invoke: " << elapsed / kSequences << "ns per sequence";
+
+  start = TimeNanos();
+  for (int i = 0; i < kSequences; ++i) {
+    thread.InvokeAsync<int>(CountingFunctor(&count));
+    thread.InvokeAsync<int>(CountingFunctor(&count))->Wait();
+  }
+  elapsed = TimeNanos() - start;
+  LOG(LS_INFO) << "InvokeAsync: " << elapsed / kSequences << "ns per sequence";
+  EXPECT_EQ(4 * kSequences, count);
+}
+
 #ifdef WIN32
 class ComThreadTest : public testing::Test, public MessageHandler {
  public:
@@ -0,0 +1,189 @@
+/*
+ * libjingle
+ * Copyright 2013, Google Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "talk/base/threadlocalpool.h"
+
+#if defined(WIN32)
+#include "talk/base/win32.h"
+#else
+#include <pthread.h>
+#endif
+
+#include <cstring>
+
+#include "talk/base/common.h"
+
+namespace talk_base {
+
+namespace {
+
+const size_t kNumSizeClasses =
+    ThreadLocalPool::kMaxBlockSize / ThreadLocalPool::kSizeClassGranularity;
+
+size_t SizeClass(size_t size) {
+  return (size == 0) ? 0 : (size - 1) / ThreadLocalPool::kSizeClassGranularity;
+}
+
+size_t ClassBlockSize(size_t size_class) {
+  return (size_class + 1) * ThreadLocalPool::kSizeClassGranularity;
+}
+
+// Free blocks are linked through their first word.
+struct FreeBlock {
+  FreeBlock* next;
+};
+
+struct ThreadCache {
+  ThreadCache() {
+    memset(free_lists, 0, sizeof(free_lists));
+    memset(free_counts, 0, sizeof(free_counts));
+  }
+  ~ThreadCache() {
+    for (size_t i = 0; i < kNumSizeClasses; ++i) {
+      while (FreeBlock* block = free_lists[i]) {
+        free_lists[i] = block->next;
+        ::operator delete(block);
+      }
+    }
+  }
+
+  FreeBlock* free_lists[kNumSizeClasses];
+  int free_counts[kNumSizeClasses];
+  ThreadLocalPool::Stats stats;
+};
+
+// Owns the thread-local slot that points to each thread's ThreadCache.
+class ThreadCacheKey {
+ public:
+  ThreadCacheKey() {
+#if defined(WIN32)
+    key_ = TlsAlloc();
+#else
+    pthread_key_create(&key_, &OnThreadExit);
+#endif
+  }
+
+  ThreadCache* Get() {
+#if defined(WIN32)
+    return static_cast<ThreadCache*>(TlsGetValue(key_));
+#else
+    return static_cast<ThreadCache*>(pthread_getspecific(key_));
+#endif
+  }
+
+  ThreadCache* GetOrCreate() {
+    ThreadCache* cache = Get();
+    if (!cache) {
+      cache = new ThreadCache;
+      Set(cache);
+    }
+    return cache;
+  }
+
+  void Set(ThreadCache* cache) {
+#if defined(WIN32)
+    TlsSetValue(key_, cache);
+#else
+    pthread_setspecific(key_, cache);
+#endif
+  }
+
+ private:
+#if !defined(WIN32)
+  static void OnThreadExit(void* cache) {
+    delete static_cast<ThreadCache*>(cache);
+  }
+#endif
+
+#if defined(WIN32)
+  DWORD key_;
+#else
+  pthread_key_t key_;
+#endif
+};
+
+ThreadCacheKey* GetThreadCacheKey() {
+  LIBJINGLE_DEFINE_STATIC_LOCAL(ThreadCacheKey, key, ());
+  return &key;
+}
+
+}  // namespace
+
+void* ThreadLocalPool::Allocate(size_t size) {
+  if (size > kMaxBlockSize) {
+    return ::operator new(size);
+  }
+  size_t size_class = SizeClass(size);
+  ThreadCache* cache = GetThreadCacheKey()->GetOrCreate();
+  ++cache->stats.allocations;
+  FreeBlock* block = cache->free_lists[size_class];
+  if (!block) {
+    // Always allocate the whole class size, so that the block can be reused
+    // for any request in its class once it is freed.
+    return ::operator new(ClassBlockSize(size_class));
+  }
+  ++cache->stats.hits;
+  cache->free_lists[size_class] = block->next;
+  --cache->free_counts[size_class];
+  return block;
+}
+
+void ThreadLocalPool::Free(void* block, size_t size) {
+  if (!block) {
+    return;
+  }
+  if (size > kMaxBlockSize) {
+    ::operator delete(block);
+    return;
+  }
+  size_t size_class = SizeClass(size);
+  ThreadCache* cache = GetThreadCacheKey()->GetOrCreate();
+  ++cache->stats.frees;
+  if (cache->free_counts[size_class] >= kMaxFreeBlocks) {
+    ++cache->stats.releases;
+    ::operator delete(block);
+    return;
+  }
+  FreeBlock* free_block = static_cast<FreeBlock*>(block);
+  free_block->next = cache->free_lists[size_class];
+  cache->free_lists[size_class] = free_block;
+  ++cache->free_counts[size_class];
+}
+
+void ThreadLocalPool::GetStats(Stats* stats) {
+  ThreadCache* cache = GetThreadCacheKey()->Get();
+  *stats = cache ? cache->stats : Stats();
+}
+
+void ThreadLocalPool::ReleaseThreadCache() {
+  ThreadCacheKey* key = GetThreadCacheKey();
+  delete key->Get();
+  key->Set(NULL);
+}
+
+}  // namespace talk_base
@@ -0,0 +1,84 @@
+/*
+ * libjingle
+ * Copyright 2013, Google Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef TALK_BASE_THREADLOCALPOOL_H_
+#define TALK_BASE_THREADLOCALPOOL_H_
+
+#include <stddef.h>
+
+#include "talk/base/basictypes.h"
+
+namespace talk_base {
+
+// Per-thread caches of small memory blocks, for objects that are created on
+// one thread and destroyed soon after, often on another, such as the
+// MessageData that goes with every Post and Send. Each thread keeps a free
+// list per size class, so as long as it has a block of the right size cached,
+// allocating and freeing touch neither the shared heap nor any lock.
+//
+// A block freed on a thread other than the one that allocated it joins the
+// freeing thread's cache. Each cache is bounded, and blocks beyond the bound
+// go back to the heap, so a one-way flow of blocks between two threads can't
+// make a cache grow without limit.
+class ThreadLocalPool {
+ public:
+  // Requests larger than this go straight to the heap.
+  static const size_t kMaxBlockSize = 256;
+  // Block sizes are rounded up to a multiple of this.
+  static const size_t kSizeClassGranularity = 16;
+  // The number of free blocks a thread keeps per size class.
+  static const int kMaxFreeBlocks = 256;
+
+  // Counters for one thread. The hit rate is hits / allocations.
+  struct Stats {
+    Stats() : allocations(0), hits(0), frees(0), releases(0) {}
+    // Allocations of up to kMaxBlockSize bytes.
+    int64 allocations;
+    // Allocations served from the thread's cache.
+    int64 hits;
+    int64 frees;
+    // Frees that went to the heap because the cache was full.
+    int64 releases;
+  };
+
+  static void* Allocate(size_t size);
+  // |size| must be the size that was passed to Allocate.
+  static void Free(void* block, size_t size);
+
+  // Returns the calling thread's counters.
+  static void GetStats(Stats* stats);
+
+  // Gives the calling thread's cached blocks back to the heap. Threads do
+  // this on exit; Thread calls it when its Run returns, which is what cleans
+  // up on Windows, where thread-local storage has no destructors.
+  static void ReleaseThreadCache();
+};
+
+}  // namespace talk_base
+
+#endif  // TALK_BASE_THREADLOCALPOOL_H_
@@ -0,0 +1,171 @@
+/*
+ * libjingle
+ * Copyright 2013, Google Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <list>
+
+#include "talk/base/gunit.h"
+#include "talk/base/logging.h"
+#include "talk/base/messagequeue.h"
+#include "talk/base/thread.h"
+#include "talk/base/threadlocalpool.h"
+#include "talk/base/timeutils.h"
+
+namespace talk_base {
+
+TEST(ThreadLocalPoolTest, TestReuse) {
+  ThreadLocalPool::Stats before, after;
+  ThreadLocalPool::GetStats(&before);
+  void* first = ThreadLocalPool::Allocate(40);
+  ThreadLocalPool::Free(first, 40);
+  // Anything in the same size class gets the block back.
+  void* second = ThreadLocalPool::Allocate(33);
+  EXPECT_EQ(first, second);
+  ThreadLocalPool::Free(second, 33);
+  ThreadLocalPool::GetStats(&after);
+  EXPECT_EQ(before.allocations + 2, after.allocations);
+  EXPECT_GE(after.hits, before.hits + 1);
+  EXPECT_EQ(before.frees + 2, after.frees);
+}
+
+TEST(ThreadLocalPoolTest, TestLargeBlocksBypassPool) {
+  ThreadLocalPool::Stats before, after;
+  ThreadLocalPool::GetStats(&before);
+  void* block = ThreadLocalPool::Allocate(ThreadLocalPool::kMaxBlockSize + 1);
+  ThreadLocalPool::Free(block, ThreadLocalPool::kMaxBlockSize + 1);
+  ThreadLocalPool::GetStats(&after);
+  EXPECT_EQ(before.allocations, after.allocations);
+  EXPECT_EQ(before.frees, after.frees);
+}
+
+TEST(ThreadLocalPoolTest, TestCacheIsBounded) {
+  const int kBlocks = ThreadLocalPool::kMaxFreeBlocks + 10;
+  std::list<void*> blocks;
+  for (int i = 0; i < kBlocks; ++i) {
+    blocks.push_back(ThreadLocalPool::Allocate(200));
+  }
+  ThreadLocalPool::Stats before, after;
+  ThreadLocalPool::GetStats(&before);
+  for (std::list<void*>::iterator it = blocks.begin(); it != blocks.end();
+       ++it) {
+    ThreadLocalPool::Free(*it, 200);
+  }
+  ThreadLocalPool::GetStats(&after);
+  EXPECT_GE(after.releases - before.releases, 10);
+}
+
+struct PooledMessageData : public MessageData {
+  char payload[24];
+};
+
+TEST(ThreadLocalPoolTest, TestMessageDataIsPooled) {
+  ThreadLocalPool::Stats before, after;
+  delete new PooledMessageData;
+  delete WrapMessageData(5);
+  ThreadLocalPool::GetStats(&before);
+  delete new PooledMessageData;
+  delete WrapMessageData(5);
+  ThreadLocalPool::GetStats(&after);
+  EXPECT_EQ(before.allocations + 2, after.allocations);
+  EXPECT_EQ(before.hits + 2, after.hits);
+}
+
+// Blocks allocated on one thread and freed on another end up in the freeing
+// thread's cache.
+class PoolFreer : public Runnable {
+ public:
+  explicit PoolFreer(void* block) : block_(block) {}
+  virtual void Run(Thread* thread) {
+    ThreadLocalPool::Free(block_, 64);
+    void* again = ThreadLocalPool::Allocate(64);
+    reused_ = (again == block_);
+    ThreadLocalPool::Free(again, 64);
+  }
+  void* block_;
+  bool reused_;
+};
+
+TEST(ThreadLocalPoolTest, TestFreeOnOtherThread) {
+  PoolFreer freer(ThreadLocalPool::Allocate(64));
+  Thread thread;
+  thread.Start(&freer);
+  thread.Stop();
+  EXPECT_TRUE(freer.reused_);
+}
+
+// Allocates and frees small blocks in bursts, the way a busy thread churns
+// through messages, either from the pool or from the heap.
+class PoolChurner : public Runnable {
+ public:
+  static const int kBurst = 32;
+  static const int kRounds = 100000;
+  explicit PoolChurner(bool pooled) : pooled_(pooled) {}
+  virtual void Run(Thread* thread) {
+    void* blocks[kBurst];
+    for (int round = 0; round < kRounds; ++round) {
+      for (int i = 0; i < kBurst; ++i) {
+        blocks[i] = pooled_ ? ThreadLocalPool::Allocate(48) :
+            ::operator new(48);
+      }
+      for (int i = 0; i < kBurst; ++i) {
+        if (pooled_) {
+          ThreadLocalPool::Free(blocks[i], 48);
+        } else {
+          ::operator delete(blocks[i]);
+        }
+      }
+    }
+  }
+ private:
+  bool pooled_;
+};
+
+static uint64 RunChurners(int threads, bool pooled) {
+  std::list<Thread*> running;
+  PoolChurner churner(pooled);
+  uint64 start = TimeNanos();
+  for (int i = 0; i < threads; ++i) {
+    running.push_back(new Thread());
+    running.back()->Start(&churner);
+  }
+  for (std::list<Thread*>::iterator it = running.begin(); it != running.end();
+       ++it) {
+    (*it)->Stop();
+    delete *it;
+  }
+  return (TimeNanos() - start) /
+      (threads * PoolChurner::kRounds * PoolChurner::kBurst);
+}
+
+TEST(ThreadLocalPoolBenchmark, DISABLED_AllocateFree) {
+  for (int threads = 1; threads <= 8; threads *= 2) {
+    LOG(LS_INFO) << threads << " threads: heap " << RunChurners(threads, false)
+                 << "ns, pool " << RunChurners(threads, true)
+                 << "ns per allocation";
+  }
+}
+
+}  // namespace talk_base
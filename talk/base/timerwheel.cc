@@ -0,0 +1,310 @@
+/*
+ * libjingle
+ * Copyright 2013, Google Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "talk/base/timerwheel.h"
+
+#include "talk/base/common.h"
+#include "talk/base/timeutils.h"
+
+namespace talk_base {
+
+// Bits of the time that select a slot at each level; the rest of the level's
+// range is covered by the levels inside it.
+static const int kLevelShift[] = { 0, 8, 14, 20, 26 };
+// Index of each level's first slot.
+static const int kLevelBase[] = { 0, 256, 320, 384, 448 };
+static const int kLevelSize[] = { 256, 64, 64, 64, 64 };
+
+// Returns the index of the lowest set bit, or -1 if there is none.
+static int FindFirstSet(uint64 word) {
+  if (!word)
+    return -1;
+#if defined(__GNUC__)
+  return __builtin_ctzll(word);
+#else
+  int index = 0;
+  while (!(word & 1)) {
+    word >>= 1;
+    ++index;
+  }
+  return index;
+#endif
+}
+
+// Orders messages by trigger time, then by the order they were posted.
+static bool IsBefore(uint32 trigger1, uint32 num1,
+                     uint32 trigger2, uint32 num2) {
+  int diff = TimeDiff(trigger1, trigger2);
+  if (diff != 0)
+    return diff < 0;
+  return static_cast<int32>(num1 - num2) < 0;
+}
+
+TimerWheel::TimerWheel()
+    : current_(0), size_(0), free_entries_(NULL) {
+  memset(slots_, 0, sizeof(slots_));
+  memset(occupied_, 0, sizeof(occupied_));
+}
+
+TimerWheel::~TimerWheel() {
+  for (int i = 0; i < kNumSlots; ++i) {
+    while (Entry* entry = slots_[i].head) {
+      slots_[i].head = entry->next;
+      delete entry;
+    }
+  }
+  while (Entry* entry = free_entries_) {
+    free_entries_ = entry->next;
+    delete entry;
+  }
+}
+
+void TimerWheel::Insert(uint32 now, uint32 trigger, uint32 num,
+                        const Message& msg) {
+  if (size_ == 0) {
+    current_ = now;
+  }
+  Entry* entry = free_entries_;
+  if (entry) {
+    free_entries_ = entry->next;
+  } else {
+    entry = new Entry;
+  }
+  entry->trigger = trigger;
+  entry->num = num;
+  entry->msg = msg;
+  ++size_;
+
+  Entry*& first = handlers_[msg.phandler];
+  entry->handler_prev = NULL;
+  entry->handler_next = first;
+  if (first)
+    first->handler_prev = entry;
+  first = entry;
+
+  Place(entry);
+}
+
+void TimerWheel::Place(Entry* entry) {
+  // Messages that are already due go in the next slot to be expired.
+  uint32 time = TimeIsLater(current_, entry->trigger) ?
+      entry->trigger : current_;
+  uint32 delta = time - current_;
+  int level = 0;
+  while (level < kLevels - 1 && delta >= (1u << kLevelShift[level + 1])) {
+    ++level;
+  }
+  int slot = kLevelBase[level] +
+      ((time >> kLevelShift[level]) & (kLevelSize[level] - 1));
+  entry->slot = slot;
+  occupied_[slot / 64] |= static_cast<uint64>(1) << (slot % 64);
+
+  // Only the innermost level needs to be in order; the others are sorted
+  // when they move inward.
+  Slot* s = &slots_[slot];
+  Entry* prev = s->tail;
+  if (level == 0) {
+    while (prev && IsBefore(entry->trigger, entry->num,
+                            prev->trigger, prev->num)) {
+      prev = prev->prev;
+    }
+  }
+  entry->prev = prev;
+  entry->next = prev ? prev->next : s->head;
+  if (entry->next) {
+    entry->next->prev = entry;
+  } else {
+    s->tail = entry;
+  }
+  if (prev) {
+    prev->next = entry;
+  } else {
+    s->head = entry;
+  }
+}
+
+void TimerWheel::Unlink(Entry* entry) {
+  Slot* s = &slots_[entry->slot];
+  if (entry->prev) {
+    entry->prev->next = entry->next;
+  } else {
+    s->head = entry->next;
+  }
+  if (entry->next) {
+    entry->next->prev = entry->prev;
+  } else {
+    s->tail = entry->prev;
+  }
+  if (!s->head) {
+    occupied_[entry->slot / 64] &=
+        ~(static_cast<uint64>(1) << (entry->slot % 64));
+  }
+}
+
+void TimerWheel::Release(Entry* entry) {
+  if (entry->handler_next)
+    entry->handler_next->handler_prev = entry->handler_prev;
+  if (entry->handler_prev) {
+    entry->handler_prev->handler_next = entry->handler_next;
+  } else if (entry->handler_next) {
+    handlers_[entry->msg.phandler] = entry->handler_next;
+  } else {
+    handlers_.erase(entry->msg.phandler);
+  }
+  entry->next = free_entries_;
+  free_entries_ = entry;
+  --size_;
+}
+
+void TimerWheel::Cascade(int level) {
+  int slot = kLevelBase[level] +
+      ((current_ >> kLevelShift[level]) & (kLevelSize[level] - 1));
+  Entry* entry = slots_[slot].head;
+  slots_[slot].head = slots_[slot].tail = NULL;
+  occupied_[slot / 64] &= ~(static_cast<uint64>(1) << (slot % 64));
+  while (entry) {
+    Entry* next = entry->next;
+    Place(entry);
+    entry = next;
+  }
+}
+
+void TimerWheel::Advance(uint32 now, std::deque<Message>* expired) {
+  while (size_ > 0 && !TimeIsLater(now, current_)) {
+    // Move messages inward when the levels inside have gone all the way
+    // round.
+    for (int level = 1; level < kLevels; ++level) {
+      uint32 inner_mask = (1u << kLevelShift[level]) - 1;
+      if ((current_ & inner_mask) != 0)
+        break;
+      Cascade(level);
+    }
+
+    Slot* s = &slots_[current_ & (kLevelSize[0] - 1)];
+    while (Entry* entry = s->head) {
+      Unlink(entry);
+      expired->push_back(entry->msg);
+      Release(entry);
+    }
+
+    if (size_ == 0)
+      break;
+    uint32 next = NextEvent(current_ + 1);
+    current_ = TimeIsLater(now, next) ? now + 1 : next;
+  }
+  if (size_ == 0 && !TimeIsLater(now, current_)) {
+    current_ = now + 1;
+  }
+}
+
+int TimerWheel::GetDelay(uint32 now) const {
+  if (size_ == 0)
+    return kForever;
+  return _max(0, TimeDiff(NextEvent(current_), now));
+}
+
+void TimerWheel::Remove(MessageHandler* handler, uint32 id,
+                        MessageList* removed) {
+  HandlerMap::iterator it, end;
+  if (handler) {
+    it = handlers_.find(handler);
+    if (it == handlers_.end())
+      return;
+    end = it;
+    ++end;
+  } else {
+    it = handlers_.begin();
+    end = handlers_.end();
+  }
+  while (it != end) {
+    // Release may erase the handler's map entry, so move on first.
+    Entry* entry = it->second;
+    ++it;
+    while (entry) {
+      Entry* next = entry->handler_next;
+      if (entry->msg.Match(handler, id)) {
+        Unlink(entry);
+        removed->push_back(entry->msg);
+        Release(entry);
+      }
+      entry = next;
+    }
+  }
+}
+
+// Returns the index within |level| of the first occupied slot, starting at
+// |start| and wrapping around, or -1 if the level is empty.
+int TimerWheel::FindSlot(int level, int start) const {
+  const uint64* words = &occupied_[kLevelBase[level] / 64];
+  int num_words = kLevelSize[level] / 64;
+  int first_word = start / 64;
+  // The rest of the first word, then the others, then all of the first one.
+  for (int i = 0; i <= num_words; ++i) {
+    int word = (first_word + i) % num_words;
+    uint64 bits = words[word];
+    if (i == 0)
+      bits &= ~static_cast<uint64>(0) << (start % 64);
+    int found = FindFirstSet(bits);
+    if (found >= 0)
+      return word * 64 + found;
+  }
+  return -1;
+}
+
+uint32 TimerWheel::NextEvent(uint32 from) const {
+  ASSERT(size_ > 0);
+  uint32 next = from;
+  bool found = false;
+
+  int start = from & (kLevelSize[0] - 1);
+  int index = FindSlot(0, start);
+  if (index >= 0) {
+    next = from + ((index - start) & (kLevelSize[0] - 1));
+    found = true;
+  }
+
+  // Outer slots move inward at the start of their range.
+  for (int level = 1; level < kLevels; ++level) {
+    uint32 width = 1u << kLevelShift[level];
+    uint32 boundary = (from + width - 1) & ~(width - 1);
+    start = (boundary >> kLevelShift[level]) & (kLevelSize[level] - 1);
+    index = FindSlot(level, start);
+    if (index < 0)
+      continue;
+    uint32 time = boundary +
+        (((index - start) & (kLevelSize[level] - 1)) << kLevelShift[level]);
+    if (!found || TimeIsLater(time, next)) {
+      next = time;
+      found = true;
+    }
+  }
+  ASSERT(found);
+  return next;
+}
+
+}  // namespace talk_base
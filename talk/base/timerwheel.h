@@ -0,0 +1,119 @@
+/*
+ * libjingle
+ * Copyright 2013, Google Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef TALK_BASE_TIMERWHEEL_H_
+#define TALK_BASE_TIMERWHEEL_H_
+
+#include <deque>
+#include <map>
+
+#include "talk/base/basictypes.h"
+#include "talk/base/constructormagic.h"
+#include "talk/base/messagequeue.h"
+
+namespace talk_base {
+
+// A hierarchical timer wheel holding delayed messages, as an alternative to
+// MessageQueue's heap when a queue has many timers outstanding. Adding a
+// message is O(1), and so is removing one, given its handler. The innermost
+// level has a slot for each of the next 256 milliseconds; each of the four
+// outer levels has 64 slots, each 64 times as wide as those of the level
+// inside it. Messages move inward as their time gets closer, so a wheel may
+// need to run a little earlier than its next message is due to do that.
+// Not thread safe.
+class TimerWheel {
+ public:
+  TimerWheel();
+  // Messages still in the wheel are dropped without deleting their data.
+  ~TimerWheel();
+
+  bool empty() const { return size_ == 0; }
+  size_t size() const { return size_; }
+
+  // Adds |msg|, to be returned by Advance once |trigger| is reached. Messages
+  // with the same trigger time are returned in |num| order.
+  void Insert(uint32 now, uint32 trigger, uint32 num, const Message& msg);
+
+  // Appends the messages due at |now| to |expired|, in order.
+  void Advance(uint32 now, std::deque<Message>* expired);
+
+  // Returns the milliseconds from |now| until Advance has work to do, or
+  // kForever if the wheel is empty.
+  int GetDelay(uint32 now) const;
+
+  // Moves the messages that match |handler| and |id| to |removed|.
+  void Remove(MessageHandler* handler, uint32 id, MessageList* removed);
+
+ private:
+  struct Entry {
+    uint32 trigger;
+    uint32 num;
+    Message msg;
+    int slot;
+    Entry* prev;
+    Entry* next;
+    // The other entries with the same handler.
+    Entry* handler_prev;
+    Entry* handler_next;
+  };
+  struct Slot {
+    Entry* head;
+    Entry* tail;
+  };
+  typedef std::map<MessageHandler*, Entry*> HandlerMap;
+  enum {
+    kLevels = 5,
+    kInnerBits = 8,
+    kOuterBits = 6,
+    kNumSlots = (1 << kInnerBits) + (kLevels - 1) * (1 << kOuterBits),
+  };
+
+  void Place(Entry* entry);
+  void Unlink(Entry* entry);
+  void Release(Entry* entry);
+  void Cascade(int level);
+  // Returns the first time, starting at |from|, that a message is due or
+  // needs to move inward.
+  uint32 NextEvent(uint32 from) const;
+  int FindSlot(int level, int start) const;
+
+  // The next millisecond that Advance will look at.
+  uint32 current_;
+  size_t size_;
+  Slot slots_[kNumSlots];
+  // One bit for each slot that isn't empty.
+  uint64 occupied_[kNumSlots / 64];
+  HandlerMap handlers_;
+  Entry* free_entries_;
+
+  DISALLOW_COPY_AND_ASSIGN(TimerWheel);
+};
+
+}  // namespace talk_base
+
+#endif  // TALK_BASE_TIMERWHEEL_H_
@@ -0,0 +1,175 @@
+/*
+ * libjingle
+ * Copyright 2013, Google Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <deque>
+
+#include "talk/base/gunit.h"
+#include "talk/base/timerwheel.h"
+
+namespace talk_base {
+
+class TimerWheelTest : public testing::Test {
+ protected:
+  void Insert(uint32 trigger, uint32 id, MessageHandler* handler = NULL) {
+    Message msg;
+    msg.phandler = handler;
+    msg.message_id = id;
+    wheel_.Insert(now_, trigger, num_++, msg);
+  }
+  // Moves time forward to |now| and checks that exactly |ids| expire.
+  void ExpectExpired(uint32 now, const uint32* ids, size_t count) {
+    now_ = now;
+    std::deque<Message> expired;
+    wheel_.Advance(now_, &expired);
+    ASSERT_EQ(count, expired.size());
+    for (size_t i = 0; i < count; ++i) {
+      EXPECT_EQ(ids[i], expired[i].message_id);
+    }
+  }
+  // Finds when the next message expires by following GetDelay.
+  uint32 RunUntilExpired(uint32* id) {
+    std::deque<Message> expired;
+    while (expired.empty()) {
+      int delay = wheel_.GetDelay(now_);
+      EXPECT_NE(kForever, delay);
+      now_ += delay;
+      wheel_.Advance(now_, &expired);
+    }
+    EXPECT_EQ(1u, expired.size());
+    *id = expired.front().message_id;
+    return now_;
+  }
+
+  TimerWheelTest() : now_(1000), num_(0) {}
+  TimerWheel wheel_;
+  uint32 now_;
+  uint32 num_;
+};
+
+class NullHandler : public MessageHandler {
+ public:
+  virtual void OnMessage(Message* msg) {}
+};
+
+TEST_F(TimerWheelTest, TestEmpty) {
+  EXPECT_TRUE(wheel_.empty());
+  EXPECT_EQ(kForever, wheel_.GetDelay(now_));
+  ExpectExpired(5000, NULL, 0);
+}
+
+TEST_F(TimerWheelTest, TestOrder) {
+  Insert(1003, 3);
+  Insert(998, 0);
+  Insert(999, 1);
+  Insert(1003, 4);
+  Insert(999, 2);
+  Insert(1010, 5);
+  EXPECT_EQ(6u, wheel_.size());
+  EXPECT_EQ(0, wheel_.GetDelay(now_));
+  const uint32 kDue[] = { 0, 1, 2 };
+  ExpectExpired(1000, kDue, ARRAY_SIZE(kDue));
+  EXPECT_EQ(3, wheel_.GetDelay(now_));
+  ExpectExpired(1002, NULL, 0);
+  const uint32 kLater[] = { 3, 4 };
+  ExpectExpired(1005, kLater, ARRAY_SIZE(kLater));
+  EXPECT_EQ(5, wheel_.GetDelay(now_));
+  const uint32 kLast[] = { 5 };
+  ExpectExpired(2000, kLast, ARRAY_SIZE(kLast));
+  EXPECT_TRUE(wheel_.empty());
+}
+
+// Messages posted earlier for the same time come out first, even when they
+// had to move in from an outer level.
+TEST_F(TimerWheelTest, TestFifoAcrossLevels) {
+  Insert(21000, 0);
+  Insert(21000, 1);
+  ExpectExpired(20900, NULL, 0);
+  Insert(21000, 2);
+  EXPECT_EQ(92, wheel_.GetDelay(now_));
+  ExpectExpired(20999, NULL, 0);
+  const uint32 kDue[] = { 0, 1, 2 };
+  ExpectExpired(21000, kDue, ARRAY_SIZE(kDue));
+}
+
+TEST_F(TimerWheelTest, TestLongDelays) {
+  const uint32 kDelays[] = { 1, 255, 256, 257, 16383, 16384, 16385,
+                             1000000, 1 << 20, 67108864, 1u << 30,
+                             0x7fffffff };
+  for (size_t i = 0; i < ARRAY_SIZE(kDelays); ++i) {
+    Insert(now_ + kDelays[i], i);
+  }
+  uint32 start = now_;
+  for (size_t i = 0; i < ARRAY_SIZE(kDelays); ++i) {
+    uint32 id;
+    EXPECT_EQ(start + kDelays[i], RunUntilExpired(&id));
+    EXPECT_EQ(i, id);
+  }
+  EXPECT_TRUE(wheel_.empty());
+}
+
+TEST_F(TimerWheelTest, TestTimeWraps) {
+  now_ = 0xffffff00;
+  Insert(now_ + 100, 0);
+  Insert(now_ + 300, 1);
+  Insert(now_ + 70000, 2);
+  uint32 id;
+  EXPECT_EQ(0xffffff00 + 100, RunUntilExpired(&id));
+  EXPECT_EQ(0u, id);
+  EXPECT_EQ(0xffffff00 + 300, RunUntilExpired(&id));
+  EXPECT_EQ(1u, id);
+  EXPECT_EQ(0xffffff00 + 70000, RunUntilExpired(&id));
+  EXPECT_EQ(2u, id);
+}
+
+TEST_F(TimerWheelTest, TestRemove) {
+  NullHandler handler1, handler2;
+  Insert(1010, 1, &handler1);
+  Insert(1020, 2, &handler1);
+  Insert(50000, 3, &handler1);
+  Insert(1010, 1, &handler2);
+  Insert(1030, 2, &handler2);
+
+  MessageList removed;
+  wheel_.Remove(&handler1, 2, &removed);
+  EXPECT_EQ(1u, removed.size());
+  EXPECT_EQ(4u, wheel_.size());
+  wheel_.Remove(&handler1, MQID_ANY, &removed);
+  EXPECT_EQ(3u, removed.size());
+  EXPECT_EQ(2u, wheel_.size());
+  wheel_.Remove(&handler1, MQID_ANY, &removed);
+  EXPECT_EQ(3u, removed.size());
+
+  const uint32 kFirst[] = { 1 };
+  ExpectExpired(1025, kFirst, ARRAY_SIZE(kFirst));
+  wheel_.Remove(NULL, MQID_ANY, &removed);
+  EXPECT_EQ(4u, removed.size());
+  EXPECT_TRUE(wheel_.empty());
+  EXPECT_EQ(kForever, wheel_.GetDelay(now_));
+}
+
+}  // namespace talk_base
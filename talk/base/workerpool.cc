@@ -0,0 +1,134 @@
+/*
+ * libjingle
+ * Copyright 2013, Google Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "talk/base/workerpool.h"
+
+#include "talk/base/common.h"
+
+namespace talk_base {
+
+WorkerPool::Worker::Worker(WorkerPool* pool, int index)
+    : pool_(pool), index_(index), idle_(0), wakeup_(false, false) {
+  SetName("WorkerPool", pool);
+}
+
+WorkerPool::Worker::~Worker() {
+  // Join before the queue and lock go away.
+  Stop();
+}
+
+WorkerPool::WorkerPool(int num_threads) : next_(0), stopping_(0) {
+  ASSERT(num_threads > 0);
+  for (int i = 0; i < num_threads; ++i) {
+    workers_.push_back(new Worker(this, i));
+  }
+  for (int i = 0; i < num_threads; ++i) {
+    workers_[i]->Start();
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  AtomicOps::ReleaseStore(&stopping_, 1);
+  for (size_t i = 0; i < workers_.size(); ++i) {
+    workers_[i]->wakeup_.Set();
+  }
+  for (size_t i = 0; i < workers_.size(); ++i) {
+    delete workers_[i];
+  }
+}
+
+WorkerPool* WorkerPool::Default() {
+  LIBJINGLE_DEFINE_STATIC_LOCAL(WorkerPool, pool, (kDefaultThreads));
+  return &pool;
+}
+
+void WorkerPool::Post(Runnable* task) {
+  ASSERT(!AtomicOps::AcquireLoad(&stopping_));
+  int next = AtomicOps::Increment(const_cast<int*>(&next_)) & 0x7fffffff;
+  Worker* worker = workers_[next % workers_.size()];
+  {
+    CritScope cs(&worker->crit_);
+    worker->tasks_.push_back(task);
+  }
+  WakeIdleWorker(worker);
+}
+
+void WorkerPool::WorkerLoop(Worker* worker) {
+  for (;;) {
+    Runnable* task = TakeTask(worker);
+    if (!task) {
+      // Say we're going to sleep before looking once more, so that a Post
+      // racing with us either sees the flag or has its task found here.
+      AtomicOps::CompareAndSwap(&worker->idle_, 0, 1);
+      task = TakeTask(worker);
+      if (!task) {
+        if (AtomicOps::AcquireLoad(&stopping_))
+          return;
+        worker->wakeup_.Wait(kForever);
+        AtomicOps::CompareAndSwap(&worker->idle_, 1, 0);
+        continue;
+      }
+      AtomicOps::CompareAndSwap(&worker->idle_, 1, 0);
+    }
+    task->Run(worker);
+  }
+}
+
+Runnable* WorkerPool::TakeTask(Worker* worker) {
+  {
+    CritScope cs(&worker->crit_);
+    if (!worker->tasks_.empty()) {
+      Runnable* task = worker->tasks_.front();
+      worker->tasks_.pop_front();
+      return task;
+    }
+  }
+  for (size_t i = 1; i < workers_.size(); ++i) {
+    Worker* victim = workers_[(worker->index_ + i) % workers_.size()];
+    CritScope cs(&victim->crit_);
+    if (!victim->tasks_.empty()) {
+      Runnable* task = victim->tasks_.back();
+      victim->tasks_.pop_back();
+      return task;
+    }
+  }
+  return NULL;
+}
+
+void WorkerPool::WakeIdleWorker(Worker* preferred) {
+  for (size_t i = 0; i < workers_.size(); ++i) {
+    Worker* worker = workers_[(preferred->index_ + i) % workers_.size()];
+    // Clearing the flag claims the sleeper, so two Posts don't both wake it.
+    if (AtomicOps::CompareAndSwap(&worker->idle_, 1, 0) == 1) {
+      worker->wakeup_.Set();
+      return;
+    }
+  }
+}
+
+}  // namespace talk_base
@@ -0,0 +1,101 @@
+/*
+ * libjingle
+ * Copyright 2013, Google Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef TALK_BASE_WORKERPOOL_H_
+#define TALK_BASE_WORKERPOOL_H_
+
+#include <deque>
+#include <vector>
+
+#include "talk/base/constructormagic.h"
+#include "talk/base/criticalsection.h"
+#include "talk/base/event.h"
+#include "talk/base/thread.h"
+
+namespace talk_base {
+
+// WorkerPool runs Runnables on a fixed set of threads, for short blocking jobs
+// such as DNS lookups that would otherwise each start and join an OS thread.
+//
+// Each thread has its own queue. Post adds to the queues in turn and wakes a
+// sleeping thread if there is one; a thread whose queue is empty steals from
+// the back of the others' before going to sleep, so a slow job only holds up
+// the jobs behind it while every thread is busy.
+class WorkerPool {
+ public:
+  explicit WorkerPool(int num_threads);
+  // Runs any tasks still queued, then stops the threads.
+  ~WorkerPool();
+
+  // The process-wide pool that SignalThread subclasses can opt into. It is
+  // created on first use and never destroyed.
+  static WorkerPool* Default();
+
+  // The size of the default pool.
+  static const int kDefaultThreads = 8;
+
+  // Context: Any Thread. Queues |task| to run on one of the pool's threads,
+  // which is passed to Runnable::Run. The caller keeps ownership and must
+  // keep |task| alive until it has run.
+  void Post(Runnable* task);
+
+  int size() const { return static_cast<int>(workers_.size()); }
+
+ private:
+  class Worker : public Thread {
+   public:
+    Worker(WorkerPool* pool, int index);
+    virtual ~Worker();
+    virtual void Run() { pool_->WorkerLoop(this); }
+
+    WorkerPool* pool_;
+    int index_;
+    CriticalSection crit_;
+    std::deque<Runnable*> tasks_;  // Guarded by crit_.
+    volatile int idle_;            // 1 while asleep or about to be.
+    Event wakeup_;
+
+    DISALLOW_COPY_AND_ASSIGN(Worker);
+  };
+
+  void WorkerLoop(Worker* worker);
+  // Pops from |worker|'s own queue, or steals from another.
+  Runnable* TakeTask(Worker* worker);
+  // Wakes |preferred| if it is asleep, otherwise any sleeping thread.
+  void WakeIdleWorker(Worker* preferred);
+
+  std::vector<Worker*> workers_;
+  volatile int next_;
+  volatile int stopping_;
+
+  DISALLOW_COPY_AND_ASSIGN(WorkerPool);
+};
+
+}  // namespace talk_base
+
+#endif  // TALK_BASE_WORKERPOOL_H_
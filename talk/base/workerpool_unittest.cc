@@ -0,0 +1,216 @@
+/*
+ * libjingle
+ * Copyright 2013, Google Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifdef POSIX
+#include <netdb.h>
+#endif
+
+#include "talk/base/gunit.h"
+#include "talk/base/nethelpers.h"
+#include "talk/base/signalthread.h"
+#include "talk/base/thread.h"
+#include "talk/base/timeutils.h"
+#include "talk/base/workerpool.h"
+
+namespace talk_base {
+
+// Counts its runs. Optionally sets |started| and then blocks until |release|
+// is set.
+class CountingTask : public Runnable {
+ public:
+  explicit CountingTask(int* count, Event* started = NULL,
+                        Event* release = NULL)
+      : count_(count), started_(started), release_(release), thread_(NULL) {}
+  virtual void Run(Thread* thread) {
+    thread_ = thread;
+    if (started_)
+      started_->Set();
+    if (release_)
+      release_->Wait(kForever);
+    AtomicOps::Increment(count_);
+  }
+  Thread* thread() const { return thread_; }
+
+ private:
+  int* count_;
+  Event* started_;
+  Event* release_;
+  Thread* thread_;
+};
+
+static int LoadCount(int* count) {
+  return AtomicOps::AcquireLoad(count);
+}
+
+TEST(WorkerPoolTest, TestRunsAllTasks) {
+  const int kTasks = 1000;
+  int count = 0;
+  std::vector<CountingTask*> tasks;
+  {
+    WorkerPool pool(4);
+    EXPECT_EQ(4, pool.size());
+    for (int i = 0; i < kTasks; ++i) {
+      tasks.push_back(new CountingTask(&count));
+      pool.Post(tasks.back());
+    }
+    EXPECT_EQ_WAIT(kTasks, LoadCount(&count), 5000);
+  }
+  for (int i = 0; i < kTasks; ++i) {
+    EXPECT_TRUE(tasks[i]->thread() != NULL);
+    EXPECT_NE(Thread::Current(), tasks[i]->thread());
+    delete tasks[i];
+  }
+}
+
+// Tasks queued behind a blocked one are stolen by the other thread.
+TEST(WorkerPoolTest, TestIdleThreadSteals) {
+  const int kTasks = 10;
+  int count = 0;
+  Event started(true, false), release(true, false);
+  WorkerPool pool(2);
+  CountingTask blocker(&count, &started, &release);
+  pool.Post(&blocker);
+  EXPECT_TRUE(started.Wait(5000));
+  std::vector<CountingTask*> tasks;
+  for (int i = 0; i < kTasks; ++i) {
+    tasks.push_back(new CountingTask(&count));
+    pool.Post(tasks.back());
+  }
+  EXPECT_EQ_WAIT(kTasks, LoadCount(&count), 5000);
+  release.Set();
+  EXPECT_EQ_WAIT(kTasks + 1, LoadCount(&count), 5000);
+  for (int i = 0; i < kTasks; ++i) {
+    EXPECT_NE(blocker.thread(), tasks[i]->thread());
+    delete tasks[i];
+  }
+}
+
+TEST(WorkerPoolTest, TestDestructorRunsQueuedTasks) {
+  const int kTasks = 100;
+  int count = 0;
+  Event release(true, false);
+  CountingTask blocker(&count, NULL, &release);
+  std::vector<CountingTask*> tasks;
+  {
+    WorkerPool pool(1);
+    pool.Post(&blocker);
+    for (int i = 0; i < kTasks; ++i) {
+      tasks.push_back(new CountingTask(&count));
+      pool.Post(tasks.back());
+    }
+    release.Set();
+  }
+  EXPECT_EQ(kTasks + 1, count);
+  for (int i = 0; i < kTasks; ++i) {
+    delete tasks[i];
+  }
+}
+
+// Resolves localhost on its own thread, or on |pool| if given.
+class LookupThread : public SignalThread {
+ public:
+  explicit LookupThread(WorkerPool* pool) : SignalThread(pool), error_(-1) {}
+  int error() const { return error_; }
+
+ protected:
+  virtual void DoWork() {
+    struct addrinfo* result = NULL;
+    error_ = getaddrinfo("localhost", NULL, NULL, &result);
+    if (result)
+      freeaddrinfo(result);
+  }
+
+ private:
+  int error_;
+};
+
+class LookupCounter : public sigslot::has_slots<> {
+ public:
+  LookupCounter() : done_(0), errors_(0) {}
+  void OnWorkDone(SignalThread* thread) {
+    ++done_;
+    if (static_cast<LookupThread*>(thread)->error() != 0)
+      ++errors_;
+    thread->Release();
+  }
+  int done_;
+  int errors_;
+};
+
+TEST(WorkerPoolTest, TestSignalThreadOnPool) {
+  WorkerPool pool(2);
+  LookupCounter counter;
+  LookupThread* lookup = new LookupThread(&pool);
+  lookup->SignalWorkDone.connect(&counter, &LookupCounter::OnWorkDone);
+  lookup->Start();
+  EXPECT_EQ_WAIT(1, counter.done_, 5000);
+  EXPECT_EQ(0, counter.errors_);
+
+  // Destroying with wait blocks until DoWork has returned.
+  lookup = new LookupThread(&pool);
+  lookup->SignalWorkDone.connect(&counter, &LookupCounter::OnWorkDone);
+  lookup->Start();
+  lookup->Destroy(true);
+  Thread::Current()->ProcessMessages(0);
+  EXPECT_EQ(1, counter.done_);
+}
+
+TEST(WorkerPoolTest, TestAsyncResolverUsesDefaultPool) {
+  LookupCounter counter;
+  AsyncResolver* resolver = new AsyncResolver();
+  resolver->set_address(SocketAddress("localhost", 0));
+  resolver->SignalWorkDone.connect(&counter, &LookupCounter::OnWorkDone);
+  resolver->Start();
+  EXPECT_EQ_WAIT(1, counter.done_, 5000);
+}
+
+// Starts |kLookups| lookups at once and waits for them all, on a thread per
+// lookup and then on the default pool.
+TEST(WorkerPoolBenchmark, DISABLED_ConcurrentResolutions) {
+  const int kLookups = 10000;
+  for (int use_pool = 0; use_pool < 2; ++use_pool) {
+    LookupCounter counter;
+    uint64 start = TimeNanos();
+    for (int i = 0; i < kLookups; ++i) {
+      LookupThread* lookup =
+          new LookupThread(use_pool ? WorkerPool::Default() : NULL);
+      lookup->SignalWorkDone.connect(&counter, &LookupCounter::OnWorkDone);
+      lookup->Start();
+    }
+    while (counter.done_ < kLookups) {
+      Thread::Current()->ProcessMessages(10);
+    }
+    uint64 elapsed = TimeNanos() - start;
+    EXPECT_EQ(0, counter.errors_);
+    LOG(LS_INFO) << (use_pool ? "WorkerPool: " : "Thread per lookup: ")
+                 << kLookups << " lookups in "
+                 << elapsed / kNumNanosecsPerMillisec << "ms";
+  }
+}
+
+}  // namespace talk_base
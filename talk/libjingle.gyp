@@ -252,6 +252,8 @@
         'base/asyncfile.h',
         'base/asynchttprequest.cc',
         'base/asynchttprequest.h',
+        'base/asynclogstream.cc',
+        'base/asynclogstream.h',
         'base/asyncpacketsocket.h',
         'base/asyncsocket.cc',
         'base/asyncsocket.h',
@@ -270,6 +272,8 @@
         'base/basictypes.h',
         'base/bind.h',
         'base/buffer.h',
+        'base/bufferpool.cc',
+        'base/bufferpool.h',
         'base/bytebuffer.cc',
         'base/bytebuffer.h',
         'base/byteorder.h',
@@ -335,6 +339,7 @@
         'base/messagehandler.h',
         'base/messagequeue.cc',
         'base/messagequeue.h',
+        'base/mpscqueue.h',
         'base/multipart.cc',
         'base/multipart.h',
         'base/natserver.cc',
@@ -399,6 +404,7 @@
         'base/socketserver.h',
         'base/socketstream.cc',
         'base/socketstream.h',
+        'base/spscqueue.h',
         'base/ssladapter.cc',
         'base/ssladapter.h',
         'base/sslconfig.h',
@@ -431,6 +437,10 @@
         'base/testclient.h',
         'base/thread.cc',
         'base/thread.h',
+        'base/threadlocalpool.cc',
+        'base/threadlocalpool.h',
+        'base/timerwheel.cc',
+        'base/timerwheel.h',
         'base/timeutils.cc',
         'base/timeutils.h',
         'base/timing.cc',
@@ -448,6 +458,8 @@
         'base/windowpickerfactory.h',
         'base/worker.cc',
         'base/worker.h',
+        'base/workerpool.cc',
+        'base/workerpool.h',
         'xmllite/qname.cc',
         'xmllite/qname.h',
         'xmllite/xmlbuilder.cc',
@@ -557,6 +569,8 @@
           'sources': [
             'base/linux.cc',
             'base/linux.h',
+            'base/netlinkmonitor.cc',
+            'base/netlinkmonitor.h',
           ],
         }],
         ['OS=="linux"', {
@@ -805,6 +819,8 @@
         'media/base/mediaengine.h',
         'media/base/mutedvideocapturer.cc',
         'media/base/mutedvideocapturer.h',
+        'media/base/planarfunctions.cc',
+        'media/base/planarfunctions.h',
         'media/base/rtpdataengine.cc',
         'media/base/rtpdataengine.h',
         'media/base/rtpdump.cc',
@@ -989,6 +1005,8 @@
         'p2p/base/packetsocketfactory.h',
         'p2p/base/parsing.cc',
         'p2p/base/parsing.h',
+        'p2p/base/pingpacer.cc',
+        'p2p/base/pingpacer.h',
         'p2p/base/port.cc',
         'p2p/base/port.h',
         'p2p/base/portallocator.cc',
@@ -1018,6 +1036,8 @@
         'p2p/base/sessionmanager.h',
         'p2p/base/sessionmessages.cc',
         'p2p/base/sessionmessages.h',
+        'p2p/base/shardedturnserver.cc',
+        'p2p/base/shardedturnserver.h',
         'p2p/base/stun.cc',
         'p2p/base/stun.h',
         'p2p/base/stunport.cc',
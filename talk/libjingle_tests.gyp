@@ -106,6 +106,7 @@
       ],
       'sources': [
         'base/asynchttprequest_unittest.cc',
+        'base/asynclogstream_unittest.cc',
         'base/atomicops_unittest.cc',
         'base/autodetectproxy_unittest.cc',
         'base/bandwidthsmoother_unittest.cc',
@@ -113,6 +114,7 @@
         'base/basictypes_unittest.cc',
         'base/bind_unittest.cc',
         'base/buffer_unittest.cc',
+        'base/bufferpool_unittest.cc',
         'base/bytebuffer_unittest.cc',
         'base/byteorder_unittest.cc',
         'base/cpumonitor_unittest.cc',
@@ -130,6 +132,7 @@
         'base/md5digest_unittest.cc',
         'base/messagedigest_unittest.cc',
         'base/messagequeue_unittest.cc',
+        'base/mpscqueue_unittest.cc',
         'base/multipart_unittest.cc',
         'base/nat_unittest.cc',
         'base/network_unittest.cc',
@@ -151,6 +154,7 @@
         'base/socket_unittest.cc',
         'base/socket_unittest.h',
         'base/socketaddress_unittest.cc',
+        'base/spscqueue_unittest.cc',
         'base/stream_unittest.cc',
         'base/stringencode_unittest.cc',
         'base/stringutils_unittest.cc',
@@ -159,12 +163,15 @@
         'base/task_unittest.cc',
         'base/testclient_unittest.cc',
         'base/thread_unittest.cc',
+        'base/threadlocalpool_unittest.cc',
+        'base/timerwheel_unittest.cc',
         'base/timeutils_unittest.cc',
         'base/urlencode_unittest.cc',
         'base/versionparsing_unittest.cc',
         'base/virtualsocket_unittest.cc',
         # TODO(ronghuawu): Reenable this test.
         # 'base/windowpicker_unittest.cc',
+        'base/workerpool_unittest.cc',
         'xmllite/qname_unittest.cc',
         'xmllite/xmlbuilder_unittest.cc',
         'xmllite/xmlelement_unittest.cc',
@@ -194,6 +201,7 @@
             # TODO(ronghuawu): Reenable this test.
             # 'base/linux_unittest.cc',
             'base/linuxfdwalk_unittest.cc',
+            'base/netlinkmonitor_unittest.cc',
           ],
         }],
         ['OS=="win"', {
@@ -269,6 +277,7 @@
         # 'media/base/capturemanager_unittest.cc',
         'media/base/codec_unittest.cc',
         'media/base/filemediaengine_unittest.cc',
+        'media/base/planarfunctions_unittest.cc',
         'media/base/rtpdataengine_unittest.cc',
         'media/base/rtpdump_unittest.cc',
         'media/base/rtputils_unittest.cc',
@@ -323,21 +332,25 @@
         'p2p/base/dtlstransportchannel_unittest.cc',
         'p2p/base/fakesession.h',
         'p2p/base/p2ptransportchannel_unittest.cc',
+        'p2p/base/pingpacer_unittest.cc',
         'p2p/base/port_unittest.cc',
         'p2p/base/portallocatorsessionproxy_unittest.cc',
         'p2p/base/pseudotcp_unittest.cc',
         'p2p/base/relayport_unittest.cc',
         'p2p/base/relayserver_unittest.cc',
         'p2p/base/session_unittest.cc',
+        'p2p/base/shardedturnserver_unittest.cc',
         'p2p/base/stun_unittest.cc',
         'p2p/base/stunport_unittest.cc',
         'p2p/base/stunrequest_unittest.cc',
         'p2p/base/stunserver_unittest.cc',
         'p2p/base/testrelayserver.h',
         'p2p/base/teststunserver.h',
+        'p2p/base/testturnclient.h',
         'p2p/base/testturnserver.h',
         'p2p/base/transport_unittest.cc',
         'p2p/base/transportdescriptionfactory_unittest.cc',
+        'p2p/base/turnserver_unittest.cc',
         'p2p/client/connectivitychecker_unittest.cc',
         'p2p/client/fakeportallocator.h',
         'p2p/client/portallocator_unittest.cc',
@@ -364,6 +377,18 @@
         }],
       ],
     },  # target libjingle_p2p_unittest
+    {
+      'target_name': 'libjingle_p2p_loadtest',
+      'type': 'executable',
+      'dependencies': [
+        'gunit',
+        'libjingle.gyp:libjingle',
+        'libjingle.gyp:libjingle_p2p',
+      ],
+      'sources': [
+        'p2p/base/serverloadtest_main.cc',
+      ],
+    },  # target libjingle_p2p_loadtest
     {
       'target_name': 'libjingle_peerconnection_unittest',
       'type': 'executable',
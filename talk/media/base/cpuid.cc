@@ -29,21 +29,100 @@
 
 #if !defined(DISABLE_YUV)
 #include "libyuv/cpu_id.h"
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <intrin.h>
+#define CPUID_X86
+#elif defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#include <cpuid.h>
+#define CPUID_X86
 #endif
 
 namespace cricket {
 
+#if defined(DISABLE_YUV)
+// Without libyuv we detect the x86 features our own kernels use. Other
+// architectures report no features, so callers take their portable paths.
+static int cpu_info_ = CpuInfo::kCpuInit;
+static int cpu_mask_ = -1;
+
+#if defined(CPUID_X86)
+static void CpuId(int leaf, int subleaf, int regs[4]) {
+#if defined(_MSC_VER)
+  __cpuidex(regs, leaf, subleaf);
+#else
+  unsigned int a, b, c, d;
+  __cpuid_count(leaf, subleaf, a, b, c, d);
+  regs[0] = a;
+  regs[1] = b;
+  regs[2] = c;
+  regs[3] = d;
+#endif
+}
+
+// Returns the OS-enabled register state mask, which tells whether the YMM
+// registers are saved on context switches.
+static int GetXcr0() {
+#if defined(_MSC_VER)
+  return static_cast<int>(_xgetbv(0));
+#else
+  unsigned int xcr0, edx;
+  // xgetbv, spelled out for assemblers that predate it.
+  __asm__ volatile(".byte 0x0f, 0x01, 0xd0"  // NOLINT
+                   : "=a"(xcr0), "=d"(edx) : "c"(0));
+  return static_cast<int>(xcr0);
+#endif
+}
+#endif  // CPUID_X86
+
+static int InitCpuFlags() {
+  int flags = 0;
+#if defined(CPUID_X86)
+  int regs[4];
+  CpuId(0, 0, regs);
+  int max_leaf = regs[0];
+  CpuId(1, 0, regs);
+  flags = CpuInfo::kCpuHasX86 |
+      ((regs[3] & 0x04000000) ? CpuInfo::kCpuHasSSE2 : 0) |
+      ((regs[2] & 0x00000200) ? CpuInfo::kCpuHasSSSE3 : 0) |
+      ((regs[2] & 0x00080000) ? CpuInfo::kCpuHasSSE41 : 0) |
+      ((regs[2] & 0x00100000) ? CpuInfo::kCpuHasSSE42 : 0);
+  // AVX needs both the instructions and an OS that saves the YMM registers.
+  bool has_avx = (regs[2] & 0x18000000) == 0x18000000 &&
+      (GetXcr0() & 0x6) == 0x6;
+  if (has_avx) {
+    flags |= CpuInfo::kCpuHasAVX;
+  }
+  if (max_leaf >= 7) {
+    CpuId(7, 0, regs);
+    if (has_avx && (regs[1] & 0x00000020)) {
+      flags |= CpuInfo::kCpuHasAVX2;
+    }
+    if (regs[1] & 0x00000200) {
+      flags |= CpuInfo::kCpuHasERMS;
+    }
+  }
+#endif
+  return flags;
+}
+#endif  // DISABLE_YUV
+
 bool CpuInfo::TestCpuFlag(int flag) {
 #if !defined(DISABLE_YUV)
   return libyuv::TestCpuFlag(flag) ? true : false;
 #else
-  return false;
+  // Racing initializations all store the same value.
+  if (cpu_info_ == kCpuInit) {
+    cpu_info_ = InitCpuFlags();
+  }
+  return (cpu_info_ & cpu_mask_ & flag) ? true : false;
 #endif
 }
 
 void CpuInfo::MaskCpuFlagsForTest(int enable_flags) {
 #if !defined(DISABLE_YUV)
   libyuv::MaskCpuFlags(enable_flags);
+#else
+  cpu_mask_ = enable_flags;
 #endif
 }
 
@@ -72,14 +72,16 @@ template <class Base> class RtpHelper : public Base {
     if (!sending_ || !Base::network_interface_) {
       return false;
     }
-    talk_base::Buffer packet(data, len, kMaxRtpPacketLen);
+    talk_base::Buffer packet(Base::network_interface_->packet_pool(),
+                             data, len, kMaxRtpPacketLen);
     return Base::network_interface_->SendPacket(&packet);
   }
   bool SendRtcp(const void* data, int len) {
     if (!Base::network_interface_) {
       return false;
     }
-    talk_base::Buffer packet(data, len, kMaxRtpPacketLen);
+    talk_base::Buffer packet(Base::network_interface_->packet_pool(),
+                             data, len, kMaxRtpPacketLen);
     return Base::network_interface_->SendRtcp(&packet);
   }
 
@@ -249,8 +249,9 @@ bool RtpSenderReceiver::SendRtpPacket(const void* data, size_t len) {
     return false;
   }
 
-  talk_base::Buffer packet(data, len, kMaxRtpPacketLen);
-  return media_channel_->network_interface()->SendPacket(&packet);
+  MediaChannel::NetworkInterface* network = media_channel_->network_interface();
+  talk_base::Buffer packet(network->packet_pool(), data, len, kMaxRtpPacketLen);
+  return network->SendPacket(&packet);
 }
 
 ///////////////////////////////////////////////////////////////////////////
@@ -407,6 +407,10 @@ class MediaChannel : public sigslot::has_slots<> {
     virtual bool SendRtcp(talk_base::Buffer* packet) = 0;
     virtual int SetOption(SocketType type, talk_base::Socket::Option opt,
                           int option) = 0;
+    // Returns a pool that outgoing packets can borrow storage from, or NULL.
+    // Its blocks hold kMaxRtpPacketLen bytes, enough for any packet after
+    // SRTP protection.
+    virtual talk_base::BufferPool* packet_pool() { return NULL; }
     virtual ~NetworkInterface() {}
   };
 
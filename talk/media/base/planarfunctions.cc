@@ -0,0 +1,321 @@
+/*
+ * libjingle
+ * Copyright 2013, Google Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "talk/media/base/planarfunctions.h"
+
+#include <string.h>
+
+#include "talk/base/scoped_ptr.h"
+#include "talk/media/base/cpuid.h"
+
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+#include <immintrin.h>
+#define PLANAR_HAS_SSE2
+#define PLANAR_HAS_AVX2
+#define PLANAR_TARGET(isa) __attribute__((target(isa)))
+#elif defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <emmintrin.h>
+#define PLANAR_HAS_SSE2
+#define PLANAR_TARGET(isa)
+#endif
+
+namespace cricket {
+
+// Averages 2x2 boxes from rows |src0| and |src1| into |dst_width| pixels.
+typedef void (*ScaleRowDown2BoxFunc)(const uint8* src0, const uint8* src1,
+                                     uint8* dst, int dst_width);
+// Blends |src0| and |src1| as src0 * (256 - fraction) + src1 * fraction.
+typedef void (*InterpolateRowFunc)(const uint8* src0, const uint8* src1,
+                                   uint8* dst, int width, int fraction);
+
+static void ScaleRowDown2Box_C(const uint8* src0, const uint8* src1,
+                               uint8* dst, int dst_width) {
+  for (int x = 0; x < dst_width; ++x) {
+    dst[x] = static_cast<uint8>((src0[0] + src0[1] + src1[0] + src1[1] + 2)
+                                >> 2);
+    src0 += 2;
+    src1 += 2;
+  }
+}
+
+static void InterpolateRow_C(const uint8* src0, const uint8* src1,
+                             uint8* dst, int width, int fraction) {
+  const int fraction0 = 256 - fraction;
+  for (int x = 0; x < width; ++x) {
+    dst[x] = static_cast<uint8>(
+        (src0[x] * fraction0 + src1[x] * fraction + 128) >> 8);
+  }
+}
+
+#if defined(PLANAR_HAS_SSE2)
+PLANAR_TARGET("sse2")
+static void ScaleRowDown2Box_SSE2(const uint8* src0, const uint8* src1,
+                                  uint8* dst, int dst_width) {
+  const __m128i mask = _mm_set1_epi16(0xff);
+  const __m128i two = _mm_set1_epi16(2);
+  int x = 0;
+  for (; x + 16 <= dst_width; x += 16) {
+    const __m128i* p0 = reinterpret_cast<const __m128i*>(src0 + x * 2);
+    const __m128i* p1 = reinterpret_cast<const __m128i*>(src1 + x * 2);
+    __m128i a0 = _mm_loadu_si128(p0);
+    __m128i a1 = _mm_loadu_si128(p0 + 1);
+    __m128i b0 = _mm_loadu_si128(p1);
+    __m128i b1 = _mm_loadu_si128(p1 + 1);
+    // Sum horizontal pairs in 16 bits, then the two rows.
+    __m128i s0 = _mm_add_epi16(
+        _mm_add_epi16(_mm_and_si128(a0, mask), _mm_srli_epi16(a0, 8)),
+        _mm_add_epi16(_mm_and_si128(b0, mask), _mm_srli_epi16(b0, 8)));
+    __m128i s1 = _mm_add_epi16(
+        _mm_add_epi16(_mm_and_si128(a1, mask), _mm_srli_epi16(a1, 8)),
+        _mm_add_epi16(_mm_and_si128(b1, mask), _mm_srli_epi16(b1, 8)));
+    s0 = _mm_srli_epi16(_mm_add_epi16(s0, two), 2);
+    s1 = _mm_srli_epi16(_mm_add_epi16(s1, two), 2);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x),
+                     _mm_packus_epi16(s0, s1));
+  }
+  ScaleRowDown2Box_C(src0 + x * 2, src1 + x * 2, dst + x, dst_width - x);
+}
+
+PLANAR_TARGET("sse2")
+static void InterpolateRow_SSE2(const uint8* src0, const uint8* src1,
+                                uint8* dst, int width, int fraction) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i f0 = _mm_set1_epi16(static_cast<int16>(256 - fraction));
+  const __m128i f1 = _mm_set1_epi16(static_cast<int16>(fraction));
+  const __m128i round = _mm_set1_epi16(128);
+  int x = 0;
+  for (; x + 16 <= width; x += 16) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src0 + x));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src1 + x));
+    // The weighted sums fit in unsigned 16 bits since the weights add to 256.
+    __m128i lo = _mm_add_epi16(
+        _mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), f0),
+        _mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), f1));
+    __m128i hi = _mm_add_epi16(
+        _mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), f0),
+        _mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), f1));
+    lo = _mm_srli_epi16(_mm_add_epi16(lo, round), 8);
+    hi = _mm_srli_epi16(_mm_add_epi16(hi, round), 8);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x),
+                     _mm_packus_epi16(lo, hi));
+  }
+  InterpolateRow_C(src0 + x, src1 + x, dst + x, width - x, fraction);
+}
+
+#endif  // PLANAR_HAS_SSE2
+
+#if defined(PLANAR_HAS_AVX2)
+PLANAR_TARGET("avx2")
+static void ScaleRowDown2Box_AVX2(const uint8* src0, const uint8* src1,
+                                  uint8* dst, int dst_width) {
+  const __m256i mask = _mm256_set1_epi16(0xff);
+  const __m256i two = _mm256_set1_epi16(2);
+  int x = 0;
+  for (; x + 32 <= dst_width; x += 32) {
+    const __m256i* p0 = reinterpret_cast<const __m256i*>(src0 + x * 2);
+    const __m256i* p1 = reinterpret_cast<const __m256i*>(src1 + x * 2);
+    __m256i a0 = _mm256_loadu_si256(p0);
+    __m256i a1 = _mm256_loadu_si256(p0 + 1);
+    __m256i b0 = _mm256_loadu_si256(p1);
+    __m256i b1 = _mm256_loadu_si256(p1 + 1);
+    __m256i s0 = _mm256_add_epi16(
+        _mm256_add_epi16(_mm256_and_si256(a0, mask), _mm256_srli_epi16(a0, 8)),
+        _mm256_add_epi16(_mm256_and_si256(b0, mask), _mm256_srli_epi16(b0, 8)));
+    __m256i s1 = _mm256_add_epi16(
+        _mm256_add_epi16(_mm256_and_si256(a1, mask), _mm256_srli_epi16(a1, 8)),
+        _mm256_add_epi16(_mm256_and_si256(b1, mask), _mm256_srli_epi16(b1, 8)));
+    s0 = _mm256_srli_epi16(_mm256_add_epi16(s0, two), 2);
+    s1 = _mm256_srli_epi16(_mm256_add_epi16(s1, two), 2);
+    // The pack works within 128 bit lanes; put the quarters back in order.
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(s0, s1),
+                                              0xd8);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x), packed);
+  }
+  _mm256_zeroupper();
+  ScaleRowDown2Box_C(src0 + x * 2, src1 + x * 2, dst + x, dst_width - x);
+}
+
+PLANAR_TARGET("avx2")
+static void InterpolateRow_AVX2(const uint8* src0, const uint8* src1,
+                                uint8* dst, int width, int fraction) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i f0 = _mm256_set1_epi16(static_cast<int16>(256 - fraction));
+  const __m256i f1 = _mm256_set1_epi16(static_cast<int16>(fraction));
+  const __m256i round = _mm256_set1_epi16(128);
+  int x = 0;
+  for (; x + 32 <= width; x += 32) {
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src0 + x));
+    __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src1 + x));
+    // Unpacking and packing within lanes leaves the pixels in order.
+    __m256i lo = _mm256_add_epi16(
+        _mm256_mullo_epi16(_mm256_unpacklo_epi8(a, zero), f0),
+        _mm256_mullo_epi16(_mm256_unpacklo_epi8(b, zero), f1));
+    __m256i hi = _mm256_add_epi16(
+        _mm256_mullo_epi16(_mm256_unpackhi_epi8(a, zero), f0),
+        _mm256_mullo_epi16(_mm256_unpackhi_epi8(b, zero), f1));
+    lo = _mm256_srli_epi16(_mm256_add_epi16(lo, round), 8);
+    hi = _mm256_srli_epi16(_mm256_add_epi16(hi, round), 8);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x),
+                        _mm256_packus_epi16(lo, hi));
+  }
+  _mm256_zeroupper();
+  InterpolateRow_C(src0 + x, src1 + x, dst + x, width - x, fraction);
+}
+#endif  // PLANAR_HAS_AVX2
+
+static ScaleRowDown2BoxFunc GetScaleRowDown2Box() {
+#if defined(PLANAR_HAS_AVX2)
+  if (CpuInfo::TestCpuFlag(CpuInfo::kCpuHasAVX2)) {
+    return ScaleRowDown2Box_AVX2;
+  }
+#endif
+#if defined(PLANAR_HAS_SSE2)
+  if (CpuInfo::TestCpuFlag(CpuInfo::kCpuHasSSE2)) {
+    return ScaleRowDown2Box_SSE2;
+  }
+#endif
+  return ScaleRowDown2Box_C;
+}
+
+static InterpolateRowFunc GetInterpolateRow() {
+#if defined(PLANAR_HAS_AVX2)
+  if (CpuInfo::TestCpuFlag(CpuInfo::kCpuHasAVX2)) {
+    return InterpolateRow_AVX2;
+  }
+#endif
+#if defined(PLANAR_HAS_SSE2)
+  if (CpuInfo::TestCpuFlag(CpuInfo::kCpuHasSSE2)) {
+    return InterpolateRow_SSE2;
+  }
+#endif
+  return InterpolateRow_C;
+}
+
+static void ScalePlaneDown2Box(const uint8* src, int src_pitch,
+                               uint8* dst, int dst_pitch,
+                               int dst_width, int dst_height) {
+  ScaleRowDown2BoxFunc scale_row = GetScaleRowDown2Box();
+  for (int y = 0; y < dst_height; ++y) {
+    scale_row(src, src + src_pitch, dst, dst_width);
+    src += src_pitch * 2;
+    dst += dst_pitch;
+  }
+}
+
+// Source positions are 16.16 fixed point, sampled at pixel centers.
+static void ScalePlaneBilinear(const uint8* src, int src_pitch,
+                               int src_width, int src_height,
+                               uint8* dst, int dst_pitch,
+                               int dst_width, int dst_height) {
+  InterpolateRowFunc interpolate_row = GetInterpolateRow();
+  talk_base::scoped_array<uint8> row(new uint8[src_width]);
+  const int dx = (src_width << 16) / dst_width;
+  const int dy = (src_height << 16) / dst_height;
+  const int x0 = talk_base::_max(0, (dx >> 1) - 32768);
+  int y = talk_base::_max(0, (dy >> 1) - 32768);
+  for (int j = 0; j < dst_height; ++j, y += dy) {
+    int yi = talk_base::_min(y >> 16, src_height - 1);
+    const uint8* src0 = src + yi * src_pitch;
+    const uint8* src1 = src0 + (yi + 1 < src_height ? src_pitch : 0);
+    interpolate_row(src0, src1, row.get(), src_width, (y >> 8) & 0xff);
+    int x = x0;
+    for (int i = 0; i < dst_width; ++i, x += dx) {
+      int xi = x >> 16;
+      // The last column is filtered against itself.
+      int xi1 = (xi + 1 < src_width) ? xi + 1 : xi;
+      int fraction = (x >> 8) & 0xff;
+      dst[i] = static_cast<uint8>((row[xi] * (256 - fraction) +
+                                   row[xi1] * fraction + 128) >> 8);
+    }
+    dst += dst_pitch;
+  }
+}
+
+static void ScalePlanePoint(const uint8* src, int src_pitch,
+                            int src_width, int src_height,
+                            uint8* dst, int dst_pitch,
+                            int dst_width, int dst_height) {
+  const int dx = (src_width << 16) / dst_width;
+  const int dy = (src_height << 16) / dst_height;
+  int y = dy >> 1;
+  for (int j = 0; j < dst_height; ++j, y += dy) {
+    const uint8* src_row = src + (y >> 16) * src_pitch;
+    int x = dx >> 1;
+    for (int i = 0; i < dst_width; ++i, x += dx) {
+      dst[i] = src_row[x >> 16];
+    }
+    dst += dst_pitch;
+  }
+}
+
+void ScalePlane(const uint8* src, int src_pitch,
+                int src_width, int src_height,
+                uint8* dst, int dst_pitch,
+                int dst_width, int dst_height,
+                bool interpolate) {
+  if (src_width <= 0 || src_height <= 0 || dst_width <= 0 || dst_height <= 0) {
+    return;
+  }
+  if (src_width == dst_width && src_height == dst_height) {
+    for (int y = 0; y < dst_height; ++y) {
+      memcpy(dst + y * dst_pitch, src + y * src_pitch, dst_width);
+    }
+  } else if (interpolate && src_width == dst_width * 2 &&
+             src_height == dst_height * 2) {
+    ScalePlaneDown2Box(src, src_pitch, dst, dst_pitch, dst_width, dst_height);
+  } else if (interpolate) {
+    ScalePlaneBilinear(src, src_pitch, src_width, src_height,
+                       dst, dst_pitch, dst_width, dst_height);
+  } else {
+    ScalePlanePoint(src, src_pitch, src_width, src_height,
+                    dst, dst_pitch, dst_width, dst_height);
+  }
+}
+
+void ScaleI420(const uint8* src_y, const uint8* src_u, const uint8* src_v,
+               int src_pitch_y, int src_pitch_u, int src_pitch_v,
+               int src_width, int src_height,
+               uint8* dst_y, uint8* dst_u, uint8* dst_v,
+               int dst_pitch_y, int dst_pitch_u, int dst_pitch_v,
+               int dst_width, int dst_height,
+               bool interpolate) {
+  ScalePlane(src_y, src_pitch_y, src_width, src_height,
+             dst_y, dst_pitch_y, dst_width, dst_height, interpolate);
+  const int src_chroma_width = (src_width + 1) >> 1;
+  const int src_chroma_height = (src_height + 1) >> 1;
+  const int dst_chroma_width = (dst_width + 1) >> 1;
+  const int dst_chroma_height = (dst_height + 1) >> 1;
+  ScalePlane(src_u, src_pitch_u, src_chroma_width, src_chroma_height,
+             dst_u, dst_pitch_u, dst_chroma_width, dst_chroma_height,
+             interpolate);
+  ScalePlane(src_v, src_pitch_v, src_chroma_width, src_chroma_height,
+             dst_v, dst_pitch_v, dst_chroma_width, dst_chroma_height,
+             interpolate);
+}
+
+}  // namespace cricket
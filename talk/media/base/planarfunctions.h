@@ -0,0 +1,61 @@
+/*
+ * libjingle
+ * Copyright 2013, Google Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+// Portable I420 scaling, used where libyuv is not available.
+// Hot loops have SSE2 and AVX2 versions that are picked at runtime through
+// CpuInfo, so a build for a baseline x86 CPU still uses what the host has.
+
+#ifndef TALK_MEDIA_BASE_PLANARFUNCTIONS_H_
+#define TALK_MEDIA_BASE_PLANARFUNCTIONS_H_
+
+#include "talk/base/basictypes.h"
+
+namespace cricket {
+
+// Scales one plane. With |interpolate|, an exact halving in both dimensions
+// averages 2x2 boxes and any other ratio filters bilinearly; otherwise the
+// nearest source pixel is taken.
+void ScalePlane(const uint8* src, int src_pitch,
+                int src_width, int src_height,
+                uint8* dst, int dst_pitch,
+                int dst_width, int dst_height,
+                bool interpolate);
+
+// Scales an I420 image. Chroma planes are (width + 1) / 2 wide and
+// (height + 1) / 2 high.
+void ScaleI420(const uint8* src_y, const uint8* src_u, const uint8* src_v,
+               int src_pitch_y, int src_pitch_u, int src_pitch_v,
+               int src_width, int src_height,
+               uint8* dst_y, uint8* dst_u, uint8* dst_v,
+               int dst_pitch_y, int dst_pitch_u, int dst_pitch_v,
+               int dst_width, int dst_height,
+               bool interpolate);
+
+}  // namespace cricket
+
+#endif  // TALK_MEDIA_BASE_PLANARFUNCTIONS_H_
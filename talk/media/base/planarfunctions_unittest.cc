@@ -0,0 +1,172 @@
+/*
+ * libjingle
+ * Copyright 2013, Google Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "talk/base/common.h"
+#include "talk/base/gunit.h"
+#include "talk/base/logging.h"
+#include "talk/base/scoped_ptr.h"
+#include "talk/base/timeutils.h"
+#include "talk/media/base/cpuid.h"
+#include "talk/media/base/planarfunctions.h"
+
+namespace cricket {
+
+// The CPU feature sets the kernels are dispatched on, from none up to all.
+static const int kCpuMasks[] = {
+  0,
+  CpuInfo::kCpuHasX86 | CpuInfo::kCpuHasSSE2,
+  -1,
+};
+
+class PlanarFunctionsTest : public testing::Test {
+ protected:
+  virtual void TearDown() {
+    CpuInfo::MaskCpuFlagsForTest(-1);
+  }
+
+  // Fills |size| bytes with a repeatable pseudo-random pattern.
+  static void FillRandom(uint8* data, int size, uint32 seed) {
+    for (int i = 0; i < size; ++i) {
+      seed = seed * 1103515245 + 12345;
+      data[i] = static_cast<uint8>(seed >> 16);
+    }
+  }
+
+  // Scales a random plane with every CPU mask and checks that all the
+  // kernels agree with the portable one.
+  static void TestScaleAgrees(int src_width, int src_height,
+                              int dst_width, int dst_height,
+                              bool interpolate) {
+    talk_base::scoped_array<uint8> src(new uint8[src_width * src_height]);
+    FillRandom(src.get(), src_width * src_height, src_width);
+    const int dst_size = dst_width * dst_height;
+    talk_base::scoped_array<uint8> expected(new uint8[dst_size]);
+    talk_base::scoped_array<uint8> actual(new uint8[dst_size]);
+    CpuInfo::MaskCpuFlagsForTest(0);
+    ScalePlane(src.get(), src_width, src_width, src_height,
+               expected.get(), dst_width, dst_width, dst_height, interpolate);
+    for (int i = 1; i < ARRAY_SIZE(kCpuMasks); ++i) {
+      CpuInfo::MaskCpuFlagsForTest(kCpuMasks[i]);
+      memset(actual.get(), 0, dst_size);
+      ScalePlane(src.get(), src_width, src_width, src_height,
+                 actual.get(), dst_width, dst_width, dst_height, interpolate);
+      EXPECT_EQ(0, memcmp(expected.get(), actual.get(), dst_size))
+          << src_width << "x" << src_height << " to "
+          << dst_width << "x" << dst_height << " with mask " << kCpuMasks[i];
+    }
+  }
+};
+
+TEST_F(PlanarFunctionsTest, ScaleDown2Box) {
+  const uint8 src[] = {
+    0, 2, 10, 20, 255,
+    4, 6, 30, 41, 255,
+    9, 9, 0, 0, 255,
+    9, 8, 0, 1, 255,
+  };
+  uint8 dst[4] = { 0 };
+  // The fifth column is outside the halved image and must be ignored.
+  ScalePlane(src, 5, 4, 4, dst, 2, 2, 2, true);
+  EXPECT_EQ(3, dst[0]);   // (0 + 2 + 4 + 6 + 2) / 4
+  EXPECT_EQ(25, dst[1]);  // (10 + 20 + 30 + 41 + 2) / 4
+  EXPECT_EQ(9, dst[2]);   // (9 + 9 + 9 + 8 + 2) / 4
+  EXPECT_EQ(0, dst[3]);   // (0 + 0 + 0 + 1 + 2) / 4
+}
+
+TEST_F(PlanarFunctionsTest, ScaleConstantPlane) {
+  const int kSrcWidth = 100;
+  const int kSrcHeight = 60;
+  uint8 src[kSrcWidth * kSrcHeight];
+  memset(src, 77, sizeof(src));
+  const int kSizes[][2] = { { 50, 30 }, { 33, 17 }, { 160, 90 }, { 1, 1 } };
+  for (int i = 0; i < ARRAY_SIZE(kSizes); ++i) {
+    for (int interpolate = 0; interpolate < 2; ++interpolate) {
+      const int width = kSizes[i][0];
+      const int height = kSizes[i][1];
+      talk_base::scoped_array<uint8> dst(new uint8[width * height]);
+      ScalePlane(src, kSrcWidth, kSrcWidth, kSrcHeight,
+                 dst.get(), width, width, height, interpolate != 0);
+      for (int j = 0; j < width * height; ++j) {
+        ASSERT_EQ(77, dst[j]) << width << "x" << height << " at " << j;
+      }
+    }
+  }
+}
+
+TEST_F(PlanarFunctionsTest, ScaleKernelsAgree) {
+  // Widths that exercise both the vector loops and the scalar tails.
+  TestScaleAgrees(640, 480, 320, 240, true);
+  TestScaleAgrees(2 * 77, 2 * 5, 77, 5, true);
+  TestScaleAgrees(640, 480, 480, 270, true);
+  TestScaleAgrees(101, 37, 203, 75, true);
+  TestScaleAgrees(640, 480, 480, 270, false);
+}
+
+// Times the capture-side downscales for each instruction set.
+TEST_F(PlanarFunctionsTest, DISABLED_Benchmark) {
+  const int kFrames = 100;
+  const struct {
+    const char* name;
+    int src_width, src_height, dst_width, dst_height;
+  } kCases[] = {
+    { "VGA->QVGA", 640, 480, 320, 240 },
+    { "720p->360p", 1280, 720, 640, 360 },
+    { "1080p->540p", 1920, 1080, 960, 540 },
+    { "720p->480x270", 1280, 720, 480, 270 },
+  };
+  const char* kMaskNames[] = { "C", "SSE2", "AVX2" };
+  for (int c = 0; c < ARRAY_SIZE(kCases); ++c) {
+    const int sw = kCases[c].src_width;
+    const int sh = kCases[c].src_height;
+    const int dw = kCases[c].dst_width;
+    const int dh = kCases[c].dst_height;
+    const int src_size = sw * sh + 2 * ((sw + 1) / 2) * ((sh + 1) / 2);
+    const int dst_size = dw * dh + 2 * ((dw + 1) / 2) * ((dh + 1) / 2);
+    talk_base::scoped_array<uint8> src(new uint8[src_size]);
+    talk_base::scoped_array<uint8> dst(new uint8[dst_size]);
+    FillRandom(src.get(), src_size, 0);
+    const uint8* src_u = src.get() + sw * sh;
+    const uint8* src_v = src_u + ((sw + 1) / 2) * ((sh + 1) / 2);
+    uint8* dst_u = dst.get() + dw * dh;
+    uint8* dst_v = dst_u + ((dw + 1) / 2) * ((dh + 1) / 2);
+    for (int m = 0; m < ARRAY_SIZE(kCpuMasks); ++m) {
+      CpuInfo::MaskCpuFlagsForTest(kCpuMasks[m]);
+      uint64 start = talk_base::TimeNanos();
+      for (int i = 0; i < kFrames; ++i) {
+        ScaleI420(src.get(), src_u, src_v, sw, (sw + 1) / 2, (sw + 1) / 2,
+                  sw, sh, dst.get(), dst_u, dst_v, dw, (dw + 1) / 2,
+                  (dw + 1) / 2, dw, dh, true);
+      }
+      uint64 scale_us = (talk_base::TimeNanos() - start) / kFrames / 1000;
+      LOG(LS_INFO) << kCases[c].name << " " << kMaskNames[m] << ": scale "
+                   << scale_us << "us";
+    }
+  }
+}
+
+}  // namespace cricket
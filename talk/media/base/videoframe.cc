@@ -36,6 +36,7 @@
 #endif
 
 #include "talk/base/logging.h"
+#include "talk/media/base/planarfunctions.h"
 #include "talk/media/base/videocommon.h"
 
 namespace cricket {
@@ -156,14 +157,18 @@ void VideoFrame::StretchToPlanes(
     }
   }
 
-  // TODO(fbarchard): Implement a simple scale for non-libyuv.
-#if !defined(DISABLE_YUV)
   // Scale to the output I420 frame.
+#if !defined(DISABLE_YUV)
   libyuv::Scale(src_y, src_u, src_v,
                 GetYPitch(), GetUPitch(), GetVPitch(),
                 static_cast<int>(src_width), static_cast<int>(src_height),
                 dst_y, dst_u, dst_v, dst_pitch_y, dst_pitch_u, dst_pitch_v,
                 static_cast<int>(width), static_cast<int>(height), interpolate);
+#else
+  ScaleI420(src_y, src_u, src_v, GetYPitch(), GetUPitch(), GetVPitch(),
+            static_cast<int>(src_width), static_cast<int>(src_height),
+            dst_y, dst_u, dst_v, dst_pitch_y, dst_pitch_u, dst_pitch_v,
+            static_cast<int>(width), static_cast<int>(height), interpolate);
 #endif
 }
 
@@ -3353,7 +3353,8 @@ int WebRtcVideoMediaChannel::SendPacket(int channel, const void* data,
   if (!network_interface_) {
     return -1;
   }
-  talk_base::Buffer packet(data, len, kMaxRtpPacketLen);
+  talk_base::Buffer packet(network_interface_->packet_pool(),
+                           data, len, kMaxRtpPacketLen);
   return network_interface_->SendPacket(&packet) ? len : -1;
 }
 
@@ -3363,7 +3364,8 @@ int WebRtcVideoMediaChannel::SendRTCPPacket(int channel,
   if (!network_interface_) {
     return -1;
   }
-  talk_base::Buffer packet(data, len, kMaxRtpPacketLen);
+  talk_base::Buffer packet(network_interface_->packet_pool(),
+                           data, len, kMaxRtpPacketLen);
   return network_interface_->SendRtcp(&packet) ? len : -1;
 }
 
@@ -299,7 +299,8 @@ class WebRtcMediaChannel : public T, public webrtc::Transport {
     }
     sequence_number_ = seq_num;
 
-    talk_base::Buffer packet(data, len, kMaxRtpPacketLen);
+    talk_base::Buffer packet(T::network_interface_->packet_pool(),
+                             data, len, kMaxRtpPacketLen);
     return T::network_interface_->SendPacket(&packet) ? len : -1;
   }
   virtual int SendRTCPPacket(int channel, const void *data, int len) {
@@ -307,7 +308,8 @@ class WebRtcMediaChannel : public T, public webrtc::Transport {
       return -1;
     }
 
-    talk_base::Buffer packet(data, len, kMaxRtpPacketLen);
+    talk_base::Buffer packet(T::network_interface_->packet_pool(),
+                             data, len, kMaxRtpPacketLen);
     return T::network_interface_->SendRtcp(&packet) ? len : -1;
   }
   int sequence_number() const {
@@ -82,16 +82,17 @@ int AsyncStunTCPSocket::Send(const void *pv, size_t cb) {
   if (cb != expected_pkt_len)
     return -1;
 
-  AppendToOutBuffer(pv, cb);
-
   ASSERT(pad_bytes < 4);
   char padding[4] = {0};
-  AppendToOutBuffer(padding, pad_bytes);
+  talk_base::IoVec iov[2];
+  iov[0].data = pv;
+  iov[0].len = cb;
+  iov[1].data = padding;
+  iov[1].len = pad_bytes;
 
-  int res = FlushOutBuffer();
+  int res = SendFromBuffers(iov, pad_bytes ? 2 : 1);
   if (res <= 0) {
     // drop packet if we made no progress
-    ClearOutBuffer();
     return res;
   }
 
@@ -41,7 +41,6 @@ namespace {
 // messages for queuing up work for ourselves
 enum {
   MSG_SORT = 1,
-  MSG_PING,
 };
 
 // When the socket is unwritable, we will use 10 Kbps (ignoring IP+UDP headers)
@@ -57,6 +56,10 @@ static const uint32 UNWRITABLE_DELAY = 1000 * PING_PACKET_SIZE / 10000;  // 50ms
 // make sure it is pinged at this rate.
 static const uint32 MAX_CURRENT_WRITABLE_DELAY = 900;  // 2*WRITABLE_DELAY - bit
 
+// Between sorts, we bring the state of every connection up to date at least
+// this often.  In between, only the connection about to be pinged is updated.
+static const uint32 STATE_UPDATE_INTERVAL = WRITABLE_DELAY;
+
 // The minimum improvement in RTT that justifies a switch.
 static const double kMinImprovement = 10;
 
@@ -130,6 +133,29 @@ class ConnectionCompare {
   }
 };
 
+// A connection and its place in the ranking before it was updated.  Ordering
+// ties by that place gives the same order std::stable_sort would.
+struct RankedConnection {
+  RankedConnection(cricket::Connection* conn, size_t index)
+      : conn(conn), index(index) {}
+  cricket::Connection* conn;
+  size_t index;
+};
+
+class RankedConnectionCompare {
+ public:
+  bool operator()(const RankedConnection& a, const RankedConnection& b) {
+    if (cmp_(a.conn, b.conn))
+      return true;
+    if (cmp_(b.conn, a.conn))
+      return false;
+    return a.index < b.index;
+  }
+
+ private:
+  ConnectionCompare cmp_;
+};
+
 // Determines whether we should switch between two connections, based first on
 // static preferences and then (if those are equal) on latency estimates.
 bool ShouldSwitch(cricket::Connection* a_conn, cricket::Connection* b_conn) {
@@ -160,9 +186,11 @@ P2PTransportChannel::P2PTransportChannel(const std::string& content_name,
     transport_(transport),
     allocator_(allocator),
     worker_thread_(talk_base::Thread::Current()),
+    ping_pacer_(PingPacer::Acquire(worker_thread_)),
     incoming_only_(false),
     waiting_for_signaling_(false),
     error_(0),
+    last_state_update_(0),
     best_connection_(NULL),
     pending_best_connection_(NULL),
     sort_dirty_(false),
@@ -177,6 +205,9 @@ P2PTransportChannel::P2PTransportChannel(const std::string& content_name,
 P2PTransportChannel::~P2PTransportChannel() {
   ASSERT(worker_thread_ == talk_base::Thread::Current());
 
+  ping_pacer_->Cancel(this);
+  ping_pacer_->Release();
+
   for (uint32 i = 0; i < allocator_sessions_.size(); ++i)
     delete allocator_sessions_[i];
 }
@@ -202,6 +233,8 @@ void P2PTransportChannel::AddAllocatorSession(PortAllocatorSession* session) {
 
 void P2PTransportChannel::AddConnection(Connection* connection) {
   connections_.push_back(connection);
+  changed_connections_.insert(connection);
+  UpdatePingable(connection);
   connection->set_remote_ice_mode(remote_ice_mode_);
   connection->SignalReadPacket.connect(
       this, &P2PTransportChannel::OnReadPacket);
@@ -223,6 +256,8 @@ void P2PTransportChannel::SetRole(TransportRole role) {
          it != ports_.end(); ++it) {
       (*it)->SetRole(role_);
     }
+    // The role goes into every pair priority.
+    changed_connections_.insert(connections_.begin(), connections_.end());
   }
 }
 
@@ -304,7 +339,7 @@ void P2PTransportChannel::Connect() {
   Allocate();
 
   // Start pinging as the ports come in.
-  thread()->Post(this, MSG_PING);
+  ping_pacer_->Schedule(this, 0);
 }
 
 // Reset the socket, clear up any previous allocations and start over
@@ -318,6 +353,8 @@ void P2PTransportChannel::Reset() {
   allocator_sessions_.clear();
   ports_.clear();
   connections_.clear();
+  changed_connections_.clear();
+  ping_queue_.clear();
   best_connection_ = NULL;
 
   // Forget about all of the candidates we got before.
@@ -337,7 +374,7 @@ void P2PTransportChannel::Reset() {
 
   // Start pinging as the ports come in.
   thread()->Clear(this);
-  thread()->Post(this, MSG_PING);
+  ping_pacer_->Schedule(this, 0);
 }
 
 // A new port is available, attempt to make connections for it
@@ -839,6 +876,7 @@ void P2PTransportChannel::UpdateConnectionStates() {
   // when we call UpdateState.
   for (uint32 i = 0; i < connections_.size(); ++i)
     connections_[i]->UpdateState(now);
+  last_state_update_ = now;
 }
 
 // Prepare for best candidate sorting.
@@ -871,8 +909,7 @@ void P2PTransportChannel::SortConnections() {
   // one whose estimated latency is lowest.  So it is the only one that we
   // need to consider switching to.
 
-  ConnectionCompare cmp;
-  std::stable_sort(connections_.begin(), connections_.end(), cmp);
+  RankConnections();
   LOG(LS_VERBOSE) << "Sorting available connections:";
   for (uint32 i = 0; i < connections_.size(); ++i) {
     LOG(LS_VERBOSE) << connections_[i]->ToString();
@@ -979,7 +1016,8 @@ void P2PTransportChannel::UpdateChannelState() {
 // was writable, go into the writable state.
 void P2PTransportChannel::HandleWritable() {
   ASSERT(worker_thread_ == talk_base::Thread::Current());
-  if (!writable()) {
+  bool changed = !writable();
+  if (changed) {
     for (uint32 i = 0; i < allocator_sessions_.size(); ++i) {
       if (allocator_sessions_[i]->IsGettingPorts()) {
         allocator_sessions_[i]->StopGettingPorts();
@@ -989,6 +1027,8 @@ void P2PTransportChannel::HandleWritable() {
 
   was_writable_ = true;
   set_writable(true);
+  if (changed)
+    UpdatePingQueue();
 }
 
 // Notify upper layer about channel not writable state, if it was before.
@@ -997,6 +1037,7 @@ void P2PTransportChannel::HandleNotWritable() {
   if (was_writable_) {
     was_writable_ = false;
     set_writable(false);
+    UpdatePingQueue();
   }
 }
 
@@ -1005,6 +1046,46 @@ void P2PTransportChannel::HandleAllTimedOut() {
   HandleNotWritable();
 }
 
+// Puts connections_ back in the order std::stable_sort with ConnectionCompare
+// would give it, assuming only the connections in changed_connections_, and
+// those whose RTT estimate has moved them, are out of place.  Rather than
+// sorting everything, this pulls those out, leaving the rest in order, then
+// searches for where each one goes.  That costs O(n) comparisons plus
+// O(log n) for each connection that moved, instead of O(n log n).
+void P2PTransportChannel::RankConnections() {
+  ConnectionCompare cmp;
+  std::vector<RankedConnection> ranked, moved;
+  ranked.reserve(connections_.size());
+  for (size_t i = 0; i < connections_.size(); ++i) {
+    Connection* conn = connections_[i];
+    // RTT updates aren't signaled, so also pull out any connection that now
+    // belongs ahead of the last one kept.
+    if (changed_connections_.find(conn) != changed_connections_.end() ||
+        (!ranked.empty() && cmp(conn, ranked.back().conn))) {
+      moved.push_back(RankedConnection(conn, i));
+    } else {
+      ranked.push_back(RankedConnection(conn, i));
+    }
+  }
+  changed_connections_.clear();
+  if (moved.empty())
+    return;
+
+  RankedConnectionCompare ranked_cmp;
+  std::sort(moved.begin(), moved.end(), ranked_cmp);
+  connections_.clear();
+  std::vector<RankedConnection>::iterator next = ranked.begin();
+  for (size_t i = 0; i < moved.size(); ++i) {
+    std::vector<RankedConnection>::iterator pos =
+        std::upper_bound(next, ranked.end(), moved[i], ranked_cmp);
+    for (; next != pos; ++next)
+      connections_.push_back(next->conn);
+    connections_.push_back(moved[i].conn);
+  }
+  for (; next != ranked.end(); ++next)
+    connections_.push_back(next->conn);
+}
+
 // If we have a best connection, return it, otherwise return top one in the
 // list (later we will mark it best).
 Connection* P2PTransportChannel::GetBestConnectionOnNetwork(
@@ -1028,9 +1109,6 @@ void P2PTransportChannel::OnMessage(talk_base::Message *pmsg) {
     case MSG_SORT:
       OnSort();
       break;
-    case MSG_PING:
-      OnPing();
-      break;
     default:
       ASSERT(false);
       break;
@@ -1043,20 +1121,28 @@ void P2PTransportChannel::OnSort() {
   SortConnections();
 }
 
-// Handle queued up ping request
-void P2PTransportChannel::OnPing() {
+// Called by the pacer when it's our turn to ping.
+uint32 P2PTransportChannel::OnPingDue() {
   // Make sure the states of the connections are up-to-date (since this affects
-  // which ones are pingable).
-  UpdateConnectionStates();
+  // which ones are pingable).  Updating them all is O(n), so most of the time
+  // we update just the one we picked, and pick again if that changed it.
+  uint32 now = talk_base::Time();
+  if (talk_base::TimeDiff(now, last_state_update_) >=
+      static_cast<int>(STATE_UPDATE_INTERVAL)) {
+    UpdateConnectionStates();
+  }
 
   // Find the oldest pingable connection and have it do a ping.
   Connection* conn = FindNextPingableConnection();
+  if (conn && last_state_update_ != now) {
+    conn->UpdateState(now);
+    conn = FindNextPingableConnection();
+  }
   if (conn)
     PingConnection(conn);
 
-  // Post ourselves a message to perform the next ping.
-  uint32 delay = writable() ? WRITABLE_DELAY : UNWRITABLE_DELAY;
-  thread()->PostDelayed(delay, this, MSG_PING);
+  // Tell the pacer when to perform the next ping.
+  return writable() ? WRITABLE_DELAY : UNWRITABLE_DELAY;
 }
 
 // Is the connection in a state for us to even consider pinging the other side?
@@ -1081,6 +1167,24 @@ bool P2PTransportChannel::IsPingable(Connection* conn) {
   }
 }
 
+// Adds |conn| to or removes it from ping_queue_, according to whether it is
+// pingable now.  This is called whenever that may have changed, except for a
+// change in our own writability, which needs UpdatePingQueue.
+void P2PTransportChannel::UpdatePingable(Connection* conn) {
+  std::pair<uint32, Connection*> entry(conn->last_ping_sent(), conn);
+  if (IsPingable(conn)) {
+    ping_queue_.insert(entry);
+  } else {
+    ping_queue_.erase(entry);
+  }
+}
+
+void P2PTransportChannel::UpdatePingQueue() {
+  ping_queue_.clear();
+  for (uint32 i = 0; i < connections_.size(); ++i)
+    UpdatePingable(connections_[i]);
+}
+
 // Returns the next pingable connection to ping.  This will be the oldest
 // pingable connection unless we have a writable connection that is past the
 // maximum acceptable ping delay.
@@ -1093,17 +1197,20 @@ Connection* P2PTransportChannel::FindNextPingableConnection() {
     return best_connection_;
   }
 
-  Connection* oldest_conn = NULL;
-  uint32 oldest_time = 0xFFFFFFFF;
-  for (uint32 i = 0; i < connections_.size(); ++i) {
-    if (IsPingable(connections_[i])) {
-      if (connections_[i]->last_ping_sent() < oldest_time) {
-        oldest_time = connections_[i]->last_ping_sent();
-        oldest_conn = connections_[i];
+  if (ping_queue_.empty())
+    return NULL;
+
+  // Connections that have never been pinged go in sorted order, so the most
+  // promising ones are checked first.
+  if (ping_queue_.begin()->first == 0) {
+    for (uint32 i = 0; i < connections_.size(); ++i) {
+      if (connections_[i]->last_ping_sent() == 0 &&
+          IsPingable(connections_[i])) {
+        return connections_[i];
       }
     }
   }
-  return oldest_conn;
+  return ping_queue_.begin()->second;
 }
 
 // Apart from sending ping from |conn| this method also updates
@@ -1131,7 +1238,10 @@ void P2PTransportChannel::PingConnection(Connection* conn) {
     }
   }
   conn->set_use_candidate_attr(use_candidate);
+  // The ping moves the connection to the back of the queue.
+  ping_queue_.erase(std::make_pair(conn->last_ping_sent(), conn));
   conn->Ping(talk_base::Time());
+  UpdatePingable(conn);
 }
 
 // When a connection's state changes, we need to figure out who to use as
@@ -1148,8 +1258,11 @@ void P2PTransportChannel::OnConnectionStateChange(Connection* connection) {
     }
   }
 
+  UpdatePingable(connection);
+
   // We have to unroll the stack before doing this because we may be changing
   // the state of connections while sorting.
+  changed_connections_.insert(connection);
   RequestSort();
 }
 
@@ -1166,6 +1279,8 @@ void P2PTransportChannel::OnConnectionDestroyed(Connection* connection) {
       std::find(connections_.begin(), connections_.end(), connection);
   ASSERT(iter != connections_.end());
   connections_.erase(iter);
+  changed_connections_.erase(connection);
+  ping_queue_.erase(std::make_pair(connection->last_ping_sent(), connection));
 
   LOG_J(LS_INFO, this) << "Removed connection ("
     << static_cast<int>(connections_.size()) << " remaining)";
@@ -38,6 +38,8 @@
 #define TALK_P2P_BASE_P2PTRANSPORTCHANNEL_H_
 
 #include <map>
+#include <set>
+#include <utility>
 #include <vector>
 #include <string>
 #include "talk/base/sigslot.h"
@@ -47,6 +49,7 @@
 #include "talk/p2p/base/transport.h"
 #include "talk/p2p/base/transportchannelimpl.h"
 #include "talk/p2p/base/p2ptransport.h"
+#include "talk/p2p/base/pingpacer.h"
 
 namespace cricket {
 
@@ -65,7 +68,8 @@ class RemoteCandidate : public Candidate {
 // P2PTransportChannel manages the candidates and connection process to keep
 // two P2P clients connected to each other.
 class P2PTransportChannel : public TransportChannelImpl,
-                            public talk_base::MessageHandler {
+                            public talk_base::MessageHandler,
+                            public PingPacer::Client {
  public:
   P2PTransportChannel(const std::string& content_name,
                       int component,
@@ -114,6 +118,7 @@ class P2PTransportChannel : public TransportChannelImpl,
   void UpdateConnectionStates();
   void RequestSort();
   void SortConnections();
+  void RankConnections();
   void SwitchBestConnectionTo(Connection* conn);
   void UpdateChannelState();
   void HandleWritable();
@@ -131,6 +136,8 @@ class P2PTransportChannel : public TransportChannelImpl,
   void RememberRemoteCandidate(const Candidate& remote_candidate,
                                PortInterface* origin_port);
   bool IsPingable(Connection* conn);
+  void UpdatePingable(Connection* conn);
+  void UpdatePingQueue();
   Connection* FindNextPingableConnection();
   void PingConnection(Connection* conn);
   void AddAllocatorSession(PortAllocatorSession* session);
@@ -158,17 +165,26 @@ class P2PTransportChannel : public TransportChannelImpl,
 
   virtual void OnMessage(talk_base::Message *pmsg);
   void OnSort();
-  void OnPing();
+  // From PingPacer::Client:
+  virtual uint32 OnPingDue();
 
   P2PTransport* transport_;
   PortAllocator *allocator_;
   talk_base::Thread *worker_thread_;
+  PingPacer* ping_pacer_;
   bool incoming_only_;
   bool waiting_for_signaling_;
   int error_;
   std::vector<PortAllocatorSession*> allocator_sessions_;
   std::vector<PortInterface *> ports_;
   std::vector<Connection *> connections_;
+  // Connections that may have moved in the ranking since the last sort.
+  std::set<Connection*> changed_connections_;
+  // The pingable connections, by when they were last pinged.
+  typedef std::set<std::pair<uint32, Connection*> > PingQueue;
+  PingQueue ping_queue_;
+  // When the state of every connection was last brought up to date.
+  uint32 last_state_update_;
   Connection* best_connection_;
   // Connection selected by the controlling agent. This should be used only
   // at controlled side when protocol type is RFC5245.
@@ -41,6 +41,7 @@
 #include "talk/p2p/base/testrelayserver.h"
 #include "talk/p2p/base/teststunserver.h"
 #include "talk/p2p/client/basicportallocator.h"
+#include "talk/p2p/client/fakeportallocator.h"
 
 using cricket::kDefaultPortAllocatorFlags;
 using cricket::kMinimumStepDelay;
@@ -1459,3 +1460,100 @@ TEST_F(P2PTransportChannelTest, TestIceConfigWillPassDownToPort) {
 
   TestSendRecv(1);
 }
+
+// A channel with |pairs| connections from one local port to remote candidates
+// of random priority, for the benchmarks below.
+class BenchmarkChannel {
+ public:
+  explicit BenchmarkChannel(int pairs)
+      : allocator_(talk_base::Thread::Current(), NULL),
+        channel_("benchmark", 1, NULL, &allocator_) {
+    channel_.SetIceProtocolType(cricket::ICEPROTO_RFC5245);
+    channel_.SetRole(cricket::ROLE_CONTROLLING);
+    channel_.SetIceCredentials(kIceUfrag[0], kIcePwd[0]);
+    channel_.SetRemoteIceCredentials(kIceUfrag[1], kIcePwd[1]);
+    channel_.Connect();
+    channel_.OnSignalingReady();
+    EXPECT_EQ_WAIT(1u, channel_.ports().size(), kDefaultTimeout);
+    if (channel_.ports().empty())
+      return;
+    cricket::PortInterface* port = channel_.ports()[0];
+
+    for (int i = 0; i < pairs; ++i) {
+      cricket::Candidate candidate;
+      candidate.set_component(1);
+      candidate.set_protocol("udp");
+      candidate.set_address(SocketAddress("127.0.0.1", 10000 + i));
+      candidate.set_priority(talk_base::CreateRandomId());
+      candidate.set_type(cricket::LOCAL_PORT_TYPE);
+      channel_.OnCandidate(candidate);
+      cricket::Connection* conn = port->GetConnection(candidate.address());
+      EXPECT_TRUE(conn != NULL);
+      if (conn)
+        connections_.push_back(conn);
+    }
+    // Leave nothing in the queue but what the benchmark asks for.
+    talk_base::Thread::Current()->Clear(&channel_);
+  }
+
+  cricket::P2PTransportChannel* channel() { return &channel_; }
+  const std::vector<cricket::Connection*>& connections() const {
+    return connections_;
+  }
+
+ private:
+  cricket::FakePortAllocator allocator_;
+  cricket::P2PTransportChannel channel_;
+  std::vector<cricket::Connection*> connections_;
+};
+
+// Measures how long a channel takes to re-rank its connections after one of
+// them changes state, for 10 to 400 candidate pairs. Run with
+// --gtest_also_run_disabled_tests and --log "info" to see the numbers.
+TEST(P2PTransportChannelBenchmark, DISABLED_SortConnections) {
+  talk_base::VirtualSocketServer vss(NULL);
+  talk_base::SocketServerScope ss_scope(&vss);
+  talk_base::Thread* thread = talk_base::Thread::Current();
+  const int kPairs[] = { 10, 25, 50, 100, 200, 400 };
+  const int kSorts = 5000;
+
+  for (size_t i = 0; i < ARRAY_SIZE(kPairs); ++i) {
+    BenchmarkChannel benchmark(kPairs[i]);
+    const std::vector<cricket::Connection*>& connections =
+        benchmark.connections();
+    ASSERT_EQ(static_cast<size_t>(kPairs[i]), connections.size());
+
+    uint64 start = talk_base::TimeNanos();
+    for (int j = 0; j < kSorts; ++j) {
+      cricket::Connection* conn = connections[j % connections.size()];
+      conn->SignalStateChange(conn);
+      thread->ProcessMessages(0);
+    }
+    uint64 sort_ns = (talk_base::TimeNanos() - start) / kSorts;
+
+    LOG(LS_INFO) << kPairs[i] << " pairs: " << sort_ns << " ns/sort";
+  }
+}
+
+// Measures what it costs a channel to pick and ping its next connection, for
+// 10 to 400 candidate pairs.
+TEST(P2PTransportChannelBenchmark, DISABLED_PingConnections) {
+  talk_base::VirtualSocketServer vss(NULL);
+  talk_base::SocketServerScope ss_scope(&vss);
+  const int kPairs[] = { 10, 25, 50, 100, 200, 400 };
+  const int kPings = 5000;
+
+  for (size_t i = 0; i < ARRAY_SIZE(kPairs); ++i) {
+    BenchmarkChannel benchmark(kPairs[i]);
+    ASSERT_EQ(static_cast<size_t>(kPairs[i]), benchmark.connections().size());
+    cricket::PingPacer::Client* pinger = benchmark.channel();
+
+    uint64 start = talk_base::TimeNanos();
+    for (int j = 0; j < kPings; ++j) {
+      pinger->OnPingDue();
+    }
+    uint64 ping_ns = (talk_base::TimeNanos() - start) / kPings;
+
+    LOG(LS_INFO) << kPairs[i] << " pairs: " << ping_ns << " ns/ping";
+  }
+}
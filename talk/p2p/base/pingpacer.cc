@@ -0,0 +1,160 @@
+/*
+ * libjingle
+ * Copyright 2013, Google Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "talk/p2p/base/pingpacer.h"
+
+#include <algorithm>
+
+#include "talk/base/common.h"
+#include "talk/base/criticalsection.h"
+#include "talk/base/thread.h"
+#include "talk/base/timeutils.h"
+
+namespace cricket {
+
+namespace {
+
+typedef std::map<talk_base::Thread*, PingPacer*> PacerMap;
+
+// The pacers in use, by thread.
+PacerMap* Pacers() {
+  LIBJINGLE_DEFINE_STATIC_LOCAL(PacerMap, pacers, ());
+  return &pacers;
+}
+
+talk_base::CriticalSection* PacersLock() {
+  LIBJINGLE_DEFINE_STATIC_LOCAL(talk_base::CriticalSection, crit, ());
+  return &crit;
+}
+
+}  // namespace
+
+const int PingPacer::kMaxPingsPerTick;
+const uint32 PingPacer::kTickInterval;
+
+PingPacer::PingPacer(talk_base::Thread* thread)
+    : thread_(thread), ref_count_(0), pinging_(NULL) {
+}
+
+PingPacer::~PingPacer() {
+  ASSERT(schedule_.empty());
+}
+
+PingPacer* PingPacer::Acquire(talk_base::Thread* thread) {
+  ASSERT(thread->IsCurrent());
+  talk_base::CritScope cs(PacersLock());
+  PingPacer*& pacer = (*Pacers())[thread];
+  if (!pacer)
+    pacer = new PingPacer(thread);
+  ++pacer->ref_count_;
+  return pacer;
+}
+
+void PingPacer::Release() {
+  ASSERT(thread_->IsCurrent());
+  {
+    talk_base::CritScope cs(PacersLock());
+    if (--ref_count_ > 0)
+      return;
+    Pacers()->erase(thread_);
+  }
+  delete this;
+}
+
+void PingPacer::Schedule(Client* client, uint32 delay) {
+  ASSERT(thread_->IsCurrent());
+  uint64 time = Now() + delay;
+  Insert(client, time);
+  PostTick(time);
+}
+
+void PingPacer::Cancel(Client* client) {
+  ASSERT(thread_->IsCurrent());
+  if (client == pinging_)
+    pinging_ = NULL;
+  Remove(client);
+}
+
+uint64 PingPacer::Now() {
+  return talk_base::TimeNanos() / talk_base::kNumNanosecsPerMillisec;
+}
+
+void PingPacer::Insert(Client* client, uint64 time) {
+  Remove(client);
+  schedule_.insert(std::make_pair(time, client));
+  times_[client] = time;
+}
+
+void PingPacer::Remove(Client* client) {
+  std::map<Client*, uint64>::iterator it = times_.find(client);
+  if (it != times_.end()) {
+    schedule_.erase(std::make_pair(it->second, client));
+    times_.erase(it);
+  }
+}
+
+// Ticks that are already coming soon enough cover |time|, so only post one
+// if it would be the earliest.
+void PingPacer::PostTick(uint64 time) {
+  if (!ticks_.empty() && *ticks_.begin() <= time)
+    return;
+  uint64 now = Now();
+  thread_->PostDelayed(time > now ? static_cast<int>(time - now) : 0, this);
+  ticks_.insert(time);
+}
+
+void PingPacer::OnMessage(talk_base::Message* msg) {
+  // Delayed messages arrive in order, so this is the earliest tick.
+  ASSERT(!ticks_.empty());
+  ticks_.erase(ticks_.begin());
+
+  uint64 now = Now();
+  int pinged = 0;
+  while (pinged < kMaxPingsPerTick && !schedule_.empty() &&
+         schedule_.begin()->first <= now) {
+    Client* client = schedule_.begin()->second;
+    Remove(client);
+    pinging_ = client;
+    uint32 delay = client->OnPingDue();
+    // The client may have rescheduled or cancelled itself while pinging.
+    if (pinging_ == client && times_.find(client) == times_.end())
+      Insert(client, now + delay);
+    pinging_ = NULL;
+    ++pinged;
+  }
+
+  if (!schedule_.empty()) {
+    uint64 next = schedule_.begin()->first;
+    // If we stopped at the limit, the rest wait for the next tick.
+    if (pinged == kMaxPingsPerTick)
+      next = std::max(next, now + kTickInterval);
+    PostTick(next);
+  }
+}
+
+}  // namespace cricket
@@ -0,0 +1,111 @@
+/*
+ * libjingle
+ * Copyright 2013, Google Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef TALK_P2P_BASE_PINGPACER_H_
+#define TALK_P2P_BASE_PINGPACER_H_
+
+#include <map>
+#include <set>
+#include <utility>
+
+#include "talk/base/basictypes.h"
+#include "talk/base/constructormagic.h"
+#include "talk/base/messagehandler.h"
+
+namespace talk_base {
+class Thread;
+}
+
+namespace cricket {
+
+// Paces the connectivity checks of all the P2PTransportChannels on a thread.
+// Instead of each channel keeping a ping timer of its own, a channel tells
+// the pacer when it next wants to ping, and the pacer runs a single timer
+// that lets at most kMaxPingsPerTick of them ping each time it fires. When
+// more are due than that, as when thousands of sessions start at once, the
+// rest wait for the next tick, kTickInterval later, so the checks are spread
+// out and the thread's work per tick stays bounded.
+class PingPacer : public talk_base::MessageHandler {
+ public:
+  class Client {
+   public:
+    // Sends at most one ping and returns how many milliseconds it wants to
+    // wait before the next.
+    virtual uint32 OnPingDue() = 0;
+
+   protected:
+    virtual ~Client() {}
+  };
+
+  static const int kMaxPingsPerTick = 50;
+  static const uint32 kTickInterval = 5;
+
+  // Returns the pacer for |thread|, creating it if need be. Every call must be
+  // balanced by a call to Release on |thread|; the last one deletes the pacer.
+  static PingPacer* Acquire(talk_base::Thread* thread);
+  void Release();
+
+  // Has |client| ping |delay| milliseconds from now, replacing any time it
+  // was scheduled for before.
+  void Schedule(Client* client, uint32 delay);
+  // Removes |client| from the schedule. Clients must do this before they go
+  // away.
+  void Cancel(Client* client);
+
+  talk_base::Thread* thread() const { return thread_; }
+  // The number of clients waiting to ping.
+  size_t scheduled() const { return schedule_.size(); }
+
+ private:
+  // Times are in milliseconds, from a 64-bit clock so they never wrap.
+  typedef std::set<std::pair<uint64, Client*> > ScheduleQueue;
+
+  explicit PingPacer(talk_base::Thread* thread);
+  virtual ~PingPacer();
+
+  static uint64 Now();
+  void Insert(Client* client, uint64 time);
+  void Remove(Client* client);
+  void PostTick(uint64 time);
+  virtual void OnMessage(talk_base::Message* msg);
+
+  talk_base::Thread* thread_;
+  int ref_count_;
+  ScheduleQueue schedule_;
+  std::map<Client*, uint64> times_;
+  // When the ticks we have posted will fire, earliest first.
+  std::multiset<uint64> ticks_;
+  // The client being asked to ping, unless it cancelled meanwhile.
+  Client* pinging_;
+
+  DISALLOW_COPY_AND_ASSIGN(PingPacer);
+};
+
+}  // namespace cricket
+
+#endif  // TALK_P2P_BASE_PINGPACER_H_
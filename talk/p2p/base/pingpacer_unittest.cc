@@ -0,0 +1,151 @@
+/*
+ * libjingle
+ * Copyright 2013, Google Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <vector>
+
+#include "talk/base/gunit.h"
+#include "talk/base/thread.h"
+#include "talk/base/timeutils.h"
+#include "talk/p2p/base/pingpacer.h"
+
+using cricket::PingPacer;
+
+static const int kTimeout = 1000;
+
+// Counts its pings, and records the order they came in across clients.
+class FakePingClient : public PingPacer::Client {
+ public:
+  FakePingClient(PingPacer* pacer, std::vector<FakePingClient*>* order)
+      : pacer_(pacer), order_(order), pings_(0), delay_(kTimeout * 10),
+        cancel_on_ping_(false) {}
+  virtual ~FakePingClient() { pacer_->Cancel(this); }
+
+  virtual uint32 OnPingDue() {
+    ++pings_;
+    if (order_)
+      order_->push_back(this);
+    if (cancel_on_ping_)
+      pacer_->Cancel(this);
+    return delay_;
+  }
+
+  int pings() const { return pings_; }
+  void set_delay(uint32 delay) { delay_ = delay; }
+  void set_cancel_on_ping(bool cancel) { cancel_on_ping_ = cancel; }
+
+ private:
+  PingPacer* pacer_;
+  std::vector<FakePingClient*>* order_;
+  int pings_;
+  uint32 delay_;
+  bool cancel_on_ping_;
+};
+
+class PingPacerTest : public testing::Test {
+ public:
+  PingPacerTest()
+      : pacer_(PingPacer::Acquire(talk_base::Thread::Current())) {}
+  ~PingPacerTest() { pacer_->Release(); }
+
+ protected:
+  PingPacer* pacer_;
+};
+
+// Channels on the same thread share a pacer.
+TEST_F(PingPacerTest, TestAcquireSharesPacer) {
+  PingPacer* pacer = PingPacer::Acquire(talk_base::Thread::Current());
+  EXPECT_EQ(pacer_, pacer);
+  EXPECT_EQ(talk_base::Thread::Current(), pacer->thread());
+  pacer->Release();
+}
+
+// Clients ping in the order they are due, then again after the delay they
+// ask for.
+TEST_F(PingPacerTest, TestPingsInOrder) {
+  std::vector<FakePingClient*> order;
+  FakePingClient a(pacer_, &order), b(pacer_, &order);
+  a.set_delay(50);
+  pacer_->Schedule(&a, 20);
+  pacer_->Schedule(&b, 0);
+  EXPECT_EQ(2u, pacer_->scheduled());
+
+  EXPECT_EQ_WAIT(2, a.pings(), kTimeout);
+  EXPECT_EQ(1, b.pings());
+  ASSERT_EQ(3u, order.size());
+  EXPECT_EQ(&b, order[0]);
+  EXPECT_EQ(&a, order[1]);
+  EXPECT_EQ(&a, order[2]);
+}
+
+// Scheduling a client again replaces its earlier time.
+TEST_F(PingPacerTest, TestScheduleReplaces) {
+  FakePingClient a(pacer_, NULL);
+  pacer_->Schedule(&a, kTimeout * 10);
+  pacer_->Schedule(&a, 0);
+  EXPECT_EQ(1u, pacer_->scheduled());
+  EXPECT_EQ_WAIT(1, a.pings(), kTimeout);
+}
+
+TEST_F(PingPacerTest, TestCancel) {
+  FakePingClient a(pacer_, NULL), b(pacer_, NULL);
+  pacer_->Schedule(&a, 0);
+  pacer_->Schedule(&b, 10);
+  pacer_->Cancel(&a);
+  EXPECT_EQ_WAIT(1, b.pings(), kTimeout);
+  EXPECT_EQ(0, a.pings());
+}
+
+// A client that cancels itself while pinging isn't put back on the schedule.
+TEST_F(PingPacerTest, TestCancelWhilePinging) {
+  FakePingClient a(pacer_, NULL);
+  a.set_delay(0);
+  a.set_cancel_on_ping(true);
+  pacer_->Schedule(&a, 0);
+  EXPECT_EQ_WAIT(1, a.pings(), kTimeout);
+  EXPECT_EQ(0u, pacer_->scheduled());
+}
+
+// When more clients are due than one tick allows, the rest wait for the next.
+TEST_F(PingPacerTest, TestLimitsPingsPerTick) {
+  const int kClients = PingPacer::kMaxPingsPerTick * 2 + 10;
+  std::vector<FakePingClient*> order;
+  std::vector<FakePingClient*> clients;
+  for (int i = 0; i < kClients; ++i) {
+    clients.push_back(new FakePingClient(pacer_, &order));
+    pacer_->Schedule(clients.back(), 0);
+  }
+
+  talk_base::Thread::Current()->ProcessMessages(0);
+  EXPECT_EQ(static_cast<size_t>(PingPacer::kMaxPingsPerTick), order.size());
+  EXPECT_EQ_WAIT(static_cast<size_t>(kClients), order.size(), kTimeout);
+  for (int i = 0; i < kClients; ++i) {
+    EXPECT_EQ(1, clients[i]->pings());
+    delete clients[i];
+  }
+  EXPECT_EQ(0u, pacer_->scheduled());
+}
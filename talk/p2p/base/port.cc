@@ -109,6 +109,17 @@ inline uint32 ConservativeRTTEstimate(uint32 rtt) {
 // Weighting of the old rtt value to new data.
 const int RTT_RATIO = 3;  // 3 : 1
 
+// Formats the times of unanswered pings for logging.
+std::string PingTimesToString(const std::vector<uint32>& pings) {
+  std::string str;
+  for (size_t i = 0; i < pings.size(); ++i) {
+    char buf[32];
+    talk_base::sprintfn(buf, sizeof(buf), "%u", pings[i]);
+    str.append(buf).append(" ");
+  }
+  return str;
+}
+
 // The delay before we begin checking if this port is useless.
 const int kPortTimeoutDelay = 30 * 1000;  // 30 seconds
 
@@ -219,6 +230,7 @@ void Port::Construct() {
     ice_username_fragment_ = talk_base::CreateRandomString(ICE_UFRAG_LENGTH);
     password_ = talk_base::CreateRandomString(ICE_PWD_LENGTH);
   }
+  hmac_.SetKey(password_.data(), password_.size());
   LOG_J(LS_INFO, this) << "Port created";
 }
 
@@ -342,61 +354,90 @@ bool Port::IsGoogleIce() const {
 bool Port::GetStunMessage(const char* data, size_t size,
                           const talk_base::SocketAddress& addr,
                           IceMessage** out_msg, std::string* out_username) {
-  // NOTE: This could clearly be optimized to avoid allocating any memory.
-  //       However, at the data rates we'll be looking at on the client side,
-  //       this probably isn't worth worrying about.
   ASSERT(out_msg != NULL);
   ASSERT(out_username != NULL);
   *out_msg = NULL;
   out_username->clear();
 
-  // Don't bother parsing the packet if we can tell it's not STUN.
-  // In ICE mode, all STUN packets will have a valid fingerprint.
-  if (IsStandardIce() && !StunMessage::ValidateFingerprint(data, size)) {
+  // Look at the packet in place first, so that packets that aren't STUN are
+  // turned away without allocating anything, and so that checking a request
+  // doesn't take another pass over it. If the packet is not a complete and
+  // correct STUN message, then ignore it.
+  StunMessageView view;
+  if (!view.Parse(data, size)) {
     return false;
   }
 
-  // Parse the request message.  If the packet is not a complete and correct
-  // STUN message, then ignore it.
-  talk_base::scoped_ptr<IceMessage> stun_msg(new IceMessage());
-  talk_base::ByteBuffer buf(data, size);
-  if (!stun_msg->Read(&buf) || (buf.Length() > 0)) {
+  // In ICE mode, all STUN packets will have a valid fingerprint.
+  if (IsStandardIce() && !view.ValidateFingerprint()) {
     return false;
   }
 
-  if (stun_msg->type() == STUN_BINDING_REQUEST) {
+  int error_code = 0;
+  const char* error_reason = NULL;
+  std::string remote_ufrag;
+  if (view.type() == STUN_BINDING_REQUEST) {
     // Check for the presence of USERNAME and MESSAGE-INTEGRITY (if ICE) first.
     // If not present, fail with a 400 Bad Request.
-    if (!stun_msg->GetByteString(STUN_ATTR_USERNAME) ||
+    std::string username;
+    std::string local_ufrag;
+    if (!view.GetString(STUN_ATTR_USERNAME, &username) ||
         (IsStandardIce() &&
-         !stun_msg->GetByteString(STUN_ATTR_MESSAGE_INTEGRITY))) {
+         !view.HasAttribute(STUN_ATTR_MESSAGE_INTEGRITY))) {
       LOG_J(LS_ERROR, this) << "Received STUN request without username/M-I "
                             << "from " << addr.ToSensitiveString();
-      SendBindingErrorResponse(stun_msg.get(), addr, STUN_ERROR_BAD_REQUEST,
-                               STUN_ERROR_REASON_BAD_REQUEST);
-      return true;
-    }
-
-    // If the username is bad or unknown, fail with a 401 Unauthorized.
-    std::string local_ufrag;
-    std::string remote_ufrag;
-    if (!ParseStunUsername(stun_msg.get(), &local_ufrag, &remote_ufrag) ||
-        local_ufrag != username_fragment()) {
+      error_code = STUN_ERROR_BAD_REQUEST;
+      error_reason = STUN_ERROR_REASON_BAD_REQUEST;
+    } else if (!ParseStunUsername(username, &local_ufrag, &remote_ufrag) ||
+               local_ufrag != username_fragment()) {
+      // If the username is bad or unknown, fail with a 401 Unauthorized.
       LOG_J(LS_ERROR, this) << "Received STUN request with bad local username "
                             << local_ufrag << " from "
                             << addr.ToSensitiveString();
-      SendBindingErrorResponse(stun_msg.get(), addr, STUN_ERROR_UNAUTHORIZED,
-                               STUN_ERROR_REASON_UNAUTHORIZED);
-      return true;
-    }
-
-    // If ICE, and the MESSAGE-INTEGRITY is bad, fail with a 401 Unauthorized
-    if (IsStandardIce() &&
-        !stun_msg->ValidateMessageIntegrity(data, size, password_)) {
+      error_code = STUN_ERROR_UNAUTHORIZED;
+      error_reason = STUN_ERROR_REASON_UNAUTHORIZED;
+    } else if (IsStandardIce() &&
+               !view.ValidateMessageIntegrity(hmac_)) {
+      // If ICE, and the MESSAGE-INTEGRITY is bad, fail with a 401
+      // Unauthorized.
       LOG_J(LS_ERROR, this) << "Received STUN request with bad M-I "
                             << "from " << addr.ToSensitiveString();
-      SendBindingErrorResponse(stun_msg.get(), addr, STUN_ERROR_UNAUTHORIZED,
-                               STUN_ERROR_REASON_UNAUTHORIZED);
+      error_code = STUN_ERROR_UNAUTHORIZED;
+      error_reason = STUN_ERROR_REASON_UNAUTHORIZED;
+    }
+  }
+
+  // Turn away what our callers have no use for before paying for the full
+  // parse below.
+  if (view.type() == STUN_BINDING_ERROR_RESPONSE &&
+      !view.HasAttribute(STUN_ATTR_ERROR_CODE)) {
+    LOG_J(LS_ERROR, this) << "Received STUN binding error without a error "
+                          << "code from " << addr.ToSensitiveString();
+    return true;
+  } else if (view.type() != STUN_BINDING_REQUEST &&
+             view.type() != STUN_BINDING_RESPONSE &&
+             view.type() != STUN_BINDING_ERROR_RESPONSE &&
+             view.type() != STUN_BINDING_INDICATION) {
+    LOG_J(LS_ERROR, this) << "Received STUN packet with invalid type ("
+                          << view.type() << ") from "
+                          << addr.ToSensitiveString();
+    return true;
+  }
+
+  // Parse the full message, which our callers and the error response need.
+  // Connection and the port subclasses take an IceMessage, so an accepted
+  // message is still read in full; the view only spares the checks above a
+  // second pass over the attributes and the allocations for what is dropped.
+  talk_base::scoped_ptr<IceMessage> stun_msg(new IceMessage());
+  talk_base::ByteBuffer buf(data, size);
+  if (!stun_msg->Read(&buf) || (buf.Length() > 0)) {
+    return false;
+  }
+
+  if (stun_msg->type() == STUN_BINDING_REQUEST) {
+    if (error_code) {
+      SendBindingErrorResponse(stun_msg.get(), addr, error_code,
+                               error_reason);
       return true;
     }
     out_username->assign(remote_ufrag);
@@ -418,17 +459,14 @@ bool Port::GetStunMessage(const char* data, size_t size,
     }
     // NOTE: Username should not be used in verifying response messages.
     out_username->clear();
-  } else if (stun_msg->type() == STUN_BINDING_INDICATION) {
+  } else {
+    // Other types were turned away above.
+    ASSERT(stun_msg->type() == STUN_BINDING_INDICATION);
     LOG_J(LS_VERBOSE, this) << "Received STUN binding indication:"
                             << " from " << addr.ToSensitiveString();
     out_username->clear();
     // No stun attributes will be verified, if it's stun indication message.
     // Returning from end of the this method.
-  } else {
-    LOG_J(LS_ERROR, this) << "Received STUN packet with invalid type ("
-                          << stun_msg->type() << ") from "
-                          << addr.ToSensitiveString();
-    return true;
   }
 
   // Return the STUN message found.
@@ -452,9 +490,6 @@ bool Port::IsCompatibleAddress(const talk_base::SocketAddress& addr) {
 bool Port::ParseStunUsername(const StunMessage* stun_msg,
                              std::string* local_ufrag,
                              std::string* remote_ufrag) const {
-  // The packet must include a username that either begins or ends with our
-  // fragment.  It should begin with our fragment if it is a request and it
-  // should end with our fragment if it is a response.
   local_ufrag->clear();
   remote_ufrag->clear();
   const StunByteStringAttribute* username_attr =
@@ -462,7 +497,18 @@ bool Port::ParseStunUsername(const StunMessage* stun_msg,
   if (username_attr == NULL)
     return false;
 
-  const std::string username_attr_str = username_attr->GetString();
+  return ParseStunUsername(username_attr->GetString(), local_ufrag,
+                           remote_ufrag);
+}
+
+bool Port::ParseStunUsername(const std::string& username_attr_str,
+                             std::string* local_ufrag,
+                             std::string* remote_ufrag) const {
+  // The packet must include a username that either begins or ends with our
+  // fragment.  It should begin with our fragment if it is a request and it
+  // should end with our fragment if it is a response.
+  local_ufrag->clear();
+  remote_ufrag->clear();
   if (IsStandardIce()) {
     size_t colon_pos = username_attr_str.find(":");
     if (colon_pos != std::string::npos) {  // RFRAG:LFRAG
@@ -594,7 +640,7 @@ void Port::SendBindingResponse(StunMessage* request,
   if (IsStandardIce()) {
     response.AddAttribute(
         new StunXorAddressAttribute(STUN_ATTR_XOR_MAPPED_ADDRESS, addr));
-    response.AddMessageIntegrity(password_);
+    response.AddMessageIntegrity(hmac_);
     response.AddFingerprint();
   } else if (IsGoogleIce()) {
     response.AddAttribute(
@@ -646,7 +692,7 @@ void Port::SendBindingErrorResponse(StunMessage* request,
     // because we don't have enough information to determine the shared secret.
     if (error_code != STUN_ERROR_BAD_REQUEST &&
         error_code != STUN_ERROR_UNAUTHORIZED)
-      response.AddMessageIntegrity(password_);
+      response.AddMessageIntegrity(hmac_);
     response.AddFingerprint();
   } else if (IsGoogleIce()) {
     // GICE responses include a username, if one exists.
@@ -792,7 +838,7 @@ class ConnectionRequest : public StunRequest {
           new StunUInt32Attribute(STUN_ATTR_PRIORITY, prflx_priority));
 
       // Adding Message Integrity attribute.
-      request->AddMessageIntegrity(connection_->remote_candidate().password());
+      request->AddMessageIntegrity(connection_->remote_hmac());
       // Adding Fingerprint.
       request->AddFingerprint();
     }
@@ -828,7 +874,10 @@ class ConnectionRequest : public StunRequest {
 Connection::Connection(Port* port, size_t index,
                        const Candidate& remote_candidate)
   : port_(port), local_candidate_index_(index),
-    remote_candidate_(remote_candidate), read_state_(STATE_READ_INIT),
+    remote_candidate_(remote_candidate),
+    remote_hmac_(remote_candidate.password().data(),
+                 remote_candidate.password().size()),
+    read_state_(STATE_READ_INIT),
     write_state_(STATE_WRITE_INIT), connected_(true), pruned_(false),
     use_candidate_attr_(false), remote_ice_mode_(ICEMODE_FULL),
     requests_(port->thread()), rtt_(DEFAULT_RTT), last_ping_sent_(0),
@@ -907,6 +956,7 @@ void Connection::set_connected(bool value) {
   connected_ = value;
   if (value != old_value) {
     LOG_J(LS_VERBOSE, this) << "set_connected";
+    SignalStateChange(this);
   }
 }
 
@@ -1002,8 +1052,7 @@ void Connection::OnReadPacket(const char* data, size_t size) {
       case STUN_BINDING_RESPONSE:
       case STUN_BINDING_ERROR_RESPONSE:
         if (port_->IceProtocol() == ICEPROTO_GOOGLE ||
-            msg->ValidateMessageIntegrity(
-                data, size, remote_candidate().password())) {
+            msg->ValidateMessageIntegrity(data, size, remote_hmac_)) {
           requests_.CheckResponse(msg.get());
         }
         // Otherwise silently discard the response message.
@@ -1053,15 +1102,11 @@ void Connection::Destroy() {
 void Connection::UpdateState(uint32 now) {
   uint32 rtt = ConservativeRTTEstimate(rtt_);
 
-  std::string pings;
-  for (size_t i = 0; i < pings_since_last_response_.size(); ++i) {
-    char buf[32];
-    talk_base::sprintfn(buf, sizeof(buf), "%u",
-        pings_since_last_response_[i]);
-    pings.append(buf).append(" ");
-  }
-  LOG_J(LS_VERBOSE, this) << "UpdateState(): pings_since_last_response_=" <<
-      pings << ", rtt=" << rtt << ", now=" << now;
+  // The pings are only formatted if this is logged, which matters since it
+  // runs for every connection on every sort.
+  LOG_J(LS_VERBOSE, this) << "UpdateState(): pings_since_last_response_="
+                          << PingTimesToString(pings_since_last_response_)
+                          << ", rtt=" << rtt << ", now=" << now;
 
   // Check the readable state.
   //
@@ -1209,20 +1254,13 @@ void Connection::OnConnectionRequestResponse(ConnectionRequest* request,
     ReceivedPing();
   }
 
-  std::string pings;
-  for (size_t i = 0; i < pings_since_last_response_.size(); ++i) {
-    char buf[32];
-    talk_base::sprintfn(buf, sizeof(buf), "%u",
-        pings_since_last_response_[i]);
-    pings.append(buf).append(" ");
-  }
-
   talk_base::LoggingSeverity level =
       (pings_since_last_response_.size() > CONNECTION_WRITE_CONNECT_FAILURES) ?
           talk_base::LS_INFO : talk_base::LS_VERBOSE;
 
   LOG_JV(level, this) << "Received STUN ping response " << request->id()
-                      << ", pings_since_last_response_=" << pings
+                      << ", pings_since_last_response_="
+                      << PingTimesToString(pings_since_last_response_)
                       << ", rtt=" << rtt;
 
   pings_since_last_response_.clear();
@@ -32,6 +32,7 @@
 #include <vector>
 #include <map>
 
+#include "talk/base/messagedigest.h"
 #include "talk/base/network.h"
 #include "talk/base/proxyinfo.h"
 #include "talk/base/ratetracker.h"
@@ -233,7 +234,7 @@ class Port : public PortInterface, public talk_base::MessageHandler,
 
   // In a shared socket mode each port which shares the socket will decide
   // to accept the packet based on the |remote_addr|. Currently only UDP
-  // port implemented this method.
+  // and TURN ports implement this method.
   // TODO(mallinath) - Make it pure virtual.
   virtual bool HandleIncomingPacket(
       talk_base::AsyncPacketSocket* socket, const char* data, size_t size,
@@ -281,6 +282,9 @@ class Port : public PortInterface, public talk_base::MessageHandler,
   bool ParseStunUsername(const StunMessage* stun_msg,
                          std::string* local_username,
                          std::string* remote_username) const;
+  bool ParseStunUsername(const std::string& username,
+                         std::string* local_username,
+                         std::string* remote_username) const;
   void CreateStunUsername(const std::string& remote_username,
                           std::string* stun_username_attr_str) const;
 
@@ -361,6 +365,8 @@ class Port : public PortInterface, public talk_base::MessageHandler,
   // username_fragment().
   std::string ice_username_fragment_;
   std::string password_;
+  // Keyed with |password_|, for the M-I of requests to us and our responses.
+  talk_base::HmacContext hmac_;
   std::vector<Candidate> candidates_;
   AddressMap connections_;
   enum Lifetime { LT_PRESTART, LT_PRETIMEOUT, LT_POSTTIMEOUT } lifetime_;
@@ -401,6 +407,9 @@ class Connection : public talk_base::MessageHandler,
 
   // Returns the description of the remote port to which we communicate.
   const Candidate& remote_candidate() const { return remote_candidate_; }
+  // Keyed with the remote password, for the M-I of our requests and of the
+  // responses to them.
+  const talk_base::HmacContext& remote_hmac() const { return remote_hmac_; }
 
   // Returns the pair priority.
   uint64 priority() const;
@@ -535,6 +544,7 @@ class Connection : public talk_base::MessageHandler,
   Port* port_;
   size_t local_candidate_index_;
   Candidate remote_candidate_;
+  talk_base::HmacContext remote_hmac_;
   ReadState read_state_;
   WriteState write_state_;
   bool connected_;
@@ -55,6 +55,9 @@ const uint32 PORTALLOCATOR_ENABLE_SHARED_UFRAG = 0x80;
 const uint32 PORTALLOCATOR_ENABLE_SHARED_SOCKET = 0x100;
 const uint32 PORTALLOCATOR_ENABLE_STUN_RETRANSMIT_ATTRIBUTE = 0x200;
 const uint32 PORTALLOCATOR_USE_LARGE_SOCKET_SEND_BUFFERS = 0x400;
+// Starts every allocation phase at once instead of one per step delay. With
+// PORTALLOCATOR_ENABLE_SHARED_SOCKET, TURN/UDP ports also share the socket.
+const uint32 PORTALLOCATOR_ENABLE_PARALLEL_GATHERING = 0x800;
 
 const uint32 kDefaultPortAllocatorFlags = 0;
 
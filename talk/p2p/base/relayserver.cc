@@ -48,6 +48,9 @@ const uint32 USERNAME_LENGTH = 16;
 
 static const uint32 kMessageAcceptConnection = 1;
 
+// Maximum number of packets read from a server socket per wakeup.
+static const size_t kSocketBatchSize = 16;
+
 // Calls SendTo on the given socket and logs any bad results.
 void Send(talk_base::AsyncPacketSocket* socket, const char* bytes, size_t size,
           const talk_base::SocketAddress& addr) {
@@ -119,6 +122,7 @@ void RelayServer::AddInternalSocket(talk_base::AsyncPacketSocket* socket) {
   ASSERT(internal_sockets_.end() ==
       std::find(internal_sockets_.begin(), internal_sockets_.end(), socket));
   internal_sockets_.push_back(socket);
+  socket->SetBatchSize(kSocketBatchSize);
   socket->SignalReadPacket.connect(this, &RelayServer::OnInternalPacket);
 }
 
@@ -134,6 +138,7 @@ void RelayServer::AddExternalSocket(talk_base::AsyncPacketSocket* socket) {
   ASSERT(external_sockets_.end() ==
       std::find(external_sockets_.begin(), external_sockets_.end(), socket));
   external_sockets_.push_back(socket);
+  socket->SetBatchSize(kSocketBatchSize);
   socket->SignalReadPacket.connect(this, &RelayServer::OnExternalPacket);
 }
 
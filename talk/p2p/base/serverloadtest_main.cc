@@ -0,0 +1,538 @@
+/*
+ * libjingle
+ * Copyright 2013, Google Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+// A load generator for the STUN, TURN and relay servers. It starts a server
+// on a thread of its own, bound to loopback, sets up the simulated clients on
+// the main thread, then offers a fixed packet rate for a fixed time and
+// reports what came out the other side: packets per second, p50/p99
+// forwarding latency and the server thread's CPU use per 10k packets per
+// second.
+//
+// For TURN each client allocates, creates a permission and binds a channel
+// to a peer of its own, then sends ChannelData ("turn") or Send indications
+// ("turn-send"). Relay clients allocate, have their peer ping the external
+// address, then send Send requests. STUN clients send Binding requests, and
+// latency is the round trip.
+
+#include <stdlib.h>
+#include <string.h>
+#ifdef POSIX
+#include <time.h>
+#endif
+
+#include <algorithm>
+#include <iostream>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "talk/base/asyncudpsocket.h"
+#include "talk/base/bind.h"
+#include "talk/base/bytebuffer.h"
+#include "talk/base/helpers.h"
+#include "talk/base/scoped_ptr.h"
+#include "talk/base/stringencode.h"
+#include "talk/base/thread.h"
+#include "talk/base/timeutils.h"
+#include "talk/p2p/base/basicpacketsocketfactory.h"
+#include "talk/p2p/base/relayserver.h"
+#include "talk/p2p/base/stun.h"
+#include "talk/p2p/base/stunserver.h"
+#include "talk/p2p/base/testturnclient.h"
+#include "talk/p2p/base/turnserver.h"
+
+using talk_base::AsyncPacketSocket;
+using talk_base::AsyncUDPSocket;
+using talk_base::SocketAddress;
+using talk_base::Thread;
+
+namespace {
+
+enum Mode { MODE_STUN, MODE_TURN, MODE_TURN_SEND, MODE_RELAY, MODE_COUNT };
+const char* const kModeNames[] = { "stun", "turn", "turn-send", "relay" };
+
+const SocketAddress kLoopback("127.0.0.1", 0);
+const char kRealm[] = "example.org";
+const char kSoftware[] = "libjingle ServerLoadTest";
+const int kChannel = 0x4000;
+const int kRelayLifetime = 600;
+const int kSetupTimeout = 2000;
+const int kDrainTime = 200;
+
+// Packets sent through the server carry a marker and their send time.
+const char kMarker[4] = { 'L', 'O', 'A', 'D' };
+const size_t kPayloadSize = 100;
+
+void WritePayload(uint64 now, char* payload) {
+  memset(payload, 0, kPayloadSize);
+  memcpy(payload, kMarker, sizeof(kMarker));
+  memcpy(payload + sizeof(kMarker), &now, sizeof(now));
+}
+
+bool ReadPayload(const char* data, size_t size, uint64* sent) {
+  if (size != kPayloadSize || memcmp(data, kMarker, sizeof(kMarker)) != 0)
+    return false;
+  memcpy(sent, data + sizeof(kMarker), sizeof(*sent));
+  return true;
+}
+
+// Pumps the current thread until |*done| is set or |cms| expires.
+bool WaitFor(const bool* done, int cms) {
+  uint32 start = talk_base::Time();
+  while (!*done && talk_base::TimeSince(start) < cms) {
+    Thread::Current()->ProcessMessages(1);
+  }
+  return *done;
+}
+
+// Collects the latency of every marked packet it is given, in microseconds.
+class LatencySink : public sigslot::has_slots<> {
+ public:
+  void OnPacket(AsyncPacketSocket* socket, const char* data, size_t size,
+                const SocketAddress& addr) {
+    uint64 sent;
+    if (ReadPayload(data, size, &sent)) {
+      AddSample(sent);
+    }
+  }
+  void AddSample(uint64 sent) {
+    latencies_.push_back(static_cast<uint32>(
+        (talk_base::TimeNanos() - sent) / talk_base::kNumNanosecsPerMicrosec));
+  }
+  void Clear() { latencies_.clear(); }
+
+  size_t count() const { return latencies_.size(); }
+  // |fraction| of the samples are at or below the returned value.
+  uint32 Percentile(double fraction) {
+    if (latencies_.empty())
+      return 0;
+    size_t n = std::min(latencies_.size() - 1,
+                        static_cast<size_t>(latencies_.size() * fraction));
+    std::nth_element(latencies_.begin(), latencies_.begin() + n,
+                     latencies_.end());
+    return latencies_[n];
+  }
+
+ private:
+  std::vector<uint32> latencies_;
+};
+
+// Owns the server under test. Everything but the constructor runs on the
+// server thread.
+class LoadTestServer : public cricket::TurnAuthInterface {
+ public:
+  explicit LoadTestServer(Mode mode) : mode_(mode) {}
+
+  bool Start() {
+    Thread* thread = Thread::Current();
+    AsyncUDPSocket* int_socket =
+        AsyncUDPSocket::Create(thread->socketserver(), kLoopback);
+    if (!int_socket)
+      return false;
+    int_addr_ = int_socket->GetLocalAddress();
+    // The servers take ownership of their sockets.
+    switch (mode_) {
+      case MODE_STUN:
+        stun_server_.reset(new cricket::StunServer(int_socket));
+        break;
+      case MODE_TURN:
+      case MODE_TURN_SEND:
+        turn_server_.reset(new cricket::TurnServer(thread));
+        turn_server_->set_realm(kRealm);
+        turn_server_->set_software(kSoftware);
+        turn_server_->set_auth_hook(this);
+        turn_server_->AddInternalSocket(int_socket, cricket::PROTO_UDP);
+        turn_server_->SetExternalSocketFactory(
+            new talk_base::BasicPacketSocketFactory(), kLoopback);
+        break;
+      case MODE_RELAY: {
+        AsyncUDPSocket* ext_socket =
+            AsyncUDPSocket::Create(thread->socketserver(), kLoopback);
+        if (!ext_socket) {
+          delete int_socket;
+          return false;
+        }
+        ext_addr_ = ext_socket->GetLocalAddress();
+        relay_server_.reset(new cricket::RelayServer(thread));
+        relay_server_->AddInternalSocket(int_socket);
+        relay_server_->AddExternalSocket(ext_socket);
+        break;
+      }
+      default:
+        ASSERT(false);
+        delete int_socket;
+        return false;
+    }
+    return true;
+  }
+
+  void Stop() {
+    stun_server_.reset();
+    turn_server_.reset();
+    relay_server_.reset();
+  }
+
+  // CPU time used so far by the calling thread, or 0 if unknown.
+  uint64 ThreadCpuNanos() {
+#if defined(POSIX) && defined(CLOCK_THREAD_CPUTIME_ID)
+    timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+      return static_cast<uint64>(ts.tv_sec) * talk_base::kNumNanosecsPerSec +
+          ts.tv_nsec;
+    }
+#endif
+    return 0;
+  }
+
+  const SocketAddress& internal_address() const { return int_addr_; }
+  const SocketAddress& external_address() const { return ext_addr_; }
+
+ private:
+  // As in TestTurnServer, the password is the username.
+  virtual bool GetKey(const std::string& username, const std::string& realm,
+                      std::string* key) {
+    return cricket::ComputeStunCredentialHash(username, realm, username, key);
+  }
+
+  Mode mode_;
+  SocketAddress int_addr_;
+  SocketAddress ext_addr_;
+  talk_base::scoped_ptr<cricket::StunServer> stun_server_;
+  talk_base::scoped_ptr<cricket::TurnServer> turn_server_;
+  talk_base::scoped_ptr<cricket::RelayServer> relay_server_;
+};
+
+// One simulated client. Setup blocks, pumping the current thread.
+class LoadClient {
+ public:
+  virtual ~LoadClient() {}
+  virtual bool Setup() = 0;
+  virtual void SendPacket(uint64 now) = 0;
+};
+
+class StunLoadClient : public LoadClient, public sigslot::has_slots<> {
+ public:
+  StunLoadClient(const SocketAddress& server_addr, LatencySink* sink)
+      : socket_(AsyncUDPSocket::Create(Thread::Current()->socketserver(),
+                                       kLoopback)),
+        server_addr_(server_addr),
+        sink_(sink) {
+    socket_->SignalReadPacket.connect(this, &StunLoadClient::OnReadPacket);
+  }
+
+  virtual bool Setup() { return true; }
+
+  // The transaction ID carries the marker and the send time.
+  virtual void SendPacket(uint64 now) {
+    char id[cricket::kStunTransactionIdLength];
+    memcpy(id, kMarker, sizeof(kMarker));
+    memcpy(id + sizeof(kMarker), &now, sizeof(now));
+    cricket::StunMessage req;
+    req.SetType(cricket::STUN_BINDING_REQUEST);
+    req.SetTransactionID(std::string(id, sizeof(id)));
+    talk_base::ByteBuffer buf;
+    req.Write(&buf);
+    socket_->SendTo(buf.Data(), buf.Length(), server_addr_);
+  }
+
+ private:
+  void OnReadPacket(AsyncPacketSocket* socket, const char* data, size_t size,
+                    const SocketAddress& addr) {
+    cricket::StunMessage msg;
+    talk_base::ByteBuffer buf(data, size);
+    if (!msg.Read(&buf) || msg.type() != cricket::STUN_BINDING_RESPONSE)
+      return;
+    const std::string& id = msg.transaction_id();
+    uint64 sent;
+    if (id.size() == cricket::kStunTransactionIdLength &&
+        memcmp(id.data(), kMarker, sizeof(kMarker)) == 0) {
+      memcpy(&sent, id.data() + sizeof(kMarker), sizeof(sent));
+      sink_->AddSample(sent);
+    }
+  }
+
+  talk_base::scoped_ptr<AsyncUDPSocket> socket_;
+  SocketAddress server_addr_;
+  LatencySink* sink_;
+};
+
+class TurnLoadClient : public LoadClient {
+ public:
+  TurnLoadClient(const SocketAddress& server_addr, bool use_channel,
+                 const std::string& username, LatencySink* sink)
+      : client_(Thread::Current()->socketserver(), kLoopback, server_addr,
+                username),
+        peer_(AsyncUDPSocket::Create(Thread::Current()->socketserver(),
+                                     kLoopback)),
+        use_channel_(use_channel) {
+    peer_->SignalReadPacket.connect(sink, &LatencySink::OnPacket);
+  }
+
+  virtual bool Setup() {
+    SocketAddress peer_addr = peer_->GetLocalAddress();
+    return client_.Allocate() == 0 &&
+        client_.CreatePermission(peer_addr) == 0 &&
+        client_.BindChannel(kChannel, peer_addr) == 0;
+  }
+
+  virtual void SendPacket(uint64 now) {
+    char payload[kPayloadSize];
+    WritePayload(now, payload);
+    if (use_channel_) {
+      client_.SendChannelData(kChannel, payload, sizeof(payload));
+    } else {
+      client_.SendIndication(peer_->GetLocalAddress(), payload,
+                             sizeof(payload));
+    }
+  }
+
+ private:
+  cricket::TestTurnClient client_;
+  talk_base::scoped_ptr<AsyncUDPSocket> peer_;
+  bool use_channel_;
+};
+
+class RelayLoadClient : public LoadClient, public sigslot::has_slots<> {
+ public:
+  RelayLoadClient(const SocketAddress& int_addr, const SocketAddress& ext_addr,
+                  const std::string& username, LatencySink* sink)
+      : socket_(AsyncUDPSocket::Create(Thread::Current()->socketserver(),
+                                       kLoopback)),
+        peer_(AsyncUDPSocket::Create(Thread::Current()->socketserver(),
+                                     kLoopback)),
+        int_addr_(int_addr),
+        ext_addr_(ext_addr),
+        username_(username),
+        allocated_(false),
+        bound_(false) {
+    socket_->SignalReadPacket.connect(this, &RelayLoadClient::OnReadPacket);
+    peer_->SignalReadPacket.connect(sink, &LatencySink::OnPacket);
+  }
+
+  // Allocates, then has the peer ping the external address. The server passes
+  // that on as a Data indication and from then on forwards to the peer.
+  virtual bool Setup() {
+    cricket::RelayMessage allocate;
+    InitMessage(cricket::STUN_ALLOCATE_REQUEST, &allocate);
+    allocate.AddAttribute(new cricket::StunUInt32Attribute(
+        cricket::STUN_ATTR_LIFETIME, kRelayLifetime));
+    Send(socket_.get(), allocate, int_addr_);
+    if (!WaitFor(&allocated_, kSetupTimeout))
+      return false;
+
+    cricket::RelayMessage bind;
+    InitMessage(cricket::STUN_BINDING_REQUEST, &bind);
+    Send(peer_.get(), bind, ext_addr_);
+    return WaitFor(&bound_, kSetupTimeout);
+  }
+
+  virtual void SendPacket(uint64 now) {
+    char payload[kPayloadSize];
+    WritePayload(now, payload);
+    // The server looks for the magic cookie as the first attribute.
+    cricket::RelayMessage msg;
+    msg.SetType(cricket::STUN_SEND_REQUEST);
+    msg.SetTransactionID(
+        talk_base::CreateRandomString(cricket::kStunTransactionIdLength));
+    cricket::StunByteStringAttribute* cookie =
+        new cricket::StunByteStringAttribute(cricket::STUN_ATTR_MAGIC_COOKIE);
+    cookie->CopyBytes(cricket::TURN_MAGIC_COOKIE_VALUE,
+                      sizeof(cricket::TURN_MAGIC_COOKIE_VALUE));
+    msg.AddAttribute(cookie);
+    msg.AddAttribute(new cricket::StunByteStringAttribute(
+        cricket::STUN_ATTR_USERNAME, username_));
+    cricket::StunAddressAttribute* dest = new cricket::StunAddressAttribute(
+        cricket::STUN_ATTR_DESTINATION_ADDRESS, peer_->GetLocalAddress());
+    msg.AddAttribute(dest);
+    msg.AddAttribute(new cricket::StunByteStringAttribute(
+        cricket::STUN_ATTR_DATA, payload, sizeof(payload)));
+    Send(socket_.get(), msg, int_addr_);
+  }
+
+ private:
+  void InitMessage(int type, cricket::RelayMessage* msg) {
+    msg->SetType(type);
+    msg->SetTransactionID(
+        talk_base::CreateRandomString(cricket::kStunTransactionIdLength));
+    msg->AddAttribute(new cricket::StunByteStringAttribute(
+        cricket::STUN_ATTR_USERNAME, username_));
+  }
+  static void Send(AsyncUDPSocket* socket, const cricket::RelayMessage& msg,
+                   const SocketAddress& addr) {
+    talk_base::ByteBuffer buf;
+    msg.Write(&buf);
+    socket->SendTo(buf.Data(), buf.Length(), addr);
+  }
+
+  void OnReadPacket(AsyncPacketSocket* socket, const char* data, size_t size,
+                    const SocketAddress& addr) {
+    if (bound_)
+      return;
+    cricket::RelayMessage msg;
+    talk_base::ByteBuffer buf(data, size);
+    if (!msg.Read(&buf))
+      return;
+    if (msg.type() == cricket::STUN_ALLOCATE_RESPONSE) {
+      allocated_ = true;
+    } else if (msg.type() == cricket::STUN_DATA_INDICATION) {
+      bound_ = true;
+    }
+  }
+
+  talk_base::scoped_ptr<AsyncUDPSocket> socket_;
+  talk_base::scoped_ptr<AsyncUDPSocket> peer_;
+  SocketAddress int_addr_;
+  SocketAddress ext_addr_;
+  std::string username_;
+  bool allocated_;
+  bool bound_;
+};
+
+// Runs one load test, and returns false if the server or clients couldn't be
+// set up.
+bool RunLoadTest(Mode mode, int num_clients, int seconds, int pps) {
+  Thread server_thread;
+  server_thread.SetName("ServerLoadTest", NULL);
+  server_thread.Start();
+  LoadTestServer server(mode);
+  if (!server_thread.Invoke<bool>(
+          talk_base::Bind(&LoadTestServer::Start, &server))) {
+    std::cerr << kModeNames[mode] << ": failed to start the server"
+              << std::endl;
+    return false;
+  }
+
+  LatencySink sink;
+  std::vector<LoadClient*> clients;
+  bool ok = true;
+  for (int i = 0; i < num_clients && ok; ++i) {
+    std::string username = "load" + talk_base::ToString(i);
+    LoadClient* client = NULL;
+    switch (mode) {
+      case MODE_STUN:
+        client = new StunLoadClient(server.internal_address(), &sink);
+        break;
+      case MODE_TURN:
+      case MODE_TURN_SEND:
+        client = new TurnLoadClient(server.internal_address(),
+                                    mode == MODE_TURN, username, &sink);
+        break;
+      case MODE_RELAY:
+        client = new RelayLoadClient(server.internal_address(),
+                                     server.external_address(), username,
+                                     &sink);
+        break;
+      default:
+        ASSERT(false);
+        break;
+    }
+    clients.push_back(client);
+    ok = client->Setup();
+  }
+  if (!ok) {
+    std::cerr << kModeNames[mode] << ": client " << clients.size() - 1
+              << " failed to set up" << std::endl;
+  } else {
+    // Offer |pps| packets per second, spread over the clients in turn.
+    sink.Clear();
+    uint64 cpu_start = server_thread.Invoke<uint64>(
+        talk_base::Bind(&LoadTestServer::ThreadCpuNanos, &server));
+    uint64 start = talk_base::TimeNanos();
+    uint64 end = start + seconds * talk_base::kNumNanosecsPerSec;
+    int64 sent = 0;
+    for (uint64 now = start; now < end; now = talk_base::TimeNanos()) {
+      int64 due = static_cast<int64>(
+          (now - start) * pps / talk_base::kNumNanosecsPerSec);
+      for (; sent < due; ++sent) {
+        clients[sent % clients.size()]->SendPacket(now);
+      }
+      Thread::Current()->ProcessMessages(0);
+    }
+    Thread::Current()->ProcessMessages(kDrainTime);
+    uint64 cpu = server_thread.Invoke<uint64>(
+        talk_base::Bind(&LoadTestServer::ThreadCpuNanos, &server)) - cpu_start;
+    uint64 elapsed = talk_base::TimeNanos() - start;
+
+    double forwarded_pps = static_cast<double>(sink.count()) / seconds;
+    std::cout << kModeNames[mode] << ": " << num_clients << " clients, "
+              << pps << " pps offered, " << forwarded_pps << " pps through ("
+              << sent - static_cast<int64>(sink.count()) << " lost), "
+              << "latency p50 " << sink.Percentile(0.5) << "us p99 "
+              << sink.Percentile(0.99) << "us";
+    if (cpu > 0 && forwarded_pps > 0) {
+      double cpu_percent = 100.0 * cpu / elapsed;
+      std::cout << ", server CPU " << cpu_percent << "% of a core, "
+                << cpu_percent * 10000 / forwarded_pps << "% per 10k pps";
+    }
+    std::cout << std::endl;
+  }
+
+  for (size_t i = 0; i < clients.size(); ++i) {
+    delete clients[i];
+  }
+  server_thread.Invoke<void>(talk_base::Bind(&LoadTestServer::Stop, &server));
+  return ok;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc > 5) {
+    std::cerr << "usage: serverloadtest [stun|turn|turn-send|relay|all] "
+              << "[clients] [seconds] [pps]" << std::endl;
+    return 1;
+  }
+
+  int first_mode = 0, last_mode = MODE_COUNT - 1;
+  if (argc > 1 && strcmp(argv[1], "all") != 0) {
+    first_mode = MODE_COUNT;
+    for (int i = 0; i < MODE_COUNT; ++i) {
+      if (strcmp(argv[1], kModeNames[i]) == 0)
+        first_mode = last_mode = i;
+    }
+    if (first_mode == MODE_COUNT) {
+      std::cerr << "Unknown server: " << argv[1] << std::endl;
+      return 1;
+    }
+  }
+
+  int num_clients = 100, seconds = 5, pps = 10000;
+  if ((argc > 2 && (!talk_base::FromString(argv[2], &num_clients) ||
+                    num_clients < 1)) ||
+      (argc > 3 && (!talk_base::FromString(argv[3], &seconds) ||
+                    seconds < 1)) ||
+      (argc > 4 && (!talk_base::FromString(argv[4], &pps) || pps < 1))) {
+    std::cerr << "Invalid number" << std::endl;
+    return 1;
+  }
+
+  bool ok = true;
+  for (int mode = first_mode; mode <= last_mode; ++mode) {
+    ok = RunLoadTest(static_cast<Mode>(mode), num_clients, seconds, pps) && ok;
+  }
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,143 @@
+/*
+ * libjingle
+ * Copyright 2013, Google Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "talk/p2p/base/shardedturnserver.h"
+
+#include "talk/base/asyncudpsocket.h"
+#include "talk/base/bind.h"
+#include "talk/base/helpers.h"
+#include "talk/base/logging.h"
+#include "talk/base/physicalsocketserver.h"
+#include "talk/base/thread.h"
+#include "talk/p2p/base/basicpacketsocketfactory.h"
+
+namespace cricket {
+
+static const size_t kNonceKeySize = 16;
+
+bool ShardedTurnServer::SharedAuth::GetKey(const std::string& username,
+                                           const std::string& realm,
+                                           std::string* key) {
+  talk_base::CritScope cs(&crit_);
+  return auth_hook_ != NULL && auth_hook_->GetKey(username, realm, key);
+}
+
+ShardedTurnServer::ShardedTurnServer(int num_shards)
+    : num_shards_(num_shards),
+      nonce_key_(talk_base::CreateRandomString(kNonceKeySize)),
+      enable_otu_nonce_(false) {
+  ASSERT(num_shards_ > 0);
+}
+
+ShardedTurnServer::~ShardedTurnServer() {
+  Stop();
+}
+
+bool ShardedTurnServer::Start(const talk_base::SocketAddress& int_addr,
+                              const talk_base::SocketAddress& ext_addr) {
+  ASSERT(shards_.empty());
+  int_addr_ = int_addr;
+  ext_addr_ = ext_addr;
+  for (int i = 0; i < num_shards_; ++i) {
+    Shard* shard = new Shard();
+    shard->ss.reset(new talk_base::PhysicalSocketServer(
+        talk_base::PhysicalSocketServer::BACKEND_EPOLL));
+    shard->thread.reset(new talk_base::Thread(shard->ss.get()));
+    shard->thread->SetName("TurnServerShard", shard);
+    // Every allocation, permission and channel keeps a timer pending.
+    shard->thread->EnableTimerWheel();
+    shards_.push_back(shard);
+    if (!shard->thread->Start() ||
+        !shard->thread->Invoke<bool>(talk_base::Bind(
+            &ShardedTurnServer::StartShard, this, shard))) {
+      LOG(LS_ERROR) << "Failed to start TURN server shard " << i;
+      Stop();
+      return false;
+    }
+  }
+  LOG(LS_INFO) << "Started " << num_shards_ << " TURN server shards on "
+               << int_addr_.ToString();
+  return true;
+}
+
+void ShardedTurnServer::Stop() {
+  for (size_t i = 0; i < shards_.size(); ++i) {
+    Shard* shard = shards_[i];
+    // Allocations post timers to and are signaled on the shard thread, so
+    // they must be torn down there.
+    if (shard->server) {
+      shard->thread->Invoke<void>(talk_base::Bind(
+          &ShardedTurnServer::StopShard, this, shard));
+    }
+    shard->thread->Stop();
+    delete shard;
+  }
+  shards_.clear();
+}
+
+bool ShardedTurnServer::StartShard(Shard* shard) {
+  talk_base::AsyncSocket* socket =
+      shard->ss->CreateAsyncSocket(int_addr_.family(), SOCK_DGRAM);
+  if (!socket) {
+    return false;
+  }
+  // With a single shard there is nobody to share the port with.
+  if (num_shards_ > 1 &&
+      socket->SetOption(talk_base::Socket::OPT_REUSEPORT, 1) < 0) {
+    LOG(LS_ERROR) << "Unable to share " << int_addr_.ToString()
+                  << " between shards, error=" << socket->GetError();
+    delete socket;
+    return false;
+  }
+  if (socket->Bind(int_addr_) < 0) {
+    LOG(LS_ERROR) << "Bind to " << int_addr_.ToString() << " failed, error="
+                  << socket->GetError();
+    delete socket;
+    return false;
+  }
+  // The first shard resolves an ephemeral port for the rest.
+  int_addr_ = socket->GetLocalAddress();
+
+  shard->server.reset(new TurnServer(shard->thread.get()));
+  shard->server->set_realm(realm_);
+  shard->server->set_software(software_);
+  shard->server->set_auth_hook(&auth_);
+  shard->server->set_nonce_key(nonce_key_);
+  shard->server->set_enable_otu_nonce(enable_otu_nonce_);
+  shard->server->AddInternalSocket(new talk_base::AsyncUDPSocket(socket),
+                                   PROTO_UDP);
+  shard->server->SetExternalSocketFactory(
+      new talk_base::BasicPacketSocketFactory(shard->thread.get()), ext_addr_);
+  return true;
+}
+
+void ShardedTurnServer::StopShard(Shard* shard) {
+  shard->server.reset();
+}
+
+}  // namespace cricket
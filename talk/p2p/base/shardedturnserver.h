@@ -0,0 +1,125 @@
+/*
+ * libjingle
+ * Copyright 2013, Google Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef TALK_P2P_BASE_SHARDEDTURNSERVER_H_
+#define TALK_P2P_BASE_SHARDEDTURNSERVER_H_
+
+#include <string>
+#include <vector>
+
+#include "talk/base/criticalsection.h"
+#include "talk/base/scoped_ptr.h"
+#include "talk/base/socketaddress.h"
+#include "talk/p2p/base/turnserver.h"
+
+namespace talk_base {
+class PhysicalSocketServer;
+class Thread;
+}
+
+namespace cricket {
+
+// Runs several TurnServers side by side, each on its own thread with its own
+// socket server, so that a single relay can use more than one core.
+// Every shard binds its own UDP socket to the internal address with
+// SO_REUSEPORT, and the kernel spreads clients over those sockets by hashing
+// the 5-tuple. All packets from a client therefore reach the same shard, which
+// owns the client's allocation along with its permissions and channels.
+// The shards share one nonce key, so a nonce handed out by one shard is
+// accepted by the others, and calls into the auth hook are serialized.
+// Not yet wired up: TCP support.
+class ShardedTurnServer {
+ public:
+  explicit ShardedTurnServer(int num_shards);
+  ~ShardedTurnServer();
+
+  int num_shards() const { return num_shards_; }
+
+  // The following must be called before Start().
+  void set_realm(const std::string& realm) { realm_ = realm; }
+  void set_software(const std::string& software) { software_ = software; }
+  // Sets the authentication callback; does not take ownership. The hook is
+  // only ever called by one shard at a time.
+  void set_auth_hook(TurnAuthInterface* auth_hook) {
+    auth_.set_auth_hook(auth_hook);
+  }
+  void set_enable_otu_nonce(bool enable) { enable_otu_nonce_ = enable; }
+
+  // Starts the shards, listening for UDP clients on |int_addr| and relaying
+  // from sockets bound to |ext_addr|. If the port of |int_addr| is 0, the
+  // first shard picks one and the others join it.
+  bool Start(const talk_base::SocketAddress& int_addr,
+             const talk_base::SocketAddress& ext_addr);
+  // Destroys all allocations and stops the shard threads.
+  void Stop();
+
+  // The address the shards are listening on, once started.
+  const talk_base::SocketAddress& internal_address() const {
+    return int_addr_;
+  }
+
+ private:
+  // Serializes calls into the auth hook, which is shared by all shards.
+  class SharedAuth : public TurnAuthInterface {
+   public:
+    SharedAuth() : auth_hook_(NULL) {}
+    void set_auth_hook(TurnAuthInterface* auth_hook) { auth_hook_ = auth_hook; }
+    virtual bool GetKey(const std::string& username, const std::string& realm,
+                        std::string* key);
+
+   private:
+    talk_base::CriticalSection crit_;
+    TurnAuthInterface* auth_hook_;
+  };
+
+  struct Shard {
+    talk_base::scoped_ptr<talk_base::PhysicalSocketServer> ss;
+    talk_base::scoped_ptr<talk_base::Thread> thread;
+    talk_base::scoped_ptr<TurnServer> server;
+  };
+
+  // Run on the shard's own thread.
+  bool StartShard(Shard* shard);
+  void StopShard(Shard* shard);
+
+  int num_shards_;
+  std::string realm_;
+  std::string software_;
+  std::string nonce_key_;
+  bool enable_otu_nonce_;
+  SharedAuth auth_;
+  talk_base::SocketAddress int_addr_;
+  talk_base::SocketAddress ext_addr_;
+  std::vector<Shard*> shards_;
+
+  DISALLOW_COPY_AND_ASSIGN(ShardedTurnServer);
+};
+
+}  // namespace cricket
+
+#endif  // TALK_P2P_BASE_SHARDEDTURNSERVER_H_
@@ -0,0 +1,202 @@
+/*
+ * libjingle
+ * Copyright 2013, Google Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include "talk/base/asyncudpsocket.h"
+#include "talk/base/gunit.h"
+#include "talk/base/logging.h"
+#include "talk/base/scoped_ptr.h"
+#include "talk/base/systeminfo.h"
+#include "talk/base/thread.h"
+#include "talk/base/timeutils.h"
+#include "talk/p2p/base/basicpacketsocketfactory.h"
+#include "talk/p2p/base/shardedturnserver.h"
+#include "talk/p2p/base/stun.h"
+#include "talk/p2p/base/testturnclient.h"
+#include "talk/p2p/base/turnserver.h"
+
+using talk_base::SocketAddress;
+using namespace cricket;
+
+static const char kRealm[] = "example.org";
+static const int kChannelNumber = 0x4000;
+
+static const SocketAddress kLoopbackAddr(
+    talk_base::IPAddress(INADDR_LOOPBACK), 0);
+
+// Succeeds if the password is the same as the username.
+class TestTurnAuth : public TurnAuthInterface {
+ public:
+  virtual bool GetKey(const std::string& username, const std::string& realm,
+                      std::string* key) {
+    return ComputeStunCredentialHash(username, realm, username, key);
+  }
+};
+
+class ShardedTurnServerTest : public testing::Test,
+                              public sigslot::has_slots<> {
+ public:
+  ShardedTurnServerTest()
+      : ss_(talk_base::Thread::Current()->socketserver()),
+        peer_(talk_base::AsyncUDPSocket::Create(ss_, kLoopbackAddr)),
+        peer_packets_(0) {
+    peer_->SignalReadPacket.connect(this,
+                                    &ShardedTurnServerTest::OnPeerPacket);
+  }
+  ~ShardedTurnServerTest() {
+    DeleteClients();
+  }
+
+  // Creates |count| clients, each with an allocation and a channel to the
+  // peer socket.
+  void CreateClients(const SocketAddress& server_addr, int count) {
+    for (int i = 0; i < count; ++i) {
+      TestTurnClient* client =
+          new TestTurnClient(ss_, kLoopbackAddr, server_addr, "user");
+      clients_.push_back(client);
+      ASSERT_EQ(0, client->Allocate());
+      ASSERT_EQ(0, client->BindChannel(kChannelNumber,
+                                        peer_->GetLocalAddress()));
+    }
+  }
+
+  void DeleteClients() {
+    for (size_t i = 0; i < clients_.size(); ++i) {
+      delete clients_[i];
+    }
+    clients_.clear();
+  }
+
+ protected:
+  void OnPeerPacket(talk_base::AsyncPacketSocket* socket, const char* data,
+                    size_t size, const SocketAddress& addr) {
+    ++peer_packets_;
+    peer_sources_.insert(addr);
+  }
+
+  talk_base::SocketServer* ss_;
+  TestTurnAuth auth_;
+  talk_base::scoped_ptr<talk_base::AsyncPacketSocket> peer_;
+  int peer_packets_;
+  std::set<SocketAddress> peer_sources_;
+  std::vector<TestTurnClient*> clients_;
+};
+
+// Test that a nonce issued by one server is accepted by another only if they
+// share the nonce key.
+TEST_F(ShardedTurnServerTest, TestSharedNonceKey) {
+  talk_base::Thread* thread = talk_base::Thread::Current();
+  TurnServer server1(thread), server2(thread), server3(thread);
+  talk_base::AsyncUDPSocket* sockets[3];
+  TurnServer* servers[] = { &server1, &server2, &server3 };
+  for (int i = 0; i < 3; ++i) {
+    sockets[i] = talk_base::AsyncUDPSocket::Create(ss_, kLoopbackAddr);
+    servers[i]->set_realm(kRealm);
+    servers[i]->set_auth_hook(&auth_);
+    servers[i]->AddInternalSocket(sockets[i], PROTO_UDP);
+    servers[i]->SetExternalSocketFactory(
+        new talk_base::BasicPacketSocketFactory(), kLoopbackAddr);
+  }
+  server2.set_nonce_key(server1.nonce_key());
+
+  TestTurnClient client(ss_, kLoopbackAddr, sockets[0]->GetLocalAddress(),
+                        "user");
+  EXPECT_EQ(0, client.Allocate());
+  client.set_server_address(sockets[1]->GetLocalAddress());
+  EXPECT_EQ(0, client.Allocate());
+  client.set_server_address(sockets[2]->GetLocalAddress());
+  EXPECT_EQ(STUN_ERROR_STALE_NONCE, client.Allocate());
+}
+
+// Test that clients spread over several shards all get relayed.
+TEST_F(ShardedTurnServerTest, TestRelayThroughShards) {
+  const int kNumShards = 4;
+  const int kNumClients = 16;
+  ShardedTurnServer server(kNumShards);
+  server.set_realm(kRealm);
+  server.set_auth_hook(&auth_);
+  ASSERT_TRUE(server.Start(kLoopbackAddr, kLoopbackAddr));
+  EXPECT_NE(0, server.internal_address().port());
+
+  CreateClients(server.internal_address(), kNumClients);
+  std::set<SocketAddress> relayed_addrs;
+  for (size_t i = 0; i < clients_.size(); ++i) {
+    relayed_addrs.insert(clients_[i]->relayed_address());
+    clients_[i]->SendChannelData(kChannelNumber, "hello", 5);
+  }
+  EXPECT_EQ(static_cast<size_t>(kNumClients), relayed_addrs.size());
+  EXPECT_EQ_WAIT(kNumClients, peer_packets_, kTestTurnClientTimeout);
+  EXPECT_TRUE(peer_sources_ == relayed_addrs);
+}
+
+// Reports how many channel data packets per second the server relays to a
+// peer, in total and per core used, for an increasing number of shards.
+TEST_F(ShardedTurnServerTest, DISABLED_RelayThroughput) {
+  const int kNumClients = 64;
+  const int kWindow = 512;
+  const uint32 kDurationMs = 2000;
+  char payload[160] = { 0 };
+  int cpus = talk_base::SystemInfo().GetMaxCpus();
+
+  for (int num_shards = 1; num_shards <= 8; num_shards *= 2) {
+    ShardedTurnServer server(num_shards);
+    server.set_realm(kRealm);
+    server.set_auth_hook(&auth_);
+    ASSERT_TRUE(server.Start(kLoopbackAddr, kLoopbackAddr));
+    CreateClients(server.internal_address(), kNumClients);
+
+    // Keep at most |kWindow| packets in flight, so that the peer's receive
+    // buffer doesn't overflow and we measure the relay rather than drops.
+    peer_packets_ = 0;
+    int sent = 0;
+    uint32 start = talk_base::Time();
+    while (talk_base::TimeSince(start) < static_cast<int32>(kDurationMs)) {
+      for (size_t i = 0; i < clients_.size(); ++i) {
+        if (sent - peer_packets_ < kWindow) {
+          clients_[i]->SendChannelData(kChannelNumber, payload,
+                                       sizeof(payload));
+          ++sent;
+        }
+      }
+      talk_base::Thread::Current()->ProcessMessages(0);
+    }
+    int received = peer_packets_;
+    uint32 elapsed = talk_base::TimeSince(start);
+
+    int cores = talk_base::_min(num_shards, cpus);
+    int pps = static_cast<int>(received * 1000LL / elapsed);
+    LOG(LS_INFO) << num_shards << " shards: " << pps << " packets/sec, "
+                 << pps / cores << " packets/sec per core (" << cpus
+                 << " cpus), " << sent - received << " lost or in flight";
+    EXPECT_GT(received, 0);
+    DeleteClients();
+  }
+}
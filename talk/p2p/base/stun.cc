@@ -145,6 +145,12 @@ const StunUInt16ListAttribute* StunMessage::GetUnknownAttributes() const {
 // procedure outlined in RFC 5389, section 15.4.
 bool StunMessage::ValidateMessageIntegrity(const char* data, size_t size,
                                            const std::string& password) {
+  talk_base::HmacContext hmac(password.data(), password.size());
+  return ValidateMessageIntegrity(data, size, hmac);
+}
+
+bool StunMessage::ValidateMessageIntegrity(
+    const char* data, size_t size, const talk_base::HmacContext& hmac) {
   // Verifying the size of the message.
   if ((size % 4) != 0) {
     return false;
@@ -186,39 +192,32 @@ bool StunMessage::ValidateMessageIntegrity(const char* data, size_t size,
     return false;
   }
 
-  // Getting length of the message to calculate Message Integrity.
+  // The HMAC covers everything before the attribute, with the length in the
+  // header adjusted as if the message ended with the attribute. Only the
+  // header is copied, to adjust it; the rest is hashed in place.
+  //      0                   1                   2                   3
+  //      0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+  //     +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
+  //     |0 0|     STUN Message Type     |         Message Length        |
+  //     +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
   size_t mi_pos = current_pos;
-  talk_base::scoped_array<char> temp_data(new char[current_pos]);
-  memcpy(temp_data.get(), data, current_pos);
-  if (size > mi_pos + kStunAttributeHeaderSize + kStunMessageIntegritySize) {
-    // Stun message has other attributes after message integrity.
-    // Adjust the length parameter in stun message to calculate HMAC.
-    size_t extra_offset = size -
-        (mi_pos + kStunAttributeHeaderSize + kStunMessageIntegritySize);
-    size_t new_adjusted_len = size - extra_offset - kStunHeaderSize;
-
-    // Writing new length of the STUN message @ Message Length in temp buffer.
-    //      0                   1                   2                   3
-    //      0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
-    //     +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-    //     |0 0|     STUN Message Type     |         Message Length        |
-    //     +-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+-+
-    talk_base::SetBE16(temp_data.get() + 2,
-                       static_cast<uint16>(new_adjusted_len));
-  }
-
-  char hmac[kStunMessageIntegritySize];
-  size_t ret = talk_base::ComputeHmac(talk_base::DIGEST_SHA_1,
-                                      password.c_str(), password.size(),
-                                      temp_data.get(), mi_pos,
-                                      hmac, sizeof(hmac));
-  ASSERT(ret == sizeof(hmac));
-  if (ret != sizeof(hmac))
+  char header[kStunHeaderSize];
+  memcpy(header, data, kStunHeaderSize);
+  talk_base::SetBE16(header + 2, static_cast<uint16>(
+      mi_pos + kStunAttributeHeaderSize + kStunMessageIntegritySize -
+      kStunHeaderSize));
+
+  char computed[kStunMessageIntegritySize];
+  size_t ret = hmac.Compute(header, kStunHeaderSize,
+                            data + kStunHeaderSize, mi_pos - kStunHeaderSize,
+                            computed, sizeof(computed));
+  ASSERT(ret == sizeof(computed));
+  if (ret != sizeof(computed))
     return false;
 
   // Comparing the calculated HMAC with the one present in the message.
   return (std::memcmp(data + current_pos + kStunAttributeHeaderSize,
-                      hmac, sizeof(hmac)) == 0);
+                      computed, sizeof(computed)) == 0);
 }
 
 bool StunMessage::AddMessageIntegrity(const std::string& password) {
@@ -227,6 +226,11 @@ bool StunMessage::AddMessageIntegrity(const std::string& password) {
 
 bool StunMessage::AddMessageIntegrity(const char* key,
                                       size_t keylen) {
+  talk_base::HmacContext hmac(key, keylen);
+  return AddMessageIntegrity(hmac);
+}
+
+bool StunMessage::AddMessageIntegrity(const talk_base::HmacContext& hmac) {
   // Add the attribute with a dummy value. Since this is a known attribute, it
   // can't fail.
   StunByteStringAttribute* msg_integrity_attr =
@@ -241,20 +245,18 @@ bool StunMessage::AddMessageIntegrity(const char* key,
 
   int msg_len_for_hmac = static_cast<int>(
       buf.Length() - kStunAttributeHeaderSize - msg_integrity_attr->length());
-  char hmac[kStunMessageIntegritySize];
-  size_t ret = talk_base::ComputeHmac(talk_base::DIGEST_SHA_1,
-                                      key, keylen,
-                                      buf.Data(), msg_len_for_hmac,
-                                      hmac, sizeof(hmac));
-  ASSERT(ret == sizeof(hmac));
-  if (ret != sizeof(hmac)) {
+  char computed[kStunMessageIntegritySize];
+  size_t ret = hmac.Compute(buf.Data(), msg_len_for_hmac,
+                            computed, sizeof(computed));
+  ASSERT(ret == sizeof(computed));
+  if (ret != sizeof(computed)) {
     LOG(LS_ERROR) << "HMAC computation failed. Message-Integrity "
                   << "has dummy value.";
     return false;
   }
 
   // Insert correct HMAC into the attribute.
-  msg_integrity_attr->CopyBytes(hmac, sizeof(hmac));
+  msg_integrity_attr->CopyBytes(computed, sizeof(computed));
   return true;
 }
 
@@ -426,6 +428,238 @@ bool StunMessage::IsValidTransactionId(const std::string& transaction_id) {
       transaction_id.size() == kStunLegacyTransactionIdLength;
 }
 
+// StunMessageView
+
+StunMessageView::StunMessageView()
+    : data_(NULL),
+      size_(0),
+      type_(0),
+      num_attrs_(0),
+      integrity_pos_(0),
+      fingerprint_pos_(0) {
+}
+
+bool StunMessageView::Parse(const char* data, size_t size) {
+  data_ = NULL;
+  size_ = 0;
+  num_attrs_ = 0;
+  more_attrs_.clear();
+  integrity_pos_ = 0;
+  fingerprint_pos_ = 0;
+
+  if (size < kStunHeaderSize)
+    return false;
+
+  // RTP and RTCP set the MSB of the first byte; see StunMessage::Read.
+  uint16 type = talk_base::GetBE16(data);
+  if (type & 0x8000)
+    return false;
+
+  if (talk_base::GetBE16(data + 2) != size - kStunHeaderSize)
+    return false;
+
+  size_t pos = kStunHeaderSize;
+  while (pos < size) {
+    if (size - pos < kStunAttributeHeaderSize)
+      return false;
+    uint16 attr_type = talk_base::GetBE16(data + pos);
+    uint16 attr_length = talk_base::GetBE16(data + pos + 2);
+    // Like StunMessage::Read, require the padding to be present.
+    size_t padded_length = (attr_length + 3) & ~3;
+    if (size - pos - kStunAttributeHeaderSize < padded_length)
+      return false;
+    Attribute* attr;
+    if (num_attrs_ < kInlineAttributes) {
+      attr = &attrs_[num_attrs_++];
+    } else {
+      more_attrs_.push_back(Attribute());
+      attr = &more_attrs_.back();
+    }
+    attr->type = attr_type;
+    attr->length = attr_length;
+    attr->offset = pos + kStunAttributeHeaderSize;
+    if (attr_type == STUN_ATTR_MESSAGE_INTEGRITY && !integrity_pos_)
+      integrity_pos_ = pos;
+    fingerprint_pos_ = (attr_type == STUN_ATTR_FINGERPRINT) ? pos : 0;
+    pos += kStunAttributeHeaderSize + padded_length;
+  }
+
+  data_ = data;
+  size_ = size;
+  type_ = type;
+  return true;
+}
+
+bool StunMessageView::IsLegacy() const {
+  return talk_base::GetBE32(data_ + kStunTransactionIdOffset -
+                            kStunMagicCookieLength) != kStunMagicCookie;
+}
+
+std::string StunMessageView::transaction_id() const {
+  if (IsLegacy()) {
+    return std::string(data_ + kStunTransactionIdOffset -
+                       kStunMagicCookieLength, kStunLegacyTransactionIdLength);
+  }
+  return std::string(data_ + kStunTransactionIdOffset,
+                     kStunTransactionIdLength);
+}
+
+const StunMessageView::Attribute* StunMessageView::FindAttribute(
+    int type) const {
+  for (size_t i = 0; i < num_attrs_; ++i) {
+    if (attrs_[i].type == type)
+      return &attrs_[i];
+  }
+  for (size_t i = 0; i < more_attrs_.size(); ++i) {
+    if (more_attrs_[i].type == type)
+      return &more_attrs_[i];
+  }
+  return NULL;
+}
+
+bool StunMessageView::HasAttribute(int type) const {
+  return FindAttribute(type) != NULL;
+}
+
+bool StunMessageView::GetByteString(int type, const char** bytes,
+                                    size_t* length) const {
+  const Attribute* attr = FindAttribute(type);
+  if (!attr)
+    return false;
+  *bytes = data_ + attr->offset;
+  *length = attr->length;
+  return true;
+}
+
+bool StunMessageView::GetString(int type, std::string* str) const {
+  const char* bytes;
+  size_t length;
+  if (!GetByteString(type, &bytes, &length))
+    return false;
+  str->assign(bytes, length);
+  return true;
+}
+
+bool StunMessageView::GetUInt32(int type, uint32* value) const {
+  const Attribute* attr = FindAttribute(type);
+  if (!attr || attr->length != StunUInt32Attribute::SIZE)
+    return false;
+  *value = talk_base::GetBE32(data_ + attr->offset);
+  return true;
+}
+
+bool StunMessageView::GetUInt64(int type, uint64* value) const {
+  const Attribute* attr = FindAttribute(type);
+  if (!attr || attr->length != StunUInt64Attribute::SIZE)
+    return false;
+  *value = talk_base::GetBE64(data_ + attr->offset);
+  return true;
+}
+
+bool StunMessageView::GetAddress(int type,
+                                 talk_base::SocketAddress* addr) const {
+  // Check the length before reading anything; the attribute may be the last
+  // thing in the buffer.
+  const Attribute* attr = FindAttribute(type);
+  if (!attr || (attr->length != StunAddressAttribute::SIZE_IP4 &&
+                attr->length != StunAddressAttribute::SIZE_IP6))
+    return false;
+  const char* value = data_ + attr->offset;
+  uint8 family = value[1];
+  uint16 port = talk_base::GetBE16(value + 2);
+  if (family == STUN_ADDRESS_IPV4 &&
+      attr->length == StunAddressAttribute::SIZE_IP4) {
+    in_addr v4addr;
+    memcpy(&v4addr, value + 4, sizeof(v4addr));
+    *addr = talk_base::SocketAddress(talk_base::IPAddress(v4addr), port);
+  } else if (family == STUN_ADDRESS_IPV6 &&
+             attr->length == StunAddressAttribute::SIZE_IP6) {
+    in6_addr v6addr;
+    memcpy(&v6addr, value + 4, sizeof(v6addr));
+    *addr = talk_base::SocketAddress(talk_base::IPAddress(v6addr), port);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool StunMessageView::GetXorAddress(int type,
+                                    talk_base::SocketAddress* addr) const {
+  if (!GetAddress(type, addr))
+    return false;
+  // See StunXorAddressAttribute::GetXoredIP.
+  uint16 port = addr->port() ^ (kStunMagicCookie >> 16);
+  talk_base::IPAddress ip = addr->ipaddr();
+  if (ip.family() == AF_INET) {
+    in_addr v4addr = ip.ipv4_address();
+    v4addr.s_addr ^= talk_base::HostToNetwork32(kStunMagicCookie);
+    ip = talk_base::IPAddress(v4addr);
+  } else {
+    if (IsLegacy())
+      return false;
+    // The magic cookie is followed by the transaction ID in the header, so
+    // the mask is the 16 bytes starting at the cookie.
+    const char* mask =
+        data_ + kStunTransactionIdOffset - kStunMagicCookieLength;
+    in6_addr v6addr = ip.ipv6_address();
+    for (size_t i = 0; i < sizeof(v6addr.s6_addr); ++i) {
+      v6addr.s6_addr[i] ^= mask[i];
+    }
+    ip = talk_base::IPAddress(v6addr);
+  }
+  *addr = talk_base::SocketAddress(ip, port);
+  return true;
+}
+
+bool StunMessageView::GetErrorCode(int* code) const {
+  const Attribute* attr = FindAttribute(STUN_ATTR_ERROR_CODE);
+  if (!attr || attr->length < StunErrorCodeAttribute::MIN_SIZE)
+    return false;
+  uint32 val = talk_base::GetBE32(data_ + attr->offset);
+  *code = ((val >> 8) & 0x7) * 100 + (val & 0xff);
+  return true;
+}
+
+bool StunMessageView::ValidateMessageIntegrity(
+    const std::string& password) const {
+  talk_base::HmacContext hmac(password.data(), password.size());
+  return ValidateMessageIntegrity(hmac);
+}
+
+bool StunMessageView::ValidateMessageIntegrity(
+    const talk_base::HmacContext& hmac) const {
+  if (!integrity_pos_ ||
+      talk_base::GetBE16(data_ + integrity_pos_ + 2) !=
+          kStunMessageIntegritySize)
+    return false;
+
+  // The HMAC covers everything before the attribute, with the header length
+  // set as if the message ended with it. See
+  // StunMessage::ValidateMessageIntegrity.
+  char header[kStunHeaderSize];
+  memcpy(header, data_, kStunHeaderSize);
+  talk_base::SetBE16(header + 2, static_cast<uint16>(
+      integrity_pos_ + kStunAttributeHeaderSize + kStunMessageIntegritySize -
+      kStunHeaderSize));
+  char computed[kStunMessageIntegritySize];
+  hmac.Compute(header, kStunHeaderSize,
+               data_ + kStunHeaderSize, integrity_pos_ - kStunHeaderSize,
+               computed, sizeof(computed));
+  return memcmp(data_ + integrity_pos_ + kStunAttributeHeaderSize,
+                computed, sizeof(computed)) == 0;
+}
+
+bool StunMessageView::ValidateFingerprint() const {
+  if (!fingerprint_pos_ || IsLegacy() ||
+      talk_base::GetBE16(data_ + fingerprint_pos_ + 2) !=
+          StunUInt32Attribute::SIZE)
+    return false;
+  uint32 fingerprint = talk_base::GetBE32(
+      data_ + fingerprint_pos_ + kStunAttributeHeaderSize);
+  return ((fingerprint ^ STUN_FINGERPRINT_XOR_VALUE) ==
+      talk_base::ComputeCrc32(data_, fingerprint_pos_));
+}
+
 // StunAttribute
 
 StunAttribute::StunAttribute(uint16 type, uint16 length)
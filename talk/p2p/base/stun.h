@@ -38,6 +38,10 @@
 #include "talk/base/bytebuffer.h"
 #include "talk/base/socketaddress.h"
 
+namespace talk_base {
+class HmacContext;
+}  // namespace talk_base
+
 namespace cricket {
 
 // These are the types of STUN messages defined in RFC 5389.
@@ -183,9 +187,14 @@ class StunMessage {
   // padding data (which we discard when reading a StunMessage).
   static bool ValidateMessageIntegrity(const char* data, size_t size,
                                        const std::string& password);
+  // Like the previous function, with the HMAC key already set up. Callers
+  // that check many messages against the same password should keep one.
+  static bool ValidateMessageIntegrity(const char* data, size_t size,
+                                       const talk_base::HmacContext& hmac);
   // Adds a MESSAGE-INTEGRITY attribute that is valid for the current message.
   bool AddMessageIntegrity(const std::string& password);
   bool AddMessageIntegrity(const char* key, size_t keylen);
+  bool AddMessageIntegrity(const talk_base::HmacContext& hmac);
 
   // Verifies that a given buffer is STUN by checking for a correct FINGERPRINT.
   static bool ValidateFingerprint(const char* data, size_t size);
@@ -219,6 +228,66 @@ class StunMessage {
   std::vector<StunAttribute*>* attrs_;
 };
 
+// A read-only view of a STUN message in a buffer owned by the caller, for use
+// on the receive path. Unlike StunMessage::Read, Parse doesn't allocate or
+// copy anything; it checks the framing and records where each attribute is,
+// including MESSAGE-INTEGRITY and FINGERPRINT, so that those can be validated
+// without walking the message again. The buffer must outlive the view.
+class StunMessageView {
+ public:
+  StunMessageView();
+
+  // Returns false if |data| isn't a well-formed STUN message.
+  bool Parse(const char* data, size_t size);
+
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+  int type() const { return type_; }
+  bool IsLegacy() const;
+  // Includes the magic cookie for RFC3489 messages, as StunMessage does.
+  std::string transaction_id() const;
+
+  // Gets the desired attribute value, returning false if no such attribute
+  // exists or it is malformed. Byte strings point into the buffer.
+  bool HasAttribute(int type) const;
+  bool GetByteString(int type, const char** bytes, size_t* length) const;
+  bool GetString(int type, std::string* str) const;
+  bool GetUInt32(int type, uint32* value) const;
+  bool GetUInt64(int type, uint64* value) const;
+  bool GetAddress(int type, talk_base::SocketAddress* addr) const;
+  bool GetXorAddress(int type, talk_base::SocketAddress* addr) const;
+  bool GetErrorCode(int* code) const;
+
+  // Same checks as the StunMessage functions of the same name.
+  bool ValidateMessageIntegrity(const std::string& password) const;
+  bool ValidateMessageIntegrity(const talk_base::HmacContext& hmac) const;
+  bool ValidateFingerprint() const;
+
+ private:
+  struct Attribute {
+    uint16 type;
+    uint16 length;
+    size_t offset;  // of the value
+  };
+  // STUN messages seen in practice have around a dozen attributes. Any
+  // beyond this many go in |more_attrs_|, which allocates, but StunMessage
+  // has no limit and the view must accept whatever it does.
+  enum { kInlineAttributes = 32 };
+
+  const Attribute* FindAttribute(int type) const;
+
+  const char* data_;
+  size_t size_;
+  uint16 type_;
+  Attribute attrs_[kInlineAttributes];
+  size_t num_attrs_;
+  std::vector<Attribute> more_attrs_;
+  // Offsets of the first MESSAGE-INTEGRITY attribute and of a FINGERPRINT
+  // that is the last attribute, or 0 if there is none.
+  size_t integrity_pos_;
+  size_t fingerprint_pos_;
+};
+
 // Base class for all STUN/TURN attributes.
 class StunAttribute {
  public:
@@ -26,6 +26,7 @@
  */
 
 #include <string>
+#include <vector>
 
 #include "talk/base/bytebuffer.h"
 #include "talk/base/gunit.h"
@@ -33,6 +34,7 @@
 #include "talk/base/messagedigest.h"
 #include "talk/base/scoped_ptr.h"
 #include "talk/base/socketaddress.h"
+#include "talk/base/timeutils.h"
 #include "talk/p2p/base/stun.h"
 
 namespace cricket {
@@ -1266,6 +1268,39 @@ TEST_F(StunTest, AddMessageIntegrity) {
         kRfc5769SampleMsgPassword));
 }
 
+// Check that a reusable HMAC context signs and checks the same way.
+TEST_F(StunTest, MessageIntegrityWithHmacContext) {
+  const std::string password(kRfc5769SampleMsgPassword);
+  const talk_base::HmacContext hmac(password.data(), password.size());
+  EXPECT_TRUE(StunMessage::ValidateMessageIntegrity(
+      reinterpret_cast<const char*>(kRfc5769SampleRequest),
+      sizeof(kRfc5769SampleRequest), hmac));
+  EXPECT_TRUE(StunMessage::ValidateMessageIntegrity(
+      reinterpret_cast<const char*>(kRfc5769SampleResponse),
+      sizeof(kRfc5769SampleResponse), hmac));
+  const talk_base::HmacContext bad_hmac("InvalidPassword", 15);
+  EXPECT_FALSE(StunMessage::ValidateMessageIntegrity(
+      reinterpret_cast<const char*>(kRfc5769SampleRequest),
+      sizeof(kRfc5769SampleRequest), bad_hmac));
+
+  StunMessageView view;
+  ASSERT_TRUE(view.Parse(reinterpret_cast<const char*>(kRfc5769SampleRequest),
+                         sizeof(kRfc5769SampleRequest)));
+  EXPECT_TRUE(view.ValidateMessageIntegrity(hmac));
+  EXPECT_FALSE(view.ValidateMessageIntegrity(bad_hmac));
+
+  IceMessage msg;
+  talk_base::ByteBuffer buf(
+      reinterpret_cast<const char*>(kRfc5769SampleRequestWithoutMI),
+      sizeof(kRfc5769SampleRequestWithoutMI));
+  EXPECT_TRUE(msg.Read(&buf));
+  EXPECT_TRUE(msg.AddMessageIntegrity(hmac));
+  const StunByteStringAttribute* mi_attr =
+      msg.GetByteString(STUN_ATTR_MESSAGE_INTEGRITY);
+  EXPECT_EQ(0, std::memcmp(
+      mi_attr->bytes(), kCalculatedHmac1, sizeof(kCalculatedHmac1)));
+}
+
 // Check our STUN message validation code against the RFC5769 test messages.
 TEST_F(StunTest, ValidateFingerprint) {
   EXPECT_TRUE(StunMessage::ValidateFingerprint(
@@ -1465,4 +1500,317 @@ TEST_F(StunTest, ReadRelayMessage) {
   EXPECT_EQ(0, std::memcmp(outstring2.c_str(), input, len2));
 }
 
+TEST_F(StunTest, ParseStunMessageView) {
+  StunMessageView view;
+  ASSERT_TRUE(view.Parse(reinterpret_cast<const char*>(kRfc5769SampleRequest),
+                         sizeof(kRfc5769SampleRequest)));
+  EXPECT_EQ(STUN_BINDING_REQUEST, view.type());
+  EXPECT_FALSE(view.IsLegacy());
+  EXPECT_EQ(std::string(reinterpret_cast<const char*>(
+                            kRfc5769SampleMsgTransactionId),
+                        kStunTransactionIdLength),
+            view.transaction_id());
+
+  std::string str;
+  EXPECT_TRUE(view.GetString(STUN_ATTR_USERNAME, &str));
+  EXPECT_EQ(kRfc5769SampleMsgUsername, str);
+  EXPECT_TRUE(view.GetString(STUN_ATTR_SOFTWARE, &str));
+  EXPECT_EQ(kRfc5769SampleMsgClientSoftware, str);
+  uint32 priority;
+  EXPECT_TRUE(view.GetUInt32(STUN_ATTR_PRIORITY, &priority));
+  EXPECT_EQ(0x6e0001ffU, priority);
+  uint64 tiebreaker;
+  EXPECT_TRUE(view.GetUInt64(STUN_ATTR_ICE_CONTROLLED, &tiebreaker));
+  EXPECT_EQ(UINT64_C(0x932ff9b151263b36), tiebreaker);
+  EXPECT_TRUE(view.HasAttribute(STUN_ATTR_MESSAGE_INTEGRITY));
+  EXPECT_FALSE(view.HasAttribute(STUN_ATTR_NONCE));
+  EXPECT_FALSE(view.GetString(STUN_ATTR_NONCE, &str));
+
+  EXPECT_TRUE(view.ValidateMessageIntegrity(kRfc5769SampleMsgPassword));
+  EXPECT_FALSE(view.ValidateMessageIntegrity("InvalidPassword"));
+  EXPECT_TRUE(view.ValidateFingerprint());
+
+  // Long-term credentials.
+  ASSERT_TRUE(view.Parse(
+      reinterpret_cast<const char*>(kRfc5769SampleRequestLongTermAuth),
+      sizeof(kRfc5769SampleRequestLongTermAuth)));
+  EXPECT_TRUE(view.GetString(STUN_ATTR_REALM, &str));
+  EXPECT_EQ(kRfc5769SampleMsgWithAuthRealm, str);
+  EXPECT_TRUE(view.GetString(STUN_ATTR_NONCE, &str));
+  EXPECT_EQ(kRfc5769SampleMsgWithAuthNonce, str);
+  std::string key;
+  ComputeStunCredentialHash(kRfc5769SampleMsgWithAuthUsername,
+      kRfc5769SampleMsgWithAuthRealm, kRfc5769SampleMsgWithAuthPassword, &key);
+  EXPECT_TRUE(view.ValidateMessageIntegrity(key));
+  EXPECT_FALSE(view.ValidateMessageIntegrity("InvalidPassword"));
+  EXPECT_FALSE(view.ValidateFingerprint());
+}
+
+TEST_F(StunTest, ParseStunMessageViewAddresses) {
+  StunMessageView view;
+  talk_base::SocketAddress addr;
+  ASSERT_TRUE(view.Parse(reinterpret_cast<const char*>(kRfc5769SampleResponse),
+                         sizeof(kRfc5769SampleResponse)));
+  EXPECT_EQ(STUN_BINDING_RESPONSE, view.type());
+  EXPECT_TRUE(view.GetXorAddress(STUN_ATTR_XOR_MAPPED_ADDRESS, &addr));
+  EXPECT_EQ(kRfc5769SampleMsgMappedAddress, addr);
+  EXPECT_TRUE(view.ValidateMessageIntegrity(kRfc5769SampleMsgPassword));
+  EXPECT_TRUE(view.ValidateFingerprint());
+
+  ASSERT_TRUE(view.Parse(
+      reinterpret_cast<const char*>(kRfc5769SampleResponseIPv6),
+      sizeof(kRfc5769SampleResponseIPv6)));
+  EXPECT_TRUE(view.GetXorAddress(STUN_ATTR_XOR_MAPPED_ADDRESS, &addr));
+  EXPECT_EQ(kRfc5769SampleMsgIPv6MappedAddress, addr);
+
+  // The view has to agree with StunMessage on the other vectors.
+  const unsigned char* const kAddressMessages[] = {
+    kStunMessageWithIPv4XorMappedAddress,
+    kStunMessageWithIPv6XorMappedAddress,
+  };
+  const size_t kAddressMessageSizes[] = {
+    sizeof(kStunMessageWithIPv4XorMappedAddress),
+    sizeof(kStunMessageWithIPv6XorMappedAddress),
+  };
+  for (size_t i = 0; i < ARRAY_SIZE(kAddressMessages); ++i) {
+    StunMessage msg;
+    ReadStunMessageTestCase(&msg, kAddressMessages[i],
+                            kAddressMessageSizes[i]);
+    const StunAddressAttribute* attr =
+        msg.GetAddress(STUN_ATTR_XOR_MAPPED_ADDRESS);
+    ASSERT_TRUE(attr != NULL);
+    ASSERT_TRUE(view.Parse(reinterpret_cast<const char*>(kAddressMessages[i]),
+                           kAddressMessageSizes[i]));
+    EXPECT_TRUE(view.GetXorAddress(STUN_ATTR_XOR_MAPPED_ADDRESS, &addr));
+    EXPECT_EQ(attr->GetAddress(), addr);
+    EXPECT_EQ(msg.transaction_id(), view.transaction_id());
+  }
+
+  ASSERT_TRUE(view.Parse(
+      reinterpret_cast<const char*>(kStunMessageWithIPv4MappedAddress),
+      sizeof(kStunMessageWithIPv4MappedAddress)));
+  EXPECT_TRUE(view.GetAddress(STUN_ATTR_MAPPED_ADDRESS, &addr));
+  EXPECT_EQ(talk_base::SocketAddress("172.23.68.230", 40444), addr);
+  EXPECT_FALSE(view.GetXorAddress(STUN_ATTR_XOR_MAPPED_ADDRESS, &addr));
+
+  ASSERT_TRUE(view.Parse(
+      reinterpret_cast<const char*>(kStunMessageWithErrorAttribute),
+      sizeof(kStunMessageWithErrorAttribute)));
+  int code;
+  EXPECT_TRUE(view.GetErrorCode(&code));
+  EXPECT_EQ(STUN_ERROR_UNAUTHORIZED, code);
+}
+
+TEST_F(StunTest, FailToParseStunMessageView) {
+  StunMessageView view;
+  EXPECT_FALSE(view.Parse(
+      reinterpret_cast<const char*>(kStunMessageWithZeroLength),
+      sizeof(kStunMessageWithZeroLength)));
+  EXPECT_FALSE(view.Parse(
+      reinterpret_cast<const char*>(kStunMessageWithExcessLength),
+      sizeof(kStunMessageWithExcessLength)));
+  EXPECT_FALSE(view.Parse(
+      reinterpret_cast<const char*>(kStunMessageWithSmallLength),
+      sizeof(kStunMessageWithSmallLength)));
+  EXPECT_FALSE(view.Parse(reinterpret_cast<const char*>(kRtcpPacket),
+                          sizeof(kRtcpPacket)));
+  EXPECT_FALSE(view.Parse(reinterpret_cast<const char*>(kRfc5769SampleRequest),
+                          19));
+
+  // Munging a bit anywhere before the M-I value breaks the integrity check,
+  // and anywhere at all breaks the fingerprint.
+  char buf[sizeof(kRfc5769SampleRequest)];
+  memcpy(buf, kRfc5769SampleRequest, sizeof(kRfc5769SampleRequest));
+  for (size_t i = 0; i < sizeof(buf); ++i) {
+    buf[i] ^= 0x01;
+    if (i > 0)
+      buf[i - 1] ^= 0x01;
+    if (view.Parse(buf, sizeof(buf))) {
+      EXPECT_EQ(i >= sizeof(buf) - 8,
+                view.ValidateMessageIntegrity(kRfc5769SampleMsgPassword));
+      EXPECT_FALSE(view.ValidateFingerprint());
+    }
+  }
+}
+
+// Builds a binding request whose only attribute is |attr_type|, with a value
+// of |attr_length| zero bytes, padded, at the very end of the message.
+static void WriteStunMessageWithAttribute(uint16 attr_type,
+                                          uint16 attr_length,
+                                          talk_base::ByteBuffer* buf) {
+  size_t padded_length = (attr_length + 3) & ~3;
+  buf->WriteUInt16(STUN_BINDING_REQUEST);
+  buf->WriteUInt16(static_cast<uint16>(4 + padded_length));
+  buf->WriteUInt32(kStunMagicCookie);
+  buf->WriteString("0123456789ab");
+  buf->WriteUInt16(attr_type);
+  buf->WriteUInt16(attr_length);
+  std::string value(padded_length, '\0');
+  buf->WriteString(value);
+}
+
+// Address attributes too short to hold a family and port, or the wrong size
+// for their family, are rejected without reading past the buffer.
+TEST_F(StunTest, StunMessageViewTruncatedAddress) {
+  const uint16 kLengths[] = { 0, 1, 2, 4, 7 };
+  for (size_t i = 0; i < ARRAY_SIZE(kLengths); ++i) {
+    talk_base::ByteBuffer buf;
+    WriteStunMessageWithAttribute(STUN_ATTR_MAPPED_ADDRESS, kLengths[i], &buf);
+    // Copy to a buffer of exactly the message's size, so a checker can see
+    // any read past the end.
+    std::vector<char> data(buf.Data(), buf.Data() + buf.Length());
+    StunMessageView view;
+    ASSERT_TRUE(view.Parse(&data[0], data.size()));
+    talk_base::SocketAddress addr;
+    EXPECT_FALSE(view.GetAddress(STUN_ATTR_MAPPED_ADDRESS, &addr));
+    EXPECT_FALSE(view.GetXorAddress(STUN_ATTR_MAPPED_ADDRESS, &addr));
+  }
+
+  // An IPv4 family in an IPv6-sized attribute is rejected too.
+  talk_base::ByteBuffer buf;
+  WriteStunMessageWithAttribute(STUN_ATTR_MAPPED_ADDRESS,
+                                StunAddressAttribute::SIZE_IP6, &buf);
+  std::vector<char> data(buf.Data(), buf.Data() + buf.Length());
+  data[kStunHeaderSize + kStunAttributeHeaderSize + 1] = STUN_ADDRESS_IPV4;
+  StunMessageView view;
+  ASSERT_TRUE(view.Parse(&data[0], data.size()));
+  talk_base::SocketAddress addr;
+  EXPECT_FALSE(view.GetAddress(STUN_ATTR_MAPPED_ADDRESS, &addr));
+}
+
+// The view accepts as many attributes as StunMessage does.
+TEST_F(StunTest, StunMessageViewManyAttributes) {
+  const int kNumAttributes = 100;
+  talk_base::ByteBuffer buf;
+  buf.WriteUInt16(STUN_BINDING_REQUEST);
+  buf.WriteUInt16(kNumAttributes * 8);
+  buf.WriteUInt32(kStunMagicCookie);
+  buf.WriteString("0123456789ab");
+  for (int i = 0; i < kNumAttributes; ++i) {
+    buf.WriteUInt16(i < kNumAttributes - 1 ?
+                    static_cast<uint16>(STUN_ATTR_SOFTWARE) :
+                    static_cast<uint16>(STUN_ATTR_PRIORITY));
+    buf.WriteUInt16(4);
+    buf.WriteUInt32(i);
+  }
+
+  StunMessage msg;
+  talk_base::ByteBuffer read_buf(buf.Data(), buf.Length());
+  ASSERT_TRUE(msg.Read(&read_buf));
+
+  StunMessageView view;
+  ASSERT_TRUE(view.Parse(buf.Data(), buf.Length()));
+  uint32 priority;
+  EXPECT_TRUE(view.GetUInt32(STUN_ATTR_PRIORITY, &priority));
+  EXPECT_EQ(static_cast<uint32>(kNumAttributes - 1), priority);
+
+  // Parsing a smaller message with the same view forgets the extra ones.
+  ASSERT_TRUE(view.Parse(
+      reinterpret_cast<const char*>(kStunMessageWithIPv4MappedAddress),
+      sizeof(kStunMessageWithIPv4MappedAddress)));
+  EXPECT_FALSE(view.HasAttribute(STUN_ATTR_PRIORITY));
+}
+
+// Compares the cost of checking an incoming ICE connectivity check with
+// StunMessage and with StunMessageView. Run with
+// --gtest_also_run_disabled_tests and --log "info" to see the numbers.
+TEST_F(StunTest, DISABLED_StunMessageViewBenchmark) {
+  const char* data = reinterpret_cast<const char*>(kRfc5769SampleRequest);
+  const size_t size = sizeof(kRfc5769SampleRequest);
+  const int kIterations = 200000;
+
+  uint64 start = talk_base::TimeNanos();
+  for (int i = 0; i < kIterations; ++i) {
+    IceMessage msg;
+    talk_base::ByteBuffer buf(data, size);
+    EXPECT_TRUE(msg.Read(&buf));
+    EXPECT_TRUE(StunMessage::ValidateFingerprint(data, size));
+    EXPECT_TRUE(StunMessage::ValidateMessageIntegrity(
+        data, size, kRfc5769SampleMsgPassword));
+  }
+  uint64 message_ns = (talk_base::TimeNanos() - start) / kIterations;
+
+  const std::string password(kRfc5769SampleMsgPassword);
+  start = talk_base::TimeNanos();
+  for (int i = 0; i < kIterations; ++i) {
+    StunMessageView view;
+    EXPECT_TRUE(view.Parse(data, size));
+    EXPECT_TRUE(view.ValidateFingerprint());
+    EXPECT_TRUE(view.ValidateMessageIntegrity(password));
+  }
+  uint64 view_ns = (talk_base::TimeNanos() - start) / kIterations;
+
+  // What Port::GetStunMessage does with a request it accepts: check it from
+  // the view, then read it in full for its callers.
+  start = talk_base::TimeNanos();
+  for (int i = 0; i < kIterations; ++i) {
+    StunMessageView view;
+    EXPECT_TRUE(view.Parse(data, size));
+    EXPECT_TRUE(view.ValidateFingerprint());
+    EXPECT_TRUE(view.ValidateMessageIntegrity(password));
+    IceMessage msg;
+    talk_base::ByteBuffer buf(data, size);
+    EXPECT_TRUE(msg.Read(&buf));
+  }
+  uint64 both_ns = (talk_base::TimeNanos() - start) / kIterations;
+
+  LOG(LS_INFO) << "StunMessage: " << message_ns << " ns/message, "
+               << "StunMessageView: " << view_ns << " ns/message, "
+               << "both: " << both_ns << " ns/message";
+}
+
+// Compares the cost of signing and checking connectivity checks when the
+// HMAC is keyed per message, as before, with a context kept per credential.
+TEST_F(StunTest, DISABLED_MessageIntegrityBenchmark) {
+  const char* data = reinterpret_cast<const char*>(kRfc5769SampleRequest);
+  const size_t size = sizeof(kRfc5769SampleRequest);
+  const std::string password(kRfc5769SampleMsgPassword);
+  const int kIterations = 200000;
+
+  // Checking a received request, the way ports did before.
+  uint64 start = talk_base::TimeNanos();
+  for (int i = 0; i < kIterations; ++i) {
+    char hmac[kStunMessageIntegritySize];
+    talk_base::ComputeHmac(talk_base::DIGEST_SHA_1,
+                           password.data(), password.size(),
+                           data, size - 36, hmac, sizeof(hmac));
+  }
+  uint64 compute_hmac_ns = (talk_base::TimeNanos() - start) / kIterations;
+
+  const talk_base::HmacContext context(password.data(), password.size());
+  start = talk_base::TimeNanos();
+  for (int i = 0; i < kIterations; ++i) {
+    EXPECT_TRUE(StunMessage::ValidateMessageIntegrity(data, size, context));
+  }
+  uint64 validate_ns = (talk_base::TimeNanos() - start) / kIterations;
+
+  // Signing an outgoing request.
+  IceMessage msg;
+  talk_base::ByteBuffer buf(data, size);
+  ASSERT_TRUE(msg.Read(&buf));
+  start = talk_base::TimeNanos();
+  for (int i = 0; i < kIterations; ++i) {
+    IceMessage request;
+    request.SetType(STUN_BINDING_REQUEST);
+    request.SetTransactionID(msg.transaction_id());
+    EXPECT_TRUE(request.AddMessageIntegrity(password));
+  }
+  uint64 add_password_ns = (talk_base::TimeNanos() - start) / kIterations;
+  start = talk_base::TimeNanos();
+  for (int i = 0; i < kIterations; ++i) {
+    IceMessage request;
+    request.SetType(STUN_BINDING_REQUEST);
+    request.SetTransactionID(msg.transaction_id());
+    EXPECT_TRUE(request.AddMessageIntegrity(context));
+  }
+  uint64 add_context_ns = (talk_base::TimeNanos() - start) / kIterations;
+
+  LOG(LS_INFO) << "ComputeHmac: " << compute_hmac_ns << " ns/check, "
+               << "HmacContext: " << validate_ns << " ns/check ("
+               << 1000000000 / validate_ns << " checks/s)";
+  LOG(LS_INFO) << "AddMessageIntegrity(password): " << add_password_ns
+               << " ns, AddMessageIntegrity(context): " << add_context_ns
+               << " ns";
+}
+
 }  // namespace cricket
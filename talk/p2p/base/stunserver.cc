@@ -32,7 +32,11 @@
 
 namespace cricket {
 
+// Maximum number of requests read from the socket per wakeup.
+static const size_t kSocketBatchSize = 16;
+
 StunServer::StunServer(talk_base::AsyncUDPSocket* socket) : socket_(socket) {
+  socket_->SetBatchSize(kSocketBatchSize);
   socket_->SignalReadPacket.connect(this, &StunServer::OnPacket);
 }
 
@@ -0,0 +1,205 @@
+/*
+ * libjingle
+ * Copyright 2013, Google Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef TALK_P2P_BASE_TESTTURNCLIENT_H_
+#define TALK_P2P_BASE_TESTTURNCLIENT_H_
+
+#include <string>
+
+#include "talk/base/asyncudpsocket.h"
+#include "talk/base/bytebuffer.h"
+#include "talk/base/gunit.h"
+#include "talk/base/helpers.h"
+#include "talk/base/scoped_ptr.h"
+#include "talk/base/thread.h"
+#include "talk/p2p/base/stun.h"
+
+namespace cricket {
+
+static const int kTestTurnClientTimeout = 2000;
+
+// A bare-bones TURN client for tests. It allocates a relayed address,
+// installs permissions and binds channels to peers, and sends data to them
+// through the server.
+// Requests are sent synchronously, pumping the current thread until the
+// response arrives.
+class TestTurnClient : public sigslot::has_slots<> {
+ public:
+  TestTurnClient(talk_base::SocketFactory* factory,
+                 const talk_base::SocketAddress& local_addr,
+                 const talk_base::SocketAddress& server_addr,
+                 const std::string& username)
+      : socket_(talk_base::AsyncUDPSocket::Create(factory, local_addr)),
+        server_addr_(server_addr),
+        username_(username),
+        channel_data_received_(0) {
+    socket_->SignalReadPacket.connect(this, &TestTurnClient::OnReadPacket);
+  }
+
+  talk_base::SocketAddress local_address() const {
+    return socket_->GetLocalAddress();
+  }
+  void set_server_address(const talk_base::SocketAddress& addr) {
+    server_addr_ = addr;
+  }
+  const talk_base::SocketAddress& relayed_address() const {
+    return relayed_addr_;
+  }
+  int channel_data_received() const { return channel_data_received_; }
+
+  // Returns 0 on success, otherwise the error code of the response or -1 if
+  // none arrived. Learns the realm and nonce first, unless already known.
+  int Allocate() {
+    if (nonce_.empty()) {
+      TurnMessage req;
+      req.SetType(STUN_ALLOCATE_REQUEST);
+      AddRequestedTransport(&req);
+      if (SendRequest(&req) != STUN_ERROR_UNAUTHORIZED) {
+        return -1;
+      }
+      realm_ = response_->GetByteString(STUN_ATTR_REALM)->GetString();
+      nonce_ = response_->GetByteString(STUN_ATTR_NONCE)->GetString();
+      ComputeStunCredentialHash(username_, realm_, username_, &key_);
+    }
+
+    TurnMessage req;
+    req.SetType(STUN_ALLOCATE_REQUEST);
+    AddRequestedTransport(&req);
+    int err = SendRequest(&req);
+    if (err == 0) {
+      relayed_addr_ = response_->GetAddress(
+          STUN_ATTR_XOR_RELAYED_ADDRESS)->GetAddress();
+    }
+    return err;
+  }
+
+  // Returns 0 on success, as above.
+  int BindChannel(int channel_id, const talk_base::SocketAddress& peer) {
+    TurnMessage req;
+    req.SetType(TURN_CHANNEL_BIND_REQUEST);
+    VERIFY(req.AddAttribute(new StunUInt32Attribute(
+        STUN_ATTR_CHANNEL_NUMBER, channel_id << 16)));
+    VERIFY(req.AddAttribute(new StunXorAddressAttribute(
+        STUN_ATTR_XOR_PEER_ADDRESS, peer)));
+    return SendRequest(&req);
+  }
+
+  // Returns 0 on success, as above.
+  int CreatePermission(const talk_base::SocketAddress& peer) {
+    TurnMessage req;
+    req.SetType(TURN_CREATE_PERMISSION_REQUEST);
+    VERIFY(req.AddAttribute(new StunXorAddressAttribute(
+        STUN_ATTR_XOR_PEER_ADDRESS, peer)));
+    return SendRequest(&req);
+  }
+
+  // Needs a permission for |peer|.
+  void SendIndication(const talk_base::SocketAddress& peer, const char* data,
+                      size_t size) {
+    TurnMessage msg;
+    msg.SetType(TURN_SEND_INDICATION);
+    msg.SetTransactionID(
+        talk_base::CreateRandomString(kStunTransactionIdLength));
+    VERIFY(msg.AddAttribute(new StunXorAddressAttribute(
+        STUN_ATTR_XOR_PEER_ADDRESS, peer)));
+    VERIFY(msg.AddAttribute(new StunByteStringAttribute(
+        STUN_ATTR_DATA, data, size)));
+    talk_base::ByteBuffer buf;
+    msg.Write(&buf);
+    socket_->SendTo(buf.Data(), buf.Length(), server_addr_);
+  }
+
+  void SendChannelData(int channel_id, const char* data, size_t size) {
+    talk_base::ByteBuffer buf;
+    buf.WriteUInt16(channel_id);
+    buf.WriteUInt16(static_cast<uint16>(size));
+    buf.WriteBytes(data, size);
+    socket_->SendTo(buf.Data(), buf.Length(), server_addr_);
+  }
+
+ private:
+  static void AddRequestedTransport(TurnMessage* req) {
+    VERIFY(req->AddAttribute(new StunUInt32Attribute(
+        STUN_ATTR_REQUESTED_TRANSPORT, IPPROTO_UDP << 24)));
+  }
+
+  int SendRequest(TurnMessage* req) {
+    req->SetTransactionID(
+        talk_base::CreateRandomString(kStunTransactionIdLength));
+    if (!nonce_.empty()) {
+      VERIFY(req->AddAttribute(new StunByteStringAttribute(
+          STUN_ATTR_USERNAME, username_)));
+      VERIFY(req->AddAttribute(new StunByteStringAttribute(
+          STUN_ATTR_REALM, realm_)));
+      VERIFY(req->AddAttribute(new StunByteStringAttribute(
+          STUN_ATTR_NONCE, nonce_)));
+      VERIFY(req->AddMessageIntegrity(key_));
+    }
+    talk_base::ByteBuffer buf;
+    req->Write(&buf);
+    transaction_id_ = req->transaction_id();
+    response_.reset();
+    socket_->SendTo(buf.Data(), buf.Length(), server_addr_);
+
+    WAIT(response_.get() != NULL, kTestTurnClientTimeout);
+    if (!response_.get()) {
+      return -1;
+    }
+    const StunErrorCodeAttribute* error_attr = response_->GetErrorCode();
+    return error_attr ? error_attr->code() : 0;
+  }
+
+  void OnReadPacket(talk_base::AsyncPacketSocket* socket, const char* data,
+                    size_t size, const talk_base::SocketAddress& addr) {
+    // Channel data starts with 0b01, STUN messages with 0b00.
+    if (size >= 4 && (data[0] & 0xC0) == 0x40) {
+      ++channel_data_received_;
+      return;
+    }
+    talk_base::scoped_ptr<TurnMessage> msg(new TurnMessage());
+    talk_base::ByteBuffer buf(data, size);
+    if (msg->Read(&buf) && msg->transaction_id() == transaction_id_) {
+      response_.reset(msg.release());
+    }
+  }
+
+  talk_base::scoped_ptr<talk_base::AsyncPacketSocket> socket_;
+  talk_base::SocketAddress server_addr_;
+  std::string username_;
+  std::string realm_;
+  std::string nonce_;
+  std::string key_;
+  std::string transaction_id_;
+  talk_base::scoped_ptr<TurnMessage> response_;
+  talk_base::SocketAddress relayed_addr_;
+  int channel_data_received_;
+};
+
+}  // namespace cricket
+
+#endif  // TALK_P2P_BASE_TESTTURNCLIENT_H_
@@ -171,6 +171,29 @@ class TurnEntry : public sigslot::has_slots<> {
   BindState state_;
 };
 
+TurnPort::TurnPort(talk_base::Thread* thread,
+                   talk_base::Network* network,
+                   talk_base::AsyncPacketSocket* socket,
+                   const std::string& username,
+                   const std::string& password,
+                   const ProtocolAddress& server_address,
+                   const RelayCredentials& credentials)
+    : Port(thread, network, socket->GetLocalAddress().ipaddr(),
+           username, password),
+      server_address_(server_address),
+      credentials_(credentials),
+      socket_(socket),
+      resolver_(NULL),
+      error_(0),
+      request_manager_(thread),
+      next_channel_number_(TURN_CHANNEL_NUMBER_START),
+      connected_(false) {
+  // Only TURN over UDP can share a socket with the other ports.
+  ASSERT(server_address_.proto == PROTO_UDP);
+  set_type(RELAY_PORT_TYPE);
+  request_manager_.SignalSendPacket.connect(this, &TurnPort::OnSendStunPacket);
+}
+
 TurnPort::TurnPort(talk_base::Thread* thread,
                    talk_base::PacketSocketFactory* factory,
                    talk_base::Network* network,
@@ -184,6 +207,7 @@ TurnPort::TurnPort(talk_base::Thread* thread,
            username, password),
       server_address_(server_address),
       credentials_(credentials),
+      socket_(NULL),
       resolver_(NULL),
       error_(0),
       request_manager_(thread),
@@ -197,6 +221,8 @@ TurnPort::~TurnPort() {
   while (!entries_.empty()) {
     DestroyEntry(entries_.front()->address());
   }
+  if (!SharedSocket())
+    delete socket_;
 }
 
 void TurnPort::PrepareAddress() {
@@ -219,27 +245,33 @@ void TurnPort::PrepareAddress() {
     LOG_J(LS_INFO, this) << "Trying to connect to TURN server via "
                          << ProtoToString(server_address_.proto) << " @ "
                          << server_address_.address.ToSensitiveString();
-    if (server_address_.proto == PROTO_UDP) {
-      socket_.reset(socket_factory()->CreateUdpSocket(
-          talk_base::SocketAddress(ip(), 0), min_port(), max_port()));
-    } else if (server_address_.proto == PROTO_TCP) {
-      socket_.reset(socket_factory()->CreateClientTcpSocket(
-          talk_base::SocketAddress(ip(), 0), server_address_.address,
-          proxy(), user_agent(), talk_base::PacketSocketFactory::OPT_STUN));
-    }
-
-    if (!socket_) {
-      OnAllocateError();
-      return;
-    }
-
-    // Apply options if any.
-    for (SocketOptionsMap::iterator iter = socket_options_.begin();
-         iter != socket_options_.end(); ++iter) {
-      socket_->SetOption(iter->first, iter->second);
+    if (SharedSocket()) {
+      // The owner of the shared socket reads it and passes our packets to
+      // HandleIncomingPacket.
+      ASSERT(socket_ != NULL);
+    } else {
+      if (server_address_.proto == PROTO_UDP) {
+        socket_ = socket_factory()->CreateUdpSocket(
+            talk_base::SocketAddress(ip(), 0), min_port(), max_port());
+      } else if (server_address_.proto == PROTO_TCP) {
+        socket_ = socket_factory()->CreateClientTcpSocket(
+            talk_base::SocketAddress(ip(), 0), server_address_.address,
+            proxy(), user_agent(), talk_base::PacketSocketFactory::OPT_STUN);
+      }
+
+      if (!socket_) {
+        OnAllocateError();
+        return;
+      }
+
+      // Apply options if any.
+      for (SocketOptionsMap::iterator iter = socket_options_.begin();
+           iter != socket_options_.end(); ++iter) {
+        socket_->SetOption(iter->first, iter->second);
+      }
+
+      socket_->SignalReadPacket.connect(this, &TurnPort::OnReadPacket);
     }
-
-    socket_->SignalReadPacket.connect(this, &TurnPort::OnReadPacket);
     socket_->SignalReadyToSend.connect(this, &TurnPort::OnReadyToSend);
 
     if (server_address_.proto == PROTO_TCP) {
@@ -338,7 +370,7 @@ int TurnPort::SendTo(const void* data, size_t size,
 void TurnPort::OnReadPacket(talk_base::AsyncPacketSocket* socket,
                            const char* data, size_t size,
                            const talk_base::SocketAddress& remote_addr) {
-  ASSERT(socket == socket_.get());
+  ASSERT(socket == socket_);
   ASSERT(remote_addr == server_address_.address);
 
   // The message must be at least the size of a channel header.
@@ -368,6 +400,26 @@ void TurnPort::OnReadPacket(talk_base::AsyncPacketSocket* socket,
   }
 }
 
+bool TurnPort::HandleIncomingPacket(
+    talk_base::AsyncPacketSocket* socket, const char* data, size_t size,
+    const talk_base::SocketAddress& remote_addr) {
+  if (remote_addr != server_address_.address)
+    return false;
+
+  // The server may double as the STUN server of a port sharing our socket;
+  // we never send binding requests, so leave those responses to that port.
+  if (size >= sizeof(uint16)) {
+    uint16 msg_type = talk_base::GetBE16(data);
+    if (msg_type == STUN_BINDING_RESPONSE ||
+        msg_type == STUN_BINDING_ERROR_RESPONSE) {
+      return false;
+    }
+  }
+
+  OnReadPacket(socket, data, size, remote_addr);
+  return true;
+}
+
 void TurnPort::OnReadyToSend(talk_base::AsyncPacketSocket* socket) {
   if (connected_) {
     Port::OnReadyToSend();
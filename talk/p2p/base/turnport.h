@@ -49,6 +49,20 @@ class TurnEntry;
 
 class TurnPort : public Port {
  public:
+  // Creates a TURN/UDP port which sends and receives through |socket|, owned
+  // by the caller. Packets read from |socket| must be handed to
+  // HandleIncomingPacket.
+  static TurnPort* Create(talk_base::Thread* thread,
+                          talk_base::Network* network,
+                          talk_base::AsyncPacketSocket* socket,
+                          const std::string& username,  // ice username.
+                          const std::string& password,  // ice password.
+                          const ProtocolAddress& server_address,
+                          const RelayCredentials& credentials) {
+    return new TurnPort(thread, network, socket, username, password,
+                        server_address, credentials);
+  }
+
   static TurnPort* Create(talk_base::Thread* thread,
                           talk_base::PacketSocketFactory* factory,
                           talk_base::Network* network,
@@ -82,6 +96,9 @@ class TurnPort : public Port {
                             const char* data, size_t size,
                             const talk_base::SocketAddress& remote_addr);
   virtual void OnReadyToSend(talk_base::AsyncPacketSocket* socket);
+  virtual bool HandleIncomingPacket(
+      talk_base::AsyncPacketSocket* socket, const char* data, size_t size,
+      const talk_base::SocketAddress& remote_addr);
 
   void OnSocketConnect(talk_base::AsyncPacketSocket* socket);
   void OnSocketClose(talk_base::AsyncPacketSocket* socket, int error);
@@ -95,6 +112,14 @@ class TurnPort : public Port {
       SignalCreatePermissionResult;
 
  protected:
+  TurnPort(talk_base::Thread* thread,
+           talk_base::Network* network,
+           talk_base::AsyncPacketSocket* socket,
+           const std::string& username,
+           const std::string& password,
+           const ProtocolAddress& server_address,
+           const RelayCredentials& credentials);
+
   TurnPort(talk_base::Thread* thread,
            talk_base::PacketSocketFactory* factory,
            talk_base::Network* network,
@@ -152,7 +177,7 @@ class TurnPort : public Port {
   ProtocolAddress server_address_;
   RelayCredentials credentials_;
 
-  talk_base::scoped_ptr<talk_base::AsyncPacketSocket> socket_;
+  talk_base::AsyncPacketSocket* socket_;
   SocketOptionsMap socket_options_;
   talk_base::AsyncResolver* resolver_;
   int error_;
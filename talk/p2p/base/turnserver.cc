@@ -27,6 +27,8 @@
 
 #include "talk/p2p/base/turnserver.h"
 
+#include <vector>
+
 #include "talk/base/bytebuffer.h"
 #include "talk/base/helpers.h"
 #include "talk/base/logging.h"
@@ -48,6 +50,9 @@ static const int kDefaultAllocationTimeout = 10 * 60 * 1000;  // 10 minutes
 static const int kPermissionTimeout = 5 * 60 * 1000;          //  5 minutes
 static const int kChannelTimeout = 10 * 60 * 1000;            // 10 minutes
 
+// Maximum number of packets read from a server socket per wakeup.
+static const size_t kSocketBatchSize = 16;
+
 static const int kMinChannelNumber = 0x4000;
 static const int kMaxChannelNumber = 0x7FFF;
 
@@ -85,6 +90,7 @@ class TurnServer::Allocation : public talk_base::MessageHandler,
 
   Connection* conn() { return &conn_; }
   const std::string& key() const { return key_; }
+  const talk_base::HmacContext& hmac() const { return hmac_; }
   const std::string& transaction_id() const { return transaction_id_; }
   const std::string& username() const { return username_; }
   const std::string& last_nonce() const { return last_nonce_; }
@@ -93,17 +99,19 @@ class TurnServer::Allocation : public talk_base::MessageHandler,
   std::string ToString() const;
 
   void HandleTurnMessage(const TurnMessage* msg);
+  // Send indications carry the client's data, so they are handled straight
+  // from the packet, like channel data.
+  void HandleSendIndication(const StunMessageView* msg);
   void HandleChannelData(const char* data, size_t size);
 
   sigslot::signal1<Allocation*> SignalDestroyed;
 
  private:
-  typedef std::list<Permission*> PermissionList;
-  typedef std::list<Channel*> ChannelList;
+  typedef std::map<talk_base::IPAddress, Permission*> PermissionMap;
+  typedef std::map<talk_base::SocketAddress, Channel*> ChannelMap;
 
   void HandleAllocateRequest(const TurnMessage* msg);
   void HandleRefreshRequest(const TurnMessage* msg);
-  void HandleSendIndication(const TurnMessage* msg);
   void HandleCreatePermissionRequest(const TurnMessage* msg);
   void HandleChannelBindRequest(const TurnMessage* msg);
 
@@ -134,11 +142,17 @@ class TurnServer::Allocation : public talk_base::MessageHandler,
   Connection conn_;
   talk_base::scoped_ptr<talk_base::AsyncPacketSocket> external_socket_;
   std::string key_;
+  talk_base::HmacContext hmac_;  // Keyed with |key_|.
   std::string transaction_id_;
   std::string username_;
   std::string last_nonce_;
-  PermissionList perms_;
-  ChannelList channels_;
+  PermissionMap perms_;
+  // Channels are indexed both by peer address, for packets from the peers,
+  // and by channel number, for channel data from the client. The latter is
+  // a table covering the channel numbers bound so far, which clients hand
+  // out in order from kMinChannelNumber.
+  ChannelMap channels_;
+  std::vector<Channel*> channels_by_id_;
 };
 
 // Encapsulates a TURN permission.
@@ -235,6 +249,7 @@ void TurnServer::AddInternalSocket(talk_base::AsyncPacketSocket* socket,
                                    ProtocolType proto) {
   ASSERT(server_sockets_.end() == server_sockets_.find(socket));
   server_sockets_[socket] = proto;
+  socket->SetBatchSize(kSocketBatchSize);
   socket->SignalReadPacket.connect(this, &TurnServer::OnInternalPacket);
 }
 
@@ -306,36 +321,67 @@ void TurnServer::OnInternalPacket(talk_base::AsyncPacketSocket* socket,
 
 void TurnServer::HandleStunMessage(Connection* conn, const char* data,
                                    size_t size) {
-  TurnMessage msg;
-  talk_base::ByteBuffer buf(data, size);
-  if (!msg.Read(&buf) || (buf.Length() > 0)) {
+  // Binding requests, send indications and unauthorized requests are handled
+  // from a view of the packet, without parsing it into a TurnMessage.
+  StunMessageView view;
+  if (!view.Parse(data, size)) {
     LOG(LS_WARNING) << "Received invalid STUN message";
     return;
   }
 
   // If it's a STUN binding request, handle that specially.
-  if (msg.type() == STUN_BINDING_REQUEST) {
-    HandleBindingRequest(conn, &msg);
+  if (view.type() == STUN_BINDING_REQUEST) {
+    HandleBindingRequest(conn, &view);
     return;
   }
 
   // Look up the key that we'll use to validate the M-I. If we have an
-  // existing allocation, the key will already be cached.
+  // existing allocation, the key and its HMAC state will already be cached.
   Allocation* allocation = FindAllocation(conn);
   std::string key;
+  talk_base::HmacContext new_hmac;
+  const talk_base::HmacContext* hmac = NULL;
   if (!allocation) {
-    GetKey(&msg, &key);
+    if (GetKey(&view, &key) && !key.empty()) {
+      new_hmac.SetKey(key.data(), key.size());
+      hmac = &new_hmac;
+    }
   } else {
-    key = allocation->key();
+    hmac = &allocation->hmac();
   }
 
   // Ensure the message is authorized; only needed for requests.
-  if (IsStunRequestType(msg.type())) {
-    if (!CheckAuthorization(conn, &msg, data, size, key)) {
+  if (IsStunRequestType(view.type())) {
+    int error_code;
+    const char* reason;
+    if (!CheckAuthorization(conn, &view, hmac, &error_code, &reason)) {
+      // The response only needs the type and transaction ID of the request.
+      TurnMessage req;
+      req.SetType(view.type());
+      req.SetTransactionID(view.transaction_id());
+      if (error_code == STUN_ERROR_BAD_REQUEST) {
+        SendErrorResponse(conn, &req, error_code, reason);
+      } else {
+        SendErrorResponseWithRealmAndNonce(conn, &req, error_code, reason);
+      }
       return;
     }
   }
 
+  // Send indications are the only messages that arrive at the rate of the
+  // client's traffic; the rest are occasional and are parsed in full.
+  if (allocation && view.type() == TURN_SEND_INDICATION) {
+    allocation->HandleSendIndication(&view);
+    return;
+  }
+
+  TurnMessage msg;
+  talk_base::ByteBuffer buf(data, size);
+  if (!msg.Read(&buf) || (buf.Length() > 0)) {
+    LOG(LS_WARNING) << "Received invalid STUN message";
+    return;
+  }
+
   if (!allocation && msg.type() == STUN_ALLOCATE_REQUEST) {
     // This is a new allocate request.
     HandleAllocateRequest(conn, &msg, key);
@@ -359,81 +405,74 @@ void TurnServer::HandleStunMessage(Connection* conn, const char* data,
   }
 }
 
-bool TurnServer::GetKey(const StunMessage* msg, std::string* key) {
-  const StunByteStringAttribute* username_attr =
-      msg->GetByteString(STUN_ATTR_USERNAME);
-  if (!username_attr) {
+bool TurnServer::GetKey(const StunMessageView* msg, std::string* key) {
+  std::string username;
+  if (!msg->GetString(STUN_ATTR_USERNAME, &username)) {
     return false;
   }
 
-  std::string username = username_attr->GetString();
   return (auth_hook_ != NULL && auth_hook_->GetKey(username, realm_, key));
 }
 
 bool TurnServer::CheckAuthorization(Connection* conn,
-                                    const StunMessage* msg,
-                                    const char* data, size_t size,
-                                    const std::string& key) {
+                                    const StunMessageView* msg,
+                                    const talk_base::HmacContext* hmac,
+                                    int* error_code,
+                                    const char** reason) {
   // RFC 5389, 10.2.2.
   ASSERT(IsStunRequestType(msg->type()));
-  const StunByteStringAttribute* mi_attr =
-      msg->GetByteString(STUN_ATTR_MESSAGE_INTEGRITY);
-  const StunByteStringAttribute* username_attr =
-      msg->GetByteString(STUN_ATTR_USERNAME);
-  const StunByteStringAttribute* realm_attr =
-      msg->GetByteString(STUN_ATTR_REALM);
-  const StunByteStringAttribute* nonce_attr =
-      msg->GetByteString(STUN_ATTR_NONCE);
-
   // Fail if no M-I.
-  if (!mi_attr) {
-    SendErrorResponseWithRealmAndNonce(conn, msg, STUN_ERROR_UNAUTHORIZED,
-                                       STUN_ERROR_REASON_UNAUTHORIZED);
+  if (!msg->HasAttribute(STUN_ATTR_MESSAGE_INTEGRITY)) {
+    *error_code = STUN_ERROR_UNAUTHORIZED;
+    *reason = STUN_ERROR_REASON_UNAUTHORIZED;
     return false;
   }
 
   // Fail if there is M-I but no username, nonce, or realm.
-  if (!username_attr || !realm_attr || !nonce_attr) {
-    SendErrorResponse(conn, msg, STUN_ERROR_BAD_REQUEST,
-                      STUN_ERROR_REASON_BAD_REQUEST);
+  std::string nonce;
+  if (!msg->HasAttribute(STUN_ATTR_USERNAME) ||
+      !msg->HasAttribute(STUN_ATTR_REALM) ||
+      !msg->GetString(STUN_ATTR_NONCE, &nonce)) {
+    *error_code = STUN_ERROR_BAD_REQUEST;
+    *reason = STUN_ERROR_REASON_BAD_REQUEST;
     return false;
   }
 
   // Fail if bad nonce.
-  if (!ValidateNonce(nonce_attr->GetString())) {
-    SendErrorResponseWithRealmAndNonce(conn, msg, STUN_ERROR_STALE_NONCE,
-                                       STUN_ERROR_REASON_STALE_NONCE);
+  if (!ValidateNonce(nonce)) {
+    *error_code = STUN_ERROR_STALE_NONCE;
+    *reason = STUN_ERROR_REASON_STALE_NONCE;
     return false;
   }
 
   // Fail if bad username or M-I.
-  // We need |data| and |size| for the call to ValidateMessageIntegrity.
-  if (key.empty() || !StunMessage::ValidateMessageIntegrity(data, size, key)) {
-    SendErrorResponseWithRealmAndNonce(conn, msg, STUN_ERROR_UNAUTHORIZED,
-                                       STUN_ERROR_REASON_UNAUTHORIZED);
+  if (!hmac || !msg->ValidateMessageIntegrity(*hmac)) {
+    *error_code = STUN_ERROR_UNAUTHORIZED;
+    *reason = STUN_ERROR_REASON_UNAUTHORIZED;
     return false;
   }
 
   // Fail if one-time-use nonce feature is enabled.
   Allocation* allocation = FindAllocation(conn);
   if (enable_otu_nonce_ && allocation &&
-      allocation->last_nonce() == nonce_attr->GetString()) {
-    SendErrorResponseWithRealmAndNonce(conn, msg, STUN_ERROR_STALE_NONCE,
-                                       STUN_ERROR_REASON_STALE_NONCE);
+      allocation->last_nonce() == nonce) {
+    *error_code = STUN_ERROR_STALE_NONCE;
+    *reason = STUN_ERROR_REASON_STALE_NONCE;
     return false;
   }
 
   if (allocation) {
-    allocation->set_last_nonce(nonce_attr->GetString());
+    allocation->set_last_nonce(nonce);
   }
   // Success.
   return true;
 }
 
 void TurnServer::HandleBindingRequest(Connection* conn,
-                                      const StunMessage* req) {
+                                      const StunMessageView* req) {
   StunMessage response;
-  InitResponse(req, &response);
+  response.SetType(STUN_BINDING_RESPONSE);
+  response.SetTransactionID(req->transaction_id());
 
   // Tell the user the address that we received their request from.
   StunAddressAttribute* mapped_addr_attr;
@@ -630,19 +669,20 @@ TurnServer::Allocation::Allocation(TurnServer* server,
       thread_(thread),
       conn_(conn),
       external_socket_(socket),
-      key_(key) {
+      key_(key),
+      hmac_(key.data(), key.size()) {
   external_socket_->SignalReadPacket.connect(
       this, &TurnServer::Allocation::OnExternalPacket);
 }
 
 TurnServer::Allocation::~Allocation() {
-  for (ChannelList::iterator it = channels_.begin();
+  for (ChannelMap::iterator it = channels_.begin();
        it != channels_.end(); ++it) {
-    delete *it;
+    delete it->second;
   }
-  for (PermissionList::iterator it = perms_.begin();
+  for (PermissionMap::iterator it = perms_.begin();
        it != perms_.end(); ++it) {
-    delete *it;
+    delete it->second;
   }
   thread_->Clear(this, MSG_TIMEOUT);
   LOG_J(LS_INFO, this) << "Allocation destroyed";
@@ -663,9 +703,6 @@ void TurnServer::Allocation::HandleTurnMessage(const TurnMessage* msg) {
     case TURN_REFRESH_REQUEST:
       HandleRefreshRequest(msg);
       break;
-    case TURN_SEND_INDICATION:
-      HandleSendIndication(msg);
-      break;
     case TURN_CREATE_PERMISSION_REQUEST:
       HandleCreatePermissionRequest(msg);
       break;
@@ -732,23 +769,24 @@ void TurnServer::Allocation::HandleRefreshRequest(const TurnMessage* msg) {
   SendResponse(&response);
 }
 
-void TurnServer::Allocation::HandleSendIndication(const TurnMessage* msg) {
+void TurnServer::Allocation::HandleSendIndication(
+    const StunMessageView* msg) {
   // Check mandatory attributes.
-  const StunByteStringAttribute* data_attr = msg->GetByteString(STUN_ATTR_DATA);
-  const StunAddressAttribute* peer_attr =
-      msg->GetAddress(STUN_ATTR_XOR_PEER_ADDRESS);
-  if (!data_attr || !peer_attr) {
+  const char* data;
+  size_t size;
+  talk_base::SocketAddress peer;
+  if (!msg->GetByteString(STUN_ATTR_DATA, &data, &size) ||
+      !msg->GetXorAddress(STUN_ATTR_XOR_PEER_ADDRESS, &peer)) {
     LOG_J(LS_WARNING, this) << "Received invalid send indication";
     return;
   }
 
   // If a permission exists, send the data on to the peer.
-  if (HasPermission(peer_attr->GetAddress().ipaddr())) {
-    SendExternal(data_attr->bytes(), data_attr->length(),
-                 peer_attr->GetAddress());
+  if (HasPermission(peer.ipaddr())) {
+    SendExternal(data, size, peer);
   } else {
     LOG_J(LS_WARNING, this) << "Received send indication without permission"
-                            << "peer=" << peer_attr->GetAddress();
+                            << "peer=" << peer;
   }
 }
 
@@ -806,7 +844,12 @@ void TurnServer::Allocation::HandleChannelBindRequest(const TurnMessage* msg) {
     channel1 = new Channel(thread_, channel_id, peer_attr->GetAddress());
     channel1->SignalDestroyed.connect(this,
         &TurnServer::Allocation::OnChannelDestroyed);
-    channels_.push_back(channel1);
+    channels_[channel1->peer()] = channel1;
+    size_t index = channel_id - kMinChannelNumber;
+    if (index >= channels_by_id_.size()) {
+      channels_by_id_.resize(index + 1);
+    }
+    channels_by_id_[index] = channel1;
   } else {
     channel1->Refresh();
   }
@@ -887,7 +930,7 @@ void TurnServer::Allocation::AddPermission(const talk_base::IPAddress& addr) {
     perm = new Permission(thread_, addr);
     perm->SignalDestroyed.connect(
         this, &TurnServer::Allocation::OnPermissionDestroyed);
-    perms_.push_back(perm);
+    perms_[addr] = perm;
   } else {
     perm->Refresh();
   }
@@ -895,36 +938,26 @@ void TurnServer::Allocation::AddPermission(const talk_base::IPAddress& addr) {
 
 TurnServer::Permission* TurnServer::Allocation::FindPermission(
     const talk_base::IPAddress& addr) const {
-  for (PermissionList::const_iterator it = perms_.begin();
-       it != perms_.end(); ++it) {
-    if ((*it)->peer() == addr)
-      return *it;
-  }
-  return NULL;
+  PermissionMap::const_iterator it = perms_.find(addr);
+  return (it != perms_.end()) ? it->second : NULL;
 }
 
 TurnServer::Channel* TurnServer::Allocation::FindChannel(int channel_id) const {
-  for (ChannelList::const_iterator it = channels_.begin();
-       it != channels_.end(); ++it) {
-    if ((*it)->id() == channel_id)
-      return *it;
-  }
-  return NULL;
+  // Numbers that were never bound are past the end of the table or NULL.
+  size_t index = channel_id - kMinChannelNumber;
+  return (channel_id >= kMinChannelNumber && index < channels_by_id_.size()) ?
+      channels_by_id_[index] : NULL;
 }
 
 TurnServer::Channel* TurnServer::Allocation::FindChannel(
     const talk_base::SocketAddress& addr) const {
-  for (ChannelList::const_iterator it = channels_.begin();
-       it != channels_.end(); ++it) {
-    if ((*it)->peer() == addr)
-      return *it;
-  }
-  return NULL;
+  ChannelMap::const_iterator it = channels_.find(addr);
+  return (it != channels_.end()) ? it->second : NULL;
 }
 
 void TurnServer::Allocation::SendResponse(TurnMessage* msg) {
   // Success responses always have M-I.
-  msg->AddMessageIntegrity(key_);
+  msg->AddMessageIntegrity(hmac_);
   server_->SendStun(&conn_, msg);
 }
 
@@ -949,16 +982,18 @@ void TurnServer::Allocation::OnMessage(talk_base::Message* msg) {
 }
 
 void TurnServer::Allocation::OnPermissionDestroyed(Permission* perm) {
-  PermissionList::iterator it = std::find(perms_.begin(), perms_.end(), perm);
-  ASSERT(it != perms_.end());
+  PermissionMap::iterator it = perms_.find(perm->peer());
+  ASSERT(it != perms_.end() && it->second == perm);
   perms_.erase(it);
 }
 
 void TurnServer::Allocation::OnChannelDestroyed(Channel* channel) {
-  ChannelList::iterator it =
-      std::find(channels_.begin(), channels_.end(), channel);
-  ASSERT(it != channels_.end());
+  ChannelMap::iterator it = channels_.find(channel->peer());
+  ASSERT(it != channels_.end() && it->second == channel);
   channels_.erase(it);
+  size_t index = channel->id() - kMinChannelNumber;
+  ASSERT(index < channels_by_id_.size() && channels_by_id_[index] == channel);
+  channels_by_id_[index] = NULL;
 }
 
 TurnServer::Permission::Permission(talk_base::Thread* thread,
@@ -33,6 +33,7 @@
 #include <set>
 #include <string>
 
+#include "talk/base/messagedigest.h"
 #include "talk/base/messagequeue.h"
 #include "talk/base/sigslot.h"
 #include "talk/base/socketaddress.h"
@@ -48,6 +49,7 @@ class Thread;
 namespace cricket {
 
 class StunMessage;
+class StunMessageView;
 class TurnMessage;
 
 // The default server port for TURN, as specified in RFC5766.
@@ -85,6 +87,11 @@ class TurnServer : public sigslot::has_slots<> {
 
   void set_enable_otu_nonce(bool enable) { enable_otu_nonce_ = enable; }
 
+  // Gets/sets the secret used to sign nonces. Servers that share a key accept
+  // each other's nonces.
+  const std::string& nonce_key() const { return nonce_key_; }
+  void set_nonce_key(const std::string& key) { nonce_key_ = key; }
+
   // Starts listening for packets from internal clients.
   void AddInternalSocket(talk_base::AsyncPacketSocket* socket,
                          ProtocolType proto);
@@ -132,14 +139,17 @@ class TurnServer : public sigslot::has_slots<> {
   void OnInternalSocketClose(talk_base::AsyncPacketSocket* socket, int err);
 
   void HandleStunMessage(Connection* conn, const char* data, size_t size);
-  void HandleBindingRequest(Connection* conn, const StunMessage* msg);
+  void HandleBindingRequest(Connection* conn, const StunMessageView* msg);
   void HandleAllocateRequest(Connection* conn, const TurnMessage* msg,
                              const std::string& key);
 
-  bool GetKey(const StunMessage* msg, std::string* key);
-  bool CheckAuthorization(Connection* conn, const StunMessage* msg,
-                          const char* data, size_t size,
-                          const std::string& key);
+  bool GetKey(const StunMessageView* msg, std::string* key);
+  // Checks the credentials and nonce of a request against |hmac|, which is
+  // keyed with the user's key, or NULL if there is none. If they aren't
+  // valid, returns false along with the error to respond with.
+  bool CheckAuthorization(Connection* conn, const StunMessageView* msg,
+                          const talk_base::HmacContext* hmac,
+                          int* error_code, const char** reason);
   std::string GenerateNonce() const;
   bool ValidateNonce(const std::string& nonce) const;
 
@@ -32,6 +32,7 @@
 #include "talk/base/thread.h"
 #include "talk/base/stringencode.h"
 #include "talk/p2p/base/basicpacketsocketfactory.h"
+#include "talk/p2p/base/shardedturnserver.h"
 #include "talk/p2p/base/turnserver.h"
 
 static const char kSoftware[] = "libjingle TurnServer";
@@ -59,8 +60,8 @@ class TurnFileAuth : public cricket::TurnAuthInterface {
 };
 
 int main(int argc, char **argv) {
-  if (argc != 5) {
-    std::cerr << "usage: turnserver int-addr ext-ip realm auth-file"
+  if (argc != 5 && argc != 6) {
+    std::cerr << "usage: turnserver int-addr ext-ip realm auth-file [threads]"
               << std::endl;
     return 1;
   }
@@ -77,7 +78,35 @@ int main(int argc, char **argv) {
     return 1;
   }
 
+  int num_threads = 1;
+  if (argc == 6 && (!talk_base::FromString(argv[5], &num_threads) ||
+                    num_threads < 1)) {
+    std::cerr << "Invalid thread count: " << argv[5] << std::endl;
+    return 1;
+  }
+
   talk_base::Thread* main = talk_base::Thread::Current();
+  TurnFileAuth auth(argv[4]);
+  if (num_threads > 1) {
+    // Each thread gets its own socket bound to |int_addr|.
+    cricket::ShardedTurnServer server(num_threads);
+    server.set_realm(argv[3]);
+    server.set_software(kSoftware);
+    server.set_auth_hook(&auth);
+    if (!server.Start(int_addr, talk_base::SocketAddress(ext_addr, 0))) {
+      std::cerr << "Failed to start " << num_threads << " threads bound at "
+                << int_addr.ToString() << std::endl;
+      return 1;
+    }
+
+    std::cout << "Listening internally at "
+              << server.internal_address().ToString() << " on "
+              << num_threads << " threads" << std::endl;
+
+    main->Run();
+    return 0;
+  }
+
   talk_base::AsyncUDPSocket* int_socket =
       talk_base::AsyncUDPSocket::Create(main->socketserver(), int_addr);
   if (!int_socket) {
@@ -86,8 +115,8 @@ int main(int argc, char **argv) {
     return 1;
   }
 
+  main->EnableTimerWheel();
   cricket::TurnServer server(main);
-  TurnFileAuth auth(argv[4]);
   server.set_realm(argv[3]);
   server.set_software(kSoftware);
   server.set_auth_hook(&auth);
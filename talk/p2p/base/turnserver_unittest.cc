@@ -0,0 +1,233 @@
+/*
+ * libjingle
+ * Copyright 2013, Google Inc.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  1. Redistributions of source code must retain the above copyright notice,
+ *     this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice,
+ *     this list of conditions and the following disclaimer in the documentation
+ *     and/or other materials provided with the distribution.
+ *  3. The name of the author may not be used to endorse or promote products
+ *     derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <vector>
+
+#include "talk/base/asyncudpsocket.h"
+#include "talk/base/common.h"
+#include "talk/base/gunit.h"
+#include "talk/base/logging.h"
+#include "talk/base/physicalsocketserver.h"
+#include "talk/base/scoped_ptr.h"
+#include "talk/base/socketaddress.h"
+#include "talk/base/thread.h"
+#include "talk/base/timeutils.h"
+#include "talk/base/virtualsocketserver.h"
+#include "talk/p2p/base/testturnclient.h"
+#include "talk/p2p/base/testturnserver.h"
+
+using talk_base::SocketAddress;
+using cricket::TestTurnClient;
+using cricket::TestTurnServer;
+
+static const SocketAddress kClientAddr("11.11.11.11", 0);
+static const SocketAddress kTurnIntAddr("99.99.99.3",
+                                        cricket::TURN_SERVER_PORT);
+static const SocketAddress kTurnExtAddr("99.99.99.5", 0);
+static const int kChannel = 0x4000;
+static const int kTimeout = 1000;
+
+class TurnServerTest : public testing::Test,
+                       public sigslot::has_slots<> {
+ public:
+  TurnServerTest()
+      : pss_(new talk_base::PhysicalSocketServer),
+        ss_(new talk_base::VirtualSocketServer(pss_.get())),
+        ss_scope_(ss_.get()),
+        turn_server_(talk_base::Thread::Current(), kTurnIntAddr, kTurnExtAddr),
+        peer_packets_(0) {
+  }
+  ~TurnServerTest() {
+    DeletePeers();
+  }
+
+  TestTurnClient* CreateClient() {
+    TestTurnClient* client =
+        new TestTurnClient(ss_.get(), kClientAddr, kTurnIntAddr, "test");
+    EXPECT_EQ(0, client->Allocate());
+    return client;
+  }
+
+  // Creates |count| peers, each on its own IP address, so that every peer
+  // needs its own permission as well as its own channel.
+  void CreatePeers(int count) {
+    for (int i = 0; i < count; ++i) {
+      talk_base::IPAddress ip(0x0A000000 + i + 1);  // 10.0.0.1 and up.
+      talk_base::AsyncPacketSocket* peer = talk_base::AsyncUDPSocket::Create(
+          ss_.get(), SocketAddress(ip, 5000));
+      peer->SignalReadPacket.connect(this, &TurnServerTest::OnPeerPacket);
+      peers_.push_back(peer);
+      peer_counts_.push_back(0);
+    }
+  }
+
+  void DeletePeers() {
+    for (size_t i = 0; i < peers_.size(); ++i) {
+      delete peers_[i];
+    }
+    peers_.clear();
+    peer_counts_.clear();
+    peer_packets_ = 0;
+  }
+
+ protected:
+  void OnPeerPacket(talk_base::AsyncPacketSocket* socket, const char* data,
+                    size_t size, const SocketAddress& addr) {
+    for (size_t i = 0; i < peers_.size(); ++i) {
+      if (peers_[i] == socket) {
+        ++peer_counts_[i];
+      }
+    }
+    ++peer_packets_;
+  }
+
+  talk_base::scoped_ptr<talk_base::PhysicalSocketServer> pss_;
+  talk_base::scoped_ptr<talk_base::VirtualSocketServer> ss_;
+  talk_base::SocketServerScope ss_scope_;
+  TestTurnServer turn_server_;
+  std::vector<talk_base::AsyncPacketSocket*> peers_;
+  std::vector<int> peer_counts_;
+  int peer_packets_;
+};
+
+// Test that channel data goes to the peer bound to its channel number, and
+// that peer data comes back on the channel bound to the peer.
+TEST_F(TurnServerTest, TestChannelData) {
+  talk_base::scoped_ptr<TestTurnClient> client(CreateClient());
+  CreatePeers(3);
+  EXPECT_EQ(0, client->BindChannel(kChannel, peers_[0]->GetLocalAddress()));
+  EXPECT_EQ(0, client->BindChannel(kChannel + 1,
+                                   peers_[1]->GetLocalAddress()));
+  EXPECT_EQ(0, client->BindChannel(kChannel + 5,
+                                   peers_[2]->GetLocalAddress()));
+
+  client->SendChannelData(kChannel + 1, "a", 1);
+  client->SendChannelData(kChannel + 5, "b", 1);
+  client->SendChannelData(kChannel + 5, "c", 1);
+  // Channels that were never bound are dropped.
+  client->SendChannelData(kChannel + 2, "d", 1);
+  client->SendChannelData(kChannel + 100, "e", 1);
+  EXPECT_EQ_WAIT(3, peer_packets_, kTimeout);
+  EXPECT_EQ(0, peer_counts_[0]);
+  EXPECT_EQ(1, peer_counts_[1]);
+  EXPECT_EQ(2, peer_counts_[2]);
+
+  peers_[0]->SendTo("f", 1, client->relayed_address());
+  peers_[2]->SendTo("g", 1, client->relayed_address());
+  EXPECT_EQ_WAIT(2, client->channel_data_received(), kTimeout);
+}
+
+// Test that a channel number and a peer can't be bound to anything else, and
+// that rebinding the same pair refreshes it.
+TEST_F(TurnServerTest, TestChannelBindConflicts) {
+  talk_base::scoped_ptr<TestTurnClient> client(CreateClient());
+  CreatePeers(2);
+  EXPECT_EQ(0, client->BindChannel(kChannel, peers_[0]->GetLocalAddress()));
+  EXPECT_EQ(cricket::STUN_ERROR_BAD_REQUEST,
+            client->BindChannel(kChannel, peers_[1]->GetLocalAddress()));
+  EXPECT_EQ(cricket::STUN_ERROR_BAD_REQUEST,
+            client->BindChannel(kChannel + 1, peers_[0]->GetLocalAddress()));
+  EXPECT_EQ(cricket::STUN_ERROR_BAD_REQUEST,
+            client->BindChannel(0x3FFF, peers_[1]->GetLocalAddress()));
+  EXPECT_EQ(0, client->BindChannel(kChannel, peers_[0]->GetLocalAddress()));
+  EXPECT_EQ(0, client->BindChannel(kChannel + 1,
+                                   peers_[1]->GetLocalAddress()));
+
+  client->SendChannelData(kChannel + 1, "a", 1);
+  EXPECT_EQ_WAIT(1, peer_counts_[1], kTimeout);
+}
+
+// Test that send indications reach peers with a permission, and only those.
+TEST_F(TurnServerTest, TestSendIndication) {
+  talk_base::scoped_ptr<TestTurnClient> client(CreateClient());
+  CreatePeers(2);
+  EXPECT_EQ(0, client->CreatePermission(peers_[0]->GetLocalAddress()));
+
+  client->SendIndication(peers_[0]->GetLocalAddress(), "a", 1);
+  client->SendIndication(peers_[1]->GetLocalAddress(), "b", 1);
+  client->SendIndication(peers_[0]->GetLocalAddress(), "c", 1);
+  EXPECT_EQ_WAIT(2, peer_packets_, kTimeout);
+  EXPECT_EQ(2, peer_counts_[0]);
+  EXPECT_EQ(0, peer_counts_[1]);
+}
+
+// Reports the cost of relaying a packet in each direction for an allocation
+// with 1 to 500 peers, each with its own channel and permission. Messages
+// are pumped without WAIT, which sleeps a millisecond at a time.
+TEST_F(TurnServerTest, DISABLED_RelayForwardingBenchmark) {
+  const int kPeerCounts[] = { 1, 10, 100, 250, 500 };
+  const int kPackets = 20000;
+  const int kBurst = 100;
+  char payload[100] = { 0 };
+
+  for (int n = 0; n < ARRAY_SIZE(kPeerCounts); ++n) {
+    int num_peers = kPeerCounts[n];
+    talk_base::scoped_ptr<TestTurnClient> client(CreateClient());
+    CreatePeers(num_peers);
+    for (int i = 0; i < num_peers; ++i) {
+      ASSERT_EQ(0, client->BindChannel(kChannel + i,
+                                       peers_[i]->GetLocalAddress()));
+    }
+
+    // Client to peers, looked up by channel number.
+    uint32 start = talk_base::Time();
+    for (int i = 0; i < kPackets; i += kBurst) {
+      for (int j = i; j < i + kBurst; ++j) {
+        client->SendChannelData(kChannel + j % num_peers, payload,
+                                sizeof(payload));
+      }
+      for (uint32 t = talk_base::Time(); peer_packets_ < i + kBurst &&
+           talk_base::TimeSince(t) < kTimeout;) {
+        talk_base::Thread::Current()->ProcessMessages(0);
+      }
+      ASSERT_EQ(i + kBurst, peer_packets_);
+    }
+    uint32 to_peers = talk_base::TimeSince(start);
+
+    // Peers to client, looked up by peer address.
+    start = talk_base::Time();
+    for (int i = 0; i < kPackets; i += kBurst) {
+      for (int j = i; j < i + kBurst; ++j) {
+        peers_[j % num_peers]->SendTo(payload, sizeof(payload),
+                                      client->relayed_address());
+      }
+      for (uint32 t = talk_base::Time();
+           client->channel_data_received() < i + kBurst &&
+           talk_base::TimeSince(t) < kTimeout;) {
+        talk_base::Thread::Current()->ProcessMessages(0);
+      }
+      ASSERT_EQ(i + kBurst, client->channel_data_received());
+    }
+    uint32 to_client = talk_base::TimeSince(start);
+
+    LOG(LS_INFO) << num_peers << " peers: "
+                 << to_peers * 1000000LL / kPackets << " ns/packet to peers, "
+                 << to_client * 1000000LL / kPackets << " ns/packet to client";
+    DeletePeers();
+  }
+}
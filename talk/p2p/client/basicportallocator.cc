@@ -34,6 +34,7 @@
 #include "talk/base/helpers.h"
 #include "talk/base/host.h"
 #include "talk/base/logging.h"
+#include "talk/base/timeutils.h"
 #include "talk/p2p/base/basicpacketsocketfactory.h"
 #include "talk/p2p/base/common.h"
 #include "talk/p2p/base/port.h"
@@ -245,7 +246,10 @@ BasicPortAllocatorSession::BasicPortAllocatorSession(
       allocation_started_(false),
       network_manager_started_(false),
       running_(false),
-      allocation_sequences_created_(false) {
+      allocation_sequences_created_(false),
+      start_time_(0),
+      time_to_first_candidate_(-1),
+      time_to_all_candidates_(-1) {
   allocator_->network_manager()->SignalNetworksChanged.connect(
       this, &BasicPortAllocatorSession::OnNetworksChanged);
   allocator_->network_manager()->StartUpdating();
@@ -276,6 +280,7 @@ void BasicPortAllocatorSession::StartGettingPorts() {
   }
 
   running_ = true;
+  start_time_ = talk_base::Time();
   network_thread_->Post(this, MSG_CONFIG_START);
 
   if (flags() & PORTALLOCATOR_ENABLE_SHAKER)
@@ -543,7 +548,7 @@ void BasicPortAllocatorSession::OnCandidateReady(
   }
 
   if (!candidates.empty()) {
-    SignalCandidatesReady(this, candidates);
+    DeliverCandidates(candidates);
   }
 
   // Moving to READY state as we have atleast one candidate from the port.
@@ -605,7 +610,7 @@ void BasicPortAllocatorSession::OnProtocolEnabled(AllocationSequence* seq,
   }
 
   if (!candidates.empty()) {
-    SignalCandidatesReady(this, candidates);
+    DeliverCandidates(candidates);
   }
 }
 
@@ -636,11 +641,25 @@ void BasicPortAllocatorSession::MaybeSignalCandidatesAllocationDone() {
     if (!it->complete())
       return;
   }
+  if (time_to_all_candidates_ < 0)
+    time_to_all_candidates_ = talk_base::TimeSince(start_time_);
   LOG(LS_INFO) << "All candidates gathered for " << content_name_ << ":"
-               << component_ << ":" << generation();
+               << component_ << ":" << generation() << " in "
+               << time_to_all_candidates_ << " ms";
   SignalCandidatesAllocationDone(this);
 }
 
+void BasicPortAllocatorSession::DeliverCandidates(
+    const std::vector<Candidate>& candidates) {
+  if (time_to_first_candidate_ < 0) {
+    time_to_first_candidate_ = talk_base::TimeSince(start_time_);
+    LOG(LS_INFO) << "First candidate gathered for " << content_name_ << ":"
+                 << component_ << ":" << generation() << " in "
+                 << time_to_first_candidate_ << " ms";
+  }
+  SignalCandidatesReady(this, candidates);
+}
+
 void BasicPortAllocatorSession::OnPortDestroyed(
     PortInterface* port) {
   ASSERT(talk_base::Thread::Current() == network_thread_);
@@ -790,6 +809,22 @@ void AllocationSequence::OnMessage(talk_base::Message* msg) {
     "Udp", "Relay", "Tcp", "SslTcp"
   };
 
+  if (IsFlagSet(PORTALLOCATOR_ENABLE_PARALLEL_GATHERING)) {
+    // Start every phase now rather than one per step delay, so that e.g. a
+    // relay-only path doesn't have to wait for the UDP phase to time out.
+    LOG_J(LS_INFO, network_) << "Allocation Phase=All";
+    CreateUDPPorts();
+    CreateStunPorts();
+    CreateRelayPorts();
+    CreateTCPPorts();
+    EnableProtocol(PROTO_UDP);
+    EnableProtocol(PROTO_TCP);
+    EnableProtocol(PROTO_SSLTCP);
+    state_ = kCompleted;
+    SignalPortAllocationComplete(this);
+    return;
+  }
+
   // Perform all of the phases in the current step.
   LOG_J(LS_INFO, network_) << "Allocation Phase="
                            << PHASE_NAMES[phase_];
@@ -1008,15 +1043,32 @@ void AllocationSequence::CreateTurnPort(const RelayServerConfig& config) {
   PortList::const_iterator relay_port;
   for (relay_port = config.ports.begin();
        relay_port != config.ports.end(); ++relay_port) {
-    TurnPort* port = TurnPort::Create(session_->network_thread(),
-                                      session_->socket_factory(),
-                                      network_, ip_,
-                                      session_->allocator()->min_port(),
-                                      session_->allocator()->max_port(),
-                                      session_->username(),
-                                      session_->password(),
-                                      *relay_port, config.credentials);
+    TurnPort* port = NULL;
+    bool shared = IsFlagSet(PORTALLOCATOR_ENABLE_PARALLEL_GATHERING) &&
+        udp_socket_ && relay_port->proto == PROTO_UDP;
+    if (shared) {
+      port = TurnPort::Create(session_->network_thread(), network_,
+                              udp_socket_.get(),
+                              session_->username(), session_->password(),
+                              *relay_port, config.credentials);
+    } else {
+      port = TurnPort::Create(session_->network_thread(),
+                              session_->socket_factory(),
+                              network_, ip_,
+                              session_->allocator()->min_port(),
+                              session_->allocator()->max_port(),
+                              session_->username(),
+                              session_->password(),
+                              *relay_port, config.credentials);
+    }
     if (port) {
+      if (shared) {
+        // The UDPPort accepts every packet, so TURN ports must be offered
+        // theirs first.
+        ports.push_front(port);
+        port->SignalDestroyed.connect(
+            this, &AllocationSequence::OnPortDestroyed);
+      }
       session_->AddAllocatedPort(port, this, true);
     }
   }
@@ -1028,8 +1080,8 @@ void AllocationSequence::OnReadPacket(
   ASSERT(socket == udp_socket_.get());
   for (std::deque<Port*>::iterator iter = ports.begin();
        iter != ports.end(); ++iter) {
-    // We have only one port in the queue.
-    // TODO(mallinath) - Add shared socket support to Relay and Turn ports.
+    // TURN ports claim packets from their server, the UDPPort takes the rest.
+    // TODO(mallinath) - Add shared socket support to Relay ports.
     if ((*iter)->HandleIncomingPacket(socket, data, size, remote_addr)) {
       break;
     }
@@ -137,6 +137,11 @@ class BasicPortAllocatorSession : public PortAllocatorSession,
   virtual void StopGettingPorts();
   virtual bool IsGettingPorts() { return running_; }
 
+  // Milliseconds from StartGettingPorts to the first candidate being signaled
+  // and to SignalCandidatesAllocationDone, or -1 if that hasn't happened yet.
+  int time_to_first_candidate() const { return time_to_first_candidate_; }
+  int time_to_all_candidates() const { return time_to_all_candidates_; }
+
  protected:
   // Starts the process of getting the port configurations.
   virtual void GetPortConfigurations();
@@ -205,6 +210,7 @@ class BasicPortAllocatorSession : public PortAllocatorSession,
   void OnShake();
   void MaybeSignalCandidatesAllocationDone();
   void OnPortAllocationComplete(AllocationSequence* seq);
+  void DeliverCandidates(const std::vector<Candidate>& candidates);
   PortData* FindPort(Port* port);
 
   BasicPortAllocator* allocator_;
@@ -216,6 +222,9 @@ class BasicPortAllocatorSession : public PortAllocatorSession,
   bool network_manager_started_;
   bool running_;  // set when StartGetAllPorts is called
   bool allocation_sequences_created_;
+  uint32 start_time_;
+  int time_to_first_candidate_;
+  int time_to_all_candidates_;
   std::vector<PortConfiguration*> configs_;
   std::vector<AllocationSequence*> sequences_;
   std::vector<PortData> ports_;
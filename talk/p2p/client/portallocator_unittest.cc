@@ -43,6 +43,7 @@
 #include "talk/p2p/base/portallocatorsessionproxy.h"
 #include "talk/p2p/base/testrelayserver.h"
 #include "talk/p2p/base/teststunserver.h"
+#include "talk/p2p/base/testturnserver.h"
 #include "talk/p2p/client/basicportallocator.h"
 #include "talk/p2p/client/httpportallocator.h"
 
@@ -59,6 +60,9 @@ static const SocketAddress kRelayTcpIntAddr("99.99.99.2", 5002);
 static const SocketAddress kRelayTcpExtAddr("99.99.99.3", 5003);
 static const SocketAddress kRelaySslTcpIntAddr("99.99.99.2", 5004);
 static const SocketAddress kRelaySslTcpExtAddr("99.99.99.3", 5005);
+static const SocketAddress kTurnUdpIntAddr("99.99.99.4",
+                                           cricket::TURN_SERVER_PORT);
+static const SocketAddress kTurnUdpExtAddr("99.99.99.5", 0);
 
 // Minimum and maximum port for port range tests.
 static const int kMinPort = 10000;
@@ -71,6 +75,9 @@ static const char kIcePwd0[] = "TESTICEPWD00000000000000";
 
 static const char kContentName[] = "test content";
 
+static const char kTurnUsername[] = "test";
+static const char kTurnPassword[] = "test";
+
 static const int kDefaultAllocationTimeout = 1000;
 
 namespace cricket {
@@ -740,6 +747,70 @@ TEST_F(PortAllocatorTest, TestEnableSharedSocketNoUdpAllowed) {
   EXPECT_EQ(1U, candidates_.size());
 }
 
+// Test that with PORTALLOCATOR_ENABLE_PARALLEL_GATHERING all phases start at
+// once, so every candidate shows up well within a single step delay.
+TEST_F(PortAllocatorTest, TestParallelGathering) {
+  AddInterface(kClientAddr);
+  allocator_->set_step_delay(cricket::kDefaultStepDelay);
+  allocator_->set_flags(allocator().flags() |
+                        cricket::PORTALLOCATOR_ENABLE_PARALLEL_GATHERING);
+  EXPECT_TRUE(CreateSession(cricket::ICE_CANDIDATE_COMPONENT_RTP));
+  cricket::BasicPortAllocatorSession* session =
+      static_cast<cricket::BasicPortAllocatorSession*>(session_.get());
+  EXPECT_EQ(-1, session->time_to_first_candidate());
+  EXPECT_EQ(-1, session->time_to_all_candidates());
+  session_->StartGettingPorts();
+  ASSERT_EQ_WAIT(7U, candidates_.size(), kDefaultAllocationTimeout);
+  EXPECT_EQ(4U, ports_.size());
+  EXPECT_TRUE_WAIT(candidate_allocation_done_, kDefaultAllocationTimeout);
+  EXPECT_LE(0, session->time_to_first_candidate());
+  EXPECT_LE(session->time_to_first_candidate(),
+            session->time_to_all_candidates());
+  EXPECT_GT(static_cast<int>(cricket::kDefaultStepDelay),
+            session->time_to_all_candidates());
+}
+
+// Test that with PORTALLOCATOR_ENABLE_PARALLEL_GATHERING and
+// PORTALLOCATOR_ENABLE_SHARED_SOCKET, the host, STUN and TURN candidates of a
+// network all come from the same socket.
+TEST_F(PortAllocatorTest, TestParallelGatheringWithSharedSocketAndTurn) {
+  cricket::TestTurnServer turn_server(Thread::Current(), kTurnUdpIntAddr,
+                                      kTurnUdpExtAddr);
+  AddInterface(kClientAddr);
+  talk_base::scoped_ptr<talk_base::NATServer> nat_server(
+      CreateNatServer(kNatAddr, talk_base::NAT_OPEN_CONE));
+  allocator_.reset(new cricket::BasicPortAllocator(
+      &network_manager_, &nat_socket_factory_, kStunAddr));
+  cricket::RelayServerConfig relay_server(cricket::RELAY_TURN);
+  relay_server.credentials = cricket::RelayCredentials(kTurnUsername,
+                                                       kTurnPassword);
+  relay_server.ports.push_back(cricket::ProtocolAddress(
+      kTurnUdpIntAddr, cricket::PROTO_UDP));
+  allocator_->AddRelay(relay_server);
+  allocator_->set_step_delay(cricket::kMinimumStepDelay);
+  allocator_->set_flags(allocator().flags() |
+                        cricket::PORTALLOCATOR_DISABLE_TCP |
+                        cricket::PORTALLOCATOR_ENABLE_SHARED_UFRAG |
+                        cricket::PORTALLOCATOR_ENABLE_SHARED_SOCKET |
+                        cricket::PORTALLOCATOR_ENABLE_PARALLEL_GATHERING);
+  EXPECT_TRUE(CreateSession(cricket::ICE_CANDIDATE_COMPONENT_RTP));
+  session_->StartGettingPorts();
+  ASSERT_EQ_WAIT(3U, candidates_.size(), kDefaultAllocationTimeout);
+  ASSERT_EQ(2U, ports_.size());
+  EXPECT_PRED5(CheckCandidate, candidates_[0],
+      cricket::ICE_CANDIDATE_COMPONENT_RTP, "local", "udp", kClientAddr);
+  EXPECT_PRED5(CheckCandidate, candidates_[1],
+      cricket::ICE_CANDIDATE_COMPONENT_RTP, "stun", "udp",
+      talk_base::SocketAddress(kNatAddr.ipaddr(), 0));
+  EXPECT_PRED5(CheckCandidate, candidates_[2],
+      cricket::ICE_CANDIDATE_COMPONENT_RTP, "relay", "udp",
+      talk_base::SocketAddress(kTurnUdpExtAddr.ipaddr(), 0));
+  // The TURN server saw the same mapped address as the STUN server.
+  EXPECT_EQ(candidates_[1].address(), candidates_[2].related_address());
+  EXPECT_TRUE_WAIT(candidate_allocation_done_, kDefaultAllocationTimeout);
+  EXPECT_EQ(3U, candidates_.size());
+}
+
 // Test that the httpportallocator correctly maintains its lists of stun and
 // relay servers, by never allowing an empty list.
 TEST(HttpPortAllocatorTest, TestHttpPortAllocatorHostLists) {
@@ -31,6 +31,7 @@
 #include "talk/base/byteorder.h"
 #include "talk/base/common.h"
 #include "talk/base/logging.h"
+#include "talk/base/timeutils.h"
 #include "talk/media/base/rtputils.h"
 #include "talk/p2p/base/transportchannel.h"
 #include "talk/session/media/channelmanager.h"
@@ -63,8 +64,7 @@ enum {
   MSG_SENDINTRAFRAME,
   MSG_REQUESTINTRAFRAME,
   MSG_SCREENCASTWINDOWEVENT,
-  MSG_RTPPACKET,
-  MSG_RTCPPACKET,
+  MSG_SENDQUEUEDPACKETS,
   MSG_CHANNEL_ERROR,
   MSG_SETCHANNELOPTIONS,
   MSG_SCALEVOLUME,
@@ -185,9 +185,13 @@ struct VideoStatsMessageData : public talk_base::MessageData {
   VideoMediaInfo* stats;
 };
 
-struct PacketMessageData : public talk_base::MessageData {
-  talk_base::Buffer packet;
-};
+// The number of packet buffers each channel keeps around for reuse. This covers
+// the bursts of a keyframe without holding on to much memory when idle.
+static const size_t kPacketPoolSize = 128;
+
+// The number of packets other threads can have waiting for the worker
+// thread before SendPacket starts dropping them. Must be a power of two.
+static const int kSendQueueSize = 256;
 
 struct AudioRenderMessageData: public talk_base::MessageData {
   AudioRenderMessageData(uint32 s, AudioRenderer* r)
@@ -379,7 +383,9 @@ BaseChannel::BaseChannel(talk_base::Thread* thread,
                          MediaEngineInterface* media_engine,
                          MediaChannel* media_channel, BaseSession* session,
                          const std::string& content_name, bool rtcp)
-    : worker_thread_(thread),
+    : send_queue_(kSendQueueSize),
+      send_queue_wakeup_pending_(0),
+      worker_thread_(thread),
       media_engine_(media_engine),
       session_(session),
       media_channel_(media_channel),
@@ -387,6 +393,8 @@ BaseChannel::BaseChannel(talk_base::Thread* thread,
       rtcp_(rtcp),
       transport_channel_(NULL),
       rtcp_transport_channel_(NULL),
+      packet_pool_(new talk_base::RefCountedObject<talk_base::BufferPool>(
+          kMaxRtpPacketLen, kPacketPoolSize)),
       enabled_(false),
       writable_(false),
       rtp_ready_to_send_(false),
@@ -584,7 +592,7 @@ void BaseChannel::OnChannelRead(TransportChannel* channel,
   // When using RTCP multiplexing we might get RTCP packets on the RTP
   // transport. We feed RTP traffic into the demuxer to determine if it is RTCP.
   bool rtcp = PacketIsRtcp(channel, data, len);
-  talk_base::Buffer packet(data, len);
+  talk_base::Buffer packet(packet_pool_.get(), data, len, len);
   HandlePacket(rtcp, &packet);
 }
 
@@ -632,12 +640,30 @@ bool BaseChannel::SendPacket(bool rtcp, talk_base::Buffer* packet) {
   // SRTP and the inner workings of the transport channels.
   // The only downside is that we can't return a proper failure code if
   // needed. Since UDP is unreliable anyway, this should be a non-issue.
+  // Packets go through send_queue_ rather than one message each, so a burst
+  // costs the worker a single wakeup.
   if (talk_base::Thread::Current() != worker_thread_) {
-    // Avoid a copy by transferring the ownership of the packet data.
-    int message_id = (!rtcp) ? MSG_RTPPACKET : MSG_RTCPPACKET;
-    PacketMessageData* data = new PacketMessageData;
-    packet->TransferTo(&data->packet);
-    worker_thread_->Post(this, message_id, data);
+    {
+      talk_base::CritScope cs(&send_queue_cs_);
+      QueuedPacket* queued = send_queue_.Back();
+      if (!queued) {
+        ++send_queue_stats_.dropped_packets;
+        return false;
+      }
+      // Avoid a copy by transferring the ownership of the packet data.
+      packet->TransferTo(&queued->packet);
+      queued->rtcp = rtcp;
+      queued->queued_ns = talk_base::TimeNanos();
+      send_queue_.Push();
+      ++send_queue_stats_.queued_packets;
+      send_queue_stats_.max_depth = talk_base::_max(
+          send_queue_stats_.max_depth, static_cast<int>(send_queue_.Size()));
+    }
+    // Only wake the worker if it isn't already due to drain the queue.
+    if (talk_base::AtomicOps::CompareAndSwap(
+            &send_queue_wakeup_pending_, 0, 1) == 0) {
+      Post(MSG_SENDQUEUEDPACKETS);
+    }
     return true;
   }
 
@@ -1359,13 +1385,9 @@ void BaseChannel::OnMessage(talk_base::Message *pmsg) {
       break;
     }
 
-    case MSG_RTPPACKET:
-    case MSG_RTCPPACKET: {
-      PacketMessageData* data = static_cast<PacketMessageData*>(pmsg->pdata);
-      SendPacket(pmsg->message_id == MSG_RTCPPACKET, &data->packet);
-      delete data;  // because it is Posted
+    case MSG_SENDQUEUEDPACKETS:
+      SendQueuedPackets_w();
       break;
-    }
     case MSG_FIRSTPACKETRECEIVED: {
       SignalFirstPacketReceived(this);
       break;
@@ -1397,17 +1419,54 @@ void BaseChannel::Clear(uint32 id, talk_base::MessageList* removed) {
 }
 
 void BaseChannel::FlushRtcpMessages() {
-  // Flush all remaining RTCP messages. This should only be called in
-  // destructor.
+  // Flush all remaining RTCP packets and drop the RTP ones. This should only
+  // be called in destructor.
   ASSERT(talk_base::Thread::Current() == worker_thread_);
-  talk_base::MessageList rtcp_messages;
-  Clear(MSG_RTCPPACKET, &rtcp_messages);
-  for (talk_base::MessageList::iterator it = rtcp_messages.begin();
-       it != rtcp_messages.end(); ++it) {
-    Send(MSG_RTCPPACKET, it->pdata);
+  talk_base::Buffer packet;
+  while (QueuedPacket* queued = send_queue_.Front()) {
+    bool rtcp = queued->rtcp;
+    queued->packet.TransferTo(&packet);
+    send_queue_.Pop();
+    if (rtcp) {
+      SendPacket(true, &packet);
+    }
   }
 }
 
+void BaseChannel::SendQueuedPackets_w() {
+  ASSERT(talk_base::Thread::Current() == worker_thread_);
+  // Clear the flag before looking at the queue, so that a packet queued from
+  // here on posts a new wakeup instead of being left behind. This has to be
+  // a full barrier, hence the CAS rather than a plain store.
+  talk_base::AtomicOps::CompareAndSwap(&send_queue_wakeup_pending_, 1, 0);
+
+  int64 total_latency_us = 0;
+  int max_latency_us = 0;
+  talk_base::Buffer packet;
+  while (QueuedPacket* queued = send_queue_.Front()) {
+    bool rtcp = queued->rtcp;
+    int latency_us = static_cast<int>(
+        (talk_base::TimeNanos() - queued->queued_ns) /
+        talk_base::kNumNanosecsPerMicrosec);
+    queued->packet.TransferTo(&packet);
+    send_queue_.Pop();
+    total_latency_us += latency_us;
+    max_latency_us = talk_base::_max(max_latency_us, latency_us);
+    SendPacket(rtcp, &packet);
+  }
+
+  talk_base::CritScope cs(&send_queue_cs_);
+  ++send_queue_stats_.wakeups;
+  send_queue_stats_.total_latency_us += total_latency_us;
+  send_queue_stats_.max_latency_us = talk_base::_max(
+      send_queue_stats_.max_latency_us, max_latency_us);
+}
+
+void BaseChannel::GetSendQueueStats(SendQueueStats* stats) {
+  talk_base::CritScope cs(&send_queue_cs_);
+  *stats = send_queue_stats_;
+}
+
 VoiceChannel::VoiceChannel(talk_base::Thread* thread,
                            MediaEngineInterface* media_engine,
                            VoiceMediaChannel* media_channel,
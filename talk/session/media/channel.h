@@ -34,7 +34,9 @@
 #include "talk/base/asyncudpsocket.h"
 #include "talk/base/criticalsection.h"
 #include "talk/base/network.h"
+#include "talk/base/scoped_ref_ptr.h"
 #include "talk/base/sigslot.h"
+#include "talk/base/spscqueue.h"
 #include "talk/base/window.h"
 #include "talk/media/base/mediachannel.h"
 #include "talk/media/base/mediaengine.h"
@@ -63,6 +65,24 @@ enum SinkType {
   SINK_POST_CRYPTO  // Sink packets after encryption or before decryption.
 };
 
+// Counters for the queue that carries packets sent from threads other than
+// the worker thread over to the worker. Latencies are measured from the
+// SendPacket call to the point where the worker picks the packet up.
+struct SendQueueStats {
+  SendQueueStats()
+      : queued_packets(0), dropped_packets(0), wakeups(0), max_depth(0),
+        total_latency_us(0), max_latency_us(0) {}
+  int64 queued_packets;
+  // Packets dropped because the queue was full.
+  int64 dropped_packets;
+  // The number of times the worker was woken to drain the queue; with
+  // queued_packets this gives the average batch size.
+  int64 wakeups;
+  int max_depth;
+  int64 total_latency_us;
+  int max_latency_us;
+};
+
 // BaseChannel contains logic common to voice and video, including
 // enable/mute, marshaling calls to a worker thread, and
 // connection and media monitors.
@@ -223,6 +243,9 @@ class BaseChannel
   // Made public for easier testing.
   void SetReadyToSend(TransportChannel* channel, bool ready);
 
+  // Can be called from any thread.
+  void GetSendQueueStats(SendQueueStats* stats);
+
  protected:
   MediaEngineInterface* media_engine() const { return media_engine_; }
   virtual MediaChannel* media_channel() const { return media_channel_; }
@@ -247,11 +270,13 @@ class BaseChannel
   void Clear(uint32 id = talk_base::MQID_ANY,
              talk_base::MessageList* removed = NULL);
   void FlushRtcpMessages();
+  void SendQueuedPackets_w();
 
   // NetworkInterface implementation, called by MediaEngine
   virtual bool SendPacket(talk_base::Buffer* packet);
   virtual bool SendRtcp(talk_base::Buffer* packet);
   virtual int SetOption(SocketType type, talk_base::Socket::Option o, int val);
+  virtual talk_base::BufferPool* packet_pool() { return packet_pool_.get(); }
 
   // From TransportChannel
   void OnWritableState(TransportChannel* channel);
@@ -325,6 +350,23 @@ class BaseChannel
   talk_base::CriticalSection signal_send_packet_cs_;
   talk_base::CriticalSection signal_recv_packet_cs_;
 
+  // A packet handed to the worker thread by SendPacket.
+  struct QueuedPacket {
+    QueuedPacket() : rtcp(false), queued_ns(0) {}
+    talk_base::Buffer packet;
+    bool rtcp;
+    uint64 queued_ns;
+  };
+  // Packets sent from other threads wait here for the worker thread, which
+  // is woken once for however many have queued up in the meantime. The RTP
+  // and RTCP senders may be different threads, so producers serialize on
+  // send_queue_cs_; the worker never takes it per packet.
+  talk_base::FixedSizeSpscQueue<QueuedPacket> send_queue_;
+  talk_base::CriticalSection send_queue_cs_;
+  // Set while a wakeup is posted and the worker hasn't started draining.
+  volatile int send_queue_wakeup_pending_;
+  SendQueueStats send_queue_stats_;  // Guarded by send_queue_cs_.
+
   talk_base::Thread* worker_thread_;
   MediaEngineInterface* media_engine_;
   BaseSession* session_;
@@ -340,6 +382,8 @@ class BaseChannel
   RtcpMuxFilter rtcp_mux_filter_;
   SsrcMuxFilter ssrc_filter_;
   talk_base::scoped_ptr<SocketMonitor> socket_monitor_;
+  // Storage for packets on both the send and receive paths.
+  talk_base::scoped_refptr<talk_base::BufferPool> packet_pool_;
   bool enabled_;
   bool writable_;
   bool rtp_ready_to_send_;
@@ -1371,6 +1371,31 @@ class ChannelTest : public testing::Test, public sigslot::has_slots<> {
     EXPECT_TRUE(CheckNoRtcp2());
   }
 
+  // Test that packets sent from other threads are counted as they pass
+  // through the channel's send queue.
+  void SendQueueStatsOnThread() {
+    bool sent_rtp1, sent_rtcp1;
+    CreateChannels(RTCP, RTCP);
+    EXPECT_TRUE(SendInitiate());
+    EXPECT_TRUE(SendAccept());
+    cricket::SendQueueStats stats;
+    channel1_->GetSendQueueStats(&stats);
+    EXPECT_EQ(0, stats.queued_packets);
+    CallOnThreadAndWaitForDone(&ChannelTest<T>::SendRtp1, &sent_rtp1);
+    CallOnThreadAndWaitForDone(&ChannelTest<T>::SendRtcp1, &sent_rtcp1);
+    EXPECT_TRUE(sent_rtp1);
+    EXPECT_TRUE(sent_rtcp1);
+    EXPECT_TRUE_WAIT(CheckRtp2(), 1000);
+    EXPECT_TRUE_WAIT(CheckRtcp2(), 1000);
+    channel1_->GetSendQueueStats(&stats);
+    EXPECT_EQ(2, stats.queued_packets);
+    EXPECT_EQ(0, stats.dropped_packets);
+    EXPECT_GE(stats.wakeups, 1);
+    EXPECT_LE(stats.wakeups, 2);
+    EXPECT_GE(stats.max_depth, 1);
+    EXPECT_GE(stats.total_latency_us, stats.max_latency_us);
+  }
+
   // Test that the mediachannel retains its sending state after the transport
   // becomes non-writable.
   void SendWithWritabilityLoss() {
@@ -2162,6 +2187,10 @@ TEST_F(VoiceChannelTest, SendSrtpToSrtpOnThread) {
   Base::SendSrtpToSrtpOnThread();
 }
 
+TEST_F(VoiceChannelTest, SendQueueStatsOnThread) {
+  Base::SendQueueStatsOnThread();
+}
+
 TEST_F(VoiceChannelTest, SendWithWritabilityLoss) {
   Base::SendWithWritabilityLoss();
 }
@@ -2571,6 +2600,10 @@ TEST_F(VideoChannelTest, SendSrtpToSrtpOnThread) {
   Base::SendSrtpToSrtpOnThread();
 }
 
+TEST_F(VideoChannelTest, SendQueueStatsOnThread) {
+  Base::SendQueueStatsOnThread();
+}
+
 TEST_F(VideoChannelTest, SendWithWritabilityLoss) {
   Base::SendWithWritabilityLoss();
 }
@@ -69,6 +69,12 @@ const int SRTP_MASTER_KEY_BASE64_LEN = SRTP_MASTER_KEY_LEN * 4 / 3;
 const int SRTP_MASTER_KEY_KEY_LEN = 16;
 const int SRTP_MASTER_KEY_SALT_LEN = 14;
 
+static void MarkFailed(std::vector<SrtpFilter::Packet>* packets) {
+  for (size_t i = 0; i < packets->size(); ++i) {
+    (*packets)[i].ok = false;
+  }
+}
+
 #ifndef HAVE_SRTP
 
 // This helper function is used on systems that don't (yet) have SRTP,
@@ -231,6 +237,24 @@ bool SrtpFilter::UnprotectRtcp(void* p, int in_len, int* out_len) {
   }
 }
 
+bool SrtpFilter::ProtectRtpBatch(std::vector<Packet>* packets) {
+  if (!IsActive()) {
+    LOG(LS_WARNING) << "Failed to ProtectRtpBatch: SRTP not active";
+    MarkFailed(packets);
+    return false;
+  }
+  return send_session_->ProtectRtpBatch(packets);
+}
+
+bool SrtpFilter::UnprotectRtpBatch(std::vector<Packet>* packets) {
+  if (!IsActive()) {
+    LOG(LS_WARNING) << "Failed to UnprotectRtpBatch: SRTP not active";
+    MarkFailed(packets);
+    return false;
+  }
+  return recv_session_->UnprotectRtpBatch(packets);
+}
+
 void SrtpFilter::set_signal_silent_time(uint32 signal_silent_time_in_ms) {
   signal_silent_time_in_ms_ = signal_silent_time_in_ms;
   if (state_ == ST_ACTIVE) {
@@ -545,6 +569,90 @@ bool SrtpSession::UnprotectRtcp(void* p, int in_len, int* out_len) {
   return true;
 }
 
+// The batch calls only report failures to |srtp_stat_|, since it ignores
+// successes, and log one summary line per batch rather than one per packet.
+bool SrtpSession::ProtectRtpBatch(std::vector<SrtpFilter::Packet>* packets) {
+  if (!session_) {
+    LOG(LS_WARNING) << "Failed to protect SRTP packets: no SRTP Session";
+    MarkFailed(packets);
+    return false;
+  }
+
+  int failures = 0;
+  int last_err = err_status_ok;
+  const SrtpFilter::Packet* last_protected = NULL;
+  for (size_t i = 0; i < packets->size(); ++i) {
+    SrtpFilter::Packet& packet = (*packets)[i];
+    packet.ok = false;
+    if (packet.max_len < packet.len + rtp_auth_tag_len_) {
+      ++failures;
+      last_err = err_status_bad_param;
+      continue;
+    }
+    int len = packet.len;
+    int err = srtp_protect(session_, packet.data, &len);
+    if (err != err_status_ok) {
+      uint32 ssrc;
+      if (GetRtpSsrc(packet.data, packet.len, &ssrc)) {
+        srtp_stat_->AddProtectRtpResult(ssrc, err);
+      }
+      ++failures;
+      last_err = err;
+      continue;
+    }
+    packet.len = len;
+    packet.ok = true;
+    last_protected = &packet;
+  }
+
+  // The RTP header stays in the clear, so the sequence number can still be
+  // read after protection.
+  if (last_protected) {
+    GetRtpSeqNum(last_protected->data, last_protected->len,
+                 &last_send_seq_num_);
+  }
+  if (failures) {
+    LOG(LS_WARNING) << "Failed to protect " << failures << " of "
+                    << packets->size() << " SRTP packets, last err="
+                    << last_err << ", last seqnum=" << last_send_seq_num_;
+  }
+  return failures == 0;
+}
+
+bool SrtpSession::UnprotectRtpBatch(std::vector<SrtpFilter::Packet>* packets) {
+  if (!session_) {
+    LOG(LS_WARNING) << "Failed to unprotect SRTP packets: no SRTP Session";
+    MarkFailed(packets);
+    return false;
+  }
+
+  int failures = 0;
+  int last_err = err_status_ok;
+  for (size_t i = 0; i < packets->size(); ++i) {
+    SrtpFilter::Packet& packet = (*packets)[i];
+    int len = packet.len;
+    int err = srtp_unprotect(session_, packet.data, &len);
+    packet.ok = (err == err_status_ok);
+    if (!packet.ok) {
+      uint32 ssrc;
+      if (GetRtpSsrc(packet.data, packet.len, &ssrc)) {
+        srtp_stat_->AddUnprotectRtpResult(ssrc, err);
+      }
+      ++failures;
+      last_err = err;
+      continue;
+    }
+    packet.len = len;
+  }
+
+  if (failures) {
+    LOG(LS_WARNING) << "Failed to unprotect " << failures << " of "
+                    << packets->size() << " SRTP packets, last err="
+                    << last_err;
+  }
+  return failures == 0;
+}
+
 void SrtpSession::set_signal_silent_time(uint32 signal_silent_time_in_ms) {
   srtp_stat_->set_signal_silent_time(signal_silent_time_in_ms);
 }
@@ -693,6 +801,16 @@ bool SrtpSession::UnprotectRtcp(void* data, int in_len, int* out_len) {
   return SrtpNotAvailable(__FUNCTION__);
 }
 
+bool SrtpSession::ProtectRtpBatch(std::vector<SrtpFilter::Packet>* packets) {
+  MarkFailed(packets);
+  return SrtpNotAvailable(__FUNCTION__);
+}
+
+bool SrtpSession::UnprotectRtpBatch(std::vector<SrtpFilter::Packet>* packets) {
+  MarkFailed(packets);
+  return SrtpNotAvailable(__FUNCTION__);
+}
+
 void SrtpSession::set_signal_silent_time(uint32 signal_silent_time) {
   // Do nothing.
 }
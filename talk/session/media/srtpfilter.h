@@ -84,6 +84,19 @@ class SrtpFilter {
     ERROR_REPLAY,
   };
 
+  // An RTP packet for the batch calls. |data| is transformed in place, |len|
+  // is the packet length before and after, and |max_len| is the size of the
+  // buffer at |data|. |ok| reports whether this packet succeeded.
+  struct Packet {
+    Packet() : data(NULL), len(0), max_len(0), ok(false) {}
+    Packet(void* data, int len, int max_len)
+        : data(data), len(len), max_len(max_len), ok(false) {}
+    void* data;
+    int len;
+    int max_len;
+    bool ok;
+  };
+
   SrtpFilter();
   ~SrtpFilter();
 
@@ -126,6 +139,12 @@ class SrtpFilter {
   // If an HMAC is used, this will decrease the packet size.
   bool UnprotectRtp(void* data, int in_len, int* out_len);
   bool UnprotectRtcp(void* data, int in_len, int* out_len);
+  // Like ProtectRtp/UnprotectRtp, for a burst of packets, which may be from
+  // any number of SSRCs. The state checks and bookkeeping are done once per
+  // call rather than once per packet. Returns true if every packet succeeded;
+  // a failed packet does not stop the rest from being processed.
+  bool ProtectRtpBatch(std::vector<Packet>* packets);
+  bool UnprotectRtpBatch(std::vector<Packet>* packets);
 
   // Update the silent threshold (in ms) for signaling errors.
   void set_signal_silent_time(uint32 signal_silent_time_in_ms);
@@ -204,6 +223,9 @@ class SrtpSession {
   // If an HMAC is used, this will decrease the packet size.
   bool UnprotectRtp(void* data, int in_len, int* out_len);
   bool UnprotectRtcp(void* data, int in_len, int* out_len);
+  // Batch versions of the above; see SrtpFilter.
+  bool ProtectRtpBatch(std::vector<SrtpFilter::Packet>* packets);
+  bool UnprotectRtpBatch(std::vector<SrtpFilter::Packet>* packets);
 
   // Update the silent threshold (in ms) for signaling errors.
   void set_signal_silent_time(uint32 signal_silent_time_in_ms);
@@ -27,7 +27,9 @@
 
 #include "talk/base/byteorder.h"
 #include "talk/base/gunit.h"
+#include "talk/base/logging.h"
 #include "talk/base/thread.h"
+#include "talk/base/timeutils.h"
 #include "talk/media/base/cryptoparams.h"
 #include "talk/media/base/fakertp.h"
 #include "talk/p2p/base/sessiondescription.h"
@@ -362,6 +364,130 @@ TEST_F(SrtpFilterTest, TestProtect_AES_CM_128_HMAC_SHA1_32) {
   TestProtectUnprotect(CS_AES_CM_128_HMAC_SHA1_32, CS_AES_CM_128_HMAC_SHA1_32);
 }
 
+// Test that a burst of packets from several SSRCs can be protected and
+// unprotected in one call each, and that a packet whose buffer is too small
+// fails without affecting the others.
+TEST_F(SrtpFilterTest, TestProtectUnprotectBatch) {
+  TestSetParams(MakeVector(kTestCryptoParams1),
+                MakeVector(kTestCryptoParams2));
+  const int kPackets = 6;
+  const int rtp_len = sizeof(kPcmuFrame);
+  char buffers[kPackets][sizeof(kPcmuFrame) + 10];
+  char originals[kPackets][sizeof(kPcmuFrame)];
+  std::vector<cricket::SrtpFilter::Packet> packets;
+  for (int i = 0; i < kPackets; ++i) {
+    memcpy(buffers[i], kPcmuFrame, rtp_len);
+    talk_base::SetBE16(buffers[i] + 2, static_cast<uint16>(i / 3 + 1));
+    talk_base::SetBE32(buffers[i] + 8, static_cast<uint32>(i % 3 + 1));
+    memcpy(originals[i], buffers[i], rtp_len);
+    packets.push_back(cricket::SrtpFilter::Packet(buffers[i], rtp_len,
+                                                  sizeof(buffers[i])));
+  }
+  // No room for the auth tag.
+  packets[4].max_len = rtp_len;
+
+  EXPECT_FALSE(f1_.ProtectRtpBatch(&packets));
+  for (int i = 0; i < kPackets; ++i) {
+    EXPECT_EQ(i != 4, packets[i].ok) << i;
+    if (packets[i].ok) {
+      EXPECT_EQ(rtp_len + rtp_auth_tag_len(CS_AES_CM_128_HMAC_SHA1_80),
+                packets[i].len);
+      EXPECT_NE(0, memcmp(buffers[i], originals[i], rtp_len));
+    }
+  }
+
+  packets.erase(packets.begin() + 4);
+  EXPECT_TRUE(f2_.UnprotectRtpBatch(&packets));
+  for (int i = 0; i < kPackets; ++i) {
+    if (i == 4)
+      continue;
+    const cricket::SrtpFilter::Packet& packet = packets[i < 4 ? i : i - 1];
+    EXPECT_TRUE(packet.ok);
+    EXPECT_EQ(rtp_len, packet.len);
+    EXPECT_EQ(0, memcmp(buffers[i], originals[i], rtp_len));
+  }
+
+  // Replaying the burst is rejected packet by packet.
+  for (size_t i = 0; i < packets.size(); ++i) {
+    packets[i].len += rtp_auth_tag_len(CS_AES_CM_128_HMAC_SHA1_80);
+  }
+  EXPECT_FALSE(f2_.UnprotectRtpBatch(&packets));
+  for (size_t i = 0; i < packets.size(); ++i) {
+    EXPECT_FALSE(packets[i].ok);
+  }
+}
+
+// Test that the batch calls fail cleanly before SRTP is active.
+TEST_F(SrtpFilterTest, TestBatchNotActive) {
+  char buffer[sizeof(kPcmuFrame) + 10];
+  memcpy(buffer, kPcmuFrame, sizeof(kPcmuFrame));
+  std::vector<cricket::SrtpFilter::Packet> packets;
+  packets.push_back(cricket::SrtpFilter::Packet(buffer, sizeof(kPcmuFrame),
+                                                sizeof(buffer)));
+  packets[0].ok = true;
+  EXPECT_FALSE(f1_.ProtectRtpBatch(&packets));
+  EXPECT_FALSE(packets[0].ok);
+  EXPECT_FALSE(f1_.UnprotectRtpBatch(&packets));
+  EXPECT_FALSE(packets[0].ok);
+}
+
+// Measures packets per second for bursts of 64 packets spread over 1, 8 and
+// 64 SSRCs, handled one packet per call and one burst per call.
+TEST_F(SrtpFilterTest, DISABLED_BatchBenchmark) {
+  TestSetParams(MakeVector(kTestCryptoParams1),
+                MakeVector(kTestCryptoParams2));
+  const int kBurst = 64;
+  const int kBursts = 2000;
+  const int kSsrcCounts[] = { 1, 8, 64 };
+  const int rtp_len = sizeof(kPcmuFrame);
+  char buffers[kBurst][sizeof(kPcmuFrame) + 10];
+  std::vector<cricket::SrtpFilter::Packet> packets(kBurst);
+  uint16 sequence = 0;
+  for (int s = 0; s < ARRAY_SIZE(kSsrcCounts); ++s) {
+    for (int batch = 0; batch < 2; ++batch) {
+      uint64 protect_ns = 0, unprotect_ns = 0;
+      for (int b = 0; b < kBursts; ++b) {
+        for (int i = 0; i < kBurst; ++i) {
+          memcpy(buffers[i], kPcmuFrame, rtp_len);
+          talk_base::SetBE16(buffers[i] + 2, ++sequence);
+          talk_base::SetBE32(buffers[i] + 8, 1000 + i % kSsrcCounts[s]);
+          packets[i] = cricket::SrtpFilter::Packet(buffers[i], rtp_len,
+                                                   sizeof(buffers[i]));
+        }
+        bool ok = true;
+        uint64 start = talk_base::TimeNanos();
+        if (batch) {
+          ok = f1_.ProtectRtpBatch(&packets);
+        } else {
+          for (int i = 0; i < kBurst; ++i) {
+            ok &= f1_.ProtectRtp(packets[i].data, packets[i].len,
+                                 packets[i].max_len, &packets[i].len);
+          }
+        }
+        protect_ns += talk_base::TimeNanos() - start;
+        start = talk_base::TimeNanos();
+        if (batch) {
+          ok &= f2_.UnprotectRtpBatch(&packets);
+        } else {
+          for (int i = 0; i < kBurst; ++i) {
+            ok &= f2_.UnprotectRtp(packets[i].data, packets[i].len,
+                                   &packets[i].len);
+          }
+        }
+        unprotect_ns += talk_base::TimeNanos() - start;
+        ASSERT_TRUE(ok);
+      }
+      const double kPackets = kBurst * kBursts;
+      LOG(LS_INFO) << kSsrcCounts[s] << " SSRCs, "
+                   << (batch ? "batched" : "per packet") << ": "
+                   << static_cast<int>(kPackets * 1e9 / protect_ns)
+                   << " protects/s, "
+                   << static_cast<int>(kPackets * 1e9 / unprotect_ns)
+                   << " unprotects/s";
+    }
+  }
+}
+
 // Test that we can change encryption parameters.
 TEST_F(SrtpFilterTest, TestChangeParameters) {
   std::vector<CryptoParams> offer(MakeVector(kTestCryptoParams1));